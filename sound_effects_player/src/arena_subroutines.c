@@ -0,0 +1,271 @@
+/*
+ * arena_subroutines.c
+ *
+ * Copyright © 2016 by John Sauter <John_Sauter@systemeyescomputerstore.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <gtk/gtk.h>
+#include "arena_subroutines.h"
+#include "sound_effects_player.h"
+#include "trace_ring_subroutines.h"
+
+/* The sounds and sequence items of a show, and their strings, are
+ * allocated in bulk.  Records are carved out of large blocks, one
+ * after another, so the records of a show are next to each other in
+ * memory and are freed all at once when the show is released.
+ *
+ * Every string is interned: it is stored once, however many records
+ * use it, and two interned strings with the same text have the same
+ * address.  Names stored in records can therefore be compared by
+ * comparing pointers.  Text from outside the show, such as a sound
+ * name in a GStreamer message, is converted by arena_lookup once, 
+ * after which it too can be compared by pointer.
+ *
+ * When the project is reloaded, the new show is read into a scratch
+ * arena.  The records that become part of the running show are moved
+ * into the show's arena and the rest are freed with the scratch arena.
+ * Strings are always interned in the show's string table, so the
+ * strings of the new show can be compared with those of the running 
+ * one.  Records and strings the reload removes from the show are not 
+ * freed until the show is released.  */
+
+/* The size of a block of records.  A larger record gets a block 
+ * of its own.  */
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+/* Records are aligned for any type they contain.  */
+#define ARENA_ALIGNMENT 16
+
+struct arena
+{
+  GSList *blocks;               /* most recent first */
+  gchar *next;                  /* free space in the current block */
+  gsize remaining;
+  gsize bytes_allocated;
+  gsize bytes_used;
+  guint record_count;
+};
+
+/* The persistent data used by the arena subroutines.  */
+struct arena_info
+{
+  struct arena show_arena;
+  struct arena scratch_arena;
+  gboolean scratch_active;
+
+  /* The interned strings: their text is kept in the string chunk,
+   * and the hash table holds each string once, as both key and
+   * value.  */
+  GStringChunk *string_chunk;
+  GHashTable *string_table;
+  gsize string_bytes;
+};
+
+/* Set up an empty string table.  */
+static void
+create_string_table (struct arena_info *arena_data)
+{
+  arena_data->string_chunk = g_string_chunk_new (ARENA_BLOCK_SIZE);
+  arena_data->string_table = g_hash_table_new (g_str_hash, g_str_equal);
+  arena_data->string_bytes = 0;
+  return;
+}
+
+/* Free all the blocks of an arena, leaving it empty.  */
+static void
+clear_arena (struct arena *the_arena)
+{
+  g_slist_free_full (the_arena->blocks, g_free);
+  memset (the_arena, 0, sizeof (struct arena));
+  return;
+}
+
+/* Initialize the arenas.  */
+void *
+arena_init (GApplication * app)
+{
+  struct arena_info *arena_data;
+
+  arena_data = g_malloc0 (sizeof (struct arena_info));
+  create_string_table (arena_data);
+  return arena_data;
+}
+
+/* Allocate memory from an arena.  */
+static gpointer
+allocate (struct arena *the_arena, gsize size)
+{
+  gpointer record;
+  gsize block_size;
+
+  size = (size + ARENA_ALIGNMENT - 1) & ~((gsize) ARENA_ALIGNMENT - 1);
+  if (size > the_arena->remaining)
+    {
+      block_size = MAX (size, ARENA_BLOCK_SIZE);
+      the_arena->next = g_malloc (block_size);
+      the_arena->remaining = block_size;
+      the_arena->blocks = g_slist_prepend (the_arena->blocks, the_arena->next);
+      the_arena->bytes_allocated = the_arena->bytes_allocated + block_size;
+    }
+
+  record = the_arena->next;
+  the_arena->next = the_arena->next + size;
+  the_arena->remaining = the_arena->remaining - size;
+  the_arena->bytes_used = the_arena->bytes_used + size;
+  the_arena->record_count = the_arena->record_count + 1;
+
+  memset (record, 0, size);
+  return record;
+}
+
+/* Allocate a record for the show, or for the show being read to
+ * compare with it.  */
+gpointer
+arena_new_record (gsize size, GApplication * app)
+{
+  struct arena_info *arena_data;
+
+  arena_data = sep_get_arena_data (app);
+  if (arena_data->scratch_active)
+    return allocate (&arena_data->scratch_arena, size);
+  return allocate (&arena_data->show_arena, size);
+}
+
+/* Find or add the interned copy of a string.  */
+gchar *
+arena_intern (const gchar * text, GApplication * app)
+{
+  struct arena_info *arena_data;
+  gchar *interned_text;
+  gsize length;
+
+  if (text == NULL)
+    return NULL;
+
+  arena_data = sep_get_arena_data (app);
+  interned_text = g_hash_table_lookup (arena_data->string_table, text);
+  if (interned_text != NULL)
+    return interned_text;
+
+  length = strlen (text);
+  interned_text =
+    g_string_chunk_insert_len (arena_data->string_chunk, text, length);
+  g_hash_table_add (arena_data->string_table, interned_text);
+  arena_data->string_bytes = arena_data->string_bytes + length + 1;
+  return interned_text;
+}
+
+/* Find the interned copy of a string, if there is one.  */
+gchar *
+arena_lookup (const gchar * text, GApplication * app)
+{
+  struct arena_info *arena_data;
+
+  if (text == NULL)
+    return NULL;
+
+  arena_data = sep_get_arena_data (app);
+  return g_hash_table_lookup (arena_data->string_table, text);
+}
+
+/* Start reading a show into the scratch arena.  */
+void
+arena_begin_scratch (GApplication * app)
+{
+  struct arena_info *arena_data;
+
+  arena_data = sep_get_arena_data (app);
+  clear_arena (&arena_data->scratch_arena);
+  arena_data->scratch_active = TRUE;
+  return;
+}
+
+/* Move a record from the scratch arena into the show.  Nothing may
+ * point to the record except the caller.  */
+gpointer
+arena_keep_record (gpointer record, gsize size, GApplication * app)
+{
+  struct arena_info *arena_data;
+  gpointer kept_record;
+
+  arena_data = sep_get_arena_data (app);
+  kept_record = allocate (&arena_data->show_arena, size);
+  memcpy (kept_record, record, size);
+  return kept_record;
+}
+
+/* Done with the scratch arena.  */
+void
+arena_end_scratch (GApplication * app)
+{
+  struct arena_info *arena_data;
+
+  arena_data = sep_get_arena_data (app);
+  if (TRACE_RING_ENABLED (trace_arena))
+    {
+      trace_ring_record (trace_arena, "Freeing %u scratch records in %"
+                         G_GSIZE_FORMAT " bytes.",
+                         arena_data->scratch_arena.record_count,
+                         arena_data->scratch_arena.bytes_allocated);
+    }
+  clear_arena (&arena_data->scratch_arena);
+  arena_data->scratch_active = FALSE;
+  return;
+}
+
+/* Free the show.  Nothing may point into it any longer.  */
+void
+arena_release_show (GApplication * app)
+{
+  struct arena_info *arena_data;
+
+  arena_data = sep_get_arena_data (app);
+  if (TRACE_RING_ENABLED (trace_arena))
+    {
+      trace_ring_record (trace_arena, "Freeing %u show records in %"
+                         G_GSIZE_FORMAT " of %" G_GSIZE_FORMAT
+                         " bytes, %u strings in %" G_GSIZE_FORMAT " bytes.",
+                         arena_data->show_arena.record_count,
+                         arena_data->show_arena.bytes_used,
+                         arena_data->show_arena.bytes_allocated,
+                         g_hash_table_size (arena_data->string_table),
+                         arena_data->string_bytes);
+    }
+
+  clear_arena (&arena_data->show_arena);
+  g_hash_table_destroy (arena_data->string_table);
+  g_string_chunk_free (arena_data->string_chunk);
+  create_string_table (arena_data);
+  return;
+}
+
+/* Print the arena's memory use.  */
+void
+arena_print_statistics (GApplication * app)
+{
+  struct arena_info *arena_data;
+
+  arena_data = sep_get_arena_data (app);
+  g_print ("Show storage: %u records in %" G_GSIZE_FORMAT " of %"
+           G_GSIZE_FORMAT " bytes, %u strings in %" G_GSIZE_FORMAT
+           " bytes.\n", arena_data->show_arena.record_count,
+           arena_data->show_arena.bytes_used,
+           arena_data->show_arena.bytes_allocated,
+           g_hash_table_size (arena_data->string_table),
+           arena_data->string_bytes);
+  return;
+}
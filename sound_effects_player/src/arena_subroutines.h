@@ -0,0 +1,56 @@
+/*
+ * arena_subroutines.h
+ *
+ * Copyright © 2016 by John Sauter <John_Sauter@systemeyescomputerstore.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtk/gtk.h>
+
+/* Subroutines defined in arena_subroutines.c */
+
+/* Initialize the storage for the show's sounds and sequence items.  */
+void *arena_init (GApplication * app);
+
+/* Allocate a zeroed record, such as a sound or sequence item.
+ * It lives until the show is released.  */
+gpointer arena_new_record (gsize size, GApplication * app);
+
+/* Find the interned copy of a string, adding it if necessary.
+ * Interned strings with the same text have the same address.  */
+gchar *arena_intern (const gchar * text, GApplication * app);
+
+/* Find the interned copy of a string without adding it.  Returns NULL
+ * if no part of the show uses that text.  */
+gchar *arena_lookup (const gchar * text, GApplication * app);
+
+/* Allocate records in a scratch arena, for a show being read to 
+ * compare with the running one.  */
+void arena_begin_scratch (GApplication * app);
+
+/* Move a record from the scratch arena to the show's arena.  Returns
+ * the record's new address.  */
+gpointer arena_keep_record (gpointer record, gsize size, GApplication * app);
+
+/* Free the scratch arena and everything in it that was not kept.  */
+void arena_end_scratch (GApplication * app);
+
+/* Free all the records and strings of the show.  */
+void arena_release_show (GApplication * app);
+
+/* Print the arena's memory use.  */
+void arena_print_statistics (GApplication * app);
+
+/* End of file arena_subroutines.h */
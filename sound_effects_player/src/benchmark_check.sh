@@ -0,0 +1,65 @@
+#!/bin/sh
+# benchmark_check.sh, run by "make check".
+#
+# Run the benchmarks, collect their results in benchmark_results.txt,
+# and compare them with the baseline in benchmark_baseline.txt.
+# Each result is a line: name, value, and whether higher or lower
+# is better.  A result worse than its baseline by more than
+# BENCHMARK_TOLERANCE percent, 25 by default, fails the check.
+# Results with no baseline are reported but cannot fail, and if there
+# is no baseline file at all the check is reported as skipped rather
+# than passed.  Lines of the baseline starting with # describe the
+# machine it was measured on.  To make the latest results the
+# baseline, run "make benchmark-baseline" on the reference machine.
+
+srcdir=${srcdir:-.}
+results=benchmark_results.txt
+baseline=${BENCHMARK_BASELINE:-$srcdir/benchmark_baseline.txt}
+tolerance=${BENCHMARK_TOLERANCE:-25}
+output=benchmark_output.txt
+
+: > $output
+status=0
+
+./parse_net_benchmark 1 >> $output || status=1
+./parse_xml_benchmark 10000 >> $output || status=1
+# The pipeline benchmark exits with 77 if our plugins are not found;
+# that skips its results without failing the check.
+./pipeline_benchmark >> $output
+case $? in
+  0|77) ;;
+  *) status=1 ;;
+esac
+cat $output
+
+sed -n 's/^benchmark: //p' $output > $results
+
+if [ ! -f "$baseline" ]; then
+  echo "No baseline in $baseline; the results are in $results."
+  echo "Nothing was compared, so no regression could be found."
+  if [ $status -eq 0 ]; then
+    exit 77
+  fi
+  exit $status
+fi
+
+sed -n 's/^# *//p' "$baseline"
+
+awk -v tolerance="$tolerance" '
+  /^#/ { next }
+  FNR == NR { base[$1] = $2; next }
+  {
+    if (!($1 in base)) { printf "%-44s %12s  (new)\n", $1, $2; next }
+    change = (base[$1] == 0) ? 0 : 100 * ($2 - base[$1]) / base[$1]
+    worse = ($3 == "higher") ? -change : change
+    verdict = (worse > tolerance) ? "REGRESSION" : "ok"
+    if (worse > tolerance) failed = 1
+    printf "%-44s %12s  baseline %12s  %+6.1f%%  %s\n", \
+      $1, $2, base[$1], change, verdict
+  }
+  END { exit failed }
+' "$baseline" $results || status=1
+
+exit $status
+
+# End of file benchmark_check.sh
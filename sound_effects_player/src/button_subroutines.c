@@ -17,7 +17,9 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "button_subroutines.h"
+#include "display_subroutines.h"
 #include "gstreamer_subroutines.h"
+#include "latency_subroutines.h"
 #include "sound_effects_player.h"
 #include "sound_subroutines.h"
 #include "sound_structure.h"
@@ -106,7 +108,9 @@ button_start_clicked (GtkButton * button, gpointer user_data)
   app = sep_get_application_from_widget (user_data);
   cluster_widget = sep_get_cluster_from_widget (user_data);
   cluster_number = sep_get_cluster_number (cluster_widget);
+  latency_trigger (g_get_monotonic_time () * 1000, app);
   sequence_cluster_start (cluster_number, app);
+  latency_trigger_done (app);
 
   return;
 }
@@ -132,35 +136,11 @@ button_stop_clicked (GtkButton * button, gpointer user_data)
 void
 button_set_cluster_playing (struct sound_info *sound_data, GApplication * app)
 {
-  GtkButton *start_button = NULL;
-  GtkWidget *parent_container;
-  GList *children_list = NULL;
-  const gchar *child_name = NULL;
-
-  /* Find the start button and set its text to "Playing...". 
-   * The start button will be a child of the cluster, and will be named
-   * "start_button".  */
-  parent_container = sound_data->cluster_widget;
-
-  /* It is possible, though unlikely, that the sound will no longer
+  /* Set the text of the cluster's Start button to "Playing...".
+   * It is possible, though unlikely, that the sound will no longer
    * be in a cluster.  */
-  if (parent_container != NULL)
-    {
-      children_list =
-        gtk_container_get_children (GTK_CONTAINER (parent_container));
-      while (children_list != NULL)
-        {
-          child_name = gtk_widget_get_name (children_list->data);
-          if (g_strcmp0 (child_name, "start_button") == 0)
-            {
-              start_button = children_list->data;
-              break;
-            }
-          children_list = children_list->next;
-        }
-      g_list_free (children_list);
-      gtk_button_set_label (start_button, "Playing...");
-    }
+  display_set_cluster_start_label (sound_data->cluster_widget,
+                                   (gchar *) "Playing...", app);
 
   return;
 }
@@ -170,35 +150,11 @@ void
 button_set_cluster_releasing (struct sound_info *sound_data,
                               GApplication * app)
 {
-  GtkButton *start_button = NULL;
-  GtkWidget *parent_container;
-  GList *children_list = NULL;
-  const gchar *child_name = NULL;
-
-  /* Find the start button and set its text to "Releasing...". 
-   * The start button will be a child of the cluster, and will be named
-   * "start_button".  */
-  parent_container = sound_data->cluster_widget;
-
-  /* It is possible, though unlikely, that the sound will no longer
+  /* Set the text of the cluster's Start button to "Releasing...".
+   * It is possible, though unlikely, that the sound will no longer
    * be in a cluster.  */
-  if (parent_container != NULL)
-    {
-      children_list =
-        gtk_container_get_children (GTK_CONTAINER (parent_container));
-      while (children_list != NULL)
-        {
-          child_name = gtk_widget_get_name (children_list->data);
-          if (g_strcmp0 (child_name, "start_button") == 0)
-            {
-              start_button = children_list->data;
-              break;
-            }
-          children_list = children_list->next;
-        }
-      g_list_free (children_list);
-      gtk_button_set_label (start_button, "Releasing...");
-    }
+  display_set_cluster_start_label (sound_data->cluster_widget,
+                                   (gchar *) "Releasing...", app);
 
   return;
 }
@@ -207,35 +163,11 @@ button_set_cluster_releasing (struct sound_info *sound_data,
 void
 button_reset_cluster (struct sound_info *sound_data, GApplication * app)
 {
-  GtkButton *start_button = NULL;
-  GtkWidget *parent_container;
-  GList *children_list = NULL;
-  const gchar *child_name = NULL;
-
-  /* Find the start button and set its text back to "Start". 
-   * The start button will be a child of the cluster, and will be named
-   * "start_button".  */
-  parent_container = sound_data->cluster_widget;
-
-  /* It is possible, though unlikely, that the sound will no longer
+  /* Set the text of the cluster's Start button back to "Start".
+   * It is possible, though unlikely, that the sound will no longer
    * be in a cluster.  */
-  if (parent_container != NULL)
-    {
-      children_list =
-        gtk_container_get_children (GTK_CONTAINER (parent_container));
-      while (children_list != NULL)
-        {
-          child_name = gtk_widget_get_name (children_list->data);
-          if (g_strcmp0 (child_name, "start_button") == 0)
-            {
-              start_button = children_list->data;
-              break;
-            }
-          children_list = children_list->next;
-        }
-      g_list_free (children_list);
-      gtk_button_set_label (start_button, "Start");
-    }
+  display_set_cluster_start_label (sound_data->cluster_widget,
+                                   (gchar *) "Start", app);
 
   return;
 }
@@ -245,32 +177,17 @@ button_reset_cluster (struct sound_info *sound_data, GApplication * app)
 void
 button_volume_changed (GtkButton * button, gpointer user_data)
 {
-  GtkLabel *volume_label = NULL;
-  GtkWidget *parent_container;
-  GList *children_list = NULL;
-  const gchar *child_name = NULL;
+  GtkLabel *volume_label;
+  GApplication *app;
   struct sound_info *sound_data;
   GstBin *bin_element;
   GstElement *volume_element;
   gdouble new_value;
-  gchar *value_string;
-
-  /* Find the volume label associated with this volume widget.
-   * It will be a child of this widget's parent. */
-  parent_container = gtk_widget_get_parent (GTK_WIDGET (button));
-  children_list =
-    gtk_container_get_children (GTK_CONTAINER (parent_container));
-  while (children_list != NULL)
-    {
-      child_name = gtk_widget_get_name (children_list->data);
-      if (g_strcmp0 (child_name, "volume_label") == 0)
-        {
-          volume_label = children_list->data;
-          break;
-        }
-      children_list = children_list->next;
-    }
-  g_list_free (children_list);
+  gchar value_string[32];
+
+  /* Find the volume label of this cluster.  */
+  app = sep_get_application_from_widget (user_data);
+  volume_label = display_get_volume_label (user_data, app);
 
   if (volume_label != NULL)
     {
@@ -293,9 +210,9 @@ button_volume_changed (GtkButton * button, gpointer user_data)
       g_object_set (volume_element, "volume", new_value, NULL);
 
       /* Update the text in the volume label. */
-      value_string = g_strdup_printf ("Vol%4.0f%%", new_value * 100.0);
+      g_snprintf (value_string, sizeof (value_string), "Vol%4.0f%%",
+                  new_value * 100.0);
       gtk_label_set_text (volume_label, value_string);
-      g_free (value_string);
 
     }
 
@@ -306,32 +223,17 @@ button_volume_changed (GtkButton * button, gpointer user_data)
 void
 button_pan_changed (GtkButton * button, gpointer user_data)
 {
-  GtkLabel *pan_label = NULL;
-  GtkWidget *parent_container;
-  GList *children_list = NULL;
-  const gchar *child_name = NULL;
+  GtkLabel *pan_label;
+  GApplication *app;
   struct sound_info *sound_data;
   GstBin *bin_element;
   GstElement *pan_element;
   gdouble new_value;
-  gchar *value_string;
-
-  /* Find the pan label associated with this pan widget.
-   * It will be a child of this widget's parent. */
-  parent_container = gtk_widget_get_parent (GTK_WIDGET (button));
-  children_list =
-    gtk_container_get_children (GTK_CONTAINER (parent_container));
-  while (children_list != NULL)
-    {
-      child_name = gtk_widget_get_name (children_list->data);
-      if (g_strcmp0 (child_name, "pan_label") == 0)
-        {
-          pan_label = children_list->data;
-          break;
-        }
-      children_list = children_list->next;
-    }
-  g_list_free (children_list);
+  gchar value_string[32];
+
+  /* Find the pan label of this cluster.  */
+  app = sep_get_application_from_widget (user_data);
+  pan_label = display_get_pan_label (user_data, app);
 
   if (pan_label != NULL)
     {
@@ -362,13 +264,12 @@ button_pan_changed (GtkButton * button, gpointer user_data)
       else
         {
           if (new_value < 0.0)
-            value_string =
-              g_strdup_printf ("Left %4.0f%%", -(new_value * 100.0));
+            g_snprintf (value_string, sizeof (value_string), "Left %4.0f%%",
+                        -(new_value * 100.0));
           else
-            value_string =
-              g_strdup_printf ("Right%4.0f%%", new_value * 100.0);
+            g_snprintf (value_string, sizeof (value_string), "Right%4.0f%%",
+                        new_value * 100.0);
           gtk_label_set_text (pan_label, value_string);
-          g_free (value_string);
         }
     }
 
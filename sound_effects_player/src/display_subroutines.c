@@ -17,89 +17,648 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <math.h>
+#include <string.h>
 #include <gtk/gtk.h>
 #include "display_subroutines.h"
 #include "sound_effects_player.h"
+#include "sound_structure.h"
+#include "sound_subroutines.h"
+#include "telemetry_subroutines.h"
 
-/* Update the VU meter. */
+/* The number of clusters the user interface can have.  */
+#define DISPLAY_CLUSTER_COUNT 16
+
+/* The VU meter has a bar for each channel, with as many as this many
+ * channels.  Its scale runs from the floor, in decibels, to 0 dB, 
+ * changing color at the warning and danger levels.  */
+#define DISPLAY_VU_CHANNEL_COUNT 8
+#define DISPLAY_VU_FLOOR_DB -60.0
+#define DISPLAY_VU_WARNING_DB -12.0
+#define DISPLAY_VU_DANGER_DB -3.0
+
+/* The decaying peak markers of the cluster meters fall this many
+ * decibels each second.  */
+#define DISPLAY_METER_FALL_DB 20.0
+
+/* The envelope publishes a sound's peak and RMS levels, in that order,
+ * in units of 2^-24 of full scale; see its meter-snapshot property.  */
+#define DISPLAY_METER_PEAK 0
+#define DISPLAY_METER_RMS 1
+#define DISPLAY_METER_SCALE 16777216.0
+
+/* The longest status message shown for a running sound.  */
+#define DISPLAY_STATUS_SIZE 256
+
+/* One bar of the VU meter.  The levels are fractions of the width
+ * of the meter: the RMS level is the length of the bar, the peak level
+ * is a line, and the decaying peak is held as a marker.  The positions
+ * are those most recently sent to be drawn, in pixels, so only the
+ * part of the bar between the old and new positions is redrawn.  */
+struct display_VU_bar
+{
+  gdouble rms_level;
+  gdouble peak_level;
+  gdouble decay_level;
+  gint rms_x;
+  gint peak_x;
+  gint decay_x;
+};
+
+/* The widgets in a cluster which are changed as the show runs.  */
+struct display_cluster
+{
+  GtkWidget *cluster_widget;
+  GtkLabel *title;
+  GtkButton *start_button;
+  GtkLabel *volume_label;
+  GtkLabel *pan_label;
+  GtkWidget *meter;
+  struct display_VU_bar meter_bar;
+  struct sound_info *meter_sound;       /* The sound the meter shows */
+};
+
+/* The persistent data used by the display subroutines: the widgets
+ * that are updated while the show runs, found once, when the user
+ * interface is loaded, so updating them needs no searching.  The
+ * levels and status they show are recorded as the show runs, and
+ * copied to the widgets once per frame.  */
+struct display_info
+{
+  struct display_cluster clusters[DISPLAY_CLUSTER_COUNT];
+  GtkWidget *VU_meter;
+  struct display_VU_bar VU_bars[DISPLAY_VU_CHANNEL_COUNT];
+  gint VU_channel_count;
+  gint VU_width;
+  gboolean VU_changed;          /* A level has arrived since the last frame */
+  struct sound_info *status_sound;      /* The sound whose status is shown */
+  gchar *status_text;           /* The text shown with its times */
+  gboolean status_displaying;   /* The status is in the status bar */
+  guint status_message_id;      /* The status bar message showing it */
+  gchar status_string[DISPLAY_STATUS_SIZE];     /* The text of that message */
+  gint64 frame_time;            /* When the last frame was drawn */
+  GtkWidget *top_level_window;  /* The window whose frames we refresh */
+  guint tick_id;                /* The frame tick, or 0 if idle */
+};
+
+/* Find the widgets within a cluster by their names.  */
+static void
+index_cluster_widget (GtkWidget * widget, gpointer user_data)
+{
+  struct display_cluster *cluster_data = user_data;
+  const gchar *widget_name;
+
+  widget_name = gtk_widget_get_name (widget);
+  if (g_strcmp0 (widget_name, "title") == 0)
+    cluster_data->title = GTK_LABEL (widget);
+  else if (g_strcmp0 (widget_name, "start_button") == 0)
+    cluster_data->start_button = GTK_BUTTON (widget);
+  else if (g_strcmp0 (widget_name, "volume_label") == 0)
+    cluster_data->volume_label = GTK_LABEL (widget);
+  else if (g_strcmp0 (widget_name, "pan_label") == 0)
+    cluster_data->pan_label = GTK_LABEL (widget);
+  else if (g_strcmp0 (widget_name, "cluster_meter") == 0)
+    cluster_data->meter = widget;
+  else if (GTK_IS_CONTAINER (widget))
+    gtk_container_foreach (GTK_CONTAINER (widget), index_cluster_widget,
+                           cluster_data);
+  return;
+}
+
+static gboolean display_frame_tick (GtkWidget * widget,
+                                    GdkFrameClock * frame_clock,
+                                    gpointer user_data);
+
+/* Something the display shows has changed.  Refresh the widgets at
+ * each frame until nothing is playing and nothing is changing.  */
+static void
+start_frame_tick (struct display_info *display_data)
+{
+  if ((display_data->tick_id != 0)
+      || (display_data->top_level_window == NULL))
+    return;
+
+  /* The first frame has no previous frame to measure from.  */
+  display_data->frame_time = 0;
+  display_data->tick_id =
+    gtk_widget_add_tick_callback (display_data->top_level_window,
+                                  display_frame_tick, display_data, NULL);
+  return;
+}
+
+/* Find the widgets which are updated as the show runs.  This is done
+ * once, when the user interface is loaded.  */
+void *
+display_init (GtkBuilder * builder, GApplication * app)
+{
+  struct display_info *display_data;
+  struct display_cluster *cluster_data;
+  gchar *cluster_name;
+  gint cluster_number;
+
+  display_data = g_malloc0 (sizeof (struct display_info));
+
+  /* Each cluster has a name identifying it.  */
+  for (cluster_number = 0; cluster_number < DISPLAY_CLUSTER_COUNT;
+       cluster_number++)
+    {
+      cluster_data = &display_data->clusters[cluster_number];
+      cluster_name = g_strdup_printf ("cluster_%2.2d", cluster_number);
+      cluster_data->cluster_widget =
+        GTK_WIDGET (gtk_builder_get_object (builder, cluster_name));
+      g_free (cluster_name);
+      if (cluster_data->cluster_widget != NULL)
+        gtk_container_foreach (GTK_CONTAINER (cluster_data->cluster_widget),
+                               index_cluster_widget, cluster_data);
+    }
+
+  display_data->VU_meter =
+    GTK_WIDGET (gtk_builder_get_object (builder, "VU_meter"));
+
+  /* The widgets are refreshed at each frame of the window, but only
+   * while a sound is playing or a level or status has changed; the
+   * frame tick is added when that starts and removes itself when the
+   * display is idle again.  */
+  display_data->top_level_window =
+    GTK_WIDGET (gtk_builder_get_object (builder, "top_level_window"));
+
+  return display_data;
+}
+
+/* Find the index entry for a cluster.  */
+static struct display_cluster *
+find_cluster (GtkWidget * cluster_widget, struct display_info *display_data)
+{
+  gint cluster_number;
+
+  if (cluster_widget == NULL)
+    return NULL;
+
+  for (cluster_number = 0; cluster_number < DISPLAY_CLUSTER_COUNT;
+       cluster_number++)
+    {
+      if (display_data->clusters[cluster_number].cluster_widget ==
+          cluster_widget)
+        return &display_data->clusters[cluster_number];
+    }
+  return NULL;
+}
+
+/* Find a cluster, given its number.  */
+GtkWidget *
+display_get_cluster (guint cluster_number, GApplication * app)
+{
+  struct display_info *display_data;
+
+  display_data = sep_get_display_data (app);
+  if (cluster_number >= DISPLAY_CLUSTER_COUNT)
+    return NULL;
+  return display_data->clusters[cluster_number].cluster_widget;
+}
+
+/* Set the title displayed in a cluster.  */
+void
+display_set_cluster_title (guint cluster_number, gchar * title_text,
+                           GApplication * app)
+{
+  struct display_info *display_data;
+  GtkLabel *title_label;
+
+  display_data = sep_get_display_data (app);
+  if (cluster_number >= DISPLAY_CLUSTER_COUNT)
+    return;
+  title_label = display_data->clusters[cluster_number].title;
+  if (title_label != NULL)
+    gtk_label_set_label (title_label, title_text);
+  return;
+}
+
+/* Set the sound whose levels a cluster's meter shows, when a sound is
+ * placed in the cluster, or clear it, when the sound leaves.  The meter
+ * is refreshed from this sound alone, without searching the sounds.  */
+void
+display_set_cluster_sound (guint cluster_number,
+                           struct sound_info *sound_data, GApplication * app)
+{
+  struct display_info *display_data;
+
+  display_data = sep_get_display_data (app);
+  if (cluster_number >= DISPLAY_CLUSTER_COUNT)
+    return;
+  display_data->clusters[cluster_number].meter_sound = sound_data;
+  if (sound_data != NULL)
+    start_frame_tick (display_data);
+  return;
+}
+
+/* Set the text of a cluster's Start button.  */
+void
+display_set_cluster_start_label (GtkWidget * cluster_widget,
+                                 gchar * label_text, GApplication * app)
+{
+  struct display_cluster *cluster_data;
+
+  cluster_data = find_cluster (cluster_widget, sep_get_display_data (app));
+  if ((cluster_data != NULL) && (cluster_data->start_button != NULL))
+    gtk_button_set_label (cluster_data->start_button, label_text);
+  return;
+}
+
+/* Find the label that shows the volume of a cluster.  */
+GtkLabel *
+display_get_volume_label (GtkWidget * cluster_widget, GApplication * app)
+{
+  struct display_cluster *cluster_data;
+
+  cluster_data = find_cluster (cluster_widget, sep_get_display_data (app));
+  if (cluster_data == NULL)
+    return NULL;
+  return cluster_data->volume_label;
+}
+
+/* Find the label that shows the pan position of a cluster.  */
+GtkLabel *
+display_get_pan_label (GtkWidget * cluster_widget, GApplication * app)
+{
+  struct display_cluster *cluster_data;
+
+  cluster_data = find_cluster (cluster_widget, sep_get_display_data (app));
+  if (cluster_data == NULL)
+    return NULL;
+  return cluster_data->pan_label;
+}
+
+/* Convert a level in decibels to a fraction of the meter's width.  */
+static gdouble
+VU_fraction (gdouble level_dB)
+{
+  if (!(level_dB > DISPLAY_VU_FLOOR_DB))
+    return 0.0;
+  if (level_dB >= 0.0)
+    return 1.0;
+  return (level_dB - DISPLAY_VU_FLOOR_DB) / -DISPLAY_VU_FLOOR_DB;
+}
+
+/* Draw a level bar: the RMS level is a bar, green up to the warning
+ * level, yellow up to the danger level, and red above that.  The peak
+ * level is a thin line, and the decaying peak a bright marker.  */
+static void
+draw_level_bar (cairo_t * cr, struct display_VU_bar *bar_data, gint bar_top,
+                gint bar_height, gint width)
+{
+  gdouble warning_x, danger_x, rms_x;
+
+  warning_x = VU_fraction (DISPLAY_VU_WARNING_DB) * width;
+  danger_x = VU_fraction (DISPLAY_VU_DANGER_DB) * width;
+  bar_data->rms_x = bar_data->rms_level * width;
+  bar_data->peak_x = bar_data->peak_level * width;
+  bar_data->decay_x = bar_data->decay_level * width;
+
+  rms_x = bar_data->rms_x;
+  cairo_set_source_rgb (cr, 0.0, 0.8, 0.0);
+  cairo_rectangle (cr, 0, bar_top + 1, MIN (rms_x, warning_x),
+                   bar_height - 2);
+  cairo_fill (cr);
+  if (rms_x > warning_x)
+    {
+      cairo_set_source_rgb (cr, 0.9, 0.9, 0.0);
+      cairo_rectangle (cr, warning_x, bar_top + 1,
+                       MIN (rms_x, danger_x) - warning_x, bar_height - 2);
+      cairo_fill (cr);
+    }
+  if (rms_x > danger_x)
+    {
+      cairo_set_source_rgb (cr, 0.9, 0.0, 0.0);
+      cairo_rectangle (cr, danger_x, bar_top + 1, rms_x - danger_x,
+                       bar_height - 2);
+      cairo_fill (cr);
+    }
+
+  if (bar_data->peak_x > 0)
+    {
+      cairo_set_source_rgb (cr, 0.6, 0.6, 0.6);
+      cairo_rectangle (cr, bar_data->peak_x - 1, bar_top + 1, 1,
+                       bar_height - 2);
+      cairo_fill (cr);
+    }
+  if (bar_data->decay_x > 0)
+    {
+      cairo_set_source_rgb (cr, 1.0, 1.0, 1.0);
+      cairo_rectangle (cr, bar_data->decay_x - 2, bar_top + 1, 2,
+                       bar_height - 2);
+      cairo_fill (cr);
+    }
+  return;
+}
+
+/* Update the VU meter.  The new levels are only recorded; they are
+ * drawn at the next frame, so several level messages between frames
+ * cost one redraw.  */
 void
 display_update_vu_meter (gpointer * user_data, gint channel,
                          gdouble new_value, gdouble peak_dB, gdouble decay_dB)
 {
-  GtkWidget *common_area;
-  GList *children_list;
-  const gchar *child_name;
-  GtkWidget *VU_meter = NULL;
-  gint VU_level;
-  gint64 VU_led_number;
-  GtkLabel *VU_lamp;
-  GtkBox *channel_row = NULL;
-  gint64 channel_number;
-
-  common_area = sep_get_common_area (G_APPLICATION (user_data));
-
-  /* Find the VU meter in the common area. */
-  children_list = gtk_container_get_children (GTK_CONTAINER (common_area));
-  while (children_list != NULL)
+  struct display_info *display_data;
+  struct display_VU_bar *bar_data;
+
+  display_data = sep_get_display_data (G_APPLICATION (user_data));
+  if ((display_data == NULL) || (display_data->VU_meter == NULL)
+      || (channel < 0) || (channel >= DISPLAY_VU_CHANNEL_COUNT))
+    return;
+  bar_data = &display_data->VU_bars[channel];
+
+  /* The RMS value arrives as a fraction of full scale.  */
+  bar_data->rms_level = VU_fraction (20.0 * log10 (new_value));
+  bar_data->peak_level = VU_fraction (peak_dB);
+  bar_data->decay_level = VU_fraction (decay_dB);
+  display_data->VU_changed = TRUE;
+  start_frame_tick (display_data);
+  if (channel >= display_data->VU_channel_count)
     {
-      child_name = gtk_widget_get_name (children_list->data);
-      if (g_ascii_strcasecmp (child_name, "VU_meter") == 0)
-        {
-          VU_meter = children_list->data;
-          break;
-        }
-      children_list = children_list->next;
+      /* A new channel changes the whole meter.  */
+      display_data->VU_channel_count = channel + 1;
+      display_data->VU_width = -1;
     }
-  g_list_free (children_list);
+  return;
+}
 
-  if (VU_meter == NULL)
-    return;
+/* Redraw the parts of the VU meter whose levels have changed since
+ * the last frame.  Return TRUE if any had.  */
+static gboolean
+refresh_vu_meter (struct display_info *display_data)
+{
+  struct display_VU_bar *bar_data;
+  gint width, height;
+  gint rms_x, peak_x, decay_x;
+  gint low_x, high_x;
+  gint bar_top, bar_height;
+  gint channel;
+
+  if (!display_data->VU_changed)
+    return FALSE;
+  display_data->VU_changed = FALSE;
 
-  /* Within the VU_meter box is a box for each channel.  Find the box
-   * for this channel. */
-  children_list = gtk_container_get_children (GTK_CONTAINER (VU_meter));
-  while (children_list != NULL)
+  /* A new size changes the whole meter.  */
+  width = gtk_widget_get_allocated_width (display_data->VU_meter);
+  height = gtk_widget_get_allocated_height (display_data->VU_meter);
+  if (width != display_data->VU_width)
     {
-      channel_row = GTK_BOX (children_list->data);
-      child_name = gtk_widget_get_name (GTK_WIDGET (channel_row));
-      channel_number = g_ascii_strtoll (child_name, NULL, 10);
-      if (channel_number == channel)
-        break;
-      children_list = children_list->next;
+      display_data->VU_width = width;
+      gtk_widget_queue_draw (display_data->VU_meter);
+      return TRUE;
     }
-  g_list_free (children_list);
-  if (channel_row == NULL)
-    return;
 
-  /* Within the VU_meter's channel box is a bunch of labels, each with a name
-   * indicating its position on the line.  Light those to the left
-   * of the desired value. */
-  VU_level = new_value * 50.0;
-  if (VU_level > 50)
-    VU_level = 50;
-  if (VU_level < 1)
-    VU_level = 0;
-  children_list = gtk_container_get_children (GTK_CONTAINER (channel_row));
-  while (children_list != NULL)
+  bar_height = height / display_data->VU_channel_count;
+  for (channel = 0; channel < display_data->VU_channel_count; channel++)
+    {
+      bar_data = &display_data->VU_bars[channel];
+      rms_x = bar_data->rms_level * width;
+      peak_x = bar_data->peak_level * width;
+      decay_x = bar_data->decay_level * width;
+      if ((rms_x == bar_data->rms_x) && (peak_x == bar_data->peak_x)
+          && (decay_x == bar_data->decay_x))
+        continue;
+
+      /* Redraw from the leftmost to the rightmost of the old and new
+       * positions, allowing for the width of the markers.  */
+      low_x = MIN (rms_x, bar_data->rms_x);
+      low_x = MIN (low_x, MIN (peak_x, bar_data->peak_x));
+      low_x = MIN (low_x, MIN (decay_x, bar_data->decay_x));
+      high_x = MAX (rms_x, bar_data->rms_x);
+      high_x = MAX (high_x, MAX (peak_x, bar_data->peak_x));
+      high_x = MAX (high_x, MAX (decay_x, bar_data->decay_x));
+      bar_data->rms_x = rms_x;
+      bar_data->peak_x = peak_x;
+      bar_data->decay_x = decay_x;
+
+      bar_top = channel * bar_height;
+      gtk_widget_queue_draw_area (display_data->VU_meter, low_x - 2,
+                                  bar_top, high_x - low_x + 4, bar_height);
+    }
+  return TRUE;
+}
+
+/* Draw the VU meter.  This is called by GTK when it paints the window,
+ * with cairo clipped to the part that needs drawing.  */
+gboolean
+display_draw_vu_meter (GtkWidget * widget, cairo_t * cr, gpointer user_data)
+{
+  GApplication *app;
+  struct display_info *display_data;
+  struct display_VU_bar *bar_data;
+  GdkRectangle clip;
+  gint width, height;
+  gint bar_top, bar_height;
+  gint channel;
+
+  app = sep_get_application_from_widget (user_data);
+  display_data = sep_get_display_data (app);
+  width = gtk_widget_get_allocated_width (widget);
+  height = gtk_widget_get_allocated_height (widget);
+
+  /* The background.  */
+  cairo_set_source_rgb (cr, 0.1, 0.1, 0.1);
+  cairo_paint (cr);
+  if ((display_data == NULL) || (display_data->VU_channel_count == 0))
+    return TRUE;
+
+  display_data->VU_width = width;
+  if (!gdk_cairo_get_clip_rectangle (cr, &clip))
+    return TRUE;
+
+  bar_height = height / display_data->VU_channel_count;
+  for (channel = 0; channel < display_data->VU_channel_count; channel++)
+    {
+      bar_top = channel * bar_height;
+      if ((bar_top >= clip.y + clip.height)
+          || (bar_top + bar_height <= clip.y))
+        continue;
+      bar_data = &display_data->VU_bars[channel];
+
+      draw_level_bar (cr, bar_data, bar_top, bar_height, width);
+    }
+
+  return TRUE;
+}
+
+/* Convert a level published by an envelope to decibels.  */
+static gdouble
+meter_dB (guint level_units)
+{
+  if (level_units == 0)
+    return DISPLAY_VU_FLOOR_DB;
+  return 20.0 * log10 (level_units / DISPLAY_METER_SCALE);
+}
+
+/* Refresh the cluster meters from the levels the sounds in the
+ * clusters have published since the last frame.  The snapshots are
+ * read without a lock; only meters whose bars have moved are redrawn.
+ * Return TRUE if a cluster holds a sound or a meter has yet to fall
+ * to the floor.  */
+static gboolean
+refresh_cluster_meters (struct display_info *display_data,
+                        gdouble interval, GApplication * app)
+{
+  struct display_cluster *cluster_data;
+  struct display_VU_bar *bar_data;
+  struct sound_info *sound_data;
+  gdouble peak_dB, rms_dB;
+  gdouble decay_level;
+  guint peak_units, rms_units;
+  gint cluster_number, width;
+  gboolean active;
+
+  active = FALSE;
+  for (cluster_number = 0; cluster_number < DISPLAY_CLUSTER_COUNT;
+       cluster_number++)
     {
-      VU_lamp = GTK_LABEL (children_list->data);
-      child_name = gtk_widget_get_name (GTK_WIDGET (VU_lamp));
-      VU_led_number = g_ascii_strtoll (child_name, NULL, 10);
-      if (VU_led_number < VU_level)
+      cluster_data = &display_data->clusters[cluster_number];
+      if (cluster_data->meter == NULL)
+        continue;
+
+      /* Read the levels of the sound playing in the cluster.  The peak
+       * is cleared as it is read, so the envelope starts a new one.  */
+      peak_dB = DISPLAY_VU_FLOOR_DB;
+      rms_dB = DISPLAY_VU_FLOOR_DB;
+      sound_data = cluster_data->meter_sound;
+      if ((sound_data != NULL) && sound_data->running)
         {
-          gtk_label_set_text (VU_lamp, "*");
+          peak_units =
+            g_atomic_int_and (&sound_data->meter_snapshot
+                              [DISPLAY_METER_PEAK], 0);
+          rms_units =
+            g_atomic_int_get (&sound_data->meter_snapshot
+                              [DISPLAY_METER_RMS]);
+          peak_dB = meter_dB (peak_units);
+          rms_dB = meter_dB (rms_units);
         }
-      else
+      if (sound_data != NULL)
+        active = TRUE;
+
+      bar_data = &cluster_data->meter_bar;
+      bar_data->rms_level = VU_fraction (rms_dB);
+      bar_data->peak_level = VU_fraction (peak_dB);
+
+      /* The decaying peak holds the highest peak, falling steadily.  */
+      decay_level =
+        bar_data->decay_level -
+        (DISPLAY_METER_FALL_DB * interval / -DISPLAY_VU_FLOOR_DB);
+      bar_data->decay_level = MAX (decay_level, bar_data->peak_level);
+      bar_data->decay_level = MAX (bar_data->decay_level, 0.0);
+      if (bar_data->decay_level > 0.0)
+        active = TRUE;
+
+      width = gtk_widget_get_allocated_width (cluster_data->meter);
+      if (((gint) (bar_data->rms_level * width) != bar_data->rms_x)
+          || ((gint) (bar_data->peak_level * width) != bar_data->peak_x)
+          || ((gint) (bar_data->decay_level * width) != bar_data->decay_x))
         {
-          gtk_label_set_text (VU_lamp, " ");
+          gtk_widget_queue_draw (cluster_data->meter);
+          active = TRUE;
         }
-      children_list = children_list->next;
     }
-  g_list_free (children_list);
 
+  return active;
+}
+
+/* Refresh the status bar message showing the status of a running
+ * sound.  The message is replaced only when its text has changed.  */
+static void
+refresh_operator_status (struct display_info *display_data,
+                         GApplication * app)
+{
+  gchar status_string[DISPLAY_STATUS_SIZE];
+  gchar elapsed_time[G_ASCII_DTOSTR_BUF_SIZE];
+  gchar remaining_time[G_ASCII_DTOSTR_BUF_SIZE];
+
+  if (display_data->status_sound == NULL)
+    return;
+
+  /* Prepend the elapsed time to the text, and append the remaining
+   * time.  */
+  sound_format_time (sound_get_elapsed_time
+                     (display_data->status_sound, app), elapsed_time,
+                     G_ASCII_DTOSTR_BUF_SIZE);
+  sound_format_time (sound_get_remaining_time
+                     (display_data->status_sound, app), remaining_time,
+                     G_ASCII_DTOSTR_BUF_SIZE);
+  g_snprintf (status_string, DISPLAY_STATUS_SIZE, "%s %s (%s)", elapsed_time,
+              display_data->status_text, remaining_time);
+
+  if (display_data->status_displaying
+      && (strcmp (status_string, display_data->status_string) == 0))
+    return;
+
+  if (display_data->status_displaying)
+    display_remove_message (display_data->status_message_id, app);
+  display_data->status_message_id = display_show_message (status_string, app);
+  display_data->status_displaying = TRUE;
+  g_strlcpy (display_data->status_string, status_string, DISPLAY_STATUS_SIZE);
   return;
 }
 
+/* GTK is about to draw a frame of the window.  Copy the latest levels
+ * and status to the widgets, marking only those that have changed to
+ * be redrawn.  Once nothing is playing and nothing has changed, stop
+ * until something does.  */
+static gboolean
+display_frame_tick (GtkWidget * widget, GdkFrameClock * frame_clock,
+                    gpointer user_data)
+{
+  struct display_info *display_data = user_data;
+  GApplication *app;
+  gint64 frame_time;
+  gdouble interval;
+  gboolean active;
+
+  app = sep_get_application_from_widget (widget);
+  frame_time = gdk_frame_clock_get_frame_time (frame_clock);
+  interval = 0.0;
+  if (display_data->frame_time != 0)
+    interval = (gdouble) (frame_time - display_data->frame_time) / 1e6;
+  interval = CLAMP (interval, 0.0, 1.0);
+  display_data->frame_time = frame_time;
+
+  active = FALSE;
+  if ((display_data->VU_meter != NULL) && refresh_vu_meter (display_data))
+    active = TRUE;
+  if (refresh_cluster_meters (display_data, interval, app))
+    active = TRUE;
+  if (display_data->status_sound != NULL)
+    {
+      refresh_operator_status (display_data, app);
+      active = TRUE;
+    }
+
+  if (!active)
+    {
+      display_data->tick_id = 0;
+      return G_SOURCE_REMOVE;
+    }
+  return G_SOURCE_CONTINUE;
+}
+
+/* Draw a cluster's meter; called by GTK.  */
+gboolean
+display_draw_cluster_meter (GtkWidget * widget, cairo_t * cr,
+                            gpointer user_data)
+{
+  GApplication *app;
+  struct display_cluster *cluster_data;
+
+  app = sep_get_application_from_widget (user_data);
+  cairo_set_source_rgb (cr, 0.1, 0.1, 0.1);
+  cairo_paint (cr);
+  cluster_data = find_cluster (user_data, sep_get_display_data (app));
+  if (cluster_data == NULL)
+    return TRUE;
+
+  draw_level_bar (cr, &cluster_data->meter_bar, 0,
+                  gtk_widget_get_allocated_height (widget),
+                  gtk_widget_get_allocated_width (widget));
+  return TRUE;
+}
+
 /* Show the user a message.  The return value is a message ID, which
  * can be used to remove the message.  */
 guint
@@ -140,6 +699,37 @@ display_remove_message (guint message_id, GApplication * app)
   return;
 }
 
+/* Show the status of a running sound in the status bar: its elapsed
+ * time, the text, and its remaining time, kept current as it plays.  */
+void
+display_set_operator_status (struct sound_info *sound_effect,
+                             gchar * status_text, GApplication * app)
+{
+  struct display_info *display_data;
+
+  display_data = sep_get_display_data (app);
+  display_data->status_sound = sound_effect;
+  display_data->status_text = status_text;
+  if (sound_effect != NULL)
+    start_frame_tick (display_data);
+  return;
+}
+
+/* Stop showing the status of a sound.  */
+void
+display_clear_operator_status (GApplication * app)
+{
+  struct display_info *display_data;
+
+  display_data = sep_get_display_data (app);
+  if (display_data->status_displaying)
+    display_remove_message (display_data->status_message_id, app);
+  display_data->status_displaying = FALSE;
+  display_data->status_sound = NULL;
+  display_data->status_text = NULL;
+  return;
+}
+
 /* Display a message to the operator.  */
 void
 display_set_operator_text (gchar * text_to_display, GApplication *app)
@@ -152,6 +742,9 @@ display_set_operator_text (gchar * text_to_display, GApplication *app)
   /* Set the text.  */
   gtk_label_set_text (text_label, text_to_display);
 
+  /* Tell the remote controllers.  */
+  telemetry_operator_text (text_to_display, app);
+
   return;
 }
 
@@ -166,6 +759,7 @@ display_clear_operator_text (GApplication *app)
 
   /* Clear the text.  */
   gtk_label_set_text (text_label, (gchar *) "");
+  telemetry_operator_text ((gchar *) "", app);
 
   return;
 }
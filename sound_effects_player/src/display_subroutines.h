@@ -21,16 +21,55 @@
 #define DISPLAY_SUBROUTINES_H
 
 #include <gtk/gtk.h>
+#include "sound_structure.h"
 
 /* Subroutines defined in display_subroutines.c */
+
+/* Find the widgets that are updated as the show runs.  */
+void *display_init (GtkBuilder * builder, GApplication * app);
+
+GtkWidget *display_get_cluster (guint cluster_number, GApplication * app);
+
+void display_set_cluster_title (guint cluster_number, gchar * title_text,
+                                GApplication * app);
+
+/* Set the sound whose levels a cluster's meter shows, or NULL.  */
+void display_set_cluster_sound (guint cluster_number,
+                                struct sound_info *sound_data,
+                                GApplication * app);
+
+void display_set_cluster_start_label (GtkWidget * cluster_widget,
+                                      gchar * label_text,
+                                      GApplication * app);
+
+GtkLabel *display_get_volume_label (GtkWidget * cluster_widget,
+                                    GApplication * app);
+
+GtkLabel *display_get_pan_label (GtkWidget * cluster_widget,
+                                 GApplication * app);
+
 void display_update_vu_meter (gpointer * user_data, gint channel,
                               gdouble new_value, gdouble peak_dB,
                               gdouble decay_dB);
 
+/* Draw the VU meter; called by GTK.  */
+gboolean display_draw_vu_meter (GtkWidget * widget, cairo_t * cr,
+                                gpointer user_data);
+
+/* Draw the level meter of a cluster; called by GTK.  */
+gboolean display_draw_cluster_meter (GtkWidget * widget, cairo_t * cr,
+                                     gpointer user_data);
+
 guint display_show_message (gchar * message_text, GApplication * app);
 
 void display_remove_message (guint message_id, GApplication * app);
 
+/* Show the status of a running sound, kept current as it plays.  */
+void display_set_operator_status (struct sound_info *sound_effect,
+                                  gchar * status_text, GApplication * app);
+
+void display_clear_operator_status (GApplication * app);
+
 void display_set_operator_text (gchar * text_to_display, GApplication * app);
 
 void display_clear_operator_text (GApplication * app);
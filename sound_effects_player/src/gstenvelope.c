@@ -116,7 +116,8 @@ enum
   PROP_RELEASE_DURATION_TIME,
   PROP_VOLUME,
   PROP_AUTOSTART,
-  PROP_SOUND_NAME
+  PROP_SOUND_NAME,
+  PROP_METER_SNAPSHOT
 };
 
 /* For simplicity, we handle only floating point samples.
@@ -171,6 +172,9 @@ static gboolean envelope_src_event_handler (GstBaseTransform * trans,
                                             GstEvent * event);
 
 static gdouble compute_volume (GstEnvelope * self, GstClockTime timestamp);
+static void publish_meter (GstEnvelope * self, gdouble peak,
+                           gdouble sum_of_squares, gint sample_count);
+static void report_latency (GstEnvelope * self, gdouble peak_gain);
 
 /* Before each transform of input to output, do this.  */
 static void
@@ -280,6 +284,8 @@ envelope_before_transform (GstBaseTransform * base, GstBuffer * buffer)
       self->pausing = FALSE;
       self->base_time = timestamp;
       self->pause_time = 0;
+      self->trigger_time = self->pending_trigger_time;
+      self->pending_trigger_time = 0;
       GST_DEBUG_OBJECT (self,
                         "starting envelope, base time set to %"
                         GST_TIME_FORMAT ".", GST_TIME_ARGS (self->base_time));
@@ -303,6 +309,8 @@ envelope_transform_ip (GstBaseTransform * base, GstBuffer * outbuf)
   gint frame_count;
   gint frame_counter, channel_counter;
   gdouble volume_val;
+  gdouble sample;
+  gdouble peak, sum_of_squares, peak_gain;
   gdouble *src64;
   gfloat *src32;
   GstClockTimeDiff interval = gst_util_uint64_scale_int (1, GST_SECOND, rate);
@@ -365,15 +373,20 @@ envelope_transform_ip (GstBaseTransform * base, GstBuffer * outbuf)
                     rate, width, channel_count, frame_count);
 
   /* For each frame, compute the volume adjustment and apply it to
-   * each sample.  There will be one sample per channel.  */
+   * each sample.  There will be one sample per channel.  While we have
+   * the samples, measure their level for the meters.  */
 
   src64 = (gdouble *) map.data;
   src32 = (gfloat *) map.data;
+  peak = 0.0;
+  sum_of_squares = 0.0;
+  peak_gain = 0.0;
   for (frame_counter = 0; frame_counter < frame_count; frame_counter++)
     {
       /* Compute the volume at this time step.  */
       volume_val =
         compute_volume (self, ts - self->base_time - self->pause_time);
+      peak_gain = MAX (peak_gain, volume_val);
 
       /* Apply that volume to each channel.  */
       for (channel_counter = 0; channel_counter < channel_count;
@@ -387,25 +400,32 @@ envelope_transform_ip (GstBaseTransform * base, GstBuffer * outbuf)
             case 64:
               GST_LOG_OBJECT (self, "sample with value %g becomes %g.",
                               *src64, volume_val * *src64);
-              *src64 = volume_val * *src64;
+              sample = volume_val * *src64;
+              *src64 = sample;
               src64++;
               break;
 
             case 32:
               GST_LOG_OBJECT (self, "sample with value %g becomes %g.",
                               *src32, volume_val * *src32);
-              *src32 = volume_val * *src32;
+              sample = volume_val * *src32;
+              *src32 = sample;
               src32++;
               break;
 
             default:
               GST_ELEMENT_ERROR (self, STREAM, FORMAT, (NULL),
                                  ("unknown sample width: %d.", width));
+              sample = 0.0;
               break;
             }
+          peak = MAX (peak, fabs (sample));
+          sum_of_squares = sum_of_squares + (sample * sample);
         }
       ts = ts + interval;
     }
+  publish_meter (self, peak, sum_of_squares, frame_count * channel_count);
+  report_latency (self, peak_gain);
 
   /* We are done with the buffer.  */
   gst_buffer_unmap (outbuf, &map);
@@ -427,6 +447,8 @@ envelope_transform (GstBaseTransform * base, GstBuffer * inbuf,
   gdouble *src64, *dst64;
   gfloat *src32, *dst32;
   gdouble volume_val;
+  gdouble sample;
+  gdouble peak, sum_of_squares, peak_gain;
   gint frame_counter, channel_counter;
   GstClockTime ts;
   gint rate = GST_AUDIO_INFO_RATE (&filter->info);
@@ -532,12 +554,16 @@ envelope_transform (GstBaseTransform * base, GstBuffer * inbuf,
   dst32 = (gfloat *) dstmap.data;
 
   GST_DEBUG_OBJECT (self, "copy %d values.", frame_count * channel_count);
+  peak = 0.0;
+  sum_of_squares = 0.0;
+  peak_gain = 0.0;
   for (frame_counter = 0; frame_counter < frame_count; frame_counter++)
     {
 
       /* Compute the volume at this time step.  */
       volume_val =
         compute_volume (self, ts - self->base_time - self->pause_time);
+      peak_gain = MAX (peak_gain, volume_val);
 
       /* Apply that volume to each channel.  */
       for (channel_counter = 0; channel_counter < channel_count;
@@ -551,7 +577,8 @@ envelope_transform (GstBaseTransform * base, GstBuffer * inbuf,
             case 64:
               GST_LOG_OBJECT (self, "sample with value %g becomes %g.",
                               *src64, volume_val * *src64);
-              *dst64 = volume_val * *src64;
+              sample = volume_val * *src64;
+              *dst64 = sample;
               src64++;
               dst64++;
               break;
@@ -559,7 +586,8 @@ envelope_transform (GstBaseTransform * base, GstBuffer * inbuf,
             case 32:
               GST_LOG_OBJECT (self, "sample with value %g becomes %g.",
                               *src32, volume_val * *src32);
-              *dst32 = volume_val * *src32;
+              sample = volume_val * *src32;
+              *dst32 = sample;
               src32++;
               dst32++;
               break;
@@ -567,11 +595,16 @@ envelope_transform (GstBaseTransform * base, GstBuffer * inbuf,
             default:
               GST_ELEMENT_ERROR (self, STREAM, FORMAT, (NULL),
                                  ("unknown sample width: %d.", width));
+              sample = 0.0;
               break;
             }
+          peak = MAX (peak, fabs (sample));
+          sum_of_squares = sum_of_squares + (sample * sample);
         }
       ts = ts + interval;
     }
+  publish_meter (self, peak, sum_of_squares, frame_count * channel_count);
+  report_latency (self, peak_gain);
 
   /* We are done with the buffers.  */
   gst_buffer_unmap (outbuf, &dstmap);
@@ -579,6 +612,68 @@ envelope_transform (GstBaseTransform * base, GstBuffer * inbuf,
   return GST_FLOW_OK;
 }
 
+/* If a command started the sound and this is the first buffer the
+ * envelope has let through, tell the application how long that took.  */
+static void
+report_latency (GstEnvelope * self, gdouble peak_gain)
+{
+  GstStructure *structure;
+  GstMessage *message;
+
+  if ((self->trigger_time == 0) || (peak_gain <= 0.0))
+    return;
+
+  structure =
+    gst_structure_new ((gchar *) "latency", (gchar *) "stage",
+                       G_TYPE_STRING, "envelope", (gchar *) "trigger-time",
+                       G_TYPE_INT64, self->trigger_time,
+                       (gchar *) "stage-time", G_TYPE_INT64,
+                       g_get_monotonic_time () * 1000, NULL);
+  self->trigger_time = 0;
+  message = gst_message_new_element (GST_OBJECT (self), structure);
+  if (!gst_element_post_message (GST_ELEMENT (self), message))
+    {
+      GST_DEBUG_OBJECT (self, "unable to post a latency message");
+    }
+
+  return;
+}
+
+/* Publish the level of the samples just shaped, for the meters.  The
+ * application reads the snapshot at display rate, from another
+ * thread, without taking any lock: the peak is raised to the highest
+ * value since the application last read and cleared it, and the RMS
+ * level is replaced by that of the latest buffer.  */
+static void
+publish_meter (GstEnvelope * self, gdouble peak, gdouble sum_of_squares,
+               gint sample_count)
+{
+  guint *snapshot;
+  guint peak_units, rms_units, old_peak_units;
+
+  snapshot = g_atomic_pointer_get (&self->meter_snapshot);
+  if ((snapshot == NULL) || (sample_count <= 0))
+    return;
+
+  peak_units = MIN (peak, ENVELOPE_METER_MAXIMUM) * ENVELOPE_METER_SCALE;
+  rms_units =
+    MIN (sqrt (sum_of_squares / sample_count), ENVELOPE_METER_MAXIMUM) *
+    ENVELOPE_METER_SCALE;
+
+  do
+    {
+      old_peak_units = g_atomic_int_get (&snapshot[ENVELOPE_METER_PEAK]);
+      if (old_peak_units >= peak_units)
+        break;
+    }
+  while (!g_atomic_int_compare_and_exchange
+         ((gint *) & snapshot[ENVELOPE_METER_PEAK], old_peak_units,
+          peak_units));
+  g_atomic_int_set (&snapshot[ENVELOPE_METER_RMS], rms_units);
+
+  return;
+}
+
 /* This enumeration type indicates a stage of envelope processing.  */
 enum envelope_stage
 { not_started, attack, decay, sustain, release, completed, pausing };
@@ -950,6 +1045,16 @@ gst_envelope_class_init (GstEnvelopeClass * klass)
   g_free (sound_name_default);
   sound_name_default = NULL;
 
+  param_spec =
+    g_param_spec_pointer ("meter-snapshot", "Meter_snapshot",
+                          "Where to publish the level of the shaped sound: "
+                          "two unsigned integers, the peak since it was "
+                          "last cleared and the latest RMS level, "
+                          "in units of 2^-24 of full scale",
+                          G_PARAM_READWRITE);
+  g_object_class_install_property (gobject_class, PROP_METER_SNAPSHOT,
+                                   param_spec);
+
   gst_element_class_set_static_metadata (element_class, "Envelope",
                                          "Filter/Effect/Audio",
                                          "Shape the sound using "
@@ -1012,6 +1117,9 @@ gst_envelope_init (GstEnvelope * self)
   self->pause_time = 0;
   self->pause_start_time = 0;
   self->last_volume = 0;
+  self->meter_snapshot = NULL;
+  self->pending_trigger_time = 0;
+  self->trigger_time = 0;
 }
 
 /* Set a property.  */
@@ -1115,6 +1223,12 @@ gst_envelope_set_property (GObject * object, guint prop_id,
       GST_OBJECT_UNLOCK (self);
       break;
 
+    case PROP_METER_SNAPSHOT:
+      /* The streaming thread reads this without the object lock.  */
+      g_atomic_pointer_set (&self->meter_snapshot,
+                            g_value_get_pointer (value));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1189,6 +1303,11 @@ gst_envelope_get_property (GObject * object, guint prop_id, GValue * value,
       GST_OBJECT_UNLOCK (self);
       break;
 
+    case PROP_METER_SNAPSHOT:
+      g_value_set_pointer (value, g_atomic_pointer_get
+                           (&self->meter_snapshot));
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1262,6 +1381,10 @@ envelope_src_event_handler (GstBaseTransform * trans, GstEvent * event)
           GST_INFO_OBJECT (self, "Received custom start event");
           GST_OBJECT_LOCK (self);
           self->started = TRUE;
+          self->pending_trigger_time = 0;
+          gst_structure_get_int64 (event_structure,
+                                   (gchar *) "trigger-time",
+                                   &self->pending_trigger_time);
           GST_OBJECT_UNLOCK (self);
         }
       if (g_strcmp0 (structure_name, (gchar *) "pause") == 0)
@@ -41,6 +41,12 @@ G_BEGIN_DECLS
   (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_ENVELOPE))
 #define GST_IS_ENVELOPE_CLASS(klass) \
   (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_ENVELOPE))
+/* The meter snapshot the envelope publishes its level in is two
+ * unsigned integers, in units of 2^-24 of full scale.  */
+#define ENVELOPE_METER_PEAK 0
+#define ENVELOPE_METER_RMS 1
+#define ENVELOPE_METER_SCALE 16777216.0
+#define ENVELOPE_METER_MAXIMUM 255.0
 typedef struct _GstEnvelope GstEnvelope;
 typedef struct _GstEnvelopeClass GstEnvelopeClass;
 
@@ -59,6 +65,7 @@ struct _GstEnvelope
   gdouble volume;
   gboolean autostart;
   gchar *sound_name;
+  guint *meter_snapshot;
 
   /* Locals */
   GstClockTimeDiff release_duration_time;
@@ -81,6 +88,10 @@ struct _GstEnvelope
   GstClockTime base_time;
   GstClockTimeDiff pause_time;
   GstClockTime pause_start_time;
+  gint64 pending_trigger_time;  /* From the start event, until the envelope
+                                 * starts running */
+  gint64 trigger_time;          /* From the start event, until the gain is
+                                 * first above zero */
 };
 
 struct _GstEnvelopeClass
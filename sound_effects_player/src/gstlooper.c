@@ -137,7 +137,11 @@ enum
   PROP_AUTOSTART,
   PROP_FILE_LOCATION,
   PROP_ELAPSED_TIME,
-  PROP_REMAINING_TIME
+  PROP_REMAINING_TIME,
+  PROP_POSITION,
+  PROP_ELAPSED,
+  PROP_REMAINING,
+  PROP_PROGRESS_INTERVAL
 };
 
 #define DEBUG_INIT \
@@ -157,6 +161,13 @@ static void gst_looper_set_property (GObject * object, guint prop_id,
                                      GParamSpec * pspec);
 /* Compute the remaining running time of the sound.  */
 static gint64 compute_remaining_time (GstLooper * object);
+/* Publish the position and times for other threads to read.  */
+static GstMessage *publish_readouts (GstLooper * self);
+/* Report how long a sound took to start draining.  */
+static GstMessage *report_latency (GstLooper * self);
+/* Read the position and times, without taking the interlock.  */
+static void read_readouts (GstLooper * self, gint64 * position,
+                           gint64 * elapsed, gint64 * remaining);
 /* fetch the value of a property */
 static void gst_looper_get_property (GObject * object, guint prop_id,
                                      GValue * value, GParamSpec * pspec);
@@ -202,11 +213,9 @@ static GstStateChangeReturn gst_looper_change_state (GstElement * element,
 
 /* local subroutines */
 
-/* convert a time in nanoseconds into a position in the buffer */
-static guint64 round_up_to_position (GstLooper * self,
-                                     guint64 specified_time);
-static guint64 round_down_to_position (GstLooper * self,
-                                       guint64 specified_time);
+/* convert between times in nanoseconds and frames */
+static guint64 frames_to_time (GstLooper * self, guint64 frame_count);
+static void compute_positions (GstLooper * self);
 
 /* Read the data chunks from a WAV file into the local buffer.  */
 static gboolean read_wav_file_data (GstLooper * self, guint64 max_position);
@@ -293,6 +302,34 @@ gst_looper_class_init (GstLooperClass * klass)
   g_object_class_install_property (gobject_class, PROP_REMAINING_TIME,
                                    param_spec);
 
+  param_spec =
+    g_param_spec_int64 ("position", "Position",
+                        "Position in the sound, in frames", 0, G_MAXINT64, 0,
+                        G_PARAM_READABLE);
+  g_object_class_install_property (gobject_class, PROP_POSITION, param_spec);
+
+  param_spec =
+    g_param_spec_int64 ("elapsed", "Elapsed",
+                        "Time in nanoseconds since the sound was started", 0,
+                        G_MAXINT64, 0, G_PARAM_READABLE);
+  g_object_class_install_property (gobject_class, PROP_ELAPSED, param_spec);
+
+  param_spec =
+    g_param_spec_int64 ("remaining", "Remaining",
+                        "Time in nanoseconds until the sound stops, "
+                        "or -1 if it will not stop", -1, G_MAXINT64, 0,
+                        G_PARAM_READABLE);
+  g_object_class_install_property (gobject_class, PROP_REMAINING, param_spec);
+
+  param_spec =
+    g_param_spec_uint64 ("progress-interval", "Progress_interval",
+                         "Post a looper_progress message each time "
+                         "this many nanoseconds of sound have been sent; "
+                         "0 means never", 0, G_MAXUINT64, 0,
+                         G_PARAM_READWRITE);
+  g_object_class_install_property (gobject_class, PROP_PROGRESS_INTERVAL,
+                                   param_spec);
+
   g_free (string_default);
   string_default = NULL;
 
@@ -341,9 +378,20 @@ gst_looper_init (GstLooper * self)
   self->local_buffer_drain_level = 0;
   self->pull_level = 0;
   self->local_buffer_size = 0;
-  self->bytes_per_ns = 0.0;
-  self->local_clock = 0;
-  self->elapsed_time = 0;
+  self->frame_size = 0;
+  self->loop_from_position = 0;
+  self->loop_to_position = 0;
+  self->max_position = 0;
+  self->start_position = 0;
+  self->clock_frames = 0;
+  self->elapsed_frames = 0;
+  self->progress_interval = 0;
+  self->progress_posted = 0;
+  self->readout_sequence = 0;
+  self->readout_position = 0;
+  self->readout_elapsed = 0;
+  self->readout_remaining = 0;
+  self->trigger_time = 0;
   self->width = 0;
   self->channel_count = 0;
   self->format = NULL;
@@ -683,6 +731,8 @@ gst_looper_push_data_downstream (GstPad * pad)
   GstBuffer *buffer;
   GstEvent *event;
   GstStructure *structure;
+  GstMessage *progress_message;
+  GstMessage *latency_message;
   GstMemory *memory_out;
   GstMapInfo memory_in_info, memory_out_info;
   gsize data_size;
@@ -822,8 +872,7 @@ gst_looper_push_data_downstream (GstPad * pad)
       GST_DEBUG_OBJECT (self, "sending silence downstream");
       /* Compute the number of bytes required to hold 40 milliseconds
        * of silence.  */
-      data_size =
-        self->width * self->data_rate * self->channel_count / (8000 / 40);
+      data_size = (self->data_rate / 25) * self->frame_size;
       /* Allocate that much memory, and place it in our output buffer.  */
       memory_out = gst_allocator_alloc (NULL, data_size, NULL);
       buffer = gst_buffer_new ();
@@ -831,14 +880,14 @@ gst_looper_push_data_downstream (GstPad * pad)
       /* Fill the buffer with the silence byte.  */
       gst_buffer_map (buffer, &memory_out_info, GST_MAP_WRITE);
       gst_buffer_memset (buffer, 0, self->silence_byte, memory_out_info.size);
-      /* Set the time stamps in the buffer.  */
-      GST_BUFFER_PTS (buffer) = self->local_clock;
-      GST_BUFFER_DTS (buffer) = self->local_clock;
+      /* Set the time stamps in the buffer from our clock, and advance
+       * it.  */
+      GST_BUFFER_PTS (buffer) = frames_to_time (self, self->clock_frames);
+      GST_BUFFER_DTS (buffer) = GST_BUFFER_PTS (buffer);
+      self->clock_frames =
+        self->clock_frames + (memory_out_info.size / self->frame_size);
       GST_BUFFER_DURATION (buffer) =
-        memory_out_info.size / self->bytes_per_ns;
-      /* Advance our clock.  */
-      self->local_clock =
-        self->local_clock + (memory_out_info.size / self->bytes_per_ns);
+        frames_to_time (self, self->clock_frames) - GST_BUFFER_PTS (buffer);
       GST_BUFFER_OFFSET (buffer) = self->local_buffer_drain_level;
       GST_BUFFER_OFFSET_END (buffer) =
         self->local_buffer_drain_level + memory_out_info.size;
@@ -847,9 +896,12 @@ gst_looper_push_data_downstream (GstPad * pad)
       GST_DEBUG_OBJECT (self,
                         "pushing %" G_GUINT64_FORMAT " bytes of silence.",
                         data_size);
+      progress_message = publish_readouts (self);
       /* We must unlock before we push, since pushing can cause a query to 
        * come back upstream on a different task before it completes.  */
       g_rec_mutex_unlock (&self->interlock);
+      if (progress_message != NULL)
+        gst_element_post_message (GST_ELEMENT (self), progress_message);
 
       flow_result = gst_pad_push (self->srcpad, buffer);
       if (flow_result != GST_FLOW_OK)
@@ -868,8 +920,7 @@ gst_looper_push_data_downstream (GstPad * pad)
   /* We send 40 milliseconds of buffer data at a time, but not more than
    * is left in our local buffer, and not more than we need to reach the
    * end of the loop, if we are looping.  */
-  data_size =
-    self->width * self->data_rate * self->channel_count / (8000 / 40);
+  data_size = (self->data_rate / 25) * self->frame_size;
   if (data_size > self->local_buffer_size - self->local_buffer_drain_level)
     {
       data_size = self->local_buffer_size - self->local_buffer_drain_level;
@@ -877,7 +928,7 @@ gst_looper_push_data_downstream (GstPad * pad)
 
   /* We are within the loop if this isn't our last time around.  */
   within_loop = FALSE;
-  loop_from_position = round_up_to_position (self, self->loop_from);
+  loop_from_position = self->loop_from_position;
   if ((!self->released) && (self->loop_from > 0)
       && (self->local_buffer_drain_level <= loop_from_position))
     {
@@ -890,17 +941,15 @@ gst_looper_push_data_downstream (GstPad * pad)
    */
   if (within_loop && (self->local_buffer_drain_level == loop_from_position))
     {
-      loop_to_position = round_down_to_position (self, self->loop_to);
+      loop_to_position = self->loop_to_position;
       self->local_buffer_drain_level = loop_to_position;
       self->loop_counter = self->loop_counter + 1;
       GST_DEBUG_OBJECT (self,
                         "loop counter %" G_GUINT64_FORMAT ", looping from %"
                         GST_TIME_FORMAT " to %" GST_TIME_FORMAT ".",
                         self->loop_counter,
-                        GST_TIME_ARGS (loop_from_position /
-                                       self->bytes_per_ns),
-                        GST_TIME_ARGS (loop_to_position /
-                                       self->bytes_per_ns));
+                        GST_TIME_ARGS (self->loop_from),
+                        GST_TIME_ARGS (self->loop_to));
     }
   /* If the loop is very short, we will output buffers of its length.  */
   if (within_loop
@@ -920,18 +969,21 @@ gst_looper_push_data_downstream (GstPad * pad)
                    memory_in_info.data + self->local_buffer_drain_level,
                    memory_out_info.size);
 
-  /* Set the time stamps in the output buffer.  */
-  GST_BUFFER_PTS (buffer) = self->local_clock;
-  GST_BUFFER_DTS (buffer) = self->local_clock;
-  GST_BUFFER_DURATION (buffer) = memory_out_info.size / self->bytes_per_ns;
-  /* Advance our clock.  */
-  self->local_clock =
-    self->local_clock + (memory_out_info.size / self->bytes_per_ns);
-  /* Keep track of the amount of time we have been sending sound.  */
-  self->elapsed_time =
-    self->elapsed_time + (memory_out_info.size / self->bytes_per_ns);
-  GST_DEBUG_OBJECT (self, "elapsed time is %" G_GUINT64_FORMAT ".",
-                    self->elapsed_time);
+  /* Set the time stamps in the output buffer from our clock, and
+   * advance it.  The duration is the difference between the times
+   * of the first frames of this buffer and the next, so the buffers
+   * tile the timeline exactly.  */
+  GST_BUFFER_PTS (buffer) = frames_to_time (self, self->clock_frames);
+  GST_BUFFER_DTS (buffer) = GST_BUFFER_PTS (buffer);
+  self->clock_frames =
+    self->clock_frames + (memory_out_info.size / self->frame_size);
+  GST_BUFFER_DURATION (buffer) =
+    frames_to_time (self, self->clock_frames) - GST_BUFFER_PTS (buffer);
+  /* Keep track of the amount of sound we have sent.  */
+  self->elapsed_frames =
+    self->elapsed_frames + (memory_out_info.size / self->frame_size);
+  GST_DEBUG_OBJECT (self, "elapsed frames are %" G_GUINT64_FORMAT ".",
+                    self->elapsed_frames);
   /* Note the byte offsets in the source.  */
   GST_BUFFER_OFFSET (buffer) = self->local_buffer_drain_level;
   GST_BUFFER_OFFSET_END (buffer) =
@@ -949,10 +1001,16 @@ gst_looper_push_data_downstream (GstPad * pad)
   /* we are finished with the new buffer and our local buffer */
   gst_buffer_unmap (buffer, &memory_out_info);
   gst_buffer_unmap (self->local_buffer, &memory_in_info);
+  progress_message = publish_readouts (self);
+  latency_message = report_latency (self);
 
   /* We must unlock before we push, since pushing can cause a query to come
    * back upstream on another task before it completes.  */
   g_rec_mutex_unlock (&self->interlock);
+  if (progress_message != NULL)
+    gst_element_post_message (GST_ELEMENT (self), progress_message);
+  if (latency_message != NULL)
+    gst_element_post_message (GST_ELEMENT (self), latency_message);
 
   flow_result = gst_pad_push (self->srcpad, buffer);
   if (flow_result != GST_FLOW_OK)
@@ -1138,7 +1196,7 @@ gst_looper_pull_data_from_upstream (GstPad * pad)
   max_position = 0;
   if (self->max_duration > 0)
     {
-      max_position = round_up_to_position (self, self->max_duration);
+      max_position = self->max_position;
       if (self->local_buffer_fill_level > max_position)
         {
           max_duration_reached = TRUE;
@@ -1175,7 +1233,7 @@ gst_looper_pull_data_from_upstream (GstPad * pad)
         }
 
       /* Set the position from which to start draining the buffer.  */
-      start_position = round_down_to_position (self, self->start_time);
+      start_position = self->start_position;
       self->local_buffer_drain_level = start_position;
 
       /* If the Autostart parameter has been set to TRUE, don't wait
@@ -1183,8 +1241,8 @@ gst_looper_pull_data_from_upstream (GstPad * pad)
       if (self->autostart)
         {
           self->started = TRUE;
-          self->local_clock = 0;
-          self->elapsed_time = 0;
+          self->clock_frames = 0;
+          self->elapsed_frames = 0;
         }
       /* Begin pushing data from our local buffer downstream using the
        * source pad.  Unless we are autostarted, that task will send silence 
@@ -1317,7 +1375,7 @@ gst_looper_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
   max_duration_reached = FALSE;
   if (self->max_duration > 0)
     {
-      max_position = round_up_to_position (self, self->max_duration);
+      max_position = self->max_position;
       if (self->local_buffer_fill_level > max_position)
         {
           max_duration_reached = TRUE;
@@ -1339,7 +1397,7 @@ gst_looper_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
        */
       self->local_buffer_size = max_position;
       /* Set the position from which to start draining the buffer.  */
-      start_position = round_down_to_position (self, self->start_time);
+      start_position = self->start_position;
       self->local_buffer_drain_level = start_position;
 
       /* If the Autostart parameter has been set to TRUE, don't wait
@@ -1347,8 +1405,8 @@ gst_looper_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
       if (self->autostart)
         {
           self->started = TRUE;
-          self->local_clock = 0;
-          self->elapsed_time = 0;
+          self->clock_frames = 0;
+          self->elapsed_frames = 0;
         }
       /* Begin pushing data from our local buffer downstream using the 
        * source pad.  Unless we are autostarted, this task will send 
@@ -1486,7 +1544,6 @@ gst_looper_handle_sink_event (GstPad * pad, GstObject * parent,
   GstStructure *caps_structure;
   gchar *format_code_pointer;
   gchar format_code_0, format_code_1;
-  gdouble bits_per_second, bits_per_nanosecond;
   guint64 start_position;
   gint data_rate, channel_count;
   guint64 max_position;
@@ -1648,15 +1705,12 @@ gst_looper_handle_sink_event (GstPad * pad, GstObject * parent,
         }
       GST_DEBUG_OBJECT (self, "silence value is %hhd.", self->silence_byte);
 
-      /* Compute the data rate in bytes per nanosecond.
-       * data_rate times width times channel_count is bits per second.
-       * that divided by 1E9 is bits per nanosecond.
-       * that divided by 8 is bytes per nanosecond.  */
-      bits_per_second = self->data_rate * self->width * self->channel_count;
-      bits_per_nanosecond = (gdouble) bits_per_second / (gdouble) 1E9;
-      self->bytes_per_ns = bits_per_nanosecond / 8.0;
-      GST_DEBUG_OBJECT (self, "data rate is %f bytes per nanosecond.",
-                        self->bytes_per_ns);
+      /* Compute the size of a frame, and from it the positions in the
+       * buffer that correspond to the times we have been given.  */
+      self->frame_size = self->width * self->channel_count / 8;
+      GST_DEBUG_OBJECT (self, "frame size is %" G_GUINT64_FORMAT " bytes.",
+                        self->frame_size);
+      compute_positions (self);
 
       /* If a WAV file was specified, this is a good time to read it.  We have
        * the format and data rate, so we can convert max duration 
@@ -1666,7 +1720,7 @@ gst_looper_handle_sink_event (GstPad * pad, GstObject * parent,
           max_position = 0;
           if (self->max_duration > 0)
             {
-              max_position = round_up_to_position (self, self->max_duration);
+              max_position = self->max_position;
             }
 
           /* Read the data from the WAV file, up to the most we will need.  */
@@ -1691,8 +1745,7 @@ gst_looper_handle_sink_event (GstPad * pad, GstObject * parent,
                 }
 
               /* Set the position from which to start draining the buffer.  */
-              start_position =
-                round_down_to_position (self, self->start_time);
+              start_position = self->start_position;
               self->local_buffer_drain_level = start_position;
 
               /* If the Autostart parameter has been set to TRUE, don't wait
@@ -1700,8 +1753,8 @@ gst_looper_handle_sink_event (GstPad * pad, GstObject * parent,
               if (self->autostart)
                 {
                   self->started = TRUE;
-                  self->local_clock = 0;
-                  self->elapsed_time = 0;
+                  self->clock_frames = 0;
+                  self->elapsed_frames = 0;
                 }
               /* It is too early to start pushing data downstream.  Wait until
                * we get some data from upstream.  */
@@ -1731,7 +1784,7 @@ gst_looper_handle_sink_event (GstPad * pad, GstObject * parent,
           /* We now know the size of our local buffer.  */
           self->local_buffer_size = self->local_buffer_fill_level;
           /* Set the initial buffer drain position.  */
-          start_position = round_down_to_position (self, self->start_time);
+          start_position = self->start_position;
           self->local_buffer_drain_level = start_position;
 
           /* If the Autostart parameter has been set to TRUE, don't wait
@@ -1739,8 +1792,8 @@ gst_looper_handle_sink_event (GstPad * pad, GstObject * parent,
           if (self->autostart)
             {
               self->started = TRUE;
-              self->local_clock = 0;
-              self->elapsed_time = 0;
+              self->clock_frames = 0;
+              self->elapsed_frames = 0;
             }
           /* Begin pushing data from our local buffer downstream using the 
            * source pad.  Unless we are autostarted, this task will send 
@@ -1858,9 +1911,13 @@ gst_looper_handle_src_event (GstPad * pad, GstObject * parent,
           GST_INFO_OBJECT (self, "received custom start event");
           self->started = TRUE;
           self->completion_sent = FALSE;
-          start_position = round_down_to_position (self, self->start_time);
+          start_position = self->start_position;
           self->local_buffer_drain_level = start_position;
-          self->elapsed_time = 0;
+          self->elapsed_frames = 0;
+          self->trigger_time = 0;
+          gst_structure_get_int64 (event_structure,
+                                   (gchar *) "trigger-time",
+                                   &self->trigger_time);
         }
 
       if (g_strcmp0 (structure_name, (gchar *) "pause") == 0)
@@ -2046,68 +2103,54 @@ gst_looper_handle_sink_query (GstPad * pad, GstObject * parent,
   return result;
 }
 
-/* Round a time to the next higher buffer position from which we can start
- * a frame.  */
+/* Convert a count of frames to nanoseconds.  The conversion is exact
+ * integer scaling, so a time computed from a frame count never drifts,
+ * however long the sound has been playing.  */
 static guint64
-round_up_to_position (GstLooper * self, guint64 specified_time)
+frames_to_time (GstLooper * self, guint64 frame_count)
 {
-  guint64 position;             /* unrounded buffer position corresponding to
-                                 * the specified time.  */
-  guint frame_size;             /* The number of bytes in one frame.  */
-  guint64 frame_index;          /* The number of complete frames before the 
-                                 * position.  */
-  guint64 byte_position;        /* the position in the buffer corresponding to 
-                                 * the beginning of the first frame after the 
-                                 * specified time.  */
-
-  /* The time is specified in nanoseconds.  If the buffer position 
-   * corresponding to that time isn't on a frame boundary, convert it to the 
-   * next higher buffer positon that is on a frame boundary.  */
-  position = (gdouble) specified_time *self->bytes_per_ns;
-  frame_size = self->width * self->channel_count / 8;
-  frame_index = (position / frame_size);
-  byte_position = frame_index * frame_size;
-  if (byte_position < position)
-    {
-      byte_position = (frame_index + 1) * frame_size;
-    }
-  GST_DEBUG_OBJECT (self,
-                    "time %" GST_TIME_FORMAT " rounded up to %"
-                    GST_TIME_FORMAT " yielding buffer position %"
-                    G_GUINT64_FORMAT ".", GST_TIME_ARGS (specified_time),
-                    GST_TIME_ARGS (byte_position / self->bytes_per_ns),
-                    byte_position);
-  return byte_position;
+  if (self->data_rate == 0)
+    return 0;
+  return gst_util_uint64_scale_int (frame_count, GST_SECOND,
+                                    (gint) self->data_rate);
 }
 
-/* Round a time to the next lower buffer position from which we can start
- * a frame.  */
-static guint64
-round_down_to_position (GstLooper * self, guint64 specified_time)
+/* Convert the loop points, max-duration and start time, which are
+ * specified in nanoseconds, to positions in the local buffer.  Each
+ * is on a frame boundary: loop-from and max-duration are rounded up to
+ * the next frame, loop-to and start-time down to the previous one.
+ * This is done once, when the parameters or the format change, rather
+ * than each time a buffer is pushed.  The streaming thread reads the
+ * positions holding only the interlock, so this is called with the
+ * interlock held, and without the object lock.  */
+static void
+compute_positions (GstLooper * self)
 {
-  guint64 position;             /* unrounded buffer position corresponding to
-                                 * the specified time.  */
-  guint frame_size;             /* The number of bytes in one frame.  */
-  guint64 frame_index;          /* The number of complete frames before the 
-                                 * position.  */
-  guint64 byte_position;        /* the position in the buffer corresponding to 
-                                 * the beginning of the first frame before the 
-                                 * specified time.  */
-
-  /* The time is specified in nanoseconds.  If the buffer position 
-   * corresponding to that time isn't on a frame boundary, convert it to the 
-   * next lower buffer positon that is on a frame boundary.  */
-  position = (gdouble) specified_time *self->bytes_per_ns;
-  frame_size = self->width * self->channel_count / 8;
-  frame_index = (position / frame_size);
-  byte_position = frame_index * frame_size;
+  gint rate;
+
+  if ((self->frame_size == 0) || (self->data_rate == 0))
+    return;
+  rate = self->data_rate;
+
+  self->loop_from_position =
+    gst_util_uint64_scale_int_ceil (self->loop_from, rate,
+                                    GST_SECOND) * self->frame_size;
+  self->loop_to_position =
+    gst_util_uint64_scale_int (self->loop_to, rate,
+                               GST_SECOND) * self->frame_size;
+  self->max_position =
+    gst_util_uint64_scale_int_ceil (self->max_duration, rate,
+                                    GST_SECOND) * self->frame_size;
+  self->start_position =
+    gst_util_uint64_scale_int (self->start_time, rate,
+                               GST_SECOND) * self->frame_size;
   GST_DEBUG_OBJECT (self,
-                    "time %" GST_TIME_FORMAT " rounded down to %"
-                    GST_TIME_FORMAT " for buffer position %" G_GUINT64_FORMAT
-                    ".", GST_TIME_ARGS (specified_time),
-                    GST_TIME_ARGS (byte_position / self->bytes_per_ns),
-                    byte_position);
-  return byte_position;
+                    "buffer positions: loop from %" G_GUINT64_FORMAT
+                    ", loop to %" G_GUINT64_FORMAT ", max %"
+                    G_GUINT64_FORMAT ", start %" G_GUINT64_FORMAT ".",
+                    self->loop_from_position, self->loop_to_position,
+                    self->max_position, self->start_position);
+  return;
 }
 
 /* Subroutine to read the data chunks from a WAV file into the local buffer.
@@ -2331,6 +2374,7 @@ gst_looper_set_property (GObject * object, guint prop_id,
       GST_INFO_OBJECT (self, "loop-to: %" G_GUINT64_FORMAT ".",
                        self->loop_to);
       GST_OBJECT_UNLOCK (self);
+      compute_positions (self);
       break;
 
     case PROP_LOOP_FROM:
@@ -2339,6 +2383,7 @@ gst_looper_set_property (GObject * object, guint prop_id,
       GST_INFO_OBJECT (self, "loop-from: %" G_GUINT64_FORMAT ".",
                        self->loop_from);
       GST_OBJECT_UNLOCK (self);
+      compute_positions (self);
       break;
 
     case PROP_LOOP_LIMIT:
@@ -2355,6 +2400,7 @@ gst_looper_set_property (GObject * object, guint prop_id,
       GST_INFO_OBJECT (self, "max-duration: %" G_GUINT64_FORMAT ".",
                        self->max_duration);
       GST_OBJECT_UNLOCK (self);
+      compute_positions (self);
       break;
 
     case PROP_START_TIME:
@@ -2363,6 +2409,7 @@ gst_looper_set_property (GObject * object, guint prop_id,
       GST_INFO_OBJECT (self, "start-time: %" G_GUINT64_FORMAT ".",
                        self->start_time);
       GST_OBJECT_UNLOCK (self);
+      compute_positions (self);
       break;
 
     case PROP_AUTOSTART:
@@ -2381,6 +2428,14 @@ gst_looper_set_property (GObject * object, guint prop_id,
       GST_OBJECT_UNLOCK (self);
       break;
 
+    case PROP_PROGRESS_INTERVAL:
+      GST_OBJECT_LOCK (self);
+      self->progress_interval = g_value_get_uint64 (value);
+      GST_INFO_OBJECT (self, "progress-interval: %" G_GUINT64_FORMAT ".",
+                       self->progress_interval);
+      GST_OBJECT_UNLOCK (self);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -2395,19 +2450,18 @@ compute_remaining_time (GstLooper * object)
 {
   GstLooper *self = GST_LOOPER (object);
   guint64 time_before_loop, time_inside_loop, time_after_loop;
-  gdouble total_time;
-  gdouble current_time;
-  gdouble current_time_int;
+  guint64 current_time_int;
   guint64 total_time_int;
 
   /* Compute the total time of the sound assuming no looping.  */
-  total_time = (gdouble) self->local_buffer_size / self->bytes_per_ns;
-  total_time_int = (guint64) total_time;
+  total_time_int =
+    frames_to_time (self, self->local_buffer_size / self->frame_size);
 
   if (self->loop_from == 0)
     {
       /* If there is no looping, the time is simple to compute.  */
-      return (total_time_int - self->start_time - self->elapsed_time);
+      return (total_time_int - self->start_time -
+              frames_to_time (self, self->elapsed_frames));
     }
 
   if ((self->loop_limit == 0) && (!self->released))
@@ -2421,9 +2475,9 @@ compute_remaining_time (GstLooper * object)
       /* We are looping, but we have received a release message,
        * so looping has stopped.  We will run from the current
        * position to the end of the buffer.  */
-      current_time =
-        (gdouble) self->local_buffer_drain_level / self->bytes_per_ns;
-      current_time_int = (guint64) current_time;
+      current_time_int =
+        frames_to_time (self,
+                        self->local_buffer_drain_level / self->frame_size);
       return (total_time_int - current_time_int);
     }
 
@@ -2436,6 +2490,90 @@ compute_remaining_time (GstLooper * object)
           self->start_time);
 }
 
+/* Publish the position in the sound and the elapsed and remaining
+ * times.  This is called by the streaming thread, holding the
+ * interlock, each time it pushes a buffer.  Other threads read them
+ * without the interlock: the sequence number is odd while they are
+ * being changed, so a reader that sees it odd, or sees it change while
+ * reading, reads again.  If a progress message is due, it is returned,
+ * to be posted once the interlock is released.  */
+static GstMessage *
+publish_readouts (GstLooper * self)
+{
+  gint64 position, elapsed, remaining;
+  GstStructure *structure;
+
+  if (self->frame_size == 0)
+    return NULL;
+  position = self->local_buffer_drain_level / self->frame_size;
+  elapsed = frames_to_time (self, self->elapsed_frames);
+  remaining = compute_remaining_time (self);
+
+  g_atomic_int_inc (&self->readout_sequence);
+  self->readout_position = position;
+  self->readout_elapsed = elapsed;
+  self->readout_remaining = remaining;
+  g_atomic_int_inc (&self->readout_sequence);
+
+  /* Progress messages are coalesced: however many buffers are pushed,
+   * there is at most one message each progress interval.  The elapsed
+   * time starts over when the sound is started again.  */
+  if (self->progress_interval == 0)
+    return NULL;
+  if (elapsed < self->progress_posted)
+    self->progress_posted = 0;
+  if (elapsed < self->progress_posted + self->progress_interval)
+    return NULL;
+  self->progress_posted = elapsed;
+  structure =
+    gst_structure_new ((gchar *) "looper_progress", (gchar *) "position",
+                       G_TYPE_INT64, position, (gchar *) "elapsed",
+                       G_TYPE_INT64, elapsed,
+                       (gchar *) "remaining", G_TYPE_INT64, remaining, NULL);
+  return gst_message_new_element (GST_OBJECT (self), structure);
+}
+
+/* If this is the first data sent since a command started the sound,
+ * build a message telling the application how long that took.  This is
+ * called with the interlock held; the message is returned to be posted
+ * once it is released.  */
+static GstMessage *
+report_latency (GstLooper * self)
+{
+  GstStructure *structure;
+
+  if (self->trigger_time == 0)
+    return NULL;
+
+  structure =
+    gst_structure_new ((gchar *) "latency", (gchar *) "stage",
+                       G_TYPE_STRING, "looper", (gchar *) "trigger-time",
+                       G_TYPE_INT64, self->trigger_time,
+                       (gchar *) "stage-time", G_TYPE_INT64,
+                       g_get_monotonic_time () * 1000, NULL);
+  self->trigger_time = 0;
+  return gst_message_new_element (GST_OBJECT (self), structure);
+}
+
+/* Read the published position and times.  */
+static void
+read_readouts (GstLooper * self, gint64 * position, gint64 * elapsed,
+               gint64 * remaining)
+{
+  gint sequence;
+
+  do
+    {
+      sequence = g_atomic_int_get (&self->readout_sequence);
+      *position = self->readout_position;
+      *elapsed = self->readout_elapsed;
+      *remaining = self->readout_remaining;
+    }
+  while (((sequence & 1) != 0)
+         || (g_atomic_int_get (&self->readout_sequence) != sequence));
+  return;
+}
+
 /* Return the value of a property.  */
 static void
 gst_looper_get_property (GObject * object, guint prop_id, GValue * value,
@@ -2444,7 +2582,53 @@ gst_looper_get_property (GObject * object, guint prop_id, GValue * value,
   GstLooper *self = GST_LOOPER (object);
   gchar *string_value;
   gdouble double_value;
-  gint64 remaining_time;
+  gint64 position, elapsed, remaining;
+
+  /* The position and times are read from the readouts, so they can be
+   * sampled as often as wanted without waiting for the interlock, and
+   * without delaying the streaming thread.  */
+  switch (prop_id)
+    {
+    case PROP_POSITION:
+      read_readouts (self, &position, &elapsed, &remaining);
+      g_value_set_int64 (value, position);
+      return;
+
+    case PROP_ELAPSED:
+      read_readouts (self, &position, &elapsed, &remaining);
+      g_value_set_int64 (value, elapsed);
+      return;
+
+    case PROP_REMAINING:
+      read_readouts (self, &position, &elapsed, &remaining);
+      g_value_set_int64 (value, remaining);
+      return;
+
+    case PROP_ELAPSED_TIME:
+      read_readouts (self, &position, &elapsed, &remaining);
+      double_value = (gdouble) elapsed / (gdouble) 1e9;
+      string_value = g_strdup_printf ("%4.1f", double_value);
+      g_value_take_string (value, string_value);
+      return;
+
+    case PROP_REMAINING_TIME:
+      read_readouts (self, &position, &elapsed, &remaining);
+      if (remaining == -1)
+        {
+          /* Remaining time is infinite.  */
+          string_value = g_strdup ("∞");
+        }
+      else
+        {
+          double_value = (gdouble) remaining / (gdouble) 1e9;
+          string_value = g_strdup_printf ("%4.1f", double_value);
+        }
+      g_value_take_string (value, string_value);
+      return;
+
+    default:
+      break;
+    }
 
   g_rec_mutex_lock (&self->interlock);
   switch (prop_id)
@@ -2497,33 +2681,9 @@ gst_looper_get_property (GObject * object, guint prop_id, GValue * value,
       GST_OBJECT_UNLOCK (self);
       break;
 
-    case PROP_ELAPSED_TIME:
-      GST_OBJECT_LOCK (self);
-      double_value = (gdouble) self->elapsed_time / (gdouble) 1e9;
-      string_value = g_strdup_printf ("%4.1f", double_value);
-      g_value_set_string (value, string_value);
-      g_free (string_value);
-      string_value = NULL;
-      GST_OBJECT_UNLOCK (self);
-      break;
-
-    case PROP_REMAINING_TIME:
+    case PROP_PROGRESS_INTERVAL:
       GST_OBJECT_LOCK (self);
-      remaining_time = compute_remaining_time (self);
-      if (remaining_time == -1)
-        {
-          /* Remaining time is infinite.  */
-          string_value = g_strdup ("∞");
-        }
-      else
-        {
-          double_value = (gdouble) (remaining_time) / (gdouble) 1e9;
-          string_value = g_strdup_printf ("%4.1f", double_value);
-        }
-
-      g_value_set_string (value, string_value);
-      g_free (string_value);
-      string_value = NULL;
+      g_value_set_uint64 (value, self->progress_interval);
       GST_OBJECT_UNLOCK (self);
       break;
 
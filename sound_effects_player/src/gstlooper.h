@@ -69,11 +69,30 @@ struct _GstLooper
   guint64 local_buffer_size;    /* number of bytes in the local buffer */
   guint64 pull_level;           /* how much data we have pulled from upstream */
   guint64 timestamp_offset;
-  guint64 local_clock;          /* The current time, in nanoseconds.  
-                                 * This counts continuously through loops.  */
-  guint64 elapsed_time;         /* The amount of time, in nanoseconds, that
-				 * we have been sending sound.  */
-  gdouble bytes_per_ns;         /* data rate in bytes per nanosecond */
+  guint64 clock_frames;         /* The current time, in frames.  This counts
+                                 * continuously through loops.  */
+  guint64 elapsed_frames;       /* The number of frames of sound we have
+                                 * sent since the sound was started.  */
+  guint64 progress_interval;    /* How often to post a progress message,
+                                 * in nanoseconds of sound sent; 0 means
+                                 * never.  */
+  guint64 progress_posted;      /* The elapsed time when the last progress
+                                 * message was posted.  */
+  gint readout_sequence;        /* Odd while the readouts are being changed.
+                                 */
+  gint64 readout_position;      /* The position in the sound, in frames.  */
+  gint64 readout_elapsed;       /* The elapsed time, in nanoseconds.  */
+  gint64 readout_remaining;     /* The remaining time, in nanoseconds,
+                                 * or -1 if the sound will not stop.  */
+  gint64 trigger_time;          /* The monotonic time, in nanoseconds, of
+                                 * the command that started the sound,
+                                 * until we report that we have started
+                                 * draining; otherwise 0.  */
+  guint64 frame_size;           /* The number of bytes in one frame.  */
+  guint64 loop_from_position;   /* The buffer positions corresponding to */
+  guint64 loop_to_position;     /* loop-from, loop-to, max-duration */
+  guint64 max_position;         /* and start-time, each on a frame boundary */
+  guint64 start_position;       /* and computed when they are set.  */
   gchar *format;                /* The format of incoming data--for example,
                                  * F32LE.  */
   GRecMutex interlock;          /* used to prevent interference between tasks */
@@ -0,0 +1,602 @@
+/*
+ * File: gstpanner.c, part of Show_control, a Gstreamer application
+ *
+ * Much of this code is based on Gstreamer examples and tutorials.
+ *
+ * Copyright © 2016 John Sauter <John_Sauter@systemeyescomputerstore.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, see https://gnu.org/licenses
+ * or write to
+ * Free Software Foundation, Inc.
+ * 51 Franklin Street, Fifth Floor
+ * Boston, MA 02111-1301
+ * USA.
+ */
+
+/**
+ * SECTION:element-panner
+ *
+ * Spread a stereo sound over any number of output channels, up to 64,
+ * for surround sound and for sending a sound to several output buses
+ * at once.  Each output channel gets its own gain for the left input
+ * channel and for the right.  Properties are:
+ *
+ * #GstPanner:mix-matrix is the gains, as in audioconvert: an array with
+ * a row for each output channel, each row holding the gain from the 
+ * left and from the right input channel.  Output channels without a
+ * row are silent.  By default the left channel goes to the first
+ * output channel and the right channel to the second.
+ *
+ * #GstPanner:panorama moves the sound between its left and right 
+ * channels before it is spread, as audiopanorama does, from -1.0 for
+ * full left to 1.0 for full right.  Default is 0.0, which leaves the
+ * sound unchanged.
+ *
+ * The number of output channels is set by the caps downstream.  The
+ * panorama is folded into the gains, so every sample costs the same
+ * no matter where the sound is placed; the gains are applied to each
+ * frame by a kernel with no tests in it, specialized for the common
+ * channel counts so the compiler can vectorize it.
+ *
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ * gst-launch-1.0 -v -m audiotestsrc ! audio/x-raw,channels=2 ! panner mix-matrix="<<(float)1.0, (float)0.0>, <(float)0.0, (float)1.0>, <(float)0.5, (float)0.5>, <(float)0.0, (float)0.0>>" ! audio/x-raw,channels=4,channel-mask=(bitmask)0x0 ! fakesink silent=TRUE
+ * ]| Play the test tone on the first two of four channels, and a mono
+ * mix of it on the third.
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <gst/gst.h>
+#include <gst/base/gstbasetransform.h>
+#include <gst/audio/audio.h>
+
+#include "gstpanner.h"
+
+GST_DEBUG_CATEGORY_STATIC (panner);
+#define GST_CAT_DEFAULT panner
+
+enum
+{
+  PROP_0,
+  PROP_PANORAMA,
+  PROP_MIX_MATRIX
+};
+
+/* For simplicity, we handle only single-precision floating point
+ * samples, and only stereo input.  An audioconvert element before
+ * the panner will provide them.  */
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+#define PANNER_FORMAT "F32LE"
+#else
+#define PANNER_FORMAT "F32BE"
+#endif
+
+#define SINK_CAPS \
+  "audio/x-raw, " \
+  "format = (string) " PANNER_FORMAT ", " \
+  "rate = (int) [ 1, 2147483647 ], " \
+  "channels = (int) 2, " \
+  "layout = (string) interleaved"
+
+#define SRC_CAPS \
+  "audio/x-raw, " \
+  "format = (string) " PANNER_FORMAT ", " \
+  "rate = (int) [ 1, 2147483647 ], " \
+  "channels = (int) [ 1, 64 ], " \
+  "layout = (string) interleaved"
+
+static GstStaticPadTemplate sink_template =
+GST_STATIC_PAD_TEMPLATE ("sink", GST_PAD_SINK, GST_PAD_ALWAYS,
+                         GST_STATIC_CAPS (SINK_CAPS));
+
+static GstStaticPadTemplate src_template =
+GST_STATIC_PAD_TEMPLATE ("src", GST_PAD_SRC, GST_PAD_ALWAYS,
+                         GST_STATIC_CAPS (SRC_CAPS));
+
+#define DEBUG_INIT \
+  GST_DEBUG_CATEGORY_INIT (panner, "panner", 0, \
+			   "Spread a stereo sound over many channels");
+#define gst_panner_parent_class parent_class
+
+/* The output has a different number of channels from the input, so
+ * this filter is based on GstBaseTransform rather than
+ * GstAudioFilter.  */
+G_DEFINE_TYPE_WITH_CODE (GstPanner, gst_panner, GST_TYPE_BASE_TRANSFORM,
+                         DEBUG_INIT);
+
+/* Forward declarations.  These subroutines will be defined below.  */
+static void gst_panner_set_property (GObject * object, guint prop_id,
+                                     const GValue * value,
+                                     GParamSpec * pspec);
+static void gst_panner_get_property (GObject * object, guint prop_id,
+                                     GValue * value, GParamSpec * pspec);
+
+/* The kernels.  Each output sample is the left input sample times its
+ * left gain plus the right input sample times its right gain.  The
+ * gains are copied into local arrays, which the output cannot overlap,
+ * so the compiler can keep them in registers, and with the channel
+ * count fixed it can turn the loop over the channels into a few
+ * vector multiplies and adds.  Nothing in the loop over the frames
+ * depends on where the sound is placed.  These kernels take the
+ * channel count only to share the signature of the general one.  */
+#define PANNER_KERNEL(N) \
+static void \
+pan_frames_##N (const gfloat * input, gfloat * output, gint frame_count, \
+                gint channel_count G_GNUC_UNUSED, \
+                const gfloat * left_gains, const gfloat * right_gains) \
+{ \
+  gfloat left[N], right[N]; \
+  gfloat left_sample, right_sample; \
+  gint frame_counter, channel_counter; \
+  \
+  memcpy (left, left_gains, sizeof (left)); \
+  memcpy (right, right_gains, sizeof (right)); \
+  for (frame_counter = 0; frame_counter < frame_count; frame_counter++) \
+    { \
+      left_sample = input[0]; \
+      right_sample = input[1]; \
+      for (channel_counter = 0; channel_counter < N; channel_counter++) \
+        output[channel_counter] = \
+          (left[channel_counter] * left_sample) + \
+          (right[channel_counter] * right_sample); \
+      input = input + 2; \
+      output = output + N; \
+    } \
+  return; \
+}
+
+PANNER_KERNEL (2)
+PANNER_KERNEL (4)
+PANNER_KERNEL (6)
+PANNER_KERNEL (8)
+PANNER_KERNEL (16)
+#undef PANNER_KERNEL
+
+/* The kernel for any other number of channels.  */
+static void
+pan_frames (const gfloat * input, gfloat * output, gint frame_count,
+            gint channel_count, const gfloat * left_gains,
+            const gfloat * right_gains)
+{
+  gfloat left[PANNER_MAX_CHANNELS], right[PANNER_MAX_CHANNELS];
+  gfloat left_sample, right_sample;
+  gint frame_counter, channel_counter;
+
+  memcpy (left, left_gains, channel_count * sizeof (gfloat));
+  memcpy (right, right_gains, channel_count * sizeof (gfloat));
+  for (frame_counter = 0; frame_counter < frame_count; frame_counter++)
+    {
+      left_sample = input[0];
+      right_sample = input[1];
+      for (channel_counter = 0; channel_counter < channel_count;
+           channel_counter++)
+        output[channel_counter] =
+          (left[channel_counter] * left_sample) +
+          (right[channel_counter] * right_sample);
+      input = input + 2;
+      output = output + channel_count;
+    }
+  return;
+}
+
+/* Choose the kernel for a number of output channels.  */
+static GstPannerKernel
+choose_kernel (gint channel_count)
+{
+  switch (channel_count)
+    {
+    case 2:
+      return pan_frames_2;
+    case 4:
+      return pan_frames_4;
+    case 6:
+      return pan_frames_6;
+    case 8:
+      return pan_frames_8;
+    case 16:
+      return pan_frames_16;
+    default:
+      return pan_frames;
+    }
+}
+
+/* Compute the gains the kernel applies from the mix matrix and the
+ * panorama.  The panorama works as audiopanorama's does on stereo
+ * sound: moving right, the left channel is faded and its sound is
+ * moved into the right channel.  Call with the object locked.  */
+static void
+compute_gains (GstPanner * self)
+{
+  gdouble pan;
+  gfloat left, right;
+  gint channel_counter;
+
+  pan = self->panorama;
+  for (channel_counter = 0; channel_counter < PANNER_MAX_CHANNELS;
+       channel_counter++)
+    {
+      if (self->matrix_rows > 0)
+        {
+          left = self->matrix[channel_counter][0];
+          right = self->matrix[channel_counter][1];
+        }
+      else
+        {
+          left = (channel_counter == 0) ? 1.0 : 0.0;
+          right = (channel_counter == 1) ? 1.0 : 0.0;
+        }
+
+      if (pan <= 0.0)
+        {
+          self->left_gains[channel_counter] = left;
+          self->right_gains[channel_counter] =
+            (-pan * left) + ((1.0 + pan) * right);
+        }
+      else
+        {
+          self->left_gains[channel_counter] =
+            ((1.0 - pan) * left) + (pan * right);
+          self->right_gains[channel_counter] = right;
+        }
+    }
+  return;
+}
+
+/* The sink pad takes stereo; the source pad can have any number of
+ * channels.  */
+static GstCaps *
+panner_transform_caps (GstBaseTransform * base, GstPadDirection direction,
+                       GstCaps * caps, GstCaps * filter)
+{
+  GstCaps *result, *intersection;
+  GstStructure *structure;
+  guint i;
+
+  result = gst_caps_copy (caps);
+  for (i = 0; i < gst_caps_get_size (result); i++)
+    {
+      structure = gst_caps_get_structure (result, i);
+      gst_structure_remove_field (structure, "channel-mask");
+      if (direction == GST_PAD_SINK)
+        gst_structure_set (structure, "channels", GST_TYPE_INT_RANGE, 1,
+                           PANNER_MAX_CHANNELS, NULL);
+      else
+        gst_structure_set (structure, "channels", G_TYPE_INT, 2, NULL);
+    }
+
+  if (filter != NULL)
+    {
+      intersection =
+        gst_caps_intersect_full (filter, result, GST_CAPS_INTERSECT_FIRST);
+      gst_caps_unref (result);
+      result = intersection;
+    }
+
+  GST_DEBUG_OBJECT (base, "transformed %" GST_PTR_FORMAT " into %"
+                    GST_PTR_FORMAT ".", caps, result);
+  return result;
+}
+
+/* The size of a frame: a sample for each channel.  */
+static gboolean
+panner_get_unit_size (GstBaseTransform * base, GstCaps * caps, gsize * size)
+{
+  GstAudioInfo info;
+
+  if (!gst_audio_info_from_caps (&info, caps))
+    return FALSE;
+  *size = GST_AUDIO_INFO_BPF (&info);
+  return TRUE;
+}
+
+/* Called whenever the format changes.  */
+static gboolean
+panner_set_caps (GstBaseTransform * base, GstCaps * incaps,
+                 GstCaps * outcaps)
+{
+  GstPanner *self = GST_PANNER (base);
+  GstAudioInfo info;
+
+  if (!gst_audio_info_from_caps (&info, outcaps))
+    {
+      GST_ERROR_OBJECT (self, "invalid output caps %" GST_PTR_FORMAT ".",
+                        outcaps);
+      return FALSE;
+    }
+
+  GST_OBJECT_LOCK (self);
+  self->channel_count = GST_AUDIO_INFO_CHANNELS (&info);
+  self->kernel = choose_kernel (self->channel_count);
+  GST_OBJECT_UNLOCK (self);
+  GST_DEBUG_OBJECT (self, "panning into %d channels.", self->channel_count);
+  return TRUE;
+}
+
+/* Before each transform of input to output, bring a controlled
+ * panorama up to date.  */
+static void
+panner_before_transform (GstBaseTransform * base, GstBuffer * buffer)
+{
+  GstClockTime timestamp;
+
+  timestamp = GST_BUFFER_TIMESTAMP (buffer);
+  timestamp =
+    gst_segment_to_stream_time (&base->segment, GST_FORMAT_TIME, timestamp);
+  if (GST_CLOCK_TIME_IS_VALID (timestamp))
+    gst_object_sync_values (GST_OBJECT (base), timestamp);
+  return;
+}
+
+/* Spread the input over the output channels.  */
+static GstFlowReturn
+panner_transform (GstBaseTransform * base, GstBuffer * inbuf,
+                  GstBuffer * outbuf)
+{
+  GstPanner *self = GST_PANNER (base);
+  GstMapInfo srcmap, dstmap;
+  gfloat left_gains[PANNER_MAX_CHANNELS], right_gains[PANNER_MAX_CHANNELS];
+  GstPannerKernel kernel;
+  gint channel_count, frame_count;
+
+  /* The gains can be changed from another thread, so use a copy.  */
+  GST_OBJECT_LOCK (self);
+  channel_count = self->channel_count;
+  kernel = self->kernel;
+  memcpy (left_gains, self->left_gains, sizeof (left_gains));
+  memcpy (right_gains, self->right_gains, sizeof (right_gains));
+  GST_OBJECT_UNLOCK (self);
+
+  gst_buffer_map (inbuf, &srcmap, GST_MAP_READ);
+  gst_buffer_map (outbuf, &dstmap, GST_MAP_WRITE);
+
+  /* Each input frame has a left and a right sample.  */
+  frame_count = srcmap.size / (2 * sizeof (gfloat));
+  frame_count = MIN (frame_count,
+                     dstmap.size / (channel_count * sizeof (gfloat)));
+
+  /* Silence stays silent, and is marked as such, so the elements
+   * downstream need not process it.  */
+  if (GST_BUFFER_FLAG_IS_SET (inbuf, GST_BUFFER_FLAG_GAP))
+    {
+      memset (dstmap.data, 0, dstmap.size);
+      GST_BUFFER_FLAG_SET (outbuf, GST_BUFFER_FLAG_GAP);
+    }
+  else
+    {
+      kernel ((const gfloat *) srcmap.data, (gfloat *) dstmap.data,
+              frame_count, channel_count, left_gains, right_gains);
+      GST_BUFFER_FLAG_UNSET (outbuf, GST_BUFFER_FLAG_GAP);
+    }
+
+  gst_buffer_unmap (inbuf, &srcmap);
+  gst_buffer_unmap (outbuf, &dstmap);
+
+  return GST_FLOW_OK;
+}
+
+/* Take a new mix matrix, in the form audioconvert uses: an array of
+ * rows, each an array of gains.  Call with the object locked.  */
+static void
+set_matrix (GstPanner * self, const GValue * value)
+{
+  const GValue *row;
+  gint row_count, column_count;
+  gint channel_counter, column_counter;
+
+  memset (self->matrix, 0, sizeof (self->matrix));
+  row_count = gst_value_array_get_size (value);
+  if (row_count > PANNER_MAX_CHANNELS)
+    {
+      GST_WARNING_OBJECT (self, "mix matrix has %d rows; using the first %d.",
+                          row_count, PANNER_MAX_CHANNELS);
+      row_count = PANNER_MAX_CHANNELS;
+    }
+
+  for (channel_counter = 0; channel_counter < row_count; channel_counter++)
+    {
+      row = gst_value_array_get_value (value, channel_counter);
+      column_count = MIN (gst_value_array_get_size (row), 2);
+      for (column_counter = 0; column_counter < column_count;
+           column_counter++)
+        {
+          self->matrix[channel_counter][column_counter] =
+            g_value_get_float (gst_value_array_get_value
+                               (row, column_counter));
+        }
+    }
+  self->matrix_rows = row_count;
+
+  return;
+}
+
+/* Report the mix matrix.  Call with the object locked.  */
+static void
+get_matrix (GstPanner * self, GValue * value)
+{
+  GValue row = G_VALUE_INIT;
+  GValue gain = G_VALUE_INIT;
+  gint channel_counter, column_counter;
+
+  for (channel_counter = 0; channel_counter < self->matrix_rows;
+       channel_counter++)
+    {
+      g_value_init (&row, GST_TYPE_ARRAY);
+      for (column_counter = 0; column_counter < 2; column_counter++)
+        {
+          g_value_init (&gain, G_TYPE_FLOAT);
+          g_value_set_float (&gain,
+                             self->matrix[channel_counter][column_counter]);
+          gst_value_array_append_value (&row, &gain);
+          g_value_unset (&gain);
+        }
+      gst_value_array_append_value (value, &row);
+      g_value_unset (&row);
+    }
+
+  return;
+}
+
+/* GObject vmethod implementations */
+
+/* initialize the panner's class */
+static void
+gst_panner_class_init (GstPannerClass * klass)
+{
+  GObjectClass *gobject_class;
+  GstElementClass *element_class;
+  GstBaseTransformClass *trans_class;
+  GParamSpec *param_spec;
+
+  gobject_class = (GObjectClass *) klass;
+  element_class = (GstElementClass *) klass;
+  trans_class = (GstBaseTransformClass *) klass;
+
+  gobject_class->set_property = gst_panner_set_property;
+  gobject_class->get_property = gst_panner_get_property;
+
+  param_spec =
+    g_param_spec_double ("panorama", "Panorama",
+                         "Position between left (-1.0) and right (1.0)",
+                         -1.0, 1.0, 0.0,
+                         G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE);
+  g_object_class_install_property (gobject_class, PROP_PANORAMA, param_spec);
+
+  param_spec =
+    gst_param_spec_array ("mix-matrix", "Mix_matrix",
+                          "The gain from the left and right input channels "
+                          "to each output channel",
+                          gst_param_spec_array ("matrix-rows", "Rows",
+                                                "A row of the matrix",
+                                                g_param_spec_float
+                                                ("matrix-columns", "Columns",
+                                                 "A gain", -10.0, 10.0, 0.0,
+                                                 G_PARAM_READWRITE),
+                                                G_PARAM_READWRITE),
+                          G_PARAM_READWRITE);
+  g_object_class_install_property (gobject_class, PROP_MIX_MATRIX,
+                                   param_spec);
+
+  gst_element_class_set_static_metadata (element_class, "Panner",
+                                         "Filter/Effect/Audio",
+                                         "Spread a stereo sound over "
+                                         "many channels",
+                                         "John Sauter <John_Sauter@"
+                                         "systemeyescomputerstore.com>");
+
+  gst_element_class_add_pad_template (element_class,
+                                      gst_static_pad_template_get
+                                      (&src_template));
+  gst_element_class_add_pad_template (element_class,
+                                      gst_static_pad_template_get
+                                      (&sink_template));
+
+  trans_class->transform_caps = GST_DEBUG_FUNCPTR (panner_transform_caps);
+  trans_class->get_unit_size = GST_DEBUG_FUNCPTR (panner_get_unit_size);
+  trans_class->set_caps = GST_DEBUG_FUNCPTR (panner_set_caps);
+  trans_class->before_transform =
+    GST_DEBUG_FUNCPTR (panner_before_transform);
+  trans_class->transform = GST_DEBUG_FUNCPTR (panner_transform);
+}
+
+/* initialize the new element
+ * initialize instance structure
+ */
+static void
+gst_panner_init (GstPanner * self)
+{
+  self->panorama = 0.0;
+  memset (self->matrix, 0, sizeof (self->matrix));
+  self->matrix_rows = 0;
+  self->channel_count = 2;
+  self->kernel = choose_kernel (self->channel_count);
+  compute_gains (self);
+}
+
+/* Set a property.  */
+static void
+gst_panner_set_property (GObject * object, guint prop_id,
+                         const GValue * value, GParamSpec * pspec)
+{
+  GstPanner *self = GST_PANNER (object);
+
+  switch (prop_id)
+    {
+    case PROP_PANORAMA:
+      GST_OBJECT_LOCK (self);
+      self->panorama = g_value_get_double (value);
+      compute_gains (self);
+      GST_OBJECT_UNLOCK (self);
+      break;
+
+    case PROP_MIX_MATRIX:
+      GST_OBJECT_LOCK (self);
+      set_matrix (self, value);
+      compute_gains (self);
+      GST_OBJECT_UNLOCK (self);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+/* Return the value of a property.  */
+static void
+gst_panner_get_property (GObject * object, guint prop_id, GValue * value,
+                         GParamSpec * pspec)
+{
+  GstPanner *self = GST_PANNER (object);
+
+  switch (prop_id)
+    {
+    case PROP_PANORAMA:
+      GST_OBJECT_LOCK (self);
+      g_value_set_double (value, self->panorama);
+      GST_OBJECT_UNLOCK (self);
+      break;
+
+    case PROP_MIX_MATRIX:
+      GST_OBJECT_LOCK (self);
+      get_matrix (self, value);
+      GST_OBJECT_UNLOCK (self);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+/* entry point to initialize the plug-in
+ * initialize the plug-in itself
+ * register the element factories and other features
+ */
+static gboolean
+panner_init (GstPlugin * panner)
+{
+  return gst_element_register (panner, "panner", GST_RANK_NONE,
+                               GST_TYPE_PANNER);
+}
+
+GST_PLUGIN_DEFINE (GST_VERSION_MAJOR, GST_VERSION_MINOR, panner,
+                   "Spread a stereo sound over many channels", panner_init,
+                   VERSION, "LGPL", "GStreamer", "http://gstreamer.net/")
@@ -0,0 +1,78 @@
+/*
+ * File: gstpanner.h, part of show_control, a GStreamer application.
+ *
+ * Copyright © 2016 John Sauter <John_Sauter@systemeyescomputerstore.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, see https://gnu.org/licenses
+ * or write to:
+ * Free Software Foundation, Inc.
+ * 51 Franklin Street, Fifth Floor
+ * Boston, MA 02111-1301
+ * USA.
+ */
+
+#ifndef __GST_PANNER_H__
+#define __GST_PANNER_H__
+
+#include <gst/gst.h>
+#include <gst/base/gstbasetransform.h>
+#include <gst/audio/audio.h>
+
+G_BEGIN_DECLS
+#define GST_TYPE_PANNER \
+  (gst_panner_get_type())
+#define GST_PANNER(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_PANNER,GstPanner))
+#define GST_PANNER_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_PANNER,GstPannerClass))
+#define GST_IS_PANNER(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_PANNER))
+#define GST_IS_PANNER_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_PANNER))
+/* The most output channels the panner can feed.  */
+#define PANNER_MAX_CHANNELS 64
+typedef struct _GstPanner GstPanner;
+typedef struct _GstPannerClass GstPannerClass;
+
+/* The kernel that spreads stereo frames over the output channels.  */
+typedef void (*GstPannerKernel) (const gfloat * input, gfloat * output,
+                                 gint frame_count, gint channel_count,
+                                 const gfloat * left_gains,
+                                 const gfloat * right_gains);
+
+struct _GstPanner
+{
+  GstBaseTransform element;
+
+  /* Parameters */
+  gdouble panorama;
+  gfloat matrix[PANNER_MAX_CHANNELS][2];
+  gint matrix_rows;             /* 0 if no mix matrix has been set */
+
+  /* Locals */
+  gint channel_count;
+  GstPannerKernel kernel;
+  gfloat left_gains[PANNER_MAX_CHANNELS];
+  gfloat right_gains[PANNER_MAX_CHANNELS];
+};
+
+struct _GstPannerClass
+{
+  GstBaseTransformClass parent_class;
+};
+
+GType gst_panner_get_type (void);
+
+G_END_DECLS
+#endif /* __GST_PANNER_H__ */
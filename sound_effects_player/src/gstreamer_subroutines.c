@@ -24,10 +24,186 @@
 #include "button_subroutines.h"
 #include "display_subroutines.h"
 #include "main.h"
+#include "monitor_subroutines.h"
+#include "qos_subroutines.h"
+#include "routing_subroutines.h"
+#include "trace_ring_subroutines.h"
 #include <math.h>
 
-/* If true, print trace information as we proceed.  */
-#define GSTREAMER_TRACE FALSE
+/* Set the mix matrix of an audio converter or a panner, which has a
+ * row for each output channel and a column for each input channel.  */
+static void
+set_mix_matrix (GstElement * convert_element, const gfloat * gains,
+                gint output_channels, gint input_channels)
+{
+  GValue matrix = G_VALUE_INIT;
+  GValue row = G_VALUE_INIT;
+  GValue gain = G_VALUE_INIT;
+  gint i, j;
+
+  g_value_init (&matrix, GST_TYPE_ARRAY);
+  for (i = 0; i < output_channels; i++)
+    {
+      g_value_init (&row, GST_TYPE_ARRAY);
+      for (j = 0; j < input_channels; j++)
+        {
+          g_value_init (&gain, G_TYPE_FLOAT);
+          g_value_set_float (&gain, gains[(i * input_channels) + j]);
+          gst_value_array_append_value (&row, &gain);
+          g_value_unset (&gain);
+        }
+      gst_value_array_append_value (&matrix, &row);
+      g_value_unset (&row);
+    }
+  g_object_set_property (G_OBJECT (convert_element), "mix-matrix", &matrix);
+  g_value_unset (&matrix);
+  return;
+}
+
+/* Create a caps filter that passes a given number of channels.  */
+static GstElement *
+create_channel_filter (const gchar * element_name, gint channel_count)
+{
+  GstElement *filter_element;
+  GstCaps *caps;
+
+  filter_element = gst_element_factory_make ("capsfilter", element_name);
+  if (filter_element == NULL)
+    return NULL;
+  if (channel_count > 2)
+    {
+      /* More than two channels are not speaker positions, just
+       * channels.  */
+      caps =
+        gst_caps_new_simple ("audio/x-raw", "channels", G_TYPE_INT,
+                             channel_count, "channel-mask",
+                             GST_TYPE_BITMASK, (guint64) 0, NULL);
+    }
+  else
+    {
+      caps =
+        gst_caps_new_simple ("audio/x-raw", "channels", G_TYPE_INT,
+                             channel_count, NULL);
+    }
+  g_object_set (filter_element, "caps", caps, NULL);
+  gst_caps_unref (caps);
+  return filter_element;
+}
+
+/* Create the output of a routed show when its buses go to different
+ * devices: a bin which splits the mixed channels among the buses.
+ * Return the bin, and the sink of the first bus, which paces it.  */
+static GstElement *
+create_bus_outputs (GstElement ** device_sink_element, GApplication * app)
+{
+  GstElement *buses_bin_element, *tee_element;
+  GstElement *queue_element, *convert_element, *filter_element;
+  GstElement *sink_element;
+  const struct routing_bus *bus_data;
+  gfloat *gains;
+  gchar *element_name;
+  gint bus_count, channel_count, bus_number, channel_number;
+  GstPad *sink_pad;
+
+  bus_count = routing_get_bus_count (app);
+  channel_count = routing_get_channel_count (app);
+  buses_bin_element = gst_bin_new ("final/buses");
+  tee_element = gst_element_factory_make ("tee", "final/buses/tee");
+  if ((buses_bin_element == NULL) || (tee_element == NULL))
+    {
+      GST_ERROR ("Unable to create the bus output elements.\n");
+      return NULL;
+    }
+  gst_bin_add (GST_BIN (buses_bin_element), tee_element);
+  *device_sink_element = NULL;
+
+  for (bus_number = 0; bus_number < bus_count; bus_number++)
+    {
+      bus_data = routing_get_bus (bus_number, app);
+      element_name =
+        g_strconcat ("final/buses/", bus_data->name, "/queue", NULL);
+      queue_element = gst_element_factory_make ("queue", element_name);
+      g_free (element_name);
+      element_name =
+        g_strconcat ("final/buses/", bus_data->name, "/convert", NULL);
+      convert_element =
+        gst_element_factory_make ("audioconvert", element_name);
+      g_free (element_name);
+      element_name =
+        g_strconcat ("final/buses/", bus_data->name, "/channels", NULL);
+      filter_element =
+        create_channel_filter (element_name, bus_data->channel_count);
+      g_free (element_name);
+      element_name =
+        g_strconcat ("final/buses/", bus_data->name, "/sink", NULL);
+      sink_element = gst_element_factory_make ("alsasink", element_name);
+      g_free (element_name);
+      if ((queue_element == NULL) || (convert_element == NULL)
+          || (filter_element == NULL) || (sink_element == NULL))
+        {
+          GST_ERROR ("Unable to create the output elements of bus %s.\n",
+                     bus_data->name);
+          return NULL;
+        }
+
+      /* The converter picks the bus's channels out of all of them.  */
+      gains = g_new0 (gfloat, bus_data->channel_count * channel_count);
+      for (channel_number = 0; channel_number < bus_data->channel_count;
+           channel_number++)
+        {
+          gains[(channel_number * channel_count) + bus_data->first_channel +
+                channel_number] = 1.0;
+        }
+      set_mix_matrix (convert_element, gains, bus_data->channel_count,
+                      channel_count);
+      g_free (gains);
+      if (bus_data->device_name != NULL)
+        g_object_set (sink_element, "device", bus_data->device_name, NULL);
+
+      gst_bin_add_many (GST_BIN (buses_bin_element), queue_element,
+                        convert_element, filter_element, sink_element, NULL);
+      gst_element_link_many (tee_element, queue_element, convert_element,
+                             filter_element, sink_element, NULL);
+      if (*device_sink_element == NULL)
+        *device_sink_element = sink_element;
+    }
+
+  sink_pad = gst_element_get_static_pad (tee_element, "sink");
+  gst_element_add_pad (buses_bin_element,
+                       gst_ghost_pad_new ("sink", sink_pad));
+  gst_object_unref (sink_pad);
+
+  return buses_bin_element;
+}
+
+/* Create the element that plays the mixed sound.  Usually this is the
+ * sink for the sound output device, but if the show's buses go to
+ * different devices it is a bin holding a sink for each.  Also return
+ * the sink whose lateness is counted.  */
+static GstElement *
+create_output (GstElement ** device_sink_element, GApplication * app)
+{
+  GstElement *sink_element;
+  const struct routing_bus *bus_data;
+  gint bus_number;
+
+  if (routing_get_device (app) == NULL)
+    {
+      for (bus_number = 0; bus_number < routing_get_bus_count (app);
+           bus_number++)
+        {
+          bus_data = routing_get_bus (bus_number, app);
+          if (bus_data->device_name != NULL)
+            return create_bus_outputs (device_sink_element, app);
+        }
+    }
+
+  sink_element = gst_element_factory_make ("alsasink", "final/sink");
+  if ((sink_element != NULL) && (routing_get_device (app) != NULL))
+    g_object_set (sink_element, "device", routing_get_device (app), NULL);
+  *device_sink_element = sink_element;
+  return sink_element;
+}
 
 /* Set up the Gstreamer pipeline. */
 GstPipeline *
@@ -38,7 +214,10 @@ gstreamer_init (int sound_count, GApplication * app)
   GstElement *queue_output_element;
   GstElement *wavenc_element;
   GstElement *filesink_element;
+  GstElement *monitor_element;
   GstElement *sink_element;
+  GstElement *device_sink_element;
+  GstElement *channels_element;
   GstElement *adder_element;
   GstElement *convert_element;
   GstElement *resample_element;
@@ -53,6 +232,7 @@ gstreamer_init (int sound_count, GApplication * app)
   gchar *monitor_file_name;
   gboolean monitor_enabled;
   gboolean output_enabled;
+  gint channel_count;
 
   /* Check to see if --monitor-file was specified on the command line.  */
   monitor_file_name = main_get_monitor_file_name ();
@@ -62,8 +242,25 @@ gstreamer_init (int sound_count, GApplication * app)
       monitor_enabled = TRUE;
     }
 
-  /* We always send sound to the default sound output device.  */
+  /* We normally send sound to the default sound output device.  When
+   * rendering offline the show goes only to the render file, so nothing
+   * paces the pipeline to real time.  */
   output_enabled = TRUE;
+  if (main_get_render_file_name () != NULL)
+    {
+      monitor_file_name = main_get_render_file_name ();
+      monitor_enabled = TRUE;
+      output_enabled = FALSE;
+    }
+
+  /* While playing, the monitor file is written by its own thread.  If
+   * that could not start, because the file could not be opened, there
+   * is no monitor file.  */
+  if ((monitor_enabled == TRUE) && (output_enabled == TRUE)
+      && (sep_get_monitor_data (app) == NULL))
+    {
+      monitor_enabled = FALSE;
+    }
 
   /* Create the top-level pipeline.  */
   pipeline_element = GST_PIPELINE (gst_pipeline_new ("sound_effects"));
@@ -98,9 +295,10 @@ gstreamer_init (int sound_count, GApplication * app)
       tee_element = NULL;
       queue_file_element = NULL;
       queue_output_element = NULL;
-      sink_element = gst_element_factory_make ("alsasink", "final/sink");
+      sink_element = create_output (&device_sink_element, app);
       wavenc_element = NULL;
       filesink_element = NULL;
+      monitor_element = NULL;
       if (sink_element == NULL)
         {
           GST_ERROR ("Unable to create the final sink gstreamer element.\n");
@@ -112,9 +310,11 @@ gstreamer_init (int sound_count, GApplication * app)
       queue_file_element = NULL;
       queue_output_element = NULL;
       sink_element = NULL;
+      device_sink_element = NULL;
       wavenc_element = gst_element_factory_make ("wavenc", "final/wavenc");
       filesink_element =
         gst_element_factory_make ("filesink", "final/filesink");
+      monitor_element = NULL;
       if ((wavenc_element == NULL) || (filesink_element == NULL))
         {
           GST_ERROR ("Unable to create the final sink gstreamer elements.\n");
@@ -127,26 +327,44 @@ gstreamer_init (int sound_count, GApplication * app)
         gst_element_factory_make ("queue", "final/queue_file");
       queue_output_element =
         gst_element_factory_make ("queue", "final/queue_output");
-      sink_element = gst_element_factory_make ("alsasink", "final/sink");
-      wavenc_element = gst_element_factory_make ("wavenc", "final/wavenc");
-      filesink_element =
-        gst_element_factory_make ("filesink", "final/filesink");
+      sink_element = create_output (&device_sink_element, app);
+      wavenc_element = NULL;
+      filesink_element = NULL;
+      monitor_element = gst_element_factory_make ("appsink", "final/monitor");
       if ((tee_element == NULL) || (queue_file_element == NULL)
           || (queue_output_element == NULL) || (sink_element == NULL)
-          || (wavenc_element == NULL) || (filesink_element == NULL))
+          || (monitor_element == NULL))
         {
           GST_ERROR ("Unable to create the final sink gstreamer elements.\n");
         }
     }
 
+  /* If the show defines buses, the mix has all of their channels.  */
+  channel_count = routing_get_channel_count (app);
+  channels_element = NULL;
+  if (channel_count > 0)
+    {
+      channels_element =
+        create_channel_filter ("final/channels", channel_count);
+      if (channels_element == NULL)
+        {
+          GST_ERROR ("Unable to create the final channels element.\n");
+          return NULL;
+        }
+    }
+
   /* Put the needed elements into the final bin.  */
   gst_bin_add_many (GST_BIN (final_bin_element), adder_element, level_element,
                     convert_element, resample_element, volume_element, NULL);
+  if (channels_element != NULL)
+    {
+      gst_bin_add (GST_BIN (final_bin_element), channels_element);
+    }
   if (output_enabled == TRUE)
     {
       gst_bin_add_many (GST_BIN (final_bin_element), sink_element, NULL);
     }
-  if (monitor_enabled == TRUE)
+  if ((output_enabled == FALSE) && (monitor_enabled == TRUE))
     {
       gst_bin_add_many (GST_BIN (final_bin_element), wavenc_element,
                         filesink_element, NULL);
@@ -154,22 +372,33 @@ gstreamer_init (int sound_count, GApplication * app)
   if ((output_enabled == TRUE) && (monitor_enabled == TRUE))
     {
       gst_bin_add_many (GST_BIN (final_bin_element), tee_element,
-                        queue_file_element, queue_output_element, NULL);
+                        queue_file_element, queue_output_element,
+                        monitor_element, NULL);
     }
 
   /* Make sure we will get level messages. */
   g_object_set (level_element, "post-messages", TRUE, NULL);
 
-  if (monitor_enabled == TRUE)
+  if ((output_enabled == FALSE) && (monitor_enabled == TRUE))
     {
-      /* Set the file name for monitoring the output.  */
+      /* Set the file name for rendering the output.  */
       g_object_set (filesink_element, "location", monitor_file_name, NULL);
     }
+  if ((output_enabled == TRUE) && (monitor_enabled == TRUE))
+    {
+      /* Pass the output to the monitor file's writer.  */
+      monitor_attach (monitor_element, queue_file_element, app);
+    }
 
   /* Watch for messages from the pipeline.  */
   bus = gst_element_get_bus (GST_ELEMENT (pipeline_element));
   gst_bus_add_watch (bus, message_handler, app);
 
+  /* If we are to run in real time, raise each streaming thread's
+   * priority as it starts.  */
+  if (sep_get_realtime_data (app) != NULL)
+    gst_bus_set_sync_handler (bus, message_sync_handler, app, NULL);
+
   /* The inputs to the final bin are the inputs to the adder.  Create enough
    * sinks for each sound effect.  */
   for (i = 0; i < sound_count; i++)
@@ -184,7 +413,15 @@ gstreamer_init (int sound_count, GApplication * app)
   /* Link the various elements in the final bin together.  */
   gst_element_link (adder_element, level_element);
   gst_element_link (level_element, convert_element);
-  gst_element_link (convert_element, resample_element);
+  if (channels_element != NULL)
+    {
+      gst_element_link (convert_element, channels_element);
+      gst_element_link (channels_element, resample_element);
+    }
+  else
+    {
+      gst_element_link (convert_element, resample_element);
+    }
   gst_element_link (resample_element, volume_element);
   if ((output_enabled == TRUE) && (monitor_enabled == FALSE))
     {
@@ -201,16 +438,88 @@ gstreamer_init (int sound_count, GApplication * app)
       gst_element_link (tee_element, queue_file_element);
       gst_element_link (tee_element, queue_output_element);
       gst_element_link (queue_output_element, sink_element);
-      gst_element_link (queue_file_element, wavenc_element);
-      gst_element_link (wavenc_element, filesink_element);
+      gst_element_link (queue_file_element, monitor_element);
     }
 
+  /* Count the buffers that reach the sound output device too late.  */
+  if (output_enabled == TRUE)
+    qos_watch_master (device_sink_element, app);
+
   /* Place the final bin in the pipeline. */
   gst_bin_add (GST_BIN (pipeline_element), final_bin_element);
 
   return pipeline_element;
 }
 
+/* Set the parameters of the looper, envelope, pan and panner elements
+ * of a sound effect bin from the sound's definition.  The pan element
+ * is NULL if the sound omits panning, and the panner is NULL if the
+ * show has no buses.  In a show with buses the pan element is the
+ * panner.  */
+static void
+set_bin_parameters (struct sound_info *sound_data,
+                    GstElement * looper_element,
+                    GstElement * envelope_element, GstElement * pan_element,
+                    GstElement * panner_element, GApplication * app)
+{
+  gchar string_buffer[G_ASCII_DTOSTR_BUF_SIZE];
+  gfloat gains[ROUTING_MAX_CHANNELS * 2];
+
+  g_object_set (looper_element, "loop-to", sound_data->loop_to_time, NULL);
+  g_object_set (looper_element, "loop-from", sound_data->loop_from_time,
+                NULL);
+  g_object_set (looper_element, "loop-limit", sound_data->loop_limit, NULL);
+  g_object_set (looper_element, "max-duration", sound_data->max_duration_time,
+                NULL);
+  g_object_set (looper_element, "start-time", sound_data->start_time, NULL);
+
+  g_object_set (envelope_element, "attack-duration-time",
+                sound_data->attack_duration_time, NULL);
+  g_object_set (envelope_element, "attack_level", sound_data->attack_level,
+                NULL);
+  g_object_set (envelope_element, "decay-duration-time",
+                sound_data->decay_duration_time, NULL);
+  g_object_set (envelope_element, "sustain-level", sound_data->sustain_level,
+                NULL);
+  g_object_set (envelope_element, "release-start-time",
+                sound_data->release_start_time, NULL);
+  if (sound_data->release_duration_infinite)
+    {
+      g_object_set (envelope_element, "release-duration-time",
+                    (gchar *) "∞", NULL);
+    }
+  else
+    {
+      g_ascii_dtostr (string_buffer, G_ASCII_DTOSTR_BUF_SIZE,
+                      (gdouble) sound_data->release_duration_time);
+      g_object_set (envelope_element, "release-duration-time", string_buffer,
+                    NULL);
+    }
+  /* We don't need another volume element because the envelope element
+   * can also take a volume parameter which makes a global adjustment
+   * to the envelope, thus adjusting the volume.  */
+  g_object_set (envelope_element, "volume", sound_data->designer_volume_level,
+                NULL);
+  g_object_set (envelope_element, "sound-name", sound_data->name, NULL);
+  g_object_set (envelope_element, "meter-snapshot",
+                sound_data->meter_snapshot, NULL);
+
+  if (pan_element != NULL)
+    {
+      g_object_set (pan_element, "panorama", sound_data->designer_pan, NULL);
+    }
+
+  /* The panner places the sound on the buses' channels.  */
+  if (panner_element != NULL)
+    {
+      routing_get_gains (sound_data, gains, app);
+      set_mix_matrix (panner_element, gains, routing_get_channel_count (app),
+                      2);
+    }
+
+  return;
+}
+
 /* Create a Gstreamer bin for a sound effect.  */
 GstBin *
 gstreamer_create_bin (struct sound_info * sound_data, int sound_number,
@@ -219,12 +528,14 @@ gstreamer_create_bin (struct sound_info * sound_data, int sound_number,
   GstElement *source_element, *parse_element, *convert_element;
   GstElement *resample_element, *looper_element;
   GstElement *envelope_element, *pan_element, *volume_element;
+  GstElement *panner_element, *channels_element;
+  GstElement *last_element;
   GstElement *bin_element, *final_bin_element;
   gchar *sound_name, *pad_name, *element_name;
   GstPad *last_source_pad, *sink_pad;
   GstPadLinkReturn link_status;
   gboolean success;
-  gchar string_buffer[G_ASCII_DTOSTR_BUF_SIZE];
+  gint channel_count;
 
   /* Create the bin, source and various filter elements for this sound effect. 
    */
@@ -283,7 +594,35 @@ gstreamer_create_bin (struct sound_info * sound_data, int sound_number,
       return NULL;
     }
   g_free (element_name);
-  if (!sound_data->omit_panning)
+
+  /* If the show defines buses, the panner places the sound on their
+   * channels, and is also the pan element unless the sound omits
+   * panning.  Otherwise the sound stays stereo, and audiopanorama
+   * pans it.  */
+  channel_count = routing_get_channel_count (app);
+  pan_element = NULL;
+  panner_element = NULL;
+  channels_element = NULL;
+  if (channel_count > 0)
+    {
+      if (!sound_data->omit_panning)
+        element_name = g_strconcat (sound_name, (gchar *) "/pan", NULL);
+      else
+        element_name = g_strconcat (sound_name, (gchar *) "/router", NULL);
+      panner_element = gst_element_factory_make ("panner", element_name);
+      g_free (element_name);
+      element_name = g_strconcat (sound_name, (gchar *) "/channels", NULL);
+      channels_element = create_channel_filter (element_name, channel_count);
+      g_free (element_name);
+      if ((panner_element == NULL) || (channels_element == NULL))
+        {
+          GST_ERROR ("Unable to create the panner elements.\n");
+          return NULL;
+        }
+      if (!sound_data->omit_panning)
+        pan_element = panner_element;
+    }
+  else if (!sound_data->omit_panning)
     {
       element_name = g_strconcat (sound_name, (gchar *) "/pan", NULL);
       pan_element = gst_element_factory_make ("audiopanorama", element_name);
@@ -294,10 +633,6 @@ gstreamer_create_bin (struct sound_info * sound_data, int sound_number,
         }
       g_free (element_name);
     }
-  else
-    {
-      pan_element = NULL;
-    }
 
   element_name = g_strconcat (sound_name, (gchar *) "/volume", NULL);
   volume_element = gst_element_factory_make ("volume", element_name);
@@ -318,53 +653,19 @@ gstreamer_create_bin (struct sound_info * sound_data, int sound_number,
 
   g_object_set (looper_element, "file-location",
                 sound_data->wav_file_name_full, NULL);
-  g_object_set (looper_element, "loop-to", sound_data->loop_to_time, NULL);
-  g_object_set (looper_element, "loop-from", sound_data->loop_from_time,
-                NULL);
-  g_object_set (looper_element, "loop-limit", sound_data->loop_limit, NULL);
-  g_object_set (looper_element, "max-duration", sound_data->max_duration_time,
-                NULL);
-  g_object_set (looper_element, "start-time", sound_data->start_time, NULL);
-
-  g_object_set (envelope_element, "attack-duration-time",
-                sound_data->attack_duration_time, NULL);
-  g_object_set (envelope_element, "attack_level", sound_data->attack_level,
-                NULL);
-  g_object_set (envelope_element, "decay-duration-time",
-                sound_data->decay_duration_time, NULL);
-  g_object_set (envelope_element, "sustain-level", sound_data->sustain_level,
-                NULL);
-  g_object_set (envelope_element, "release-start-time",
-                sound_data->release_start_time, NULL);
-  if (sound_data->release_duration_infinite)
-    {
-      g_object_set (envelope_element, "release-duration-time",
-                    (gchar *) "∞", NULL);
-    }
-  else
-    {
-      g_ascii_dtostr (string_buffer, G_ASCII_DTOSTR_BUF_SIZE,
-                      (gdouble) sound_data->release_duration_time);
-      g_object_set (envelope_element, "release-duration-time", string_buffer,
-                    NULL);
-    }
-  /* We don't need another volume element because the envelope element
-   * can also take a volume parameter which makes a global adjustment
-   * to the envelope, thus adjusting the volume.  */
-  g_object_set (envelope_element, "volume", sound_data->designer_volume_level,
-                NULL);
-  g_object_set (envelope_element, "sound-name", sound_data->name, NULL);
-
-  if (!sound_data->omit_panning)
-    {
-      g_object_set (pan_element, "panorama", sound_data->designer_pan, NULL);
-    }
+  set_bin_parameters (sound_data, looper_element, envelope_element,
+                      pan_element, panner_element, app);
 
   /* Place the various elements in the bin. */
   gst_bin_add_many (GST_BIN (bin_element), source_element, parse_element,
                     looper_element, convert_element, resample_element,
                     envelope_element, volume_element, NULL);
-  if (!sound_data->omit_panning)
+  if (panner_element != NULL)
+    {
+      gst_bin_add_many (GST_BIN (bin_element), panner_element,
+                        channels_element, NULL);
+    }
+  else if (pan_element != NULL)
     {
       gst_bin_add_many (GST_BIN (bin_element), pan_element, NULL);
     }
@@ -374,13 +675,23 @@ gstreamer_create_bin (struct sound_info * sound_data, int sound_number,
    * Note that because the looper reads the wave file directly, as well
    * as getting it through the pipeline, the audio converter must be
    * after it.  It is for this reason that the looper handles a variety
-   * of audio formats.  Note also that the pan element is optional.  */
+   * of audio formats.  Note also that the pan element is optional.
+   * In a show with buses the order is instead
+   * envelope->volume->panner->channels, so the volume is applied
+   * before the sound is spread over many channels.  */
   gst_element_link (source_element, parse_element);
   gst_element_link (parse_element, looper_element);
   gst_element_link (looper_element, convert_element);
   gst_element_link (convert_element, resample_element);
   gst_element_link (resample_element, envelope_element);
-  if (!sound_data->omit_panning)
+  last_element = volume_element;
+  if (panner_element != NULL)
+    {
+      gst_element_link_many (envelope_element, volume_element,
+                             panner_element, channels_element, NULL);
+      last_element = channels_element;
+    }
+  else if (pan_element != NULL)
     {
       gst_element_link (envelope_element, pan_element);
       gst_element_link (pan_element, volume_element);
@@ -391,10 +702,13 @@ gstreamer_create_bin (struct sound_info * sound_data, int sound_number,
     }
 
   /* The output of the bin is the output of the last element. */
-  last_source_pad = gst_element_get_static_pad (volume_element, "src");
+  last_source_pad = gst_element_get_static_pad (last_element, "src");
   gst_element_add_pad (bin_element,
                        gst_ghost_pad_new ("src", last_source_pad));
 
+  /* Count the buffers that leave the looper or the bin too late.  */
+  qos_watch_voice (sound_data->name, looper_element, last_element, app);
+
   /* Place the bin in the pipeline. */
   success = gst_bin_add (GST_BIN (pipeline_element), bin_element);
   if (!success)
@@ -417,13 +731,204 @@ gstreamer_create_bin (struct sound_info * sound_data, int sound_number,
     }
   g_free (pad_name);
 
-  if (GSTREAMER_TRACE)
+  if (TRACE_RING_ENABLED (trace_gstreamer))
     {
-      g_print ("created gstreamer bin for %s.\n", sound_data->name);
+      trace_ring_record (trace_gstreamer, "created gstreamer bin for %s.",
+                         sound_data->name);
     }
   return (GST_BIN (bin_element));
 }
 
+/* Add an input to the final bin of a running pipeline, for a sound
+ * effect bin created after the pipeline was completed.  Return the
+ * number of the input, to pass to gstreamer_create_bin.  */
+static gint
+add_input (GstPipeline * pipeline_element)
+{
+  GstElement *final_bin_element, *adder_element;
+  GstPad *sink_pad, *ghost_pad;
+  gchar *pad_name;
+  gint sound_number;
+
+  final_bin_element =
+    gst_bin_get_by_name (GST_BIN (pipeline_element), (gchar *) "final");
+  adder_element =
+    gst_bin_get_by_name (GST_BIN (final_bin_element),
+                         (gchar *) "final/adder");
+
+  /* Inputs are removed along with their bins, so use the lowest
+   * number that is not in use.  */
+  sound_number = 0;
+  while (TRUE)
+    {
+      pad_name = g_strdup_printf ("sink %d", sound_number);
+      ghost_pad = gst_element_get_static_pad (final_bin_element, pad_name);
+      if (ghost_pad == NULL)
+        break;
+      gst_object_unref (ghost_pad);
+      g_free (pad_name);
+      sound_number = sound_number + 1;
+    }
+
+  sink_pad = gst_element_get_request_pad (adder_element, "sink_%u");
+  ghost_pad = gst_ghost_pad_new (pad_name, sink_pad);
+  gst_pad_set_active (ghost_pad, TRUE);
+  gst_element_add_pad (final_bin_element, ghost_pad);
+  g_free (pad_name);
+
+  gst_object_unref (sink_pad);
+  gst_object_unref (adder_element);
+  gst_object_unref (final_bin_element);
+
+  return sound_number;
+}
+
+/* Remove an input from the final bin, releasing the adder's input 
+ * behind it.  The adder would otherwise wait for data on it.  */
+static void
+remove_input (GstPad * ghost_pad)
+{
+  GstElement *final_bin_element, *adder_element;
+  GstPad *sink_pad;
+
+  final_bin_element = gst_pad_get_parent_element (ghost_pad);
+  sink_pad = gst_ghost_pad_get_target (GST_GHOST_PAD (ghost_pad));
+  if (sink_pad != NULL)
+    {
+      adder_element = gst_pad_get_parent_element (sink_pad);
+      gst_element_release_request_pad (adder_element, sink_pad);
+      gst_object_unref (adder_element);
+      gst_object_unref (sink_pad);
+    }
+  gst_element_remove_pad (final_bin_element, ghost_pad);
+  gst_object_unref (final_bin_element);
+
+  return;
+}
+
+/* Create a Gstreamer bin for a sound effect and add it to a running
+ * pipeline.  Sounds already in the pipeline are not disturbed.  */
+GstBin *
+gstreamer_add_bin (struct sound_info * sound_data,
+                   GstPipeline * pipeline_element, GApplication * app)
+{
+  GstElement *final_bin_element;
+  GstPad *ghost_pad;
+  GstBin *bin_element;
+  gchar *pad_name;
+  gint sound_number;
+
+  sound_number = add_input (pipeline_element);
+  bin_element =
+    gstreamer_create_bin (sound_data, sound_number, pipeline_element, app);
+  if (bin_element == NULL)
+    {
+      /* Don't leave the adder waiting on an input that will never
+       * receive data.  */
+      final_bin_element =
+        gst_bin_get_by_name (GST_BIN (pipeline_element), (gchar *) "final");
+      pad_name = g_strdup_printf ("sink %d", sound_number);
+      ghost_pad = gst_element_get_static_pad (final_bin_element, pad_name);
+      remove_input (ghost_pad);
+      gst_object_unref (ghost_pad);
+      gst_object_unref (final_bin_element);
+      g_free (pad_name);
+      return NULL;
+    }
+
+  /* Bring the new bin up to the state of the pipeline.  */
+  gst_element_sync_state_with_parent (GST_ELEMENT (bin_element));
+
+  return bin_element;
+}
+
+/* Find the panner of a sound that omits panning, in a show with
+ * buses.  */
+static GstElement *
+get_router (GstBin * bin_element)
+{
+  GstElement *router_element;
+  gchar *element_name, *bin_name;
+
+  bin_name = gst_element_get_name (bin_element);
+  element_name = g_strconcat (bin_name, (gchar *) "/router", NULL);
+  g_free (bin_name);
+  router_element = gst_bin_get_by_name (bin_element, element_name);
+  g_free (element_name);
+
+  return (router_element);
+}
+
+/* Change the parameters of a sound effect bin to match the sound's
+ * definition.  Parameters that need a new bin, such as the WAV file,
+ * are not changed.  A playing sound continues with the new 
+ * parameters.  */
+void
+gstreamer_update_bin (GstBin * bin_element, struct sound_info *sound_data,
+                      GApplication * app)
+{
+  GstElement *looper_element, *envelope_element, *pan_element;
+  GstElement *panner_element;
+
+  looper_element = gstreamer_get_looper (bin_element);
+  envelope_element = gstreamer_get_envelope (bin_element);
+  pan_element = gstreamer_get_pan (bin_element);
+  panner_element = NULL;
+  if (routing_get_channel_count (app) > 0)
+    {
+      if (pan_element != NULL)
+        panner_element = gst_object_ref (pan_element);
+      else
+        panner_element = get_router (bin_element);
+    }
+
+  set_bin_parameters (sound_data, looper_element, envelope_element,
+                      pan_element, panner_element, app);
+
+  gst_object_unref (looper_element);
+  gst_object_unref (envelope_element);
+  if (pan_element != NULL)
+    gst_object_unref (pan_element);
+  if (panner_element != NULL)
+    gst_object_unref (panner_element);
+
+  if (TRACE_RING_ENABLED (trace_gstreamer))
+    {
+      trace_ring_record (trace_gstreamer, "updated gstreamer bin for %s.",
+                         sound_data->name);
+    }
+  return;
+}
+
+/* Remove a sound effect bin from a running pipeline, along with its
+ * input to the final bin.  The sound must not be playing.  */
+void
+gstreamer_remove_bin (GstBin * bin_element, GstPipeline * pipeline_element,
+                      GApplication * app)
+{
+  GstPad *source_pad, *ghost_pad;
+
+  /* Stop the bin's streaming before unlinking it, so it does not
+   * push into an unlinked pad, and keep the pipeline from changing
+   * its state again.  */
+  gst_element_set_locked_state (GST_ELEMENT (bin_element), TRUE);
+  gst_element_set_state (GST_ELEMENT (bin_element), GST_STATE_NULL);
+
+  source_pad = gst_element_get_static_pad (GST_ELEMENT (bin_element), "src");
+  ghost_pad = gst_pad_get_peer (source_pad);
+  if (ghost_pad != NULL)
+    {
+      gst_pad_unlink (source_pad, ghost_pad);
+      remove_input (ghost_pad);
+      gst_object_unref (ghost_pad);
+    }
+  gst_object_unref (source_pad);
+
+  gst_bin_remove (GST_BIN (pipeline_element), GST_ELEMENT (bin_element));
+
+  return;
+}
+
 /* After the individual bins are created, complete the pipeline.  */
 void
 gstreamer_complete_pipeline (GstPipeline * pipeline_element,
@@ -458,9 +963,9 @@ gstreamer_complete_pipeline (GstPipeline * pipeline_element,
         }
     }
 
-  if (GSTREAMER_TRACE)
+  if (TRACE_RING_ENABLED (trace_gstreamer))
     {
-      g_print ("started the gstreamer pipeline.\n");
+      trace_ring_record (trace_gstreamer, "started the gstreamer pipeline.");
     }
   return;
 }
@@ -589,6 +1094,22 @@ gstreamer_get_looper (GstBin * bin_element)
   return (looper_element);
 }
 
+/* Find the envelope element in a bin. */
+GstElement *
+gstreamer_get_envelope (GstBin * bin_element)
+{
+  GstElement *envelope_element;
+  gchar *element_name, *bin_name;
+
+  bin_name = gst_element_get_name (bin_element);
+  element_name = g_strconcat (bin_name, (gchar *) "/envelope", NULL);
+  g_free (bin_name);
+  envelope_element = gst_bin_get_by_name (bin_element, element_name);
+  g_free (element_name);
+
+  return (envelope_element);
+}
+
 /* For debugging, write out an annotated, graphical representation
  * of the gstreamer pipeline.
  */
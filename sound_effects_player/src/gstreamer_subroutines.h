@@ -25,6 +25,14 @@ GstPipeline *gstreamer_init (int sound_count, GApplication * app);
 GstBin *gstreamer_create_bin (struct sound_info *sound_data, int sound_number,
                               GstPipeline * pipeline_element,
                               GApplication * app);
+GstBin *gstreamer_add_bin (struct sound_info *sound_data,
+                           GstPipeline * pipeline_element,
+                           GApplication * app);
+void gstreamer_update_bin (GstBin * bin_element, struct sound_info *sound_data,
+                           GApplication * app);
+void gstreamer_remove_bin (GstBin * bin_element,
+                           GstPipeline * pipeline_element,
+                           GApplication * app);
 void gstreamer_complete_pipeline (GstPipeline * pipeline_element,
                                   GApplication * app);
 void gstreamer_shutdown (GApplication * app);
@@ -33,4 +41,5 @@ void gstreamer_process_eos (GApplication * app);
 GstElement *gstreamer_get_volume (GstBin * bin_element);
 GstElement *gstreamer_get_pan (GstBin * bin_element);
 GstElement *gstreamer_get_looper (GstBin * bin_element);
+GstElement *gstreamer_get_envelope (GstBin * bin_element);
 void gstreamer_dump_pipeline (GstPipeline * pipeline_element);
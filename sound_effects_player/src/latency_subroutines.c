@@ -0,0 +1,269 @@
+/*
+ * latency_subroutines.c
+ *
+ * Copyright © 2016 by John Sauter <John_Sauter@systemeyescomputerstore.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <gtk/gtk.h>
+#include "latency_subroutines.h"
+#include "sound_effects_player.h"
+#include "telemetry_subroutines.h"
+#include "trace_ring_subroutines.h"
+
+/* Measure how long it takes from an operator pushing a Start button,
+ * or a start command arriving from the network, until the sound can
+ * be heard.  The trigger is stamped with the monotonic time when it
+ * arrives.  The stamp is carried through the sequencer and in the
+ * custom start event sent to the sound's bin.  The looper and the
+ * envelope each post a "latency" message holding the stamp and the
+ * time they reached their stage:
+ *
+ *   sequencer    the start event has been sent to the bin
+ *   looper       the looper has started draining its buffer
+ *   envelope     the envelope has first applied a non-zero gain
+ *
+ * A sound started by the sequencer on its own, for example after a
+ * wait, is measured from when its start event was sent.  */
+
+enum latency_stages
+{ latency_stage_sequencer = 0, latency_stage_looper, latency_stage_envelope,
+  latency_stage_count
+};
+
+static const gchar *stage_names[latency_stage_count] = {
+  "sequencer", "looper", "envelope"
+};
+
+/* The persistent data used by the latency measurements.  */
+struct latency_info
+{
+  /* The trigger being performed, or zero if none.  */
+  gint64 trigger_time;
+
+  /* From the trigger to each stage.  */
+  struct latency_statistics stage[latency_stage_count];
+};
+
+/* Add a latency, in nanoseconds, to the statistics.  */
+void
+latency_record (struct latency_statistics *statistics, gint64 latency)
+{
+  gint64 microseconds;
+  gint bucket;
+
+  if (latency < 0)
+    latency = 0;
+  statistics->count = statistics->count + 1;
+  statistics->total = statistics->total + latency;
+  if (latency > statistics->maximum)
+    statistics->maximum = latency;
+
+  /* Bucket 0 holds latencies under one microsecond, bucket 1 under
+   * two, bucket 2 under four, and so on.  The last bucket holds 
+   * everything longer.  */
+  microseconds = latency / 1000;
+  for (bucket = 0; (microseconds > 0) && (bucket < LATENCY_BUCKETS - 1);
+       bucket++)
+    microseconds = microseconds >> 1;
+  statistics->histogram[bucket] = statistics->histogram[bucket] + 1;
+
+  return;
+}
+
+/* Print one set of latency statistics.  */
+void
+latency_print (const gchar * title, struct latency_statistics *statistics)
+{
+  gint bucket;
+
+  if (statistics->count == 0)
+    return;
+
+  g_print ("%s: %" G_GUINT64_FORMAT " commands, mean %.1f, maximum %.1f "
+           "microseconds.\n", title, statistics->count,
+           (gdouble) statistics->total / statistics->count / 1000.0,
+           (gdouble) statistics->maximum / 1000.0);
+  for (bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+    {
+      if (statistics->histogram[bucket] == 0)
+        continue;
+      if (bucket == LATENCY_BUCKETS - 1)
+        g_print ("  %" G_GUINT64_FORMAT " at least %d microseconds.\n",
+                 statistics->histogram[bucket], 1 << (bucket - 1));
+      else
+        g_print ("  %" G_GUINT64_FORMAT " under %d microseconds.\n",
+                 statistics->histogram[bucket], 1 << bucket);
+    }
+
+  return;
+}
+
+/* Initialize the latency measurements.  */
+void *
+latency_init (GApplication * app)
+{
+  struct latency_info *latency_data;
+
+  latency_data = g_malloc0 (sizeof (struct latency_info));
+  return (latency_data);
+}
+
+/* An operator or network command is being performed.  */
+void
+latency_trigger (gint64 trigger_time, GApplication * app)
+{
+  struct latency_info *latency_data;
+
+  latency_data = sep_get_latency_data (app);
+  if (latency_data == NULL)
+    return;
+
+  latency_data->trigger_time = trigger_time;
+  return;
+}
+
+/* The command has been performed.  Sounds the sequencer starts from now
+ * on are not its doing.  */
+void
+latency_trigger_done (GApplication * app)
+{
+  struct latency_info *latency_data;
+
+  latency_data = sep_get_latency_data (app);
+  if (latency_data == NULL)
+    return;
+
+  latency_data->trigger_time = 0;
+  return;
+}
+
+/* A sound is being started.  If a command caused it, measure the time
+ * through the sequencer.  Return the time to measure the rest of the
+ * stages from.  */
+gint64
+latency_sound_starting (GApplication * app)
+{
+  struct latency_info *latency_data;
+  gint64 now;
+
+  now = g_get_monotonic_time () * 1000;
+  latency_data = sep_get_latency_data (app);
+  if ((latency_data == NULL) || (latency_data->trigger_time == 0))
+    return now;
+
+  latency_record (&latency_data->stage[latency_stage_sequencer],
+                  now - latency_data->trigger_time);
+  return latency_data->trigger_time;
+}
+
+/* The looper or the envelope has reached its stage of starting a sound.  */
+void
+latency_stage_reached (const gchar * stage_name, gint64 trigger_time,
+                       gint64 stage_time, GApplication * app)
+{
+  struct latency_info *latency_data;
+  gint stage;
+
+  latency_data = sep_get_latency_data (app);
+  if ((latency_data == NULL) || (stage_name == NULL) || (trigger_time == 0))
+    return;
+
+  for (stage = 0; stage < latency_stage_count; stage++)
+    {
+      if (g_strcmp0 (stage_name, stage_names[stage]) == 0)
+        break;
+    }
+  if (stage == latency_stage_count)
+    return;
+
+  if (TRACE_RING_ENABLED (trace_latency))
+    {
+      trace_ring_record (trace_latency, "latency to %s: %.1f microseconds.",
+                         stage_name,
+                         (gdouble) (stage_time - trigger_time) / 1000.0);
+    }
+
+  latency_record (&latency_data->stage[stage], stage_time - trigger_time);
+  return;
+}
+
+/* Send the latency histograms to the remote controllers.  Each stage
+ * is a line of the form
+ *   latency <stage> <count> <mean> <maximum> <bucket counts>
+ * with the times in microseconds and the bucket counts separated by
+ * commas, through the last bucket that is not empty.  */
+void
+latency_send_statistics (GApplication * app)
+{
+  struct latency_info *latency_data;
+  struct latency_statistics *statistics;
+  GString *line;
+  gint stage, bucket, last_bucket;
+
+  latency_data = sep_get_latency_data (app);
+  if (latency_data == NULL)
+    return;
+
+  line = g_string_new (NULL);
+  for (stage = 0; stage < latency_stage_count; stage++)
+    {
+      statistics = &latency_data->stage[stage];
+      if (statistics->count == 0)
+        continue;
+
+      g_string_printf (line, "latency %s %" G_GUINT64_FORMAT " %.1f %.1f ",
+                       stage_names[stage], statistics->count,
+                       (gdouble) statistics->total / statistics->count /
+                       1000.0, (gdouble) statistics->maximum / 1000.0);
+      last_bucket = 0;
+      for (bucket = 0; bucket < LATENCY_BUCKETS; bucket++)
+        {
+          if (statistics->histogram[bucket] != 0)
+            last_bucket = bucket;
+        }
+      for (bucket = 0; bucket <= last_bucket; bucket++)
+        {
+          g_string_append_printf (line, "%s%" G_GUINT64_FORMAT,
+                                  bucket == 0 ? "" : ",",
+                                  statistics->histogram[bucket]);
+        }
+      telemetry_statistics (line->str, app);
+    }
+  g_string_free (line, TRUE);
+
+  return;
+}
+
+/* Print the latency from commands to sound.  */
+void
+latency_print_statistics (GApplication * app)
+{
+  struct latency_info *latency_data;
+
+  latency_data = sep_get_latency_data (app);
+  if (latency_data == NULL)
+    return;
+
+  latency_print ("command to start event sent",
+                 &latency_data->stage[latency_stage_sequencer]);
+  latency_print ("command to looper draining",
+                 &latency_data->stage[latency_stage_looper]);
+  latency_print ("command to envelope gain",
+                 &latency_data->stage[latency_stage_envelope]);
+
+  return;
+}
@@ -0,0 +1,68 @@
+/*
+ * latency_subroutines.h
+ *
+ * Copyright © 2016 by John Sauter <John_Sauter@systemeyescomputerstore.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <gtk/gtk.h>
+
+/* The latency histogram has a bucket for each power of two
+ * microseconds.  */
+#define LATENCY_BUCKETS 24
+
+/* A set of latency measurements.  */
+struct latency_statistics
+{
+  guint64 count;
+  gint64 total;                 /* nanoseconds */
+  gint64 maximum;               /* nanoseconds */
+  guint64 histogram[LATENCY_BUCKETS];
+};
+
+/* Subroutines defined in latency_subroutines.c */
+
+/* Add a latency, in nanoseconds, to a set of measurements.  */
+void latency_record (struct latency_statistics *statistics, gint64 latency);
+
+/* Print a set of measurements.  */
+void latency_print (const gchar * title,
+                    struct latency_statistics *statistics);
+
+/* Initialize the measurement of command-to-sound latency.  */
+void *latency_init (GApplication * app);
+
+/* An operator or network command is being performed.  Its trigger time
+ * is monotonic, in nanoseconds.  Sounds started before latency_trigger_done
+ * are measured from that time.  */
+void latency_trigger (gint64 trigger_time, GApplication * app);
+void latency_trigger_done (GApplication * app);
+
+/* A sound is being started.  Returns the trigger time to carry in the
+ * start event.  */
+gint64 latency_sound_starting (GApplication * app);
+
+/* An element has reported reaching a stage of starting a sound.  */
+void latency_stage_reached (const gchar * stage_name, gint64 trigger_time,
+                            gint64 stage_time, GApplication * app);
+
+/* Send the latency histograms over the telemetry stream.  */
+void latency_send_statistics (GApplication * app);
+
+/* Print the latency histograms.  */
+void latency_print_statistics (GApplication * app);
+
+/* End of file latency_subroutines.h */
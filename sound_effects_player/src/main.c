@@ -24,6 +24,15 @@
 
 /* Persistent data.  */
 gchar *monitor_file_name = NULL;
+gchar **telemetry_addresses = NULL;
+gint telemetry_rate = 0;
+gboolean compile_show = FALSE;
+gchar *render_file_name = NULL;
+gchar *render_script_file_name = NULL;
+gchar *trace_categories = NULL;
+gchar *trace_dump_file_name = NULL;
+gint realtime_priority = 0;
+gchar *realtime_policy = NULL;
 
 /* The entry point for the sound_effects_player application.  
  * This is a GTK application, so much of what is done here is standard 
@@ -44,6 +53,33 @@ main (int argc, char *argv[])
      "name of the file written with the process id, for signaling"},
     {"monitor-file", 'p', 0, G_OPTION_ARG_FILENAME, &monitor_file_name,
      "name of the file which monitors output"},
+    {"telemetry-address", 't', 0, G_OPTION_ARG_STRING_ARRAY,
+     &telemetry_addresses,
+     "where to send state changes: address:port, [IPv6 address]:port, "
+     "host:port or unix:path; may be repeated"},
+    {"telemetry-rate", 'r', 0, G_OPTION_ARG_INT, &telemetry_rate,
+     "how many times per second to send state changes"},
+    {"compile", 'c', 0, G_OPTION_ARG_NONE, &compile_show,
+     "compile the project file into an image which loads quickly, "
+     "then exit"},
+    {"render", 0, 0, G_OPTION_ARG_FILENAME, &render_file_name,
+     "render the show offline, as fast as possible, into this WAV file, "
+     "then exit"},
+    {"render-script", 0, 0, G_OPTION_ARG_FILENAME, &render_script_file_name,
+     "the timed operator and network commands to perform while rendering"},
+    {"trace", 0, 0, G_OPTION_ARG_STRING, &trace_categories,
+     "what to record in the trace ring buffers: all, none, or a list of "
+     "sequencer, display, timer, messages, gstreamer, network, osc, "
+     "telemetry, show_image, reload, arena, render, latency, realtime "
+     "and signals"},
+    {"trace-dump-file", 0, 0, G_OPTION_ARG_FILENAME, &trace_dump_file_name,
+     "where to dump the trace ring buffers on SIGUSR1, on a trace dump "
+     "command and at exit"},
+    {"realtime-priority", 0, 0, G_OPTION_ARG_INT, &realtime_priority,
+     "run the audio streaming threads at this real-time priority, "
+     "and lock all memory"},
+    {"realtime-policy", 0, 0, G_OPTION_ARG_STRING, &realtime_policy,
+     "the real-time scheduling policy: fifo, the default, or rr"},
     /* add more command line options here */
     {G_OPTION_REMAINING, 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &filenames,
      "Special option that collects any remaining arguments for us"},
@@ -85,6 +121,13 @@ main (int argc, char *argv[])
     }
   g_option_context_free (ctx);
 
+  /* Rendering offline is driven entirely by its script.  */
+  if ((render_file_name != NULL) && (render_script_file_name == NULL))
+    {
+      g_print ("The --render option requires --render-script.\n");
+      return 1;
+    }
+
   /* If a process ID file was specified, write our process ID to it.  */
   if (pid_file_name != NULL)
     {
@@ -165,6 +208,20 @@ main (int argc, char *argv[])
   
   free(monitor_file_name);
   monitor_file_name = NULL;
+
+  g_strfreev (telemetry_addresses);
+  telemetry_addresses = NULL;
+
+  g_free (render_file_name);
+  render_file_name = NULL;
+  g_free (render_script_file_name);
+  render_script_file_name = NULL;
+  g_free (trace_categories);
+  trace_categories = NULL;
+  g_free (trace_dump_file_name);
+  trace_dump_file_name = NULL;
+  g_free (realtime_policy);
+  realtime_policy = NULL;
   
   return status;
 }
@@ -175,3 +232,67 @@ main_get_monitor_file_name ()
 {
   return monitor_file_name;
 }
+
+/* Fetch the places to send telemetry.  */
+gchar **
+main_get_telemetry_addresses ()
+{
+  return telemetry_addresses;
+}
+
+/* Fetch the number of telemetry datagrams to send per second.  */
+gint
+main_get_telemetry_rate ()
+{
+  return telemetry_rate;
+}
+
+/* Fetch whether we are only to compile the project file.  */
+gboolean
+main_get_compile ()
+{
+  return compile_show;
+}
+
+/* Fetch the name of the file to render the show into.  */
+gchar *
+main_get_render_file_name ()
+{
+  return render_file_name;
+}
+
+/* Fetch the name of the script which drives the offline render.  */
+gchar *
+main_get_render_script_file_name ()
+{
+  return render_script_file_name;
+}
+
+/* Fetch the categories to record in the trace ring buffers.  */
+gchar *
+main_get_trace_categories ()
+{
+  return trace_categories;
+}
+
+/* Fetch the name of the file to dump the trace ring buffers into.  */
+gchar *
+main_get_trace_dump_file_name ()
+{
+  return trace_dump_file_name;
+}
+
+/* Fetch the real-time priority of the streaming threads, or zero
+ * for normal priority.  */
+gint
+main_get_realtime_priority ()
+{
+  return realtime_priority;
+}
+
+/* Fetch the real-time scheduling policy.  */
+gchar *
+main_get_realtime_policy ()
+{
+  return realtime_policy;
+}
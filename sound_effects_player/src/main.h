@@ -23,4 +23,22 @@
 
 gchar *main_get_monitor_file_name ();
 
+gchar **main_get_telemetry_addresses ();
+
+gint main_get_telemetry_rate ();
+
+gboolean main_get_compile ();
+
+gchar *main_get_render_file_name ();
+
+gchar *main_get_render_script_file_name ();
+
+gchar *main_get_trace_categories ();
+
+gchar *main_get_trace_dump_file_name ();
+
+gint main_get_realtime_priority ();
+
+gchar *main_get_realtime_policy ();
+
 /* End of file main.h */
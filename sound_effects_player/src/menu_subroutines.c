@@ -23,6 +23,7 @@
 #include <libxml/parser.h>
 #include "menu_subroutines.h"
 #include "parse_xml_subroutines.h"
+#include "reload_subroutines.h"
 #include "network_subroutines.h"
 #include "sound_subroutines.h"
 #include "sound_effects_player.h"
@@ -153,6 +154,7 @@ static void
 new_activated (GSimpleAction * action, GVariant * parameter, gpointer app)
 {
   sep_set_project_file (NULL, app);
+  sep_set_project_filename (NULL, app);
   network_set_port (1500, app);
 
   return;
@@ -197,6 +199,15 @@ open_activated (GSimpleAction * action, GVariant * parameter, gpointer app)
   return;
 }
 
+/* Read the project file again, changing only what has changed in it.  */
+static void
+reload_activated (GSimpleAction * action, GVariant * parameter,
+                  gpointer app)
+{
+  reload_project (app);
+  return;
+}
+
 static void
 save_activated (GSimpleAction * action, GVariant * parameter, gpointer app)
 {
@@ -274,6 +285,7 @@ static GActionEntry app_entries[] = {
   {"quit", quit_activated, NULL, NULL, NULL},
   {"new", new_activated, NULL, NULL, NULL},
   {"open", open_activated, NULL, NULL, NULL},
+  {"reload", reload_activated, NULL, NULL, NULL},
   {"save", save_activated, NULL, NULL, NULL},
   {"save_as", save_as_activated, NULL, NULL, NULL},
   {"copy", copy_activated, NULL, NULL, NULL},
@@ -29,11 +29,12 @@
 #include "display_subroutines.h"
 #include "sound_subroutines.h"
 #include "gstreamer_subroutines.h"
+#include "latency_subroutines.h"
+#include "qos_subroutines.h"
+#include "realtime_subroutines.h"
 #include "sound_effects_player.h"
-
-/* When debugging, it is sometimes useful to have printouts of the
- * messages as they happen. */
-#define TRACE_MESSAGES FALSE
+#include "telemetry_subroutines.h"
+#include "trace_ring_subroutines.h"
 
 /* Process a message from the pipeline. User_data is the 
  * application, so we can reach the display.  */
@@ -45,7 +46,7 @@ message_handler (GstBus * bus_element, GstMessage * message,
 
   pipeline_element = sep_get_pipeline_from_app (user_data);
 
-  if (TRACE_MESSAGES && FALSE)
+  if (TRACE_RING_ENABLED (trace_messages) && FALSE)
     {
       /* For debugging, write out a graphical representation of the pipeline.  
        */
@@ -105,6 +106,7 @@ message_handler (GstBus * bus_element, GstMessage * message,
                 rms = pow (10, rms_dB / 20);
                 display_update_vu_meter (user_data, i, rms, peak_dB,
                                          decay_dB);
+                telemetry_meter_level (i, rms_dB, peak_dB, user_data);
               }
             break;
           }
@@ -118,10 +120,12 @@ message_handler (GstBus * bus_element, GstMessage * message,
                                NULL);
             if (GST_MESSAGE_TYPE (forward_msg) == GST_MESSAGE_EOS)
               {
-                if (TRACE_MESSAGES)
+                if (TRACE_RING_ENABLED (trace_messages))
                   {
-                    g_print ("Forwarded EOS from element %s.\n",
-                             GST_OBJECT_NAME (GST_MESSAGE_SRC (forward_msg)));
+                    trace_ring_record (trace_messages,
+                                       "Forwarded EOS from element %s.",
+                                       GST_OBJECT_NAME (GST_MESSAGE_SRC
+                                                        (forward_msg)));
                   }
                 break;
               }
@@ -150,21 +154,37 @@ message_handler (GstBus * bus_element, GstMessage * message,
             sound_release_started (sound_name, G_APPLICATION (user_data));
           }
 
+        if (gst_structure_has_name (s, (gchar *) "latency"))
+          {
+            /* The looper or envelope has reached its stage of starting
+             * a sound.  */
+            gint64 trigger_time = 0, stage_time = 0;
+
+            gst_structure_get_int64 (s, (gchar *) "trigger-time",
+                                     &trigger_time);
+            gst_structure_get_int64 (s, (gchar *) "stage-time",
+                                     &stage_time);
+            latency_stage_reached (gst_structure_get_string
+                                   (s, (gchar *) "stage"), trigger_time,
+                                   stage_time, G_APPLICATION (user_data));
+          }
+
         /* Catchall for unrecognized messages */
-        if (TRACE_MESSAGES)
+        if (TRACE_RING_ENABLED (trace_messages))
           {
-            g_print (" Message element: %s from %s.\n",
-                     gst_structure_get_name (s),
-                     GST_OBJECT_NAME (message->src));
+            trace_ring_record (trace_messages, " Message element: %s from %s.",
+                               gst_structure_get_name (s),
+                               GST_OBJECT_NAME (message->src));
           }
         break;
       }
 
     case GST_MESSAGE_EOS:
       {
-        if (TRACE_MESSAGES)
+        if (TRACE_RING_ENABLED (trace_messages))
           {
-            g_print ("EOS from %s.\n", GST_OBJECT_NAME (message->src));
+            trace_ring_record (trace_messages, "EOS from %s.",
+                               GST_OBJECT_NAME (message->src));
           }
 
         gstreamer_process_eos (user_data);
@@ -196,13 +216,14 @@ message_handler (GstBus * bus_element, GstMessage * message,
 
         gst_message_parse_state_changed (message, &old_state, &new_state,
                                          &pending_state);
-        if (TRACE_MESSAGES)
+        if (TRACE_RING_ENABLED (trace_messages))
           {
-            g_print ("Element %s has changed state from %s to %s, "
-                     "pending %s.\n", GST_OBJECT_NAME (message->src),
-                     gst_element_state_get_name (old_state),
-                     gst_element_state_get_name (new_state),
-                     gst_element_state_get_name (pending_state));
+            trace_ring_record (trace_messages,
+                               "Element %s has changed state from %s to %s, "
+                               "pending %s.", GST_OBJECT_NAME (message->src),
+                               gst_element_state_get_name (old_state),
+                               gst_element_state_get_name (new_state),
+                               gst_element_state_get_name (pending_state));
           }
         break;
       }
@@ -214,9 +235,10 @@ message_handler (GstBus * bus_element, GstMessage * message,
 
         gst_message_parse_reset_time (message, &running_time);
         source = GST_OBJECT_NAME (message->src);
-        if (TRACE_MESSAGES)
+        if (TRACE_RING_ENABLED (trace_messages))
           {
-            g_print ("Reset time to %ld by %s.\n", running_time, source);
+            trace_ring_record (trace_messages, "Reset time to %ld by %s.",
+                               running_time, source);
           }
         break;
       }
@@ -255,19 +277,27 @@ message_handler (GstBus * bus_element, GstMessage * message,
             status_text = (gchar *) "unknown";
             break;
           }
-        if (TRACE_MESSAGES)
+        if (TRACE_RING_ENABLED (trace_messages))
           {
-            g_print ("Stream status of %s from %s.\n", status_text,
-                     GST_OBJECT_NAME (owner));
+            trace_ring_record (trace_messages, "Stream status of %s from %s.",
+                               status_text, GST_OBJECT_NAME (owner));
           }
         break;
       }
 
+    case GST_MESSAGE_QOS:
+      {
+        /* An element dropped buffers or could not keep up.  */
+        qos_message (message, user_data);
+        break;
+      }
+
     case GST_MESSAGE_ASYNC_DONE:
       {
-        if (TRACE_MESSAGES)
+        if (TRACE_RING_ENABLED (trace_messages))
           {
-            g_print ("Async-done from %s.\n", GST_OBJECT_NAME (message->src));
+            trace_ring_record (trace_messages, "Async-done from %s.",
+                               GST_OBJECT_NAME (message->src));
           }
 
         /* The pipeline has completed an asynchronous operation.  */
@@ -277,11 +307,12 @@ message_handler (GstBus * bus_element, GstMessage * message,
 
     default:
       {
-        if (TRACE_MESSAGES)
+        if (TRACE_RING_ENABLED (trace_messages))
           {
-            g_print ("Message: %s from %s.\n",
-                     gst_message_type_get_name (GST_MESSAGE_TYPE (message)),
-                     GST_OBJECT_NAME (message->src));
+            trace_ring_record (trace_messages, "Message: %s from %s.",
+                               gst_message_type_get_name (GST_MESSAGE_TYPE
+                                                          (message)),
+                               GST_OBJECT_NAME (message->src));
           }
         break;
       }
@@ -292,3 +323,25 @@ message_handler (GstBus * bus_element, GstMessage * message,
    * so the core can unref the message for us. */
   return TRUE;
 }
+
+/* Handle a message on the thread which posted it, before it is queued
+ * for message_handler.  A streaming thread posts a stream-status enter
+ * message as it starts, so this is where we can change its priority.
+ * User_data is the application.  */
+GstBusSyncReply
+message_sync_handler (GstBus * bus_element, GstMessage * message,
+                      gpointer user_data)
+{
+  GstStreamStatusType status_type;
+  GstElement *owner;
+
+  if (GST_MESSAGE_TYPE (message) == GST_MESSAGE_STREAM_STATUS)
+    {
+      gst_message_parse_stream_status (message, &status_type, &owner);
+      if (status_type == GST_STREAM_STATUS_TYPE_ENTER)
+        realtime_enter_thread (owner, user_data);
+    }
+
+  /* Let message_handler see every message, as before.  */
+  return GST_BUS_PASS;
+}
@@ -22,3 +22,9 @@
 /* Subroutines declared in message_handler.c */
 gboolean message_handler (GstBus * bus_element, GstMessage * message,
                           gpointer user_data);
+
+/* Handle a message on the thread which posted it, before it is queued
+ * for message_handler.  */
+GstBusSyncReply message_sync_handler (GstBus * bus_element,
+                                      GstMessage * message,
+                                      gpointer user_data);
@@ -0,0 +1,567 @@
+/*
+ * monitor_subroutines.c
+ *
+ * Copyright © 2016 by John Sauter <John_Sauter@systemeyescomputerstore.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <gtk/gtk.h>
+#include <gst/gst.h>
+#include <gst/app/gstappsink.h>
+#include <gst/audio/audio.h>
+#include "main.h"
+#include "monitor_subroutines.h"
+#include "sound_effects_player.h"
+#include "telemetry_subroutines.h"
+
+/* The monitor file records what the audience hears.  It is written by
+ * its own thread, so that a slow disk cannot hold up the sound output
+ * device.
+ *
+ * The tee in the final bin feeds the monitor through a leaky queue to
+ * an appsink.  The appsink copies each buffer into a large ring,
+ * allocated and touched in advance, and returns at once.  If the ring
+ * is full, because the disk has fallen too far behind, the buffer is
+ * dropped and counted rather than making the streaming thread wait.
+ * If the appsink's thread is itself held up, the queue drops the
+ * oldest buffers, and those are counted too.
+ *
+ * The writer thread empties the ring in large writes.  The sound
+ * starts at the end of the first file system block, after a header
+ * padded with a JUNK chunk, so each write is block aligned.  Space is
+ * allocated ahead of the writes in large extents, so the file system
+ * need not find space for each write.  Every few seconds the sound is
+ * flushed to the disk and the header is updated with its length, so
+ * a crash leaves a playable file.  */
+
+/* The size of the header, which is also the file system block size we
+ * align the writes to.  */
+#define MONITOR_HEADER_SIZE 4096
+
+/* The size of the ring.  At 48,000 stereo 16-bit samples per second it
+ * holds about 87 seconds of sound.  It must be a multiple of
+ * MONITOR_WRITE_SIZE.  */
+#define MONITOR_RING_SIZE (16 * 1024 * 1024)
+
+/* The size of the largest write.  */
+#define MONITOR_WRITE_SIZE (1024 * 1024)
+
+/* How much space to allocate at once.  */
+#define MONITOR_ALLOCATE_SIZE (64 * 1024 * 1024)
+
+/* How often to flush the sound to the disk and update the header,
+ * in microseconds.  */
+#define MONITOR_UPDATE_INTERVAL (2 * G_USEC_PER_SEC)
+
+/* The persistent data used by the monitor file writer.  */
+struct monitor_info
+{
+  gchar *file_name;
+  int file_descriptor;
+  GThread *thread;
+  guint8 *ring;
+  guint8 header[MONITOR_HEADER_SIZE];
+
+  /* Protected by the lock.  */
+  GMutex lock;
+  GCond data_ready;
+  guint64 head;                 /* Bytes put into the ring */
+  guint64 tail;                 /* Bytes taken out of the ring */
+  gboolean stopping;
+  gboolean have_format;
+  GstAudioInfo audio_info;
+
+  /* Used only by the writer thread.  */
+  gint64 allocated_end;
+  gboolean allocate_failed;
+  gboolean write_failed;
+
+  /* Counters, protected by the lock.  */
+  guint64 data_size;            /* Bytes of sound in the file */
+  guint write_count;
+  gint64 longest_write;         /* microseconds */
+  guint64 greatest_fill;        /* bytes */
+  guint dropped_buffer_count;
+  guint64 dropped_byte_count;
+
+  /* Incremented by the queue's thread.  */
+  gint queue_overrun_count;
+};
+
+/* Store a little-endian number in the header.  */
+static void
+put_number (guint8 * place, guint32 value, gint length)
+{
+  gint i;
+
+  for (i = 0; i < length; i++)
+    place[i] = (value >> (8 * i)) & 0xFF;
+
+  return;
+}
+
+/* Write the whole of a block of data to the file.  */
+static gboolean
+write_all (int file_descriptor, const guint8 * data, gsize length,
+           gint64 offset)
+{
+  gssize written;
+
+  while (length > 0)
+    {
+      written = pwrite (file_descriptor, data, length, offset);
+      if (written < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          return FALSE;
+        }
+      data = data + written;
+      length = length - written;
+      offset = offset + written;
+    }
+
+  return TRUE;
+}
+
+/* Flush the sound to the disk, then update the header with its length,
+ * so the file is playable as it stands.  */
+static void
+update_header (struct monitor_info *monitor_data)
+{
+  guint8 *header = monitor_data->header;
+  GstAudioInfo *audio_info = &monitor_data->audio_info;
+  guint64 data_size;
+  gboolean is_float;
+
+  g_mutex_lock (&monitor_data->lock);
+  data_size = monitor_data->data_size;
+  g_mutex_unlock (&monitor_data->lock);
+
+  /* We do not know the format until the first buffer arrives, and
+   * after a write error there is nothing more we can do.  */
+  if ((data_size == 0) || monitor_data->write_failed)
+    return;
+  data_size = MIN (data_size, G_MAXUINT32 - MONITOR_HEADER_SIZE);
+
+  fdatasync (monitor_data->file_descriptor);
+
+  /* The header is the RIFF header, the format, a JUNK chunk filling
+   * the rest of the block, and the header of the data chunk.  */
+  memset (header, 0, MONITOR_HEADER_SIZE);
+  is_float = GST_AUDIO_INFO_IS_FLOAT (audio_info);
+  memcpy (header, "RIFF", 4);
+  put_number (header + 4, MONITOR_HEADER_SIZE - 8 + data_size, 4);
+  memcpy (header + 8, "WAVE", 4);
+  memcpy (header + 12, "fmt ", 4);
+  put_number (header + 16, 16, 4);
+  put_number (header + 20, is_float ? 3 : 1, 2);
+  put_number (header + 22, GST_AUDIO_INFO_CHANNELS (audio_info), 2);
+  put_number (header + 24, GST_AUDIO_INFO_RATE (audio_info), 4);
+  put_number (header + 28,
+              GST_AUDIO_INFO_RATE (audio_info) *
+              GST_AUDIO_INFO_BPF (audio_info), 4);
+  put_number (header + 32, GST_AUDIO_INFO_BPF (audio_info), 2);
+  put_number (header + 34, GST_AUDIO_INFO_WIDTH (audio_info), 2);
+  memcpy (header + 36, "JUNK", 4);
+  put_number (header + 40, MONITOR_HEADER_SIZE - 52, 4);
+  memcpy (header + MONITOR_HEADER_SIZE - 8, "data", 4);
+  put_number (header + MONITOR_HEADER_SIZE - 4, data_size, 4);
+
+  if (!write_all (monitor_data->file_descriptor, header, MONITOR_HEADER_SIZE,
+                  0))
+    {
+      g_print ("Unable to write monitor file %s: %s.\n",
+               monitor_data->file_name, g_strerror (errno));
+      monitor_data->write_failed = TRUE;
+    }
+
+  return;
+}
+
+/* Write sound from the ring to the file.  If the file cannot be
+ * written, the sound is discarded.  */
+static void
+write_sound (struct monitor_info *monitor_data, guint64 tail, gsize length)
+{
+  gint64 offset, start_time, elapsed;
+  gsize position, first_length;
+  gboolean success;
+
+  if ((length == 0) || monitor_data->write_failed)
+    return;
+
+  /* Allocate space ahead of the writes.  Not all file systems can.  */
+  offset = MONITOR_HEADER_SIZE + monitor_data->data_size;
+  if (!monitor_data->allocate_failed
+      && (offset + (gint64) length > monitor_data->allocated_end))
+    {
+      if (monitor_data->allocated_end < offset)
+        monitor_data->allocated_end = offset;
+      if (fallocate (monitor_data->file_descriptor, FALLOC_FL_KEEP_SIZE,
+                     monitor_data->allocated_end, MONITOR_ALLOCATE_SIZE) == 0)
+        {
+          monitor_data->allocated_end =
+            monitor_data->allocated_end + MONITOR_ALLOCATE_SIZE;
+        }
+      else
+        monitor_data->allocate_failed = TRUE;
+    }
+
+  /* The sound may wrap around the end of the ring.  */
+  start_time = g_get_monotonic_time ();
+  position = tail % MONITOR_RING_SIZE;
+  first_length = MIN (length, MONITOR_RING_SIZE - position);
+  success =
+    write_all (monitor_data->file_descriptor,
+               monitor_data->ring + position, first_length, offset);
+  if (success && (first_length < length))
+    {
+      success =
+        write_all (monitor_data->file_descriptor, monitor_data->ring,
+                   length - first_length, offset + first_length);
+    }
+  elapsed = g_get_monotonic_time () - start_time;
+
+  if (!success)
+    {
+      g_print ("Unable to write monitor file %s: %s.\n",
+               monitor_data->file_name, g_strerror (errno));
+      monitor_data->write_failed = TRUE;
+      return;
+    }
+
+  g_mutex_lock (&monitor_data->lock);
+  monitor_data->data_size = monitor_data->data_size + length;
+  monitor_data->write_count = monitor_data->write_count + 1;
+  if (elapsed > monitor_data->longest_write)
+    monitor_data->longest_write = elapsed;
+  g_mutex_unlock (&monitor_data->lock);
+
+  return;
+}
+
+/* The writer thread empties the ring into the file.  It writes when
+ * it has a full write's worth of sound, or when it is time to update
+ * the header, and writes whole blocks except at the end of the
+ * recording.  */
+static gpointer
+monitor_thread (gpointer user_data)
+{
+  struct monitor_info *monitor_data = user_data;
+  guint64 available, tail;
+  gsize length;
+  gint64 now, next_update_time;
+  gboolean stopping;
+
+  next_update_time = g_get_monotonic_time () + MONITOR_UPDATE_INTERVAL;
+  g_mutex_lock (&monitor_data->lock);
+  for (;;)
+    {
+      available = monitor_data->head - monitor_data->tail;
+      tail = monitor_data->tail;
+      stopping = monitor_data->stopping;
+      now = g_get_monotonic_time ();
+      if ((available < MONITOR_WRITE_SIZE) && !stopping
+          && (now < next_update_time))
+        {
+          g_cond_wait_until (&monitor_data->data_ready, &monitor_data->lock,
+                             next_update_time);
+          continue;
+        }
+      g_mutex_unlock (&monitor_data->lock);
+
+      length = MIN (available, MONITOR_WRITE_SIZE);
+      if (!stopping)
+        length = length - (length % MONITOR_HEADER_SIZE);
+      write_sound (monitor_data, tail, length);
+      if (stopping || (now >= next_update_time))
+        {
+          update_header (monitor_data);
+          next_update_time = now + MONITOR_UPDATE_INTERVAL;
+        }
+
+      g_mutex_lock (&monitor_data->lock);
+      monitor_data->tail = monitor_data->tail + length;
+      if (stopping && (monitor_data->head == monitor_data->tail))
+        break;
+    }
+  g_mutex_unlock (&monitor_data->lock);
+
+  return NULL;
+}
+
+/* Open the monitor file and start the thread that writes it.  */
+void *
+monitor_init (GApplication * app)
+{
+  struct monitor_info *monitor_data;
+  gchar *file_name;
+  int file_descriptor;
+
+  /* The render file is written by the pipeline, since nothing there
+   * runs in real time.  */
+  file_name = main_get_monitor_file_name ();
+  if ((file_name == NULL) || (main_get_render_file_name () != NULL))
+    return NULL;
+
+  file_descriptor = open (file_name, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (file_descriptor < 0)
+    {
+      g_print ("Unable to open monitor file %s: %s.\n", file_name,
+               g_strerror (errno));
+      return NULL;
+    }
+
+  monitor_data = g_malloc0 (sizeof (struct monitor_info));
+  monitor_data->file_name = g_strdup (file_name);
+  monitor_data->file_descriptor = file_descriptor;
+  g_mutex_init (&monitor_data->lock);
+  g_cond_init (&monitor_data->data_ready);
+
+  /* Touch every page of the ring now, so the streaming thread does not
+   * take page faults copying into it.  */
+  monitor_data->ring = g_malloc (MONITOR_RING_SIZE);
+  memset (monitor_data->ring, 0, MONITOR_RING_SIZE);
+
+  monitor_data->thread =
+    g_thread_new ("monitor", monitor_thread, monitor_data);
+
+  return monitor_data;
+}
+
+/* The queue in front of the appsink is full, and is dropping the
+ * oldest buffer.  */
+static void
+queue_overrun (GstElement * queue_element, gpointer user_data)
+{
+  struct monitor_info *monitor_data = user_data;
+
+  g_atomic_int_inc (&monitor_data->queue_overrun_count);
+
+  return;
+}
+
+/* A buffer has reached the appsink.  Copy it into the ring, or drop it
+ * if there is no room.  This runs on a streaming thread, so it must
+ * never wait for the disk.  */
+static GstFlowReturn
+new_sample (GstAppSink * appsink, gpointer user_data)
+{
+  struct monitor_info *monitor_data = user_data;
+  GstSample *sample;
+  GstBuffer *buffer;
+  GstMapInfo map_info;
+  guint64 head, fill;
+  gsize position, first_length;
+  gboolean have_room;
+
+  sample = gst_app_sink_pull_sample (appsink);
+  if (sample == NULL)
+    return GST_FLOW_EOS;
+  buffer = gst_sample_get_buffer (sample);
+  if ((buffer == NULL) || !gst_buffer_map (buffer, &map_info, GST_MAP_READ))
+    {
+      gst_sample_unref (sample);
+      return GST_FLOW_OK;
+    }
+
+  g_mutex_lock (&monitor_data->lock);
+  if (!monitor_data->have_format)
+    {
+      monitor_data->have_format =
+        gst_audio_info_from_caps (&monitor_data->audio_info,
+                                  gst_sample_get_caps (sample));
+    }
+  head = monitor_data->head;
+  have_room = monitor_data->have_format && !monitor_data->stopping
+    && ((head - monitor_data->tail + map_info.size) <= MONITOR_RING_SIZE);
+  if (!have_room)
+    {
+      monitor_data->dropped_buffer_count =
+        monitor_data->dropped_buffer_count + 1;
+      monitor_data->dropped_byte_count =
+        monitor_data->dropped_byte_count + map_info.size;
+    }
+  g_mutex_unlock (&monitor_data->lock);
+
+  /* Only this thread adds to the ring, and the writer does not touch
+   * the space beyond the head, so the copy is made without the
+   * lock.  */
+  if (have_room)
+    {
+      position = head % MONITOR_RING_SIZE;
+      first_length = MIN (map_info.size, MONITOR_RING_SIZE - position);
+      memcpy (monitor_data->ring + position, map_info.data, first_length);
+      memcpy (monitor_data->ring, map_info.data + first_length,
+              map_info.size - first_length);
+
+      g_mutex_lock (&monitor_data->lock);
+      monitor_data->head = head + map_info.size;
+      fill = monitor_data->head - monitor_data->tail;
+      if (fill > monitor_data->greatest_fill)
+        monitor_data->greatest_fill = fill;
+      if (fill >= MONITOR_WRITE_SIZE)
+        g_cond_signal (&monitor_data->data_ready);
+      g_mutex_unlock (&monitor_data->lock);
+    }
+
+  gst_buffer_unmap (buffer, &map_info);
+  gst_sample_unref (sample);
+
+  return GST_FLOW_OK;
+}
+
+/* Feed the monitor file from an appsink.  */
+void
+monitor_attach (GstElement * appsink_element, GstElement * queue_element,
+                GApplication * app)
+{
+  struct monitor_info *monitor_data;
+  GstAppSinkCallbacks callbacks;
+  GstCaps *caps;
+
+  monitor_data = sep_get_monitor_data (app);
+  if (monitor_data == NULL)
+    return;
+
+  /* Never make the tee wait: drop the oldest buffers instead.  */
+  g_object_set (queue_element, "leaky", 2, NULL);
+  g_signal_connect (queue_element, "overrun", G_CALLBACK (queue_overrun),
+                    monitor_data);
+
+  /* Accept only the formats a WAV file can hold, and take each buffer
+   * as it arrives rather than at its time.  */
+  caps =
+    gst_caps_from_string ("audio/x-raw, "
+                          "format=(string){ S16LE, S24LE, S32LE, U8, "
+                          "F32LE, F64LE }, layout=(string)interleaved");
+  g_object_set (appsink_element, "caps", caps, "sync", FALSE, NULL);
+  gst_caps_unref (caps);
+
+  memset (&callbacks, 0, sizeof (callbacks));
+  callbacks.new_sample = new_sample;
+  gst_app_sink_set_callbacks (GST_APP_SINK (appsink_element), &callbacks,
+                              monitor_data, NULL);
+
+  return;
+}
+
+/* Write what remains of the recording, complete the file and stop the
+ * writer thread.  */
+void
+monitor_shutdown (GApplication * app)
+{
+  struct monitor_info *monitor_data;
+  guint64 file_size;
+
+  monitor_data = sep_get_monitor_data (app);
+  if ((monitor_data == NULL) || (monitor_data->thread == NULL))
+    return;
+
+  g_mutex_lock (&monitor_data->lock);
+  monitor_data->stopping = TRUE;
+  g_cond_signal (&monitor_data->data_ready);
+  g_mutex_unlock (&monitor_data->lock);
+  g_thread_join (monitor_data->thread);
+  monitor_data->thread = NULL;
+
+  /* Release the space allocated beyond the end of the sound.  */
+  file_size = 0;
+  if (monitor_data->data_size > 0)
+    file_size = MONITOR_HEADER_SIZE + monitor_data->data_size;
+  if (ftruncate (monitor_data->file_descriptor, file_size) != 0)
+    {
+      g_print ("Unable to truncate monitor file %s: %s.\n",
+               monitor_data->file_name, g_strerror (errno));
+    }
+  close (monitor_data->file_descriptor);
+  monitor_data->file_descriptor = -1;
+
+  g_free (monitor_data->ring);
+  monitor_data->ring = NULL;
+
+  return;
+}
+
+/* Send the writer's counters to the remote controllers, as a line of
+ * the form
+ *   monitor <bytes written> <writes> <longest write> <greatest fill>
+ *     <dropped buffers> <dropped bytes> <queue overruns>
+ * with the longest write in milliseconds and the greatest fill of the
+ * ring in percent.  */
+void
+monitor_send_statistics (GApplication * app)
+{
+  struct monitor_info *monitor_data;
+  gchar *line;
+
+  monitor_data = sep_get_monitor_data (app);
+  if (monitor_data == NULL)
+    return;
+
+  g_mutex_lock (&monitor_data->lock);
+  line =
+    g_strdup_printf ("monitor %" G_GUINT64_FORMAT " %u %.1f %.1f %u %"
+                     G_GUINT64_FORMAT " %d", monitor_data->data_size,
+                     monitor_data->write_count,
+                     monitor_data->longest_write / 1000.0,
+                     monitor_data->greatest_fill * 100.0 / MONITOR_RING_SIZE,
+                     monitor_data->dropped_buffer_count,
+                     monitor_data->dropped_byte_count,
+                     g_atomic_int_get (&monitor_data->queue_overrun_count));
+  g_mutex_unlock (&monitor_data->lock);
+  telemetry_statistics (line, app);
+  g_free (line);
+
+  return;
+}
+
+/* Print the writer's counters.  */
+void
+monitor_print_statistics (GApplication * app)
+{
+  struct monitor_info *monitor_data;
+
+  monitor_data = sep_get_monitor_data (app);
+  if (monitor_data == NULL)
+    return;
+
+  g_mutex_lock (&monitor_data->lock);
+  g_print ("Monitor file %s: %" G_GUINT64_FORMAT " bytes of sound in %u "
+           "writes, the longest %.1f ms; the ring was %.1f%% full at most.\n",
+           monitor_data->file_name, monitor_data->data_size,
+           monitor_data->write_count, monitor_data->longest_write / 1000.0,
+           monitor_data->greatest_fill * 100.0 / MONITOR_RING_SIZE);
+  if ((monitor_data->dropped_buffer_count > 0)
+      || (g_atomic_int_get (&monitor_data->queue_overrun_count) > 0))
+    {
+      g_print ("Monitor file %s is missing sound: %u buffers (%"
+               G_GUINT64_FORMAT " bytes) were dropped because the ring "
+               "was full, and %d because the queue was full.\n",
+               monitor_data->file_name, monitor_data->dropped_buffer_count,
+               monitor_data->dropped_byte_count,
+               g_atomic_int_get (&monitor_data->queue_overrun_count));
+    }
+  g_mutex_unlock (&monitor_data->lock);
+
+  return;
+}
@@ -0,0 +1,46 @@
+/*
+ * monitor_subroutines.h
+ *
+ * Copyright © 2016 by John Sauter <John_Sauter@systemeyescomputerstore.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <gtk/gtk.h>
+#include <gst/gst.h>
+
+/* Subroutines defined in monitor_subroutines.c */
+
+/* Open the monitor file and start the thread that writes it.  Returns
+ * NULL if no monitor file was requested, or when rendering offline,
+ * since the render file is written by the pipeline itself.  */
+void *monitor_init (GApplication * app);
+
+/* Feed the monitor file from an appsink, behind the queue that
+ * separates it from the sound output device.  */
+void monitor_attach (GstElement * appsink_element, GstElement * queue_element,
+                     GApplication * app);
+
+/* Write what remains of the recording, complete the file and stop the
+ * writer thread.  */
+void monitor_shutdown (GApplication * app);
+
+/* Send the writer's counters to the remote controllers.  */
+void monitor_send_statistics (GApplication * app);
+
+/* Print the writer's counters.  */
+void monitor_print_statistics (GApplication * app);
+
+/* End of file monitor_subroutines.h */
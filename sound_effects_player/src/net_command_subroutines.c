@@ -0,0 +1,239 @@
+/*
+ * net_command_subroutines.c
+ *
+ * Copyright © 2016 by John Sauter <John_Sauter@systemeyescomputerstore.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "net_command_subroutines.h"
+
+/* These subroutines divide the text of a network message into
+ * commands, one per line, and decode each command into its keyword
+ * and operand.  The text is decoded in place.  They are used by the
+ * network message parser, and keep no state, so the parse_net
+ * benchmark measures them alone.  */
+
+/* The keyword table is indexed by a perfect hash of the keyword: 
+ * the sum of its length, its first character and its last character,
+ * modulo the size of the table.  No two keywords share a slot, so a 
+ * lookup is one hash and one comparison.  If you add a keyword, choose
+ * an empty slot by computing its hash; if its slot is taken, enlarge
+ * the table until every keyword has its own slot.
+ * net_command_check_keywords checks the table.  */
+#define KEYWORD_HASH_SIZE 18
+
+struct keyword_entry
+{
+  const gchar *name;
+  gsize length;
+  enum keyword_codes code;
+};
+
+static const struct keyword_entry keyword_table[KEYWORD_HASH_SIZE] = {
+  {NULL, 0, keyword_unknown},
+  {"stats", 5, keyword_stats},  /* 5 + 's' + 's' = 235 */
+  {"start", 5, keyword_start},  /* 5 + 's' + 't' = 236 */
+  {NULL, 0, keyword_unknown},
+  {"reload", 6, keyword_reload},        /* 6 + 'r' + 'd' = 220 */
+  {NULL, 0, keyword_unknown},
+  {"trace", 5, keyword_trace},  /* 5 + 't' + 'e' = 222 */
+  {NULL, 0, keyword_unknown},
+  {"/cue", 4, keyword_cue},     /* 4 + '/' + 'e' = 152 */
+  {NULL, 0, keyword_unknown},
+  {NULL, 0, keyword_unknown},
+  {NULL, 0, keyword_unknown},
+  {NULL, 0, keyword_unknown},
+  {NULL, 0, keyword_unknown},
+  {NULL, 0, keyword_unknown},
+  {"stop", 4, keyword_stop},    /* 4 + 's' + 'p' = 231 */
+  {NULL, 0, keyword_unknown},
+  {"quit", 4, keyword_quit}     /* 4 + 'q' + 't' = 233 */
+};
+
+/* Compute the hash of a keyword.  The length must not be zero.  */
+static guint
+keyword_hash (const gchar * keyword, gsize length)
+{
+  return ((length + (guchar) keyword[0] + (guchar) keyword[length - 1]) %
+          KEYWORD_HASH_SIZE);
+}
+
+/* Find a keyword in the keyword table.  */
+static enum keyword_codes
+keyword_lookup (const gchar * keyword, gsize length)
+{
+  const struct keyword_entry *entry;
+
+  if (length == 0)
+    return keyword_unknown;
+
+  entry = &keyword_table[keyword_hash (keyword, length)];
+  if ((entry->length == length)
+      && (memcmp (entry->name, keyword, length) == 0))
+    return entry->code;
+
+  return keyword_unknown;
+}
+
+/* Make sure each keyword is in the slot its hash selects.  */
+void
+net_command_check_keywords (void)
+{
+  int i;
+
+  for (i = 0; i < KEYWORD_HASH_SIZE; i++)
+    {
+      if ((keyword_table[i].name != NULL)
+          && (keyword_hash (keyword_table[i].name, keyword_table[i].length)
+              != i))
+        {
+          g_error ("Keyword %s is in the wrong slot of the keyword table.",
+                   keyword_table[i].name);
+        }
+    }
+
+  return;
+}
+
+/* Convert the operand of a command to a cluster number.  Return FALSE
+ * if it is missing or is not a number.  */
+static gboolean
+parse_cluster_number (gchar * operand, guint * cluster_number)
+{
+  gchar *end_ptr;
+  long int value;
+
+  if (operand == NULL)
+    return FALSE;
+
+  errno = 0;
+  value = strtol (operand, &end_ptr, 0);
+  if ((errno != 0) || (end_ptr == operand) || (*end_ptr != '\0')
+      || (value < 0) || (value > G_MAXINT))
+    return FALSE;
+
+  *cluster_number = value;
+  return TRUE;
+}
+
+/* Terminate the first line of the text, and return the next.  */
+gchar *
+net_command_next_line (gchar * text)
+{
+  gchar *next_line;
+
+  next_line = strchr (text, '\n');
+  if (next_line != NULL)
+    {
+      *next_line = '\0';
+      next_line++;
+    }
+
+  return next_line;
+}
+
+/* Decode a single command.  The command is a line of text terminated
+ * by a NUL.  The keyword and operand are terminated in place.  */
+enum net_command_result
+net_command_decode (gchar * line, struct net_command_text *command)
+{
+  gchar *keyword_string;
+  gsize kl;                     /* keyword length */
+  gchar *extra_text;
+  gchar *end_ptr;
+
+  command->keyword_value = keyword_unknown;
+  command->keyword = NULL;
+  command->operand = NULL;
+  command->cluster_number = 0;
+
+  /* Skip leading white space.  A blank line is not a command.  */
+  while (g_ascii_isspace (*line))
+    line++;
+  if (*line == '\0')
+    return net_command_blank;
+
+  /* Isolate the keyword that starts the command. The keyword will be
+   * terminated by white space or the end of the string.  */
+  keyword_string = line;
+  for (kl = 0; keyword_string[kl] != '\0'; kl++)
+    if (g_ascii_isspace (keyword_string[kl]))
+      break;
+
+  /* If there is any text after the keyword, it is probably a parameter
+   * to the command.  Isolate it, also, without the surrounding white
+   * space.  */
+  extra_text = keyword_string + kl;
+  if (*extra_text != '\0')
+    {
+      *extra_text = '\0';
+      extra_text++;
+      while (g_ascii_isspace (*extra_text))
+        extra_text++;
+      end_ptr = extra_text + strlen (extra_text);
+      while ((end_ptr > extra_text) && g_ascii_isspace (end_ptr[-1]))
+        end_ptr--;
+      *end_ptr = '\0';
+    }
+  if (*extra_text == '\0')
+    extra_text = NULL;
+
+  command->keyword = keyword_string;
+  command->operand = extra_text;
+
+  /* Find the keyword in the keyword table and check its operand.  */
+  command->keyword_value = keyword_lookup (keyword_string, kl);
+  switch (command->keyword_value)
+    {
+    case keyword_start:
+    case keyword_stop:
+      /* For the Start and Stop commands, the operand is the 
+       * cluster number. */
+      if (!parse_cluster_number (extra_text, &command->cluster_number))
+        return net_command_bad_cluster;
+      break;
+
+    case keyword_quit:
+      /* The Quit command takes no arguments. */
+      break;
+
+    case keyword_reload:
+      /* Nor does the Reload command.  */
+      break;
+
+    case keyword_stats:
+      /* Nor does the Stats command.  */
+      break;
+
+    case keyword_cue:
+      /* The cue command takes an optional Q number.  */
+      break;
+
+    case keyword_trace:
+      /* The trace command takes either "dump" or the categories
+       * to record.  */
+      if (extra_text == NULL)
+        return net_command_missing_operand;
+      break;
+
+    default:
+      return net_command_unknown;
+    }
+
+  return net_command_valid;
+}
@@ -0,0 +1,61 @@
+/*
+ * net_command_subroutines.h
+ *
+ * Copyright © 2016 by John Sauter <John_Sauter@systemeyescomputerstore.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <glib.h>
+
+/* The keywords of the network commands.  An OSC packet is not a
+ * keyword, but is passed through the command ring like one.  */
+enum keyword_codes
+{ keyword_unknown = 0, keyword_start, keyword_stop, keyword_quit,
+  keyword_cue, keyword_reload, keyword_stats, keyword_trace,
+  keyword_osc_packet
+};
+
+/* A command decoded from a line of text.  The keyword and operand
+ * point into the line, which is modified to terminate them.  */
+struct net_command_text
+{
+  enum keyword_codes keyword_value;
+  gchar *keyword;
+  gchar *operand;               /* NULL if there is none */
+  guint cluster_number;         /* for start and stop */
+};
+
+/* What decoding a line found.  */
+enum net_command_result
+{ net_command_valid = 0, net_command_blank, net_command_unknown,
+  net_command_bad_cluster, net_command_missing_operand
+};
+
+/* Subroutines defined in net_command_subroutines.c.  They depend on
+ * nothing but GLib, so they can be measured without the application.  */
+
+/* Check that each keyword is where the keyword table's hash puts it.  */
+void net_command_check_keywords (void);
+
+/* Terminate the first line of text in place, and return the start of
+ * the next, or NULL if this is the last.  */
+gchar *net_command_next_line (gchar * text);
+
+/* Decode a line of text holding one command.  The line is modified.  */
+enum net_command_result net_command_decode (gchar * line,
+                                            struct net_command_text
+                                            *command);
+
+/* End of file net_command_subroutines.h */
@@ -17,11 +17,26 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#define _GNU_SOURCE
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <sys/socket.h>
 #include <gtk/gtk.h>
 #include <gio/gio.h>
 #include "sound_effects_player.h"
 #include "parse_net_subroutines.h"
 #include "network_subroutines.h"
+#include "trace_ring_subroutines.h"
+
+/* The control buffer for each datagram holds the kernel's receive time
+ * and the count of datagrams the kernel has dropped on this socket.  */
+union network_control_buffer
+{
+  struct cmsghdr align;
+  gchar buffer[CMSG_SPACE (sizeof (struct timespec)) +
+               CMSG_SPACE (sizeof (guint32))];
+};
 
 /* The persistent data used by the network subroutines. */
 
@@ -31,46 +46,197 @@ struct network_info
   gint port_number;
   GSource *source_IPv4, *source_IPv6;
   GSocket *socket_IPv4, *socket_IPv6;
+  GApplication *app;
+
+  /* The sockets are serviced by a thread with its own main loop, 
+   * so that reception and parsing do not wait for the user 
+   * interface.  */
+  GMainContext *context;
+  GMainLoop *loop;
+  GThread *thread;
+
+  /* A batch of datagrams is read with a single call to recvmmsg.
+   * Each datagram has its own slice of the network buffer and its own
+   * control buffer.  */
+  struct mmsghdr messages[network_batch_size];
+  struct iovec vectors[network_batch_size];
+  union network_control_buffer control_buffers[network_batch_size];
+  struct parse_net_datagram datagrams[network_batch_size];
+
+  /* The kernel's drop count is cumulative for each socket, so remember
+   * the last value we saw.  */
+  guint32 kernel_drops_IPv4, kernel_drops_IPv6;
+
+  struct network_statistics statistics;
 };
 
 /* Subroutines to handle network messages */
 
-/* Receive incoming data. This is called from the main loop whenever
- * there is data or a disconnect on a port. */
+/* Extract the kernel receive time and the drop count from the control
+ * messages that came with a datagram.  */
+static void
+process_control_messages (struct network_info *network_data,
+                          struct msghdr *message_header,
+                          guint32 * last_drop_count,
+                          struct parse_net_datagram *datagram)
+{
+  struct cmsghdr *control_message;
+  struct timespec time_stamp;
+  guint32 drop_count;
+
+  datagram->receive_time = 0;
+  for (control_message = CMSG_FIRSTHDR (message_header);
+       control_message != NULL;
+       control_message = CMSG_NXTHDR (message_header, control_message))
+    {
+      if (control_message->cmsg_level != SOL_SOCKET)
+        continue;
+
+      switch (control_message->cmsg_type)
+        {
+        case SCM_TIMESTAMPNS:
+          memcpy (&time_stamp, CMSG_DATA (control_message),
+                  sizeof (time_stamp));
+          datagram->receive_time =
+            ((gint64) time_stamp.tv_sec * G_GINT64_CONSTANT (1000000000)) +
+            time_stamp.tv_nsec;
+          break;
+
+        case SO_RXQ_OVFL:
+          memcpy (&drop_count, CMSG_DATA (control_message),
+                  sizeof (drop_count));
+          __atomic_fetch_add (&network_data->statistics.kernel_drops,
+                              (guint32) (drop_count - *last_drop_count),
+                              __ATOMIC_RELAXED);
+          *last_drop_count = drop_count;
+          break;
+
+        default:
+          break;
+        }
+    }
+
+  /* If the kernel did not give us a time stamp, use the current time.  */
+  if (datagram->receive_time == 0)
+    datagram->receive_time = g_get_real_time () * 1000;
+
+  return;
+}
+
+/* Receive incoming data. This is called from the network thread's main
+ * loop whenever there is data or a disconnect on a port.  We drain the
+ * socket in batches, so a burst of datagrams costs only one main loop
+ * dispatch.  */
 static gboolean
 receive_data_callback (GSocket * socket, GIOCondition condition,
                        gpointer user_data)
 {
   struct network_info *network_data;
-  gchar *network_buffer;
-  GError *error = NULL;
-  gssize nread;
-
-  /* Find the network buffer */
-  network_data = sep_get_network_data ((GApplication *) user_data);
-  network_buffer = network_data->network_buffer;
+  struct network_statistics *statistics;
+  struct mmsghdr *message;
+  struct parse_net_datagram *datagram;
+  guint32 *last_drop_count;
+  gint socket_fd;
+  gint batch_count, datagram_count;
+  gint i;
+  gboolean drained;
+
+  /* Find the network buffers */
+  network_data = user_data;
+  statistics = &network_data->statistics;
 
   /* If we have data, process it. */
   if ((condition & G_IO_IN) != 0)
     {
-      nread =
-        g_socket_receive (socket, network_buffer, network_buffer_size, NULL,
-                          &error);
-
-      if (error != NULL)
-        {
-          g_error (error->message);
-          return G_SOURCE_REMOVE;
-        }
-      if (nread != 0)
+      socket_fd = g_socket_get_fd (socket);
+      if (socket == network_data->socket_IPv4)
+        last_drop_count = &network_data->kernel_drops_IPv4;
+      else
+        last_drop_count = &network_data->kernel_drops_IPv6;
+      __atomic_fetch_add (&statistics->wakeups, 1, __ATOMIC_RELAXED);
+
+      drained = FALSE;
+      while (!drained)
         {
-          network_buffer[nread] = '\0';
-          /* Data may be received in arbitrary-sized chunks.  
-           * Processing a chunk might range from just adding it to a buffer to 
-           * executing several commands that arrived all at once. */
-          parse_net_text (network_buffer, user_data);
+          for (i = 0; i < network_batch_size; i++)
+            {
+              message = &network_data->messages[i];
+              message->msg_hdr.msg_controllen =
+                sizeof (network_data->control_buffers[i]);
+              message->msg_hdr.msg_flags = 0;
+              message->msg_len = 0;
+            }
+
+          batch_count =
+            recvmmsg (socket_fd, network_data->messages, network_batch_size,
+                      MSG_DONTWAIT, NULL);
+          if (batch_count < 0)
+            {
+              if (errno == EINTR)
+                continue;
+              if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+                {
+                  g_printerr ("Unable to receive from the network: %s.\n",
+                              g_strerror (errno));
+                }
+              break;
+            }
+          if (batch_count == 0)
+            break;
+
+          /* A batch that did not fill the message vector means there
+           * was nothing more waiting, so we need not ask again.  */
+          if (batch_count < network_batch_size)
+            drained = TRUE;
+
+          /* Collect the datagrams in this batch.  Data may be received 
+           * in arbitrary-sized chunks.  Processing a chunk might range 
+           * from just adding it to a buffer to executing several commands
+           * that arrived all at once.  */
+          datagram_count = 0;
+          for (i = 0; i < batch_count; i++)
+            {
+              message = &network_data->messages[i];
+              datagram = &network_data->datagrams[datagram_count];
+              process_control_messages (network_data, &message->msg_hdr,
+                                        last_drop_count, datagram);
+
+              /* A datagram too large for its buffer would be parsed
+               * incomplete, so discard it.  */
+              if ((message->msg_hdr.msg_flags & MSG_TRUNC) != 0)
+                {
+                  __atomic_fetch_add (&statistics->truncated, 1,
+                                      __ATOMIC_RELAXED);
+                  continue;
+                }
+              if (message->msg_len == 0)
+                continue;
+
+              datagram->text = message->msg_hdr.msg_iov->iov_base;
+              datagram->length = message->msg_len;
+              datagram->text[datagram->length] = '\0';
+              datagram_count = datagram_count + 1;
+            }
+
+          __atomic_fetch_add (&statistics->batches, 1, __ATOMIC_RELAXED);
+          __atomic_fetch_add (&statistics->datagrams, batch_count,
+                              __ATOMIC_RELAXED);
+          __atomic_fetch_add (&statistics->batch_size_counts[batch_count], 1,
+                              __ATOMIC_RELAXED);
+          if (batch_count > statistics->max_batch_size)
+            g_atomic_int_set (&statistics->max_batch_size, batch_count);
+
+          if (TRACE_RING_ENABLED (trace_network))
+            {
+              trace_ring_record (trace_network,
+                                 "network batch of %d datagrams, "
+                                 "%d to parse.", batch_count,
+                                 datagram_count);
+            }
+
+          parse_net_batch (network_data->datagrams, datagram_count,
+                           network_data->app);
         }
-
     }
 
   /* If we have received the hangup condition, stop listening for data. */
@@ -81,204 +247,314 @@ receive_data_callback (GSocket * socket, GIOCondition condition,
   return G_SOURCE_CONTINUE;
 }
 
-/* Initialize the network subroutines.  We start to listen for messages.
- * The return value is the persistent data.  Send text messages for testing
- * using ncat: nc -u localhost 1500.  */
-void *
-network_init (GApplication * app)
+/* Create a socket which listens for UDP messages on the current port,
+ * and attach it to the network thread's main loop.  */
+static GSocket *
+create_socket (GSocketFamily family, struct network_info *network_data,
+               GSource ** source_p)
 {
   GError *error = NULL;
-  GSocket *socket_IPv4, *socket_IPv6;
-  GInetAddress *inet_IPv4_address, *inet_IPv6_address;
-  GSocketAddress *socket_IPv4_address, *socket_IPv6_address;
-  GSource *source_IPv4, *source_IPv6;
-  gchar *network_buffer;
-  struct network_info *network_data;
-
-  /* Allocate the persistent information. */
-  network_data = g_malloc (sizeof (struct network_info));
-
-  /* Allocate the network buffer. */
-  network_buffer = g_malloc0 (network_buffer_size);
-  network_data->network_buffer = network_buffer;
-
-  /* Set the default port. */
-  network_data->port_number = 1500;
-
-  /* Create a socket to listen for UDP messages on IPv6 and, if necessary,
-   * another to listen for UDP messages on IPv4. */
-
-  socket_IPv6 =
-    g_socket_new (G_SOCKET_FAMILY_IPV6, G_SOCKET_TYPE_DATAGRAM,
-                  G_SOCKET_PROTOCOL_UDP, &error);
+  GSocket *socket;
+  GInetAddress *inet_address;
+  GSocketAddress *socket_address;
+  GSource *source;
+
+  socket =
+    g_socket_new (family, G_SOCKET_TYPE_DATAGRAM, G_SOCKET_PROTOCOL_UDP,
+                  &error);
   if (error != NULL)
     {
       g_error (error->message);
       return NULL;
     }
 
-  inet_IPv6_address = g_inet_address_new_any (G_SOCKET_FAMILY_IPV6);
-  socket_IPv6_address =
-    g_inet_socket_address_new (inet_IPv6_address, network_data->port_number);
-  g_socket_bind (socket_IPv6, socket_IPv6_address, FALSE, &error);
+  /* Ask the kernel to time stamp each datagram as it arrives, and to
+   * tell us how many datagrams it dropped because we were too slow.  */
+  g_socket_set_option (socket, SOL_SOCKET, SO_TIMESTAMPNS, 1, &error);
   if (error != NULL)
     {
-      g_error (error->message);
-      return NULL;
+      g_printerr ("Unable to request receive time stamps: %s.\n",
+                  error->message);
+      g_clear_error (&error);
     }
-  source_IPv6 =
-    g_socket_create_source (socket_IPv6, G_IO_IN | G_IO_HUP, NULL);
-  g_source_set_callback (source_IPv6, (GSourceFunc) receive_data_callback,
-                         app, NULL);
-  g_source_attach (source_IPv6, NULL);
-  network_data->source_IPv6 = source_IPv6;
-  network_data->socket_IPv6 = socket_IPv6;
-
-  if (g_socket_speaks_ipv4 (socket_IPv6))
+  g_socket_set_option (socket, SOL_SOCKET, SO_RXQ_OVFL, 1, &error);
+  if (error != NULL)
     {
-      network_data->source_IPv4 = NULL;
-      network_data->socket_IPv4 = NULL;
-      return network_data;
+      g_printerr ("Unable to request drop counts: %s.\n", error->message);
+      g_clear_error (&error);
     }
 
-  /* The IPv6 socket we just created doesn't speak IPv4, so create
-   * a socket that does. */
-
-  socket_IPv4 =
-    g_socket_new (G_SOCKET_FAMILY_IPV4, G_SOCKET_TYPE_DATAGRAM,
-                  G_SOCKET_PROTOCOL_UDP, &error);
+  inet_address = g_inet_address_new_any (family);
+  socket_address =
+    g_inet_socket_address_new (inet_address, network_data->port_number);
+  g_socket_bind (socket, socket_address, FALSE, &error);
+  g_object_unref (socket_address);
+  g_object_unref (inet_address);
   if (error != NULL)
     {
       g_error (error->message);
       return NULL;
     }
-  inet_IPv4_address = g_inet_address_new_any (G_SOCKET_FAMILY_IPV4);
-  socket_IPv4_address =
-    g_inet_socket_address_new (inet_IPv4_address, network_data->port_number);
-  g_socket_bind (socket_IPv4, socket_IPv4_address, FALSE, &error);
+  source = g_socket_create_source (socket, G_IO_IN | G_IO_HUP, NULL);
+  g_source_set_callback (source, (GSourceFunc) receive_data_callback,
+                         network_data, NULL);
+  g_source_attach (source, network_data->context);
+  *source_p = source;
+
+  return socket;
+}
+
+/* Create the sockets for the current port.  */
+static void
+create_sockets (struct network_info *network_data)
+{
+  /* Create a socket to listen for UDP messages on IPv6 and, if necessary,
+   * another to listen for UDP messages on IPv4. */
+  network_data->socket_IPv6 =
+    create_socket (G_SOCKET_FAMILY_IPV6, network_data,
+                   &network_data->source_IPv6);
+  network_data->kernel_drops_IPv6 = 0;
+  network_data->source_IPv4 = NULL;
+  network_data->socket_IPv4 = NULL;
+  network_data->kernel_drops_IPv4 = 0;
+  if (network_data->socket_IPv6 == NULL)
+    return;
+
+  if (g_socket_speaks_ipv4 (network_data->socket_IPv6))
+    return;
+
+  /* The IPv6 socket we just created doesn't speak IPv4, so create
+   * a socket that does. */
+  network_data->socket_IPv4 =
+    create_socket (G_SOCKET_FAMILY_IPV4, network_data,
+                   &network_data->source_IPv4);
+
+  return;
+}
+
+/* The network thread runs its own main loop until the program ends.  */
+static gpointer
+network_thread (gpointer user_data)
+{
+  struct network_info *network_data = user_data;
+
+  g_main_context_push_thread_default (network_data->context);
+  g_main_loop_run (network_data->loop);
+  g_main_context_pop_thread_default (network_data->context);
+
+  return NULL;
+}
+
+/* Initialize the network subroutines.  We don't listen for messages
+ * until network_start is called, so that compiling a project file does
+ * not need the port.  The return value is the persistent data.  */
+void *
+network_init (GApplication * app)
+{
+  struct network_info *network_data;
+  struct msghdr *message_header;
+  gint i;
+
+  /* Allocate the persistent information.  This also clears
+   * the counters.  */
+  network_data = g_malloc0 (sizeof (struct network_info));
+
+  /* Allocate the network buffer, which is divided among the datagrams
+   * of a batch.  Leave room after each datagram for a terminating
+   * NUL.  */
+  network_data->network_buffer =
+    g_malloc0 (network_buffer_size * network_batch_size);
+  for (i = 0; i < network_batch_size; i++)
+    {
+      network_data->vectors[i].iov_base =
+        network_data->network_buffer + (i * network_buffer_size);
+      network_data->vectors[i].iov_len = network_buffer_size - 1;
+      message_header = &network_data->messages[i].msg_hdr;
+      message_header->msg_name = NULL;
+      message_header->msg_namelen = 0;
+      message_header->msg_iov = &network_data->vectors[i];
+      message_header->msg_iovlen = 1;
+      message_header->msg_control = &network_data->control_buffers[i];
+      message_header->msg_controllen =
+        sizeof (network_data->control_buffers[i]);
+    }
+
+  /* Set the default port. */
+  network_data->port_number = 1500;
+  network_data->app = app;
+
+  network_data->context = g_main_context_new ();
+
+  return network_data;
+}
+
+/* Start to listen for messages.  Send text messages for testing
+ * using ncat: nc -u localhost 1500.  */
+void
+network_start (GApplication * app)
+{
+  struct network_info *network_data;
+
+  network_data = sep_get_network_data (app);
+  create_sockets (network_data);
+  if (network_data->socket_IPv6 == NULL)
+    return;
+
+  /* Start the network thread.  */
+  network_data->loop = g_main_loop_new (network_data->context, FALSE);
+  network_data->thread =
+    g_thread_new ("network", network_thread, network_data);
+
+  return;
+}
+
+/* Close a socket and stop listening to it.  */
+static void
+close_socket (GSocket ** socket_p, GSource ** source_p)
+{
+  GError *error = NULL;
+
+  if (*source_p == NULL)
+    return;
+
+  g_socket_close (*socket_p, &error);
   if (error != NULL)
     {
       g_error (error->message);
-      return NULL;
     }
-  source_IPv4 =
-    g_socket_create_source (socket_IPv4, G_IO_IN | G_IO_HUP, NULL);
-  g_source_set_callback (source_IPv4, (GSourceFunc) receive_data_callback,
-                         app, NULL);
-  g_source_attach (source_IPv4, NULL);
-  network_data->source_IPv4 = source_IPv4;
-  network_data->socket_IPv4 = socket_IPv4;
+  g_object_unref (*socket_p);
+  *socket_p = NULL;
 
-  return network_data;
+  g_source_destroy (*source_p);
+  g_source_unref (*source_p);
+  *source_p = NULL;
+
+  return;
+}
+
+/* Move the sockets to the current port.  This runs on the network
+ * thread, so the sockets are not closed while they are being read.  */
+static gboolean
+change_port_callback (gpointer user_data)
+{
+  struct network_info *network_data = user_data;
+
+  /* Stop network processing on the old port. */
+  close_socket (&network_data->socket_IPv4, &network_data->source_IPv4);
+  close_socket (&network_data->socket_IPv6, &network_data->source_IPv6);
+
+  /* Start listening on the new port.  */
+  create_sockets (network_data);
+
+  return G_SOURCE_REMOVE;
 }
 
 /* Set the network port number. */
 void
 network_set_port (int port_number, GApplication * app)
 {
-  GError *error = NULL;
-  GSocket *socket_IPv4, *socket_IPv6;
-  GInetAddress *inet_IPv4_address, *inet_IPv6_address;
-  GSocketAddress *socket_IPv4_address, *socket_IPv6_address;
-  GSource *source_IPv4, *source_IPv6;
   struct network_info *network_data;
 
   network_data = sep_get_network_data (app);
 
+  /* Reloading the project sets the port again; don't drop the
+   * sockets if it has not changed.  */
+  if (port_number == network_data->port_number)
+    return;
+
   network_data->port_number = port_number;
 
-  /* Stop network processing on the old port. */
-  if (network_data->source_IPv4 != NULL)
-    {
-      g_socket_close (network_data->socket_IPv4, &error);
-      if (error != NULL)
-        {
-          g_error (error->message);
-        }
-      g_object_unref (network_data->socket_IPv4);
-      network_data->socket_IPv4 = NULL;
+  /* If we are not listening yet, network_start will use the new
+   * port.  */
+  if (network_data->thread == NULL)
+    return;
 
-      g_source_destroy (network_data->source_IPv4);
-      g_source_unref (network_data->source_IPv4);
-      network_data->source_IPv4 = NULL;
-    }
-  if (network_data->source_IPv6 != NULL)
-    {
-      g_socket_close (network_data->socket_IPv6, &error);
-      if (error != NULL)
-        {
-          g_error (error->message);
-        }
-      g_object_unref (network_data->socket_IPv6);
-      network_data->socket_IPv6 = NULL;
+  g_main_context_invoke (network_data->context, change_port_callback,
+                         network_data);
 
-      g_source_destroy (network_data->source_IPv6);
-      g_source_unref (network_data->source_IPv6);
-      network_data->source_IPv6 = NULL;
-    }
+  return;
+}
 
-  /* Create a socket to listen for UDP messages on IPv6 and, if necessary,
-   * another to listen for UDP messages on IPv4. */
+/* Stop the network thread and close the sockets.  */
+void
+network_shutdown (GApplication * app)
+{
+  struct network_info *network_data;
 
-  socket_IPv6 =
-    g_socket_new (G_SOCKET_FAMILY_IPV6, G_SOCKET_TYPE_DATAGRAM,
-                  G_SOCKET_PROTOCOL_UDP, &error);
-  if (error != NULL)
-    {
-      g_error (error->message);
-      return;
-    }
+  network_data = sep_get_network_data (app);
+  if ((network_data == NULL) || (network_data->thread == NULL))
+    return;
 
-  inet_IPv6_address = g_inet_address_new_any (G_SOCKET_FAMILY_IPV6);
-  socket_IPv6_address =
-    g_inet_socket_address_new (inet_IPv6_address, network_data->port_number);
-  g_socket_bind (socket_IPv6, socket_IPv6_address, FALSE, &error);
-  if (error != NULL)
-    {
-      g_error (error->message);
-      return;
-    }
-  source_IPv6 =
-    g_socket_create_source (socket_IPv6, G_IO_IN | G_IO_HUP, NULL);
-  g_source_set_callback (source_IPv6, (GSourceFunc) receive_data_callback,
-                         app, NULL);
-  g_source_attach (source_IPv6, NULL);
-  network_data->source_IPv6 = source_IPv6;
-  network_data->socket_IPv6 = socket_IPv6;
-
-  if (g_socket_speaks_ipv4 (socket_IPv6))
-    {
-      network_data->source_IPv4 = NULL;
-      return;
-    }
+  g_main_loop_quit (network_data->loop);
+  g_thread_join (network_data->thread);
+  network_data->thread = NULL;
 
-  /* The IPv6 socket we just created doesn't speak IPv4, so create
-   * a socket that does. */
+  close_socket (&network_data->socket_IPv4, &network_data->source_IPv4);
+  close_socket (&network_data->socket_IPv6, &network_data->source_IPv6);
 
-  socket_IPv4 =
-    g_socket_new (G_SOCKET_FAMILY_IPV4, G_SOCKET_TYPE_DATAGRAM,
-                  G_SOCKET_PROTOCOL_UDP, &error);
-  if (error != NULL)
+  return;
+}
+
+/* Copy the network counters.  The network thread may be updating
+ * them, so each is read atomically.  */
+gboolean
+network_get_statistics (struct network_statistics *statistics,
+                        GApplication * app)
+{
+  struct network_info *network_data;
+  struct network_statistics *counters;
+  gint i;
+
+  network_data = sep_get_network_data (app);
+  if ((network_data == NULL) || (network_data->loop == NULL))
+    return FALSE;
+
+  counters = &network_data->statistics;
+  statistics->wakeups =
+    __atomic_load_n (&counters->wakeups, __ATOMIC_RELAXED);
+  statistics->batches =
+    __atomic_load_n (&counters->batches, __ATOMIC_RELAXED);
+  statistics->datagrams =
+    __atomic_load_n (&counters->datagrams, __ATOMIC_RELAXED);
+  statistics->truncated =
+    __atomic_load_n (&counters->truncated, __ATOMIC_RELAXED);
+  statistics->kernel_drops =
+    __atomic_load_n (&counters->kernel_drops, __ATOMIC_RELAXED);
+  statistics->max_batch_size = g_atomic_int_get (&counters->max_batch_size);
+  for (i = 0; i <= network_batch_size; i++)
     {
-      g_error (error->message);
-      return;
+      statistics->batch_size_counts[i] =
+        __atomic_load_n (&counters->batch_size_counts[i], __ATOMIC_RELAXED);
     }
-  inet_IPv4_address = g_inet_address_new_any (G_SOCKET_FAMILY_IPV4);
-  socket_IPv4_address =
-    g_inet_socket_address_new (inet_IPv4_address, network_data->port_number);
-  g_socket_bind (socket_IPv4, socket_IPv4_address, FALSE, &error);
-  if (error != NULL)
+
+  return TRUE;
+}
+
+/* Print the network counters.  */
+void
+network_print_statistics (GApplication * app)
+{
+  struct network_statistics statistics;
+  gint i;
+
+  if (!network_get_statistics (&statistics, app))
+    return;
+
+  g_print ("network: %" G_GUINT64_FORMAT " wakeups, %" G_GUINT64_FORMAT
+           " batches, %" G_GUINT64_FORMAT " datagrams, largest batch %d, %"
+           G_GUINT64_FORMAT " truncated, %" G_GUINT64_FORMAT
+           " dropped by the kernel.\n",
+           statistics.wakeups, statistics.batches, statistics.datagrams,
+           statistics.max_batch_size, statistics.truncated,
+           statistics.kernel_drops);
+  for (i = 1; i <= network_batch_size; i++)
     {
-      g_error (error->message);
-      return;
+      if (statistics.batch_size_counts[i] != 0)
+        {
+          g_print ("network: %" G_GUINT64_FORMAT " batches of size %d.\n",
+                   statistics.batch_size_counts[i], i);
+        }
     }
-  source_IPv4 =
-    g_socket_create_source (socket_IPv4, G_IO_IN | G_IO_HUP, NULL);
-  g_source_set_callback (source_IPv4, (GSourceFunc) receive_data_callback,
-                         app, NULL);
-  g_source_attach (source_IPv4, NULL);
-  network_data->source_IPv4 = source_IPv4;
-  network_data->socket_IPv6 = socket_IPv6;
 
   return;
 }
@@ -22,13 +22,44 @@
 
 #define network_buffer_size 8000
 
+/* The most datagrams we read from a socket at once.  */
+#define network_batch_size 32
+
+/* Counters kept by the network subroutines.  The network thread
+ * updates them with atomic operations, so they can be read from any
+ * thread; network_get_statistics copies them the same way.  They are
+ * 64 bits wide, so they do not wrap during a long show.  */
+struct network_statistics
+{
+  guint64 wakeups;              /* main loop dispatches with data */
+  guint64 batches;              /* batches of datagrams read */
+  guint64 datagrams;            /* datagrams read */
+  guint64 truncated;            /* datagrams discarded for being too long */
+  guint64 kernel_drops;         /* datagrams the kernel had no room for */
+  gint max_batch_size;
+  guint64 batch_size_counts[network_batch_size + 1];
+};
+
 /* Subroutines defined in network_subroutines.c */
 
 /* Initialize. */
 void *network_init (GApplication * app);
 
+/* Start to listen for messages.  */
+void network_start (GApplication * app);
+
 /* Set the port number. */
 void network_set_port (int port_number, GApplication * app);
 
 /* Get the port number. */
 gint network_get_port (GApplication * app);
+
+/* Stop listening.  */
+void network_shutdown (GApplication * app);
+
+/* Copy the counters.  Return FALSE if we have not listened.  */
+gboolean network_get_statistics (struct network_statistics *statistics,
+                                 GApplication * app);
+
+/* Print the counters.  */
+void network_print_statistics (GApplication * app);
@@ -0,0 +1,864 @@
+/*
+ * osc_subroutines.c
+ *
+ * Copyright © 2016 by John Sauter <John_Sauter@systemeyescomputerstore.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <gtk/gtk.h>
+#include "osc_subroutines.h"
+#include "sound_effects_player.h"
+#include "sound_structure.h"
+#include "sound_subroutines.h"
+#include "sequence_subroutines.h"
+#include "trace_ring_subroutines.h"
+
+/* These subroutines decode Open Sound Control (OSC) 1.0 packets, which
+ * arrive on the same port as the text commands.  A packet is either a
+ * message or a bundle.  A message has an address pattern, a type tag
+ * string and arguments.  A bundle has a time tag and a sequence of
+ * messages and bundles, which are to be executed at the time indicated.
+ *
+ * The addresses we respond to are:
+ *   /cue Q_number          -- MIDI Show Control Go for the Q_number,
+ *                             which may be a string, an integer or a float
+ *   /quit                  -- terminate the program
+ *   /cluster/N/start       -- start the sound offered on cluster N
+ *   /cluster/N/stop        -- stop the sound offered on cluster N
+ *   /sound/OSC_name/start  -- start the sound with that OSC name
+ *   /sound/OSC_name/stop   -- stop the sound with that OSC name
+ *
+ * The address patterns may use the OSC wildcards ?, *, [...] and {...}
+ * in each part of the address.  */
+
+/* The addresses we respond to are held in a tree, one level per part
+ * of the address, so that an address pattern is matched one part at a
+ * time.  A part without wildcards is found with a single hash table
+ * lookup.  The tree is built when it is first needed after the sounds
+ * or clusters change.  */
+
+enum osc_method_code
+{
+  osc_method_none = 0,
+  osc_method_cue,
+  osc_method_quit,
+  osc_method_cluster_start,
+  osc_method_cluster_stop,
+  osc_method_sound_start,
+  osc_method_sound_stop
+};
+
+struct osc_node
+{
+  gchar *name;
+  GHashTable *children;         /* name -> struct osc_node */
+  enum osc_method_code method_code;
+  guint cluster_number;
+  struct sound_info *sound_effect;
+};
+
+/* A message in a bundle whose time has not yet come.  */
+struct osc_scheduled_message
+{
+  gint64 execute_time;          /* real time, in microseconds */
+  gsize length;
+  gchar *data;
+};
+
+/* The persistent data used by the OSC subroutines.  */
+struct osc_info
+{
+  struct osc_node *address_space;
+  GList *scheduled_messages;    /* sorted by execute time */
+  guint timeout_source_id;
+  gint64 timeout_time;
+};
+
+/* A decoded message.  The strings point into the packet.  */
+struct osc_message
+{
+  const gchar *address_pattern;
+  const gchar *type_tags;
+  const gchar *arguments;
+  const gchar *end;
+};
+
+/* The number of seconds from the OSC time tag epoch, 1900, to the
+ * Unix epoch, 1970.  */
+#define OSC_EPOCH_OFFSET G_GINT64_CONSTANT (2208988800)
+
+/* The time tag that means "now".  */
+#define OSC_IMMEDIATELY G_GUINT64_CONSTANT (1)
+
+static void dispatch_message (struct osc_info *osc_data, const gchar * data,
+                              gsize length, GApplication * app);
+
+/* Read a big-endian 32-bit integer from a packet, which might not be
+ * aligned in memory.  */
+static guint32
+read_uint32 (const gchar * data)
+{
+  guint32 value;
+
+  memcpy (&value, data, sizeof (value));
+  return (GUINT32_FROM_BE (value));
+}
+
+/* Likewise for a 64-bit integer.  */
+static guint64
+read_uint64 (const gchar * data)
+{
+  guint64 value;
+
+  memcpy (&value, data, sizeof (value));
+  return (GUINT64_FROM_BE (value));
+}
+
+/* Find the end of an OSC string starting at offset.  OSC strings are
+ * terminated by a NUL and padded with NULs to a multiple of 4 bytes.
+ * The value is the offset of the next item, or 0 if the string does not
+ * fit in the packet.  */
+static gsize
+skip_string (const gchar * data, gsize offset, gsize length)
+{
+  const gchar *nul_ptr;
+  gsize string_length;
+
+  if (offset >= length)
+    return 0;
+  nul_ptr = memchr (data + offset, '\0', length - offset);
+  if (nul_ptr == NULL)
+    return 0;
+  string_length = nul_ptr - (data + offset);
+  offset = offset + ((string_length + 4) & ~(gsize) 3);
+  if (offset > length)
+    return 0;
+  return offset;
+}
+
+/* Allocate a node of the address space tree.  */
+static struct osc_node *
+new_node (const gchar * name)
+{
+  struct osc_node *node;
+
+  node = g_malloc0 (sizeof (struct osc_node));
+  node->name = g_strdup (name);
+  node->children = NULL;
+  node->method_code = osc_method_none;
+  return node;
+}
+
+/* Deallocate a node and all of its children.  */
+static void
+free_node (gpointer data)
+{
+  struct osc_node *node = data;
+
+  if (node->children != NULL)
+    g_hash_table_destroy (node->children);
+  g_free (node->name);
+  g_free (node);
+  return;
+}
+
+/* Add an address to the address space.  */
+static struct osc_node *
+add_address (struct osc_node *root, const gchar * address,
+             enum osc_method_code method_code)
+{
+  gchar **parts;
+  gint i;
+  struct osc_node *node, *child;
+
+  /* The address starts with a slash, so the first part is empty.  */
+  parts = g_strsplit (address, "/", -1);
+  node = root;
+  for (i = 1; parts[i] != NULL; i++)
+    {
+      if (node->children == NULL)
+        {
+          node->children =
+            g_hash_table_new_full (g_str_hash, g_str_equal, NULL, free_node);
+        }
+      child = g_hash_table_lookup (node->children, parts[i]);
+      if (child == NULL)
+        {
+          child = new_node (parts[i]);
+          g_hash_table_insert (node->children, child->name, child);
+        }
+      node = child;
+    }
+  g_strfreev (parts);
+
+  node->method_code = method_code;
+  return node;
+}
+
+/* Build the tree of addresses we respond to.  */
+static struct osc_node *
+build_address_space (GApplication * app)
+{
+  struct osc_node *root, *node;
+  GList *sound_list;
+  struct sound_info *sound_effect;
+  guint cluster_number;
+  gchar *address;
+
+  root = new_node ("");
+  add_address (root, "/cue", osc_method_cue);
+  add_address (root, "/quit", osc_method_quit);
+
+  for (cluster_number = 0;
+       sep_get_cluster_from_number (cluster_number, app) != NULL;
+       cluster_number++)
+    {
+      address = g_strdup_printf ("/cluster/%u/start", cluster_number);
+      node = add_address (root, address, osc_method_cluster_start);
+      node->cluster_number = cluster_number;
+      g_free (address);
+      address = g_strdup_printf ("/cluster/%u/stop", cluster_number);
+      node = add_address (root, address, osc_method_cluster_stop);
+      node->cluster_number = cluster_number;
+      g_free (address);
+    }
+
+  for (sound_list = sep_get_sound_list (app); sound_list != NULL;
+       sound_list = sound_list->next)
+    {
+      sound_effect = sound_list->data;
+      if ((!sound_effect->OSC_name_specified)
+          || (sound_effect->OSC_name == NULL)
+          || (sound_effect->OSC_name[0] == '\0') || sound_effect->disabled)
+        continue;
+
+      address = g_strdup_printf ("/sound/%s/start", sound_effect->OSC_name);
+      node = add_address (root, address, osc_method_sound_start);
+      node->sound_effect = sound_effect;
+      g_free (address);
+      address = g_strdup_printf ("/sound/%s/stop", sound_effect->OSC_name);
+      node = add_address (root, address, osc_method_sound_stop);
+      node->sound_effect = sound_effect;
+      g_free (address);
+    }
+
+  return root;
+}
+
+/* Initialize the OSC subroutines.  The return value is the persistent
+ * data.  */
+void *
+osc_init (GApplication * app)
+{
+  struct osc_info *osc_data;
+
+  osc_data = g_malloc0 (sizeof (struct osc_info));
+  osc_data->address_space = NULL;
+  osc_data->scheduled_messages = NULL;
+  osc_data->timeout_source_id = 0;
+
+  return osc_data;
+}
+
+/* The sounds or clusters have changed.  Discard the address space;
+ * it will be rebuilt when it is next needed.  */
+void
+osc_address_space_changed (GApplication * app)
+{
+  struct osc_info *osc_data;
+
+  osc_data = sep_get_osc_data (app);
+  if (osc_data->address_space != NULL)
+    {
+      free_node (osc_data->address_space);
+      osc_data->address_space = NULL;
+    }
+
+  return;
+}
+
+/* Does a part of an address pattern contain any wildcards?  */
+static gboolean
+has_wildcards (const gchar * pattern, const gchar * pattern_end)
+{
+  const gchar *p;
+
+  for (p = pattern; p < pattern_end; p++)
+    {
+      switch (*p)
+        {
+        case '?':
+        case '*':
+        case '[':
+        case '{':
+          return TRUE;
+        default:
+          break;
+        }
+    }
+  return FALSE;
+}
+
+static gboolean match_part (const gchar * pattern, const gchar * pattern_end,
+                            const gchar * name);
+
+/* Match a character against a bracketed list of characters, such as
+ * [a-z] or [!0-9].  The pattern points after the opening bracket.
+ * The value is the pointer after the closing bracket, or NULL if there
+ * is no closing bracket.  */
+static const gchar *
+match_bracket (const gchar * pattern, const gchar * pattern_end, gchar c,
+               gboolean * matched)
+{
+  const gchar *p;
+  gboolean negate;
+  gboolean found;
+
+  p = pattern;
+  negate = FALSE;
+  if ((p < pattern_end) && (*p == '!'))
+    {
+      negate = TRUE;
+      p++;
+    }
+
+  found = FALSE;
+  while ((p < pattern_end) && (*p != ']'))
+    {
+      if ((p + 2 < pattern_end) && (p[1] == '-') && (p[2] != ']'))
+        {
+          if (((guchar) c >= (guchar) p[0]) && ((guchar) c <= (guchar) p[2]))
+            found = TRUE;
+          p = p + 3;
+        }
+      else
+        {
+          if (c == *p)
+            found = TRUE;
+          p = p + 1;
+        }
+    }
+  if (p >= pattern_end)
+    return NULL;
+
+  *matched = (found != negate);
+  return (p + 1);
+}
+
+/* Match a name against a list of alternatives, such as {start,stop},
+ * followed by the rest of the pattern.  The pattern points after the
+ * opening brace.  */
+static gboolean
+match_alternatives (const gchar * pattern, const gchar * pattern_end,
+                    const gchar * name)
+{
+  const gchar *close_brace;
+  const gchar *alternative, *alternative_end;
+  gsize alternative_length;
+
+  close_brace = memchr (pattern, '}', pattern_end - pattern);
+  if (close_brace == NULL)
+    return FALSE;
+
+  alternative = pattern;
+  while (alternative <= close_brace)
+    {
+      alternative_end = memchr (alternative, ',', close_brace - alternative);
+      if (alternative_end == NULL)
+        alternative_end = close_brace;
+      alternative_length = alternative_end - alternative;
+      if ((strncmp (name, alternative, alternative_length) == 0)
+          && match_part (close_brace + 1, pattern_end,
+                         name + alternative_length))
+        return TRUE;
+      alternative = alternative_end + 1;
+    }
+
+  return FALSE;
+}
+
+/* Match one part of an address pattern against the name of a node.  */
+static gboolean
+match_part (const gchar * pattern, const gchar * pattern_end,
+            const gchar * name)
+{
+  const gchar *p;
+  gboolean matched;
+
+  p = pattern;
+  while (p < pattern_end)
+    {
+      switch (*p)
+        {
+        case '*':
+          /* Try each possible length for the run of characters matched
+           * by the asterisk, including none.  */
+          p++;
+          do
+            {
+              if (match_part (p, pattern_end, name))
+                return TRUE;
+            }
+          while (*name++ != '\0');
+          return FALSE;
+
+        case '?':
+          if (*name == '\0')
+            return FALSE;
+          p++;
+          name++;
+          break;
+
+        case '[':
+          if (*name == '\0')
+            return FALSE;
+          p = match_bracket (p + 1, pattern_end, *name, &matched);
+          if ((p == NULL) || !matched)
+            return FALSE;
+          name++;
+          break;
+
+        case '{':
+          return (match_alternatives (p + 1, pattern_end, name));
+
+        default:
+          if (*p != *name)
+            return FALSE;
+          p++;
+          name++;
+          break;
+        }
+    }
+
+  return (*name == '\0');
+}
+
+/* Extract the first argument of a message as a string.  Numbers are
+ * converted to text.  The value is NULL if there is no usable argument.  */
+static const gchar *
+first_argument_as_string (struct osc_message *message, gchar * buffer,
+                          gsize buffer_size)
+{
+  guint32 int_value;
+  gfloat float_value;
+
+  if ((message->type_tags[0] != ',') || (message->type_tags[1] == '\0'))
+    return NULL;
+
+  switch (message->type_tags[1])
+    {
+    case 's':
+    case 'S':
+      if (memchr (message->arguments, '\0',
+                  message->end - message->arguments) == NULL)
+        return NULL;
+      return (message->arguments);
+
+    case 'i':
+      if (message->arguments + 4 > message->end)
+        return NULL;
+      int_value = read_uint32 (message->arguments);
+      g_snprintf (buffer, buffer_size, "%d", (gint32) int_value);
+      return buffer;
+
+    case 'f':
+      if (message->arguments + 4 > message->end)
+        return NULL;
+      int_value = read_uint32 (message->arguments);
+      memcpy (&float_value, &int_value, sizeof (float_value));
+      g_snprintf (buffer, buffer_size, "%g", float_value);
+      return buffer;
+
+    default:
+      return NULL;
+    }
+}
+
+/* Perform the action of an address that matched a message.  */
+static void
+invoke_method (struct osc_node *node, struct osc_message *message,
+               GApplication * app)
+{
+  const gchar *Q_number;
+  gchar number_buffer[G_ASCII_DTOSTR_BUF_SIZE];
+
+  if (TRACE_RING_ENABLED (trace_osc))
+    {
+      trace_ring_record (trace_osc, "OSC %s matches method %d.",
+                         message->address_pattern, node->method_code);
+    }
+
+  switch (node->method_code)
+    {
+    case osc_method_cue:
+      Q_number =
+        first_argument_as_string (message, number_buffer,
+                                  sizeof (number_buffer));
+      sequence_MIDI_show_control_go ((gchar *) Q_number, app);
+      break;
+
+    case osc_method_quit:
+      g_application_quit (app);
+      break;
+
+    case osc_method_cluster_start:
+      sequence_cluster_start (node->cluster_number, app);
+      break;
+
+    case osc_method_cluster_stop:
+      sequence_cluster_stop (node->cluster_number, app);
+      break;
+
+    case osc_method_sound_start:
+      sound_start_playing (node->sound_effect, app);
+      break;
+
+    case osc_method_sound_stop:
+      sound_stop_playing (node->sound_effect, app);
+      break;
+
+    default:
+      break;
+    }
+
+  return;
+}
+
+/* Match the rest of an address pattern against a node of the address
+ * space, and invoke every method that matches.  The pattern points
+ * after a slash.  */
+static void
+match_address (struct osc_node *node, const gchar * pattern,
+               struct osc_message *message, gint * match_count,
+               GApplication * app)
+{
+  const gchar *part_end;
+  const gchar *next_part;
+  gchar part_name[256];
+  gsize part_length;
+  struct osc_node *child;
+  GHashTableIter iter;
+  gpointer key, value;
+
+  if (node->children == NULL)
+    return;
+
+  part_end = strchr (pattern, '/');
+  if (part_end == NULL)
+    {
+      part_end = pattern + strlen (pattern);
+      next_part = NULL;
+    }
+  else
+    next_part = part_end + 1;
+
+  if (!has_wildcards (pattern, part_end))
+    {
+      /* This part of the pattern is an ordinary name, so we need
+       * only look it up.  */
+      part_length = part_end - pattern;
+      if (part_length >= sizeof (part_name))
+        return;
+      memcpy (part_name, pattern, part_length);
+      part_name[part_length] = '\0';
+      child = g_hash_table_lookup (node->children, part_name);
+      if (child == NULL)
+        return;
+      if (next_part != NULL)
+        match_address (child, next_part, message, match_count, app);
+      else if (child->method_code != osc_method_none)
+        {
+          invoke_method (child, message, app);
+          *match_count = *match_count + 1;
+        }
+      return;
+    }
+
+  /* Otherwise, try each child of this node.  */
+  g_hash_table_iter_init (&iter, node->children);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      child = value;
+      if (!match_part (pattern, part_end, child->name))
+        continue;
+      if (next_part != NULL)
+        match_address (child, next_part, message, match_count, app);
+      else if (child->method_code != osc_method_none)
+        {
+          invoke_method (child, message, app);
+          *match_count = *match_count + 1;
+        }
+    }
+
+  return;
+}
+
+/* Execute an OSC message.  */
+static void
+dispatch_message (struct osc_info *osc_data, const gchar * data,
+                  gsize length, GApplication * app)
+{
+  struct osc_message message;
+  gsize offset, arguments_offset;
+  gint match_count;
+
+  /* Isolate the address pattern and the type tag string.
+   * Very old senders omit the type tag string.  */
+  offset = skip_string (data, 0, length);
+  if (offset == 0)
+    {
+      g_print ("Malformed OSC message.\n");
+      return;
+    }
+  message.address_pattern = data;
+  message.end = data + length;
+  if ((offset < length) && (data[offset] == ','))
+    {
+      arguments_offset = skip_string (data, offset, length);
+      if (arguments_offset == 0)
+        {
+          g_print ("Malformed OSC message %s.\n", data);
+          return;
+        }
+      message.type_tags = data + offset;
+      message.arguments = data + arguments_offset;
+    }
+  else
+    {
+      message.type_tags = ",";
+      message.arguments = data + offset;
+    }
+
+  if (osc_data->address_space == NULL)
+    osc_data->address_space = build_address_space (app);
+
+  match_count = 0;
+  match_address (osc_data->address_space, message.address_pattern + 1,
+                 &message, &match_count, app);
+  if (match_count == 0)
+    {
+      g_print ("Unknown OSC address %s.\n", message.address_pattern);
+    }
+
+  return;
+}
+
+/* Convert an OSC time tag to the real time, in microseconds.  */
+static gint64
+time_tag_to_real_time (guint64 time_tag)
+{
+  gint64 seconds;
+  guint64 fraction;
+
+  seconds = (gint64) (time_tag >> 32) - OSC_EPOCH_OFFSET;
+  fraction = time_tag & G_GUINT64_CONSTANT (0xFFFFFFFF);
+  return ((seconds * G_USEC_PER_SEC) + ((fraction * G_USEC_PER_SEC) >> 32));
+}
+
+/* Order scheduled messages by their execution time.  Messages with the
+ * same time stay in the order they arrived.  */
+static gint
+compare_execute_times (gconstpointer a, gconstpointer b)
+{
+  const struct osc_scheduled_message *message_a = a;
+  const struct osc_scheduled_message *message_b = b;
+
+  if (message_a->execute_time < message_b->execute_time)
+    return -1;
+  if (message_a->execute_time > message_b->execute_time)
+    return 1;
+  return 0;
+}
+
+static void arm_timeout (struct osc_info *osc_data, GApplication * app);
+
+/* The time has come to execute one or more scheduled messages.  */
+static gboolean
+timeout_expired (gpointer user_data)
+{
+  GApplication *app = user_data;
+  struct osc_info *osc_data;
+  struct osc_scheduled_message *scheduled_message;
+  gint64 now;
+
+  osc_data = sep_get_osc_data (app);
+  osc_data->timeout_source_id = 0;
+
+  /* Execute every message whose time has come.  A timeout may fire
+   * up to a millisecond early, since its interval is in milliseconds.  */
+  now = g_get_real_time ();
+  while (osc_data->scheduled_messages != NULL)
+    {
+      scheduled_message = osc_data->scheduled_messages->data;
+      if (scheduled_message->execute_time > now + 1000)
+        break;
+      osc_data->scheduled_messages =
+        g_list_delete_link (osc_data->scheduled_messages,
+                            osc_data->scheduled_messages);
+      if (TRACE_RING_ENABLED (trace_osc))
+        {
+          trace_ring_record (trace_osc, "OSC message %s executed %"
+                             G_GINT64_FORMAT " microseconds late.",
+                             scheduled_message->data,
+                             now - scheduled_message->execute_time);
+        }
+      dispatch_message (osc_data, scheduled_message->data,
+                        scheduled_message->length, app);
+      g_free (scheduled_message->data);
+      g_free (scheduled_message);
+    }
+
+  arm_timeout (osc_data, app);
+  return G_SOURCE_REMOVE;
+}
+
+/* Make sure we will wake up when the earliest scheduled message is
+ * due.  */
+static void
+arm_timeout (struct osc_info *osc_data, GApplication * app)
+{
+  struct osc_scheduled_message *scheduled_message;
+  gint64 delay;
+
+  if (osc_data->scheduled_messages == NULL)
+    return;
+
+  scheduled_message = osc_data->scheduled_messages->data;
+  if ((osc_data->timeout_source_id != 0)
+      && (osc_data->timeout_time == scheduled_message->execute_time))
+    return;
+
+  if (osc_data->timeout_source_id != 0)
+    g_source_remove (osc_data->timeout_source_id);
+
+  delay = scheduled_message->execute_time - g_get_real_time ();
+  if (delay < 0)
+    delay = 0;
+  osc_data->timeout_time = scheduled_message->execute_time;
+  osc_data->timeout_source_id =
+    g_timeout_add_full (G_PRIORITY_HIGH, (guint) (delay / 1000),
+                        timeout_expired, app, NULL);
+
+  return;
+}
+
+/* Hold a message until its time comes.  */
+static void
+schedule_message (struct osc_info *osc_data, const gchar * data,
+                  gsize length, gint64 execute_time, GApplication * app)
+{
+  struct osc_scheduled_message *scheduled_message;
+
+  scheduled_message = g_malloc (sizeof (struct osc_scheduled_message));
+  scheduled_message->execute_time = execute_time;
+  scheduled_message->length = length;
+  scheduled_message->data = g_memdup (data, length);
+  osc_data->scheduled_messages =
+    g_list_insert_sorted (osc_data->scheduled_messages, scheduled_message,
+                          compare_execute_times);
+
+  if (TRACE_RING_ENABLED (trace_osc))
+    {
+      trace_ring_record (trace_osc, "OSC message %s scheduled %"
+                         G_GINT64_FORMAT " microseconds from now.", data,
+                         execute_time - g_get_real_time ());
+    }
+
+  arm_timeout (osc_data, app);
+  return;
+}
+
+/* Process an OSC packet, which is a message or a bundle.  Execute_time
+ * is the time at which the enclosing bundle is to be executed, or 0 if
+ * it is to be executed immediately.  */
+static void
+process_element (struct osc_info *osc_data, const gchar * data,
+                 gsize length, gint64 execute_time, GApplication * app)
+{
+  guint64 time_tag;
+  gint64 bundle_time;
+  gsize offset;
+  guint32 element_length;
+
+  if ((length >= 16) && (memcmp (data, "#bundle", 8) == 0))
+    {
+      /* A bundle has a time tag followed by its elements, each preceded
+       * by its length.  A bundle inside a bundle may not be executed
+       * before its enclosing bundle.  */
+      time_tag = read_uint64 (data + 8);
+      bundle_time = execute_time;
+      if (time_tag != OSC_IMMEDIATELY)
+        bundle_time = MAX (time_tag_to_real_time (time_tag), execute_time);
+
+      offset = 16;
+      while (offset + 4 <= length)
+        {
+          element_length = read_uint32 (data + offset);
+          offset = offset + 4;
+          if ((element_length % 4 != 0) || (element_length > length - offset))
+            {
+              g_print ("Malformed OSC bundle.\n");
+              return;
+            }
+          process_element (osc_data, data + offset, element_length,
+                           bundle_time, app);
+          offset = offset + element_length;
+        }
+      return;
+    }
+
+  if ((length >= 4) && (data[0] == '/'))
+    {
+      if ((execute_time != 0) && (execute_time > g_get_real_time ()))
+        schedule_message (osc_data, data, length, execute_time, app);
+      else
+        dispatch_message (osc_data, data, length, app);
+      return;
+    }
+
+  g_print ("Malformed OSC packet.\n");
+  return;
+}
+
+/* Determine whether a datagram is an OSC packet.  OSC packets are a
+ * multiple of 4 bytes long, and either start with "#bundle" or are
+ * messages, whose address pattern starts with a slash and is padded with
+ * NULs.  Text commands never contain a NUL.  */
+gboolean
+osc_is_packet (const gchar * data, gsize length)
+{
+  if ((length < 4) || (length % 4 != 0))
+    return FALSE;
+  if ((length >= 16) && (memcmp (data, "#bundle", 8) == 0))
+    return TRUE;
+  if ((data[0] == '/') && (memchr (data, '\0', length) != NULL))
+    return TRUE;
+  return FALSE;
+}
+
+/* Decode an OSC packet.  Its messages are executed now, or scheduled
+ * for the time given in their bundle.  Since a time tag is an absolute
+ * time, the sender's clock must agree with ours.  */
+void
+osc_process_packet (const gchar * data, gsize length, GApplication * app)
+{
+  struct osc_info *osc_data;
+
+  osc_data = sep_get_osc_data (app);
+  process_element (osc_data, data, length, 0, app);
+
+  return;
+}
@@ -0,0 +1,40 @@
+/*
+ * osc_subroutines.h
+ *
+ * Copyright © 2016 by John Sauter <John_Sauter@systemeyescomputerstore.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtk/gtk.h>
+
+/* Subroutines defined in osc_subroutines.c */
+
+/* Initialize the Open Sound Control decoder.  */
+void *osc_init (GApplication * app);
+
+/* Determine whether a datagram is an Open Sound Control packet,
+ * rather than a text command.  */
+gboolean osc_is_packet (const gchar * data, gsize length);
+
+/* Decode an Open Sound Control packet and execute or schedule
+ * its messages.  */
+void osc_process_packet (const gchar * data, gsize length,
+                         GApplication * app);
+
+/* The sounds or clusters have changed, so the addresses we respond to
+ * must be recomputed.  */
+void osc_address_space_changed (GApplication * app);
+
+/* End of file osc_subroutines.h */
@@ -0,0 +1,89 @@
+/*
+ * parse_net_benchmark.c
+ *
+ * Copyright © 2016 by John Sauter <John_Sauter@systemeyescomputerstore.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "net_command_subroutines.h"
+
+/* Measure how many network commands can be divided and decoded per
+ * second on one core.  The decoder depends on nothing but GLib, so the
+ * benchmark links it alone, not the rest of the application; only the
+ * decoding of the commands is timed, not their queuing or execution.
+ * Run it with "make parse_net_benchmark && ./parse_net_benchmark",
+ * optionally giving the number of seconds to run.  The result is also
+ * printed on a line starting with "benchmark:", for
+ * benchmark_check.sh.  */
+
+/* A datagram of typical commands, as a cue controller would send them.  */
+static const gchar sample_text[] =
+  "start 1\nstop 1\n/cue 12\nstart 15\n  stop 0x0f  \r\n/cue 1.5\n";
+
+int
+main (int argc, char *argv[])
+{
+  gchar buffer[sizeof (sample_text)];
+  gchar *line, *next_line;
+  struct net_command_text command_text;
+  gdouble run_seconds;
+  gint64 run_time, elapsed_time, batch_start_time;
+  guint64 datagram_count, command_count;
+  gint i;
+
+  run_seconds = 1.0;
+  if (argc > 1)
+    run_seconds = g_ascii_strtod (argv[1], NULL);
+
+  net_command_check_keywords ();
+
+  /* Each datagram is copied into the buffer before it is decoded, since
+   * decoding modifies its text, just as the network subroutines
+   * receive each datagram into their buffer.  */
+  datagram_count = 0;
+  command_count = 0;
+  run_time = (gint64) (run_seconds * G_USEC_PER_SEC);
+  elapsed_time = 0;
+  do
+    {
+      batch_start_time = g_get_monotonic_time ();
+      for (i = 0; i < 1000; i++)
+        {
+          memcpy (buffer, sample_text, sizeof (sample_text));
+          for (line = buffer; line != NULL; line = next_line)
+            {
+              next_line = net_command_next_line (line);
+              if (net_command_decode (line, &command_text) ==
+                  net_command_valid)
+                command_count = command_count + 1;
+            }
+        }
+      elapsed_time =
+        elapsed_time + (g_get_monotonic_time () - batch_start_time);
+      datagram_count = datagram_count + 1000;
+    }
+  while (elapsed_time < run_time);
+
+  g_print ("%" G_GUINT64_FORMAT " commands in %" G_GUINT64_FORMAT
+           " datagrams in %.3f seconds: %.0f commands per second.\n",
+           command_count, datagram_count,
+           (gdouble) elapsed_time / G_USEC_PER_SEC,
+           (gdouble) command_count * G_USEC_PER_SEC / elapsed_time);
+  g_print ("benchmark: parse_net_commands_per_second %.0f higher\n",
+           (gdouble) command_count * G_USEC_PER_SEC / elapsed_time);
+
+  return 0;
+}
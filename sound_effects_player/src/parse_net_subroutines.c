@@ -17,16 +17,35 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <stdlib.h>
 #include <string.h>
 #include "parse_net_subroutines.h"
+#include "latency_subroutines.h"
+#include "monitor_subroutines.h"
+#include "net_command_subroutines.h"
+#include "network_subroutines.h"
+#include "osc_subroutines.h"
+#include "qos_subroutines.h"
 #include "sound_effects_player.h"
 #include "sound_subroutines.h"
 #include "sequence_subroutines.h"
+#include "reload_subroutines.h"
+#include "tracer_subroutines.h"
+#include "trace_ring_subroutines.h"
 
 /* These subroutines are used to process network messages.
- * Each message consists of a keyword followed by a value.  Upon receiving
+ * Each message consists of one or more commands separated by newlines.
+ * Each command consists of a keyword followed by a value.  Upon receiving
  * a command we perform the action specified by the keyword.
+ * The message is parsed in place.
+ *
+ * Messages are received and parsed by the network thread, which
+ * decodes each command with net_command_subroutines.c.  The commands
+ * are passed through a ring of command slots to the main thread, which
+ * executes them, so parsing does not wait for the user interface.  The
+ * slots, and the main loop source which wakes the main thread to
+ * execute them, are made when the parser is initialized, so passing a
+ * command allocates no memory.  We measure how long each command
+ * takes from its arrival to the completion of its action.
  */
 
 /* The persistent data used by the parser.  It is allocated when the
@@ -36,137 +55,404 @@
 
 struct parse_net_info
 {
-  GHashTable *hash_table;
   gchar *message_buffer;
-};
 
-/* The keyword hash table. */
-enum keyword_codes
-{ keyword_start = 1, keyword_stop, keyword_quit, keyword_cue };
+  /* Commands waiting to be executed by the main thread.  Only the
+   * network thread advances the head, and only the main thread
+   * advances the tail, after it has executed the command in the
+   * slot.  */
+  struct net_command *command_ring;
+  guint head;                   /* Commands put into the ring */
+  guint tail;                   /* Commands taken out of the ring */
 
-static enum keyword_codes keyword_values[] =
-{ keyword_start, keyword_stop, keyword_quit, keyword_cue };
+  /* Commands dropped because the ring was full.  */
+  gint dropped_command_count;
 
-struct keyword_value_pairs
-{
-  gpointer key;
-  gpointer val;
+  /* Set when the main loop has been asked to execute the commands
+   * in the queue.  */
+  gint execute_pending;
+
+  /* The main loop source which executes them.  The network thread
+   * makes it ready.  */
+  GSource *execute_source;
+
+  /* From the arrival of a command to the completion of its action.  */
+  struct latency_statistics action_latency;
+
+  /* The part of that time spent waiting in the queue.  */
+  struct latency_statistics queue_latency;
 };
 
-static struct keyword_value_pairs keywords_with_values[] = {
-  {"start", &keyword_values[0]},
-  {"stop", &keyword_values[1]},
-  {"quit", &keyword_values[2]},
-  {"/cue", &keyword_values[3]}
+/* A command which has been parsed and is waiting to be executed.
+ * The payload holds the operand of a command, terminated by a NUL,
+ * or an OSC packet.  Either comes from a single datagram, so it
+ * always fits.  */
+struct net_command
+{
+  enum keyword_codes keyword_value;
+  guint cluster_number;
+  gboolean operand_present;
+  gsize packet_length;
+  gint64 receive_time;          /* real time, nanoseconds */
+  gint64 queue_time;            /* monotonic time, microseconds */
+  gchar payload[network_buffer_size];
 };
 
+/* The number of command slots.  A full batch of datagrams, each holding
+ * a command, fits several times over.  */
+#define COMMAND_RING_SIZE (4 * network_batch_size)
+
+static gboolean execute_commands_callback (gpointer user_data);
+
+/* Dispatch the source which executes the queued commands.  It stays
+ * attached, and waits until the network thread makes it ready again.  */
+static gboolean
+execute_source_dispatch (GSource * source, GSourceFunc callback,
+                         gpointer user_data)
+{
+  g_source_set_ready_time (source, -1);
+  return callback (user_data);
+}
+
+static GSourceFuncs execute_source_funcs =
+  { NULL, NULL, execute_source_dispatch, NULL };
+
 /* Initialize the network messages parser */
 
 void *
 parse_net_init (GApplication * app)
 {
   struct parse_net_info *parse_net_data;
-  int i;
 
   /* Allocate the persistent data used by the parser. */
   parse_net_data = g_malloc (sizeof (struct parse_net_info));
 
-  /* Allocate the hash table which holds the keywords. */
-  parse_net_data->hash_table = g_hash_table_new (g_str_hash, g_str_equal);
-
-  /* Populate the hash table. */
-  for (i = 0;
-       i < sizeof (keywords_with_values) / sizeof (keywords_with_values[0]);
-       i++)
-    {
-      g_hash_table_insert (parse_net_data->hash_table,
-                           keywords_with_values[i].key,
-                           keywords_with_values[i].val);
-    }
+  /* Make sure each keyword is in the slot its hash selects.  */
+  net_command_check_keywords ();
 
   /* The message buffer starts out empty. */
   parse_net_data->message_buffer = NULL;
 
+  /* Allocate the command slots, and touch them now, so the network
+   * thread does not fault them in.  */
+  parse_net_data->command_ring =
+    g_malloc (COMMAND_RING_SIZE * sizeof (struct net_command));
+  memset (parse_net_data->command_ring, 0,
+          COMMAND_RING_SIZE * sizeof (struct net_command));
+  parse_net_data->head = 0;
+  parse_net_data->tail = 0;
+  parse_net_data->dropped_command_count = 0;
+  parse_net_data->execute_pending = FALSE;
+
+  /* The commands are executed at high priority, so they are not
+   * delayed behind redrawing.  */
+  parse_net_data->execute_source =
+    g_source_new (&execute_source_funcs, sizeof (GSource));
+  g_source_set_priority (parse_net_data->execute_source, G_PRIORITY_HIGH);
+  g_source_set_callback (parse_net_data->execute_source,
+                         execute_commands_callback, app, NULL);
+  g_source_attach (parse_net_data->execute_source, NULL);
+  memset (&parse_net_data->action_latency, 0,
+          sizeof (parse_net_data->action_latency));
+  memset (&parse_net_data->queue_latency, 0,
+          sizeof (parse_net_data->queue_latency));
+
   return parse_net_data;
 }
 
-/* Receive a datagram from the network.  Parse and execute the command.
- */
-void
-parse_net_text (gchar * text, GApplication * app)
+/* Execute the commands in the queue.  This is called from the main
+ * loop.  */
+static gboolean
+execute_commands_callback (gpointer user_data)
+{
+  parse_net_execute_commands ((GApplication *) user_data);
+  return G_SOURCE_CONTINUE;
+}
+
+/* Find the next free command slot.  If the main thread has not yet
+ * executed the commands in all of the slots, count the command as
+ * dropped and return NULL.  */
+static struct net_command *
+claim_command (struct parse_net_info *parse_net_data)
+{
+  guint head;
+
+  head = parse_net_data->head;
+  if ((head - (guint) g_atomic_int_get (&parse_net_data->tail)) >=
+      COMMAND_RING_SIZE)
+    {
+      g_atomic_int_inc (&parse_net_data->dropped_command_count);
+      return NULL;
+    }
+
+  return (&parse_net_data->command_ring[head % COMMAND_RING_SIZE]);
+}
+
+/* Pass the command in the slot most recently claimed to the main
+ * thread.  */
+static void
+queue_command (struct parse_net_info *parse_net_data,
+               struct net_command *command, GApplication * app)
+{
+  command->queue_time = g_get_monotonic_time ();
+  g_atomic_int_set (&parse_net_data->head, parse_net_data->head + 1);
+
+  /* If the main loop has not already been asked to empty the queue,
+   * ask it now, by making its source ready.  */
+  if (g_atomic_int_compare_and_exchange (&parse_net_data->execute_pending,
+                                         FALSE, TRUE))
+    g_source_set_ready_time (parse_net_data->execute_source, 0);
+
+  return;
+}
+
+/* Parse a single command.  The command is a line of text
+ * terminated by a NUL.  The keyword and operand are terminated in 
+ * place.  If the command is valid, queue it for execution.  */
+static void
+parse_net_command (gchar * command, gint64 receive_time,
+                   GApplication * app)
 {
   struct parse_net_info *parse_net_data;
-  int command_length;
-  int kl;                       /* keyword length */
-  gchar *keyword_string;
-  gpointer *p;
-  enum keyword_codes keyword_value;
-  gchar *extra_text;
-  long int cluster_no;
+  struct net_command *net_command;
+  struct net_command_text command_text;
+  enum net_command_result result;
+  gsize extra_length;
 
   parse_net_data = sep_get_parse_net_data (app);
 
-  command_length = strlen (text);
-  /* Isolate the keyword that starts the command. The keyword will be
-   * terminated by white space or the end of the string.  */
-  for (kl = 0; kl < command_length; kl++)
-    if (g_ascii_isspace (text[kl]))
+  result = net_command_decode (command, &command_text);
+  if (result == net_command_blank)
+    return;
+
+  if (TRACE_RING_ENABLED (trace_network))
+    {
+      trace_ring_record (trace_network, "command %s, operand %s.",
+                         command_text.keyword,
+                         command_text.operand ==
+                         NULL ? "(none)" : command_text.operand);
+    }
+
+  switch (result)
+    {
+    case net_command_bad_cluster:
+      g_print ("Invalid cluster number: %s\n",
+               command_text.operand == NULL ? "" : command_text.operand);
+      return;
+
+    case net_command_missing_operand:
+      g_print ("The trace command needs dump or a list of categories.\n");
+      return;
+
+    case net_command_unknown:
+      g_print ("Unknown command\n");
+      return;
+
+    default:
       break;
+    }
 
-  keyword_string = g_strndup (text, kl);
-  /* If there is any text after the keyword, it is probably a parameter
-   * to the command.  Isolate it, also.  */
-  if (kl + 1 < command_length)
+  net_command = claim_command (parse_net_data);
+  if (net_command == NULL)
+    return;
+  net_command->keyword_value = command_text.keyword_value;
+  net_command->cluster_number = command_text.cluster_number;
+  net_command->operand_present = FALSE;
+  if (((command_text.keyword_value == keyword_cue)
+       || (command_text.keyword_value == keyword_trace))
+      && (command_text.operand != NULL))
     {
-      extra_text = g_strdup (text + kl + 1);
+      extra_length = strlen (command_text.operand);
+      memcpy (net_command->payload, command_text.operand, extra_length + 1);
+      net_command->operand_present = TRUE;
     }
-  else
+  net_command->packet_length = 0;
+  net_command->receive_time = receive_time;
+  queue_command (parse_net_data, net_command, app);
+
+  return;
+}
+
+/* Receive a datagram from the network.  It may hold several commands,
+ * one per line.  Parse them and queue them for execution, in order.  
+ * The text is modified.
+ */
+void
+parse_net_text (gchar * text, gint64 receive_time, GApplication * app)
+{
+  gchar *command;
+  gchar *next_command;
+
+  for (command = text; command != NULL; command = next_command)
     {
-      extra_text = NULL;
+      next_command = net_command_next_line (command);
+      parse_net_command (command, receive_time, app);
     }
 
-  /* Find the keyword in the hash table. */
-  p = g_hash_table_lookup (parse_net_data->hash_table, keyword_string);
-  if (p == NULL)
+  return;
+}
+
+/* Receive a batch of datagrams from the network.  Parse the commands 
+ * and queue them in the order they arrived.  A datagram holds either
+ * text commands or an Open Sound Control packet, which is decoded by
+ * the main thread, since its addresses refer to the sounds.  */
+void
+parse_net_batch (struct parse_net_datagram *datagrams, gint datagram_count,
+                 GApplication * app)
+{
+  struct parse_net_info *parse_net_data;
+  struct net_command *net_command;
+  gint i;
+  struct parse_net_datagram *datagram;
+
+  parse_net_data = sep_get_parse_net_data (app);
+
+  for (i = 0; i < datagram_count; i++)
     {
-      g_print ("Unknown command\n");
+      datagram = &datagrams[i];
+      if (TRACE_RING_ENABLED (trace_network))
+        {
+          trace_ring_record (trace_network, "received %" G_GSIZE_FORMAT
+                             " bytes %" G_GINT64_FORMAT " ns ago: %s",
+                             datagram->length,
+                             (g_get_real_time () * 1000) -
+                             datagram->receive_time, datagram->text);
+        }
+      if (osc_is_packet (datagram->text, datagram->length))
+        {
+          net_command = claim_command (parse_net_data);
+          if (net_command == NULL)
+            continue;
+          net_command->keyword_value = keyword_osc_packet;
+          net_command->cluster_number = 0;
+          net_command->operand_present = FALSE;
+          memcpy (net_command->payload, datagram->text, datagram->length);
+          net_command->packet_length = datagram->length;
+          net_command->receive_time = datagram->receive_time;
+          queue_command (parse_net_data, net_command, app);
+        }
+      else
+        parse_net_text (datagram->text, datagram->receive_time, app);
     }
-  else
+
+  return;
+}
+
+/* Execute the commands which the network thread has queued.  
+ * This runs on the main thread.  */
+void
+parse_net_execute_commands (GApplication * app)
+{
+  struct parse_net_info *parse_net_data;
+  struct net_command *net_command;
+  gint64 start_time;
+  guint tail;
+
+  parse_net_data = sep_get_parse_net_data (app);
+
+  /* Clear the flag before emptying the ring, so that a command queued
+   * after we have looked will ask for another call.  */
+  g_atomic_int_set (&parse_net_data->execute_pending, FALSE);
+
+  for (tail = parse_net_data->tail;
+       tail != (guint) g_atomic_int_get (&parse_net_data->head); tail++)
     {
-      keyword_value = (enum keyword_codes) *p;
-      switch (keyword_value)
+      net_command = &parse_net_data->command_ring[tail % COMMAND_RING_SIZE];
+      start_time = g_get_monotonic_time ();
+      latency_record (&parse_net_data->queue_latency,
+                      (start_time - net_command->queue_time) * 1000);
+
+      /* Sounds started by this command are measured from its arrival.
+       * The receive time is real time, so convert it to monotonic.  */
+      latency_trigger ((start_time * 1000) -
+                       ((g_get_real_time () * 1000) -
+                        net_command->receive_time), app);
+
+      switch (net_command->keyword_value)
         {
         case keyword_start:
-          /* For the Start command, the operand is the 
-           * cluster number. */
-          cluster_no = strtol (extra_text, NULL, 0);
-          sequence_cluster_start (cluster_no, app);
+          sequence_cluster_start (net_command->cluster_number, app);
           break;
 
         case keyword_stop:
-          /* Likewise for the Stop command. */
-          cluster_no = strtol (extra_text, NULL, 0);
-          sequence_cluster_stop (cluster_no, app);
+          sequence_cluster_stop (net_command->cluster_number, app);
           break;
 
         case keyword_quit:
-          /* The Quit command takes no arguments. */
           g_application_quit (app);
           break;
 
+        case keyword_reload:
+          /* Read the project file again, keeping the sounds playing.  */
+          reload_project (app);
+          break;
+
         case keyword_cue:
           /* The cue command is treated as the 
            * MIDI Show Control command Go.  */
-          sequence_MIDI_show_control_go (extra_text, app);
+          sequence_MIDI_show_control_go (net_command->operand_present ?
+                                         net_command->payload : NULL, app);
+          break;
+
+        case keyword_stats:
+          /* Send the latency histograms, the pipeline trace summary,
+           * the underrun counters and the monitor file counters to the
+           * remote controllers.  */
+          latency_send_statistics (app);
+          tracer_send_statistics (app);
+          qos_send_statistics (app);
+          monitor_send_statistics (app);
+          break;
+
+        case keyword_trace:
+          /* Dump the trace ring buffers, or change what they record.  */
+          if (g_ascii_strcasecmp (net_command->payload, "dump") == 0)
+            trace_ring_dump (app);
+          else if (!trace_ring_set_categories (net_command->payload))
+            g_print ("Unknown trace category in %s.\n",
+                     net_command->payload);
+          break;
+
+        case keyword_osc_packet:
+          osc_process_packet (net_command->payload,
+                              net_command->packet_length, app);
           break;
 
         default:
-          g_print ("unknown command\n");
+          break;
         }
 
+      latency_trigger_done (app);
+      latency_record (&parse_net_data->action_latency,
+                      (g_get_real_time () * 1000) -
+                      net_command->receive_time);
+
+      /* Give the slot back to the network thread.  */
+      g_atomic_int_set (&parse_net_data->tail, tail + 1);
+    }
 
-      g_free (keyword_string);
-      g_free (extra_text);
+  return;
+}
+
+/* Print the latency of network commands.  */
+void
+parse_net_print_statistics (GApplication * app)
+{
+  struct parse_net_info *parse_net_data;
+
+  parse_net_data = sep_get_parse_net_data (app);
+  if (parse_net_data == NULL)
+    return;
+
+  latency_print ("network command arrival to action",
+                 &parse_net_data->action_latency);
+  latency_print ("network command waiting for the main loop",
+                 &parse_net_data->queue_latency);
+  if (g_atomic_int_get (&parse_net_data->dropped_command_count) > 0)
+    {
+      g_print ("parse_net: %d network commands were dropped because the "
+               "main loop fell behind.\n",
+               g_atomic_int_get (&parse_net_data->dropped_command_count));
     }
 
   return;
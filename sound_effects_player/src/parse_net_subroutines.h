@@ -19,11 +19,33 @@
 
 #include <gtk/gtk.h>
 
+/* A datagram received from the network.  The text is terminated
+ * by a NUL, which is not counted in the length.  The receive time
+ * is in nanoseconds since the epoch.  */
+struct parse_net_datagram
+{
+  gchar *text;
+  gsize length;
+  gint64 receive_time;
+};
+
 /* Subroutines defined in parse_net_subroutines.c */
 
 /* Initialize the parser. */
 void *parse_net_init (GApplication * app);
 
-/* Accept text, divide or accumulate it into commands, 
- * and execute those commands. */
-void parse_net_text (gchar * text, GApplication * app);
+/* Accept text, divide it into commands, one per line, 
+ * and queue those commands for execution.  The text is modified. 
+ * This is called from the network thread.  */
+void parse_net_text (gchar * text, gint64 receive_time, GApplication * app);
+
+/* Process a batch of datagrams, in the order they arrived.  This is
+ * called from the network thread.  */
+void parse_net_batch (struct parse_net_datagram *datagrams,
+                      gint datagram_count, GApplication * app);
+
+/* Execute the queued commands.  This is called from the main thread.  */
+void parse_net_execute_commands (GApplication * app);
+
+/* Print the latency of network commands.  */
+void parse_net_print_statistics (GApplication * app);
@@ -0,0 +1,369 @@
+/*
+ * parse_xml_benchmark.c
+ *
+ * Copyright © 2016 by John Sauter <John_Sauter@systemeyescomputerstore.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <glib/gstdio.h>
+#include <libxml/parser.h>
+#include "parse_xml_subroutines.h"
+#include "arena_subroutines.h"
+#include "routing_subroutines.h"
+#include "show_image_subroutines.h"
+#include "sound_structure.h"
+#include "sequence_structure.h"
+
+/* Measure the time and peak memory needed to read a large show.
+ * A synthetic project is written to a temporary directory, with its
+ * sounds and its sequence in separate files, then read by the project
+ * file parser, which is linked with the stand-ins below instead of the
+ * rest of the player.  The sounds and sequence items are kept, as the 
+ * player keeps them, so the peak includes the parsed data.
+ * Run it with "make parse_xml_benchmark && ./parse_xml_benchmark",
+ * optionally giving the number of sounds and of sequence items, which
+ * defaults to 50,000 each.  Give "dom" as a second argument to measure
+ * only building the libxml2 document trees of the same files, 
+ * for comparison, or "image" to compile the show in another process
+ * and measure loading its compiled image.  Peak memory only increases
+ * during a run, so each measurement needs its own run.
+ * The results are also printed on lines starting with "benchmark:",
+ * for benchmark_check.sh.  */
+
+static GList *sound_list = NULL;
+static GList *sequence_list = NULL;
+static gchar *project_filename = NULL;
+static void *show_image_data = NULL;
+static void *arena_data = NULL;
+static void *routing_data = NULL;
+static gboolean compile_show = FALSE;
+
+/* Stand-ins for the subroutines the parser calls.  */
+void
+tracer_set_file_name (const gchar * file_name, GApplication * app)
+{
+  return;
+}
+
+const gchar *
+tracer_get_file_name (GApplication * app)
+{
+  return NULL;
+}
+
+void
+sound_append_sound (struct sound_info *sound_data, GApplication * app)
+{
+  sound_list = g_list_prepend (sound_list, sound_data);
+  return;
+}
+
+void
+sequence_append_item (struct sequence_item_info *item, GApplication * app)
+{
+  sequence_list = g_list_prepend (sequence_list, item);
+  return;
+}
+
+void
+network_set_port (int port_number, GApplication * app)
+{
+  return;
+}
+
+int
+network_get_port (GApplication * app)
+{
+  return 1500;
+}
+
+xmlDocPtr
+sep_get_project_file (GApplication * app)
+{
+  return NULL;
+}
+
+void
+sep_set_project_file (xmlDocPtr project_file, GApplication * app)
+{
+  return;
+}
+
+GList *
+sep_get_sound_list (GApplication * app)
+{
+  return sound_list;
+}
+
+GList *
+sequence_get_item_list (GApplication * app)
+{
+  return sequence_list;
+}
+
+void *
+sep_get_show_image_data (GApplication * app)
+{
+  return show_image_data;
+}
+
+void *
+sep_get_arena_data (GApplication * app)
+{
+  return arena_data;
+}
+
+void *
+sep_get_routing_data (GApplication * app)
+{
+  return routing_data;
+}
+
+GstPipeline *
+sep_get_pipeline_from_app (GApplication * app)
+{
+  return NULL;
+}
+
+gboolean
+main_get_compile ()
+{
+  return compile_show;
+}
+
+gchar *
+sep_get_project_filename (GApplication * app)
+{
+  return project_filename;
+}
+
+void
+sep_set_project_filename (gchar * filename, GApplication * app)
+{
+  project_filename = filename;
+  return;
+}
+
+/* Nothing is traced.  */
+volatile guint trace_ring_categories = 0;
+
+void
+trace_ring_record (guint category, const gchar * format, ...)
+{
+  return;
+}
+
+/* Write the synthetic show.  Every sound names an existing file, 
+ * the project file itself, so no sound is disabled.  */
+static void
+write_show (gchar * directory_name, gint item_count)
+{
+  gchar *file_name;
+  gchar *project_name;
+  FILE *show_file;
+  gint i;
+
+  project_name = g_build_filename (directory_name, "project.xml", NULL);
+  show_file = fopen (project_name, "w");
+  fprintf (show_file, "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+           "<show_control>\n <project>\n  <version>1.0</version>\n"
+           "  <equipment>\n   <version>1.0</version>\n"
+           "   <program id=\"sound_effects\">\n    <port>1500</port>\n"
+           "    <sounds href=\"sounds.xml\"/>\n"
+           "    <sound_sequence href=\"sequence.xml\"/>\n"
+           "   </program>\n  </equipment>\n </project>\n"
+           "</show_control>\n");
+  fclose (show_file);
+
+  file_name = g_build_filename (directory_name, "sounds.xml", NULL);
+  show_file = fopen (file_name, "w");
+  fprintf (show_file, "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+           "<show_control>\n <sounds>\n  <version>1.0</version>\n");
+  for (i = 0; i < item_count; i++)
+    {
+      fprintf (show_file, "  <sound>\n   <name>Sound %d</name>\n"
+               "   <wav_file_name>%s</wav_file_name>\n"
+               "   <attack_duration_time>0.05</attack_duration_time>\n"
+               "   <release_duration_time>1.5</release_duration_time>\n"
+               "   <loop_from_time>12.25</loop_from_time>\n"
+               "   <loop_to_time>2.0</loop_to_time>\n"
+               "   <designer_volume_level>0.8</designer_volume_level>\n"
+               "   <designer_pan>-0.25</designer_pan>\n"
+               "   <OSC_name>sound_%d</OSC_name>\n"
+               "  </sound>\n", i, project_name, i);
+    }
+  fprintf (show_file, " </sounds>\n</show_control>\n");
+  fclose (show_file);
+  g_free (file_name);
+
+  file_name = g_build_filename (directory_name, "sequence.xml", NULL);
+  show_file = fopen (file_name, "w");
+  fprintf (show_file, "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+           "<show_control>\n <sound_sequence>\n  <version>1.0</version>\n");
+  for (i = 0; i < item_count; i++)
+    {
+      fprintf (show_file, "  <sequence_item>\n   <name>item %d</name>\n"
+               "   <type>start_sound</type>\n"
+               "   <sound_name>Sound %d</sound_name>\n"
+               "   <tag>tag %d</tag>\n   <volume>0.9</volume>\n"
+               "   <next_completion>item %d</next_completion>\n"
+               "   <next_termination>item %d</next_termination>\n"
+               "   <importance>2</importance>\n"
+               "   <text_to_display>Cue %d: wait for the door</text_to_display>\n"
+               "  </sequence_item>\n", i, i, i, i + 1, i + 1, i);
+    }
+  fprintf (show_file, " </sound_sequence>\n</show_control>\n");
+  fclose (show_file);
+  g_free (file_name);
+
+  g_free (project_name);
+  return;
+}
+
+/* The peak resident memory of this process, in kilobytes.  */
+static glong
+peak_memory (void)
+{
+  struct rusage usage;
+
+  getrusage (RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+int
+main (int argc, char *argv[])
+{
+  gchar *directory_name;
+  gchar *file_name;
+  gint item_count;
+  gboolean dom;
+  gboolean image;
+  gchar *compile_argv[5];
+  glong memory_before;
+  gint64 start_time, end_time;
+  xmlDocPtr documents[3];
+  const gchar *file_names[3] = { "project.xml", "sounds.xml", "sequence.xml" };
+  GError *error = NULL;
+  gint i;
+
+  item_count = 50000;
+  if (argc > 1)
+    item_count = atoi (argv[1]);
+  dom = (argc > 2) && (g_strcmp0 (argv[2], "dom") == 0);
+  image = (argc > 2) && (g_strcmp0 (argv[2], "image") == 0);
+  show_image_data = show_image_init (NULL);
+  arena_data = arena_init (NULL);
+  routing_data = routing_init (NULL);
+
+  /* This program runs itself with "compile" and the directory name
+   * to compile the show.  */
+  if ((argc > 3) && (g_strcmp0 (argv[2], "compile") == 0))
+    {
+      compile_show = TRUE;
+      file_name = g_build_filename (argv[3], "project.xml", NULL);
+      parse_xml_read_project_file (file_name, NULL);
+      return show_image_write (file_name, NULL) ? 0 : 1;
+    }
+
+  directory_name = g_dir_make_tmp ("parse_xml_benchmark_XXXXXX", &error);
+  if (directory_name == NULL)
+    {
+      g_printerr ("Cannot make a directory for the show: %s.\n",
+                  error->message);
+      g_error_free (error);
+      return 1;
+    }
+  write_show (directory_name, item_count);
+
+  if (image)
+    {
+      /* Compile the show in another process, so the memory used
+       * to read the XML files is not counted.  */
+      compile_argv[0] = argv[0];
+      compile_argv[1] = argv[1];
+      compile_argv[2] = (gchar *) "compile";
+      compile_argv[3] = directory_name;
+      compile_argv[4] = NULL;
+      g_spawn_sync (NULL, compile_argv, NULL, G_SPAWN_DEFAULT, NULL, NULL,
+                    NULL, NULL, NULL, NULL);
+    }
+
+  memory_before = peak_memory ();
+  start_time = g_get_monotonic_time ();
+  if (dom)
+    {
+      /* Build the document trees, as the project file parser did 
+       * before it streamed.  */
+      xmlKeepBlanksDefault (0);
+      for (i = 0; i < 3; i++)
+        {
+          file_name =
+            g_build_filename (directory_name, file_names[i], NULL);
+          documents[i] = xmlParseFile (file_name);
+          g_free (file_name);
+        }
+    }
+  else
+    {
+      file_name = g_build_filename (directory_name, "project.xml", NULL);
+      parse_xml_read_project_file (file_name, NULL);
+    }
+  end_time = g_get_monotonic_time ();
+
+  if (dom)
+    {
+      g_print ("Building the document trees of %d sounds and %d sequence "
+               "items took %.3f seconds and %ld kB of memory.\n",
+               item_count, item_count,
+               (gdouble) (end_time - start_time) / G_USEC_PER_SEC,
+               peak_memory () - memory_before);
+      for (i = 0; i < 3; i++)
+        xmlFreeDoc (documents[i]);
+    }
+  else
+    {
+      g_print ("Reading %u sounds and %u sequence items took %.3f seconds "
+               "and %ld kB of memory.\n", g_list_length (sound_list),
+               g_list_length (sequence_list),
+               (gdouble) (end_time - start_time) / G_USEC_PER_SEC,
+               peak_memory () - memory_before);
+      g_print ("benchmark: project_%s_%d_seconds %.3f lower\n",
+               image ? "image_load" : "load", item_count,
+               (gdouble) (end_time - start_time) / G_USEC_PER_SEC);
+      g_print ("benchmark: project_%s_%d_kilobytes %ld lower\n",
+               image ? "image_load" : "load", item_count,
+               peak_memory () - memory_before);
+      arena_print_statistics (NULL);
+    }
+
+  /* Remove the synthetic show.  */
+  for (i = 0; i < 3; i++)
+    {
+      file_name = g_build_filename (directory_name, file_names[i], NULL);
+      g_remove (file_name);
+      g_free (file_name);
+    }
+  file_name = g_build_filename (directory_name, "project.xml.image", NULL);
+  g_remove (file_name);
+  g_free (file_name);
+  g_rmdir (directory_name);
+  g_free (directory_name);
+
+  return 0;
+}
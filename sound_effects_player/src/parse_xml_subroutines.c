@@ -18,1638 +18,1546 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <gtk/gtk.h>
 #include <libxml/xmlmemory.h>
 #include <libxml/parser.h>
+#include <libxml/xmlreader.h>
 #include "parse_xml_subroutines.h"
+#include "arena_subroutines.h"
 #include "network_subroutines.h"
+#include "routing_subroutines.h"
 #include "sound_effects_player.h"
 #include "sound_structure.h"
 #include "sound_subroutines.h"
 #include "sequence_structure.h"
 #include "sequence_subroutines.h"
+#include "show_image_subroutines.h"
+#include "tracer_subroutines.h"
+#include "main.h"
+
+/* The project file, and the equipment, sounds and sequence files it
+ * refers to, are read with a streaming parser.  Only the current element
+ * is held in memory, and the fields of each sound and sequence item are
+ * stored into its structure as they are read, so a show with many 
+ * thousands of sounds and sequence items costs little more to load 
+ * than its own data.  */
+
+/* The elements we recognize.  The name of each element is looked up
+ * once, when the reader reaches it, and the resulting code is 
+ * dispatched through a switch.  */
+enum element_codes
+{
+  element_unknown = 0,
+  element_MIDI_note_number,
+  element_MIDI_program_number,
+  element_OSC_name,
+  element_Q_number,
+  element_attack_duration_time,
+  element_attack_level,
+  element_bank_number,
+  element_bus,
+  element_bus_name,
+  element_channel,
+  element_channels,
+  element_cluster_number,
+  element_decay_duration_time,
+  element_designer_pan,
+  element_designer_volume_level,
+  element_device,
+  element_equipment,
+  element_function_key,
+  element_importance,
+  element_loop_from_time,
+  element_loop_limit,
+  element_loop_to_time,
+  element_macro_number,
+  element_max_duration_time,
+  element_name,
+  element_next,
+  element_next_completion,
+  element_next_play,
+  element_next_release_started,
+  element_next_starts,
+  element_next_termination,
+  element_next_to_start,
+  element_omit_from_display,
+  element_omit_panning,
+  element_pan,
+  element_port,
+  element_program,
+  element_program_number,
+  element_project,
+  element_release_duration_time,
+  element_release_start_time,
+  element_routing,
+  element_send,
+  element_sequence_item,
+  element_show_control,
+  element_sound,
+  element_sound_name,
+  element_sound_sequence,
+  element_sounds,
+  element_speaker,
+  element_start_time,
+  element_sustain_level,
+  element_tag,
+  element_text_to_display,
+  element_time_to_wait,
+  element_trace_file,
+  element_type,
+  element_use_external_velocity,
+  element_version,
+  element_volume,
+  element_wav_file_name
+};
+
+struct element_entry
+{
+  const gchar *name;
+  enum element_codes code;
+};
+
+/* The element names, in strcmp order so they can be found by
+ * binary search.  When adding an element, keep the order.  */
+static const struct element_entry element_table[] = {
+  {"MIDI_note_number", element_MIDI_note_number},
+  {"MIDI_program_number", element_MIDI_program_number},
+  {"OSC_name", element_OSC_name},
+  {"Q_number", element_Q_number},
+  {"attack_duration_time", element_attack_duration_time},
+  {"attack_level", element_attack_level},
+  {"bank_number", element_bank_number},
+  {"bus", element_bus},
+  {"bus_name", element_bus_name},
+  {"channel", element_channel},
+  {"channels", element_channels},
+  {"cluster_number", element_cluster_number},
+  {"decay_duration_time", element_decay_duration_time},
+  {"designer_pan", element_designer_pan},
+  {"designer_volume_level", element_designer_volume_level},
+  {"device", element_device},
+  {"equipment", element_equipment},
+  {"function_key", element_function_key},
+  {"importance", element_importance},
+  {"loop_from_time", element_loop_from_time},
+  {"loop_limit", element_loop_limit},
+  {"loop_to_time", element_loop_to_time},
+  {"macro_number", element_macro_number},
+  {"max_duration_time", element_max_duration_time},
+  {"name", element_name},
+  {"next", element_next},
+  {"next_completion", element_next_completion},
+  {"next_play", element_next_play},
+  {"next_release_started", element_next_release_started},
+  {"next_starts", element_next_starts},
+  {"next_termination", element_next_termination},
+  {"next_to_start", element_next_to_start},
+  {"omit_from_display", element_omit_from_display},
+  {"omit_panning", element_omit_panning},
+  {"pan", element_pan},
+  {"port", element_port},
+  {"program", element_program},
+  {"program_number", element_program_number},
+  {"project", element_project},
+  {"release_duration_time", element_release_duration_time},
+  {"release_start_time", element_release_start_time},
+  {"routing", element_routing},
+  {"send", element_send},
+  {"sequence_item", element_sequence_item},
+  {"show_control", element_show_control},
+  {"sound", element_sound},
+  {"sound_name", element_sound_name},
+  {"sound_sequence", element_sound_sequence},
+  {"sounds", element_sounds},
+  {"speaker", element_speaker},
+  {"start_time", element_start_time},
+  {"sustain_level", element_sustain_level},
+  {"tag", element_tag},
+  {"text_to_display", element_text_to_display},
+  {"time_to_wait", element_time_to_wait},
+  {"trace_file", element_trace_file},
+  {"type", element_type},
+  {"use_external_velocity", element_use_external_velocity},
+  {"version", element_version},
+  {"volume", element_volume},
+  {"wav_file_name", element_wav_file_name}
+};
+
+/* The types of sequence item, as they are written in the XML file.  */
+static const struct
+{
+  const gchar *name;
+  enum sequence_item_type item_type;
+} sequence_item_type_table[] = {
+  {"start_sound", start_sound},
+  {"stop", stop},
+  {"wait", wait},
+  {"offer_sound", offer_sound},
+  {"cease_offering_sound", cease_offering_sound},
+  {"operator_wait", operator_wait},
+  {"start_sequence", start_sequence}
+};
+
+/* The state of the reader for one XML file.  */
+struct xml_stream
+{
+  xmlTextReaderPtr reader;
+  gchar *file_name;             /* used for messages and to find
+                                 * the files it refers to */
+  GString *text;                /* the text of the current element */
+  gboolean failed;              /* the file is not valid XML */
+  GApplication *app;
+};
+
+static gboolean parse_file (gchar * file_name,
+                            enum element_codes section_code,
+                            GApplication * app);
+
+/* Compare an element name with an entry in the element table.  */
+static int
+compare_element (const void *name, const void *entry)
+{
+  return strcmp (name, ((const struct element_entry *) entry)->name);
+}
 
-/* Dig through a sounds xml file, or the sounds content of an equipment
- * or project xml file, looking for the individual sounds.  Construct the
- * sound effect player's internal data structure for each sound.  */
-static void
-parse_sounds_info (xmlDocPtr sounds_file, gchar * sounds_file_name,
-                   xmlNodePtr sounds_loc, GApplication * app)
+/* Find the code for the element the reader is on.  */
+static enum element_codes
+element_code (struct xml_stream *stream)
 {
   const xmlChar *name;
-  xmlChar *name_data;
-  gchar *file_dirname, *absolute_file_name;
-  gdouble double_data;
-  gint64 long_data;
-  xmlNodePtr sound_loc;
-  struct sound_info *sound_data;
+  const struct element_entry *entry;
+
+  name = xmlTextReaderConstLocalName (stream->reader);
+  if (name == NULL)
+    return element_unknown;
+  entry =
+    bsearch (name, element_table, G_N_ELEMENTS (element_table),
+             sizeof (element_table[0]), compare_element);
+  if (entry == NULL)
+    return element_unknown;
+  return entry->code;
+}
+
+/* Advance to the next child of the element at the specified depth.
+ * Children of children are passed over, so an element we do not
+ * recognize is ignored along with its content, which lets us read 
+ * future XML files.  Return FALSE at the end of the element.  */
+static gboolean
+next_child (struct xml_stream *stream, gint depth)
+{
+  xmlTextReaderPtr reader;
+  gint node_type;
+
+  reader = stream->reader;
+
+  /* An empty element has no children and no end.  */
+  if ((xmlTextReaderDepth (reader) == depth)
+      && (xmlTextReaderNodeType (reader) == XML_READER_TYPE_ELEMENT)
+      && xmlTextReaderIsEmptyElement (reader))
+    return FALSE;
 
-  file_dirname = NULL;
-  absolute_file_name = NULL;
-  name_data = NULL;
-  /* We start at the children of a "sounds" section.  Each child should
-   * be a "version" or "sound" section. */
-  while (sounds_loc != NULL)
+  while (!stream->failed)
     {
-      name = sounds_loc->name;
-      if (xmlStrEqual (name, (const xmlChar *) "version"))
+      switch (xmlTextReaderRead (reader))
         {
-          name_data =
-            xmlNodeListGetString (sounds_file, sounds_loc->xmlChildrenNode,
-                                  1);
-          if ((!g_str_has_prefix ((gchar *) name_data, (gchar *) "1.")))
-            {
-              g_printerr ("Version number of sounds is %s, "
-                          "should start with 1.\n", name_data);
-              return;
-            }
+        case 1:
+          break;
+        case 0:
+          return FALSE;
+        default:
+          stream->failed = TRUE;
+          return FALSE;
+        }
+      node_type = xmlTextReaderNodeType (reader);
+      if ((node_type == XML_READER_TYPE_END_ELEMENT)
+          && (xmlTextReaderDepth (reader) == depth))
+        return FALSE;
+      if ((node_type == XML_READER_TYPE_ELEMENT)
+          && (xmlTextReaderDepth (reader) == depth + 1))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/* Read the text of the current element, leaving the reader at its end.
+ * The text is valid until the next call.  Return NULL if there is 
+ * no text.  */
+static const gchar *
+element_text (struct xml_stream *stream)
+{
+  xmlTextReaderPtr reader;
+  gint depth;
+  gboolean text_found;
+
+  reader = stream->reader;
+  if (xmlTextReaderIsEmptyElement (reader))
+    return NULL;
+
+  depth = xmlTextReaderDepth (reader);
+  g_string_truncate (stream->text, 0);
+  text_found = FALSE;
+  while (!stream->failed)
+    {
+      if (xmlTextReaderRead (reader) != 1)
+        {
+          stream->failed = TRUE;
+          return NULL;
         }
-      if (xmlStrEqual (name, (const xmlChar *) "sound"))
+      switch (xmlTextReaderNodeType (reader))
         {
-          /* This is a sound.  Copy its information.  */
-          sound_loc = sounds_loc->xmlChildrenNode;
-          /* Allocate a structure to hold sound information. */
-          sound_data = g_malloc (sizeof (struct sound_info));
-          /* Set the fields to their default values.  If a field does not
-           * appear in the XML file, it will retain its default value.
-           * This lets us add new fields without invalidating old XML files.
-           */
-          sound_data->name = NULL;
-          sound_data->disabled = FALSE;
-          sound_data->wav_file_name = NULL;
-          sound_data->wav_file_name_full = NULL;
-          sound_data->attack_duration_time = 0;
-          sound_data->attack_level = 1.0;
-          sound_data->decay_duration_time = 0;
-          sound_data->sustain_level = 1.0;
-          sound_data->release_start_time = 0;
-          sound_data->release_duration_time = 0;
-          sound_data->release_duration_infinite = FALSE;
-          sound_data->loop_from_time = 0;
-          sound_data->loop_to_time = 0;
-          sound_data->loop_limit = 0;
-          sound_data->max_duration_time = 0;
-          sound_data->start_time = 0;
-          sound_data->designer_volume_level = 1.0;
-          sound_data->designer_pan = 0.0;
-          sound_data->MIDI_program_number = 0;
-          sound_data->MIDI_program_number_specified = FALSE;
-          sound_data->MIDI_note_number = 0;
-          sound_data->MIDI_note_number_specified = FALSE;
-          sound_data->OSC_name = NULL;
-          sound_data->OSC_name_specified = FALSE;
-          sound_data->function_key = NULL;
-          sound_data->function_key_specified = FALSE;
-          sound_data->omit_panning = FALSE;
-
-          /* These fields will be filled at run time.  */
-          sound_data->sound_control = NULL;
-          sound_data->cluster_widget = NULL;
-          sound_data->cluster_number = 0;
-          sound_data->running = FALSE;
-          sound_data->release_sent = FALSE;
-	  sound_data->release_has_started = FALSE;
-
-          /* Collect information from the XML file.  */
-          while (sound_loc != NULL)
+        case XML_READER_TYPE_TEXT:
+        case XML_READER_TYPE_CDATA:
+        case XML_READER_TYPE_SIGNIFICANT_WHITESPACE:
+          if (xmlTextReaderDepth (reader) == depth + 1)
             {
-              name = sound_loc->name;
-              if (xmlStrEqual (name, (const xmlChar *) "name"))
-                {
-                  /* This is the name of the sound.  It is mandatory.  */
-                  name_data =
-                    xmlNodeListGetString (sounds_file,
-                                          sound_loc->xmlChildrenNode, 1);
-                  sound_data->name = g_strdup ((gchar *) name_data);
-                  xmlFree (name_data);
-                  name_data = NULL;
-                }
-              if (xmlStrEqual (name, (const xmlChar *) "wav_file_name"))
-                {
-                  /* The name of the WAV file from which we take the
-                   * waveform.  */
-                  name_data =
-                    xmlNodeListGetString (sounds_file,
-                                          sound_loc->xmlChildrenNode, 1);
-                  if (name_data != NULL)
-                    {
-                      sound_data->wav_file_name =
-                        g_strdup ((gchar *) name_data);
-                      xmlFree (name_data);
-                      name_data = NULL;
-
-                      /* If the file name does not have an absolute path,
-                       * prepend the path of the sounds, equipment or project 
-                       * file.  This allows wave files to be copied along with 
-                       * the files that refer to them.  */
-                      if (g_path_is_absolute (sound_data->wav_file_name))
-                        {
-                          g_free (absolute_file_name);
-                          absolute_file_name =
-                            g_strdup (sound_data->wav_file_name);
-                        }
-                      else
-                        {
-                          g_free (file_dirname);
-                          file_dirname =
-                            g_path_get_dirname (sounds_file_name);
-                          g_free (absolute_file_name);
-                          absolute_file_name =
-                            g_build_filename (file_dirname,
-                                              sound_data->wav_file_name,
-                                              NULL);
-                          g_free (file_dirname);
-                          file_dirname = NULL;
-                        }
-                      sound_data->wav_file_name_full = absolute_file_name;
-                      if (!g_file_test
-                          (absolute_file_name, G_FILE_TEST_EXISTS))
-                        {
-                          g_printerr ("File %s does not exist.\n",
-                                      absolute_file_name);
-                          sound_data->disabled = TRUE;
-                        }
-                      absolute_file_name = NULL;
-                    }
-                }
-              if (xmlStrEqual
-                  (name, (const xmlChar *) "attack_duration_time"))
-                {
-                  /* The time required to ramp up the sound when it starts.  */
-                  name_data =
-                    xmlNodeListGetString (sounds_file,
-                                          sound_loc->xmlChildrenNode, 1);
-                  double_data = g_ascii_strtod ((gchar *) name_data, NULL);
-                  xmlFree (name_data);
-                  name_data = NULL;
-                  sound_data->attack_duration_time = double_data * 1E9;
-                }
-              if (xmlStrEqual (name, (const xmlChar *) "attack_level"))
-                {
-                  /* The level we ramp up to.  */
-                  name_data =
-                    xmlNodeListGetString (sounds_file,
-                                          sound_loc->xmlChildrenNode, 1);
-                  if (name_data != NULL)
-                    {
-                      double_data =
-                        g_ascii_strtod ((gchar *) name_data, NULL);
-                      xmlFree (name_data);
-                      name_data = NULL;
-                      sound_data->attack_level = double_data;
-                    }
-                }
-              if (xmlStrEqual (name, (const xmlChar *) "decay_duration_time"))
-                {
-                  /* Following the attack, the time to decrease the volume
-                   * to the sustain level.  */
-                  name_data =
-                    xmlNodeListGetString (sounds_file,
-                                          sound_loc->xmlChildrenNode, 1);
-                  if (name_data != NULL)
-                    {
-                      double_data =
-                        g_ascii_strtod ((gchar *) name_data, NULL);
-                      xmlFree (name_data);
-                      name_data = NULL;
-                      sound_data->decay_duration_time = double_data * 1E9;
-                    }
-                }
-              if (xmlStrEqual (name, (const xmlChar *) "sustain_level"))
-                {
-                  /* The volume to reach at the end of the decay.  */
-                  name_data =
-                    xmlNodeListGetString (sounds_file,
-                                          sound_loc->xmlChildrenNode, 1);
-                  if (name_data != NULL)
-                    {
-                      double_data =
-                        g_ascii_strtod ((gchar *) name_data, NULL);
-                      xmlFree (name_data);
-                      name_data = NULL;
-                      sound_data->sustain_level = double_data;
-                    }
-                }
-              if (xmlStrEqual (name, (const xmlChar *) "release_start_time"))
-                {
-                  /* When to start the release process.  If this value is
-                   * zero, we start the release process only upon receipt
-                   * of an external signal, such as MIDI Note Off.  */
-                  name_data =
-                    xmlNodeListGetString (sounds_file,
-                                          sound_loc->xmlChildrenNode, 1);
-                  if (name_data != NULL)
-                    {
-                      double_data =
-                        g_ascii_strtod ((gchar *) name_data, NULL);
-                      xmlFree (name_data);
-                      name_data = NULL;
-                      sound_data->release_start_time = double_data * 1E9;
-                    }
-                }
-              if (xmlStrEqual
-                  (name, (const xmlChar *) "release_duration_time"))
-                {
-                  /* Once release has started, the time to ramp the volume
-                   * down to zero.  Note this value may be infinity, which
-                   * means that the volume does not decrease.  */
-                  name_data =
-                    xmlNodeListGetString (sounds_file,
-                                          sound_loc->xmlChildrenNode, 1);
-                  if (name_data != NULL)
-                    {
-                      if (xmlStrEqual (name_data, (const xmlChar *) "∞"))
-                        {
-                          sound_data->release_duration_infinite = TRUE;
-                          sound_data->release_duration_time = 0;
-                          xmlFree (name_data);
-                          name_data = NULL;
-                        }
-                      else
-                        {
-                          double_data =
-                            g_ascii_strtod ((gchar *) name_data, NULL);
-                          xmlFree (name_data);
-                          sound_data->release_duration_time =
-                            double_data * 1E9;
-                          sound_data->release_duration_infinite = FALSE;
-                          name_data = NULL;
-                        }
-                    }
-                }
-              if (xmlStrEqual (name, (const xmlChar *) "loop_from_time"))
-                {
-                  /* If we are looping, the end time of the loop.  
-		  * 0, the default, means do not loop.  */
-                  name_data =
-                    xmlNodeListGetString (sounds_file,
-                                          sound_loc->xmlChildrenNode, 1);
-                  if (name_data != NULL)
-                    {
-                      double_data =
-                        g_ascii_strtod ((gchar *) name_data, NULL);
-                      xmlFree (name_data);
-                      sound_data->loop_from_time = double_data * 1E9;
-                      name_data = NULL;
-                    }
-                }
-              if (xmlStrEqual (name, (const xmlChar *) "loop_to_time"))
-                {
-                  /* If we are looping, the start time of the loop.  
-                   * Each time through the loop we play from start time
-                   * to the end time of the loop.  */
-                  name_data =
-                    xmlNodeListGetString (sounds_file,
-                                          sound_loc->xmlChildrenNode, 1);
-                  if (name_data != NULL)
-                    {
-                      double_data =
-                        g_ascii_strtod ((gchar *) name_data, NULL);
-                      xmlFree (name_data);
-                      sound_data->loop_to_time = double_data * 1E9;
-                      name_data = NULL;
-                    }
-                }
-              if (xmlStrEqual (name, (const xmlChar *) "loop_limit"))
-                {
-                  /* The number of times to pass through the loop.  Zero
-                   * means loop until stopped by a Release message.  */
-                  name_data =
-                    xmlNodeListGetString (sounds_file,
-                                          sound_loc->xmlChildrenNode, 1);
-                  if (name_data != NULL)
-                    {
-                      long_data =
-                        g_ascii_strtoll ((gchar *) name_data, NULL, 10);
-                      xmlFree (name_data);
-                      sound_data->loop_limit = long_data;
-                      name_data = NULL;
-                    }
-                }
-              if (xmlStrEqual (name, (const xmlChar *) "max_duration_time"))
-                {
-                  /* The maximum amount of time to absorb from the WAV file  */
-                  name_data =
-                    xmlNodeListGetString (sounds_file,
-                                          sound_loc->xmlChildrenNode, 1);
-                  if (name_data != NULL)
-                    {
-                      double_data =
-                        g_ascii_strtod ((gchar *) name_data, NULL);
-                      xmlFree (name_data);
-                      sound_data->max_duration_time = double_data * 1E9;
-                      name_data = NULL;
-                    }
-                }
-              if (xmlStrEqual (name, (const xmlChar *) "start_time"))
-                {
-                  /* The time within the WAV file to start this sound effect.
-                   */
-                  name_data =
-                    xmlNodeListGetString (sounds_file,
-                                          sound_loc->xmlChildrenNode, 1);
-                  if (name_data != NULL)
-                    {
-                      double_data =
-                        g_ascii_strtod ((gchar *) name_data, NULL);
-                      xmlFree (name_data);
-                      sound_data->start_time = double_data * 1E9;
-                      name_data = NULL;
-                    }
-                }
-
-              if (xmlStrEqual
-                  (name, (const xmlChar *) "designer_volume_level"))
-                {
-                  /* For this sound effect, decrease the volume from the WAV
-                   * file by this amount.  */
-                  name_data =
-                    xmlNodeListGetString (sounds_file,
-                                          sound_loc->xmlChildrenNode, 1);
-                  if (name_data != NULL)
-                    {
-                      double_data =
-                        g_ascii_strtod ((gchar *) name_data, NULL);
-                      xmlFree (name_data);
-                      sound_data->designer_volume_level = double_data;
-                      name_data = NULL;
-                    }
-                }
+              g_string_append (stream->text,
+                               (const gchar *)
+                               xmlTextReaderConstValue (reader));
+              text_found = TRUE;
+            }
+          break;
 
-              if (xmlStrEqual (name, (const xmlChar *) "designer_pan"))
-                {
-                  /* For monaural WAV files, the amount to send to the left and
-                   * right channels, expressed as -1 for left channel only,
-                   * 0 for both channels equally, and +1 for right channel
-                   * only.  Other values between +1 and -1 also place the sound
-                   * in the stereo field.  For stereo WAV files this operates
-                   * as a balance control.  */
-                  name_data =
-                    xmlNodeListGetString (sounds_file,
-                                          sound_loc->xmlChildrenNode, 1);
-                  if (name_data != NULL)
-                    {
-                      double_data =
-                        g_ascii_strtod ((gchar *) name_data, NULL);
-                      xmlFree (name_data);
-                      sound_data->designer_pan = double_data;
-                      name_data = NULL;
-                    }
-                }
+        case XML_READER_TYPE_END_ELEMENT:
+          if (xmlTextReaderDepth (reader) == depth)
+            {
+              if (text_found)
+                return stream->text->str;
+              return NULL;
+            }
+          break;
 
-              if (xmlStrEqual (name, (const xmlChar *) "MIDI_program_number"))
-                {
-                  /* If we aren't using the internal sequencer, the MIDI 
-                   * program number within which a MIDI Note On will activate 
-                   * this sound effect.  */
-                  name_data =
-                    xmlNodeListGetString (sounds_file,
-                                          sound_loc->xmlChildrenNode, 1);
-                  if (name_data != NULL)
-                    {
-                      long_data =
-                        g_ascii_strtoll ((gchar *) name_data, NULL, 10);
-                      xmlFree (name_data);
-                      sound_data->MIDI_program_number = long_data;
-                      sound_data->MIDI_program_number_specified = TRUE;
-                    }
-                  name_data = NULL;
-                }
+        default:
+          break;
+        }
+    }
 
-              if (xmlStrEqual (name, (const xmlChar *) "MIDI_note_number"))
-                {
-                  /* If we aren't using the internal sequencer, the MIDI Note
-                   * number that will activate this sound effect.  */
-                  name_data =
-                    xmlNodeListGetString (sounds_file,
-                                          sound_loc->xmlChildrenNode, 1);
-                  if (name_data != NULL)
-                    {
-                      long_data =
-                        g_ascii_strtoll ((gchar *) name_data, NULL, 10);
-                      xmlFree (name_data);
-                      sound_data->MIDI_note_number = long_data;
-                      sound_data->MIDI_note_number_specified = TRUE;
-                      name_data = NULL;
-                    }
-                }
+  return NULL;
+}
 
-              if (xmlStrEqual (name, (const xmlChar *) "OSC_name"))
-                {
-                  /* If we are not using the internal sequencer, this is the
-                   * name by which this sound effect is activated using
-                   * Open Sound Control.  */
-                  name_data =
-                    xmlNodeListGetString (sounds_file,
-                                          sound_loc->xmlChildrenNode, 1);
-                  if (name_data != NULL)
-                    {
-                      sound_data->OSC_name = g_strdup ((gchar *) name_data);
-                      sound_data->OSC_name_specified = TRUE;
-                      xmlFree (name_data);
-                      name_data = NULL;
-                    }
-                }
+/* Read the text of the current element as a floating-point number.
+ * If there is no text, leave the value unchanged.  */
+static void
+element_double (struct xml_stream *stream, gdouble * value)
+{
+  const gchar *text;
 
-              if (xmlStrEqual (name, (const xmlChar *) "function_key"))
-                {
-                  /* If we are not using the internal sequencer, this is the
-                   * function key the operator presses to activate this
-                   * sound effect.  */
-                  name_data =
-                    xmlNodeListGetString (sounds_file,
-                                          sound_loc->xmlChildrenNode, 1);
-                  if (name_data != NULL)
-                    {
-                      sound_data->function_key =
-                        g_strdup ((gchar *) name_data);
-                      sound_data->function_key_specified = TRUE;
-                      xmlFree (name_data);
-                      name_data = NULL;
-                    }
-                }
+  text = element_text (stream);
+  if (text != NULL)
+    *value = g_ascii_strtod (text, NULL);
+  return;
+}
 
-              if (xmlStrEqual (name, (const xmlChar *) "omit_panning"))
-                {
-                  /* Do not allow the operator to pan this sound.
-                   * Needed for sounds with more than two channels, or
-                   * sounds with one channel that are directed at a
-                   * specific speaker.  */
-                  name_data =
-                    xmlNodeListGetString (sounds_file,
-                                          sound_loc->xmlChildrenNode, 1);
-                  if (xmlStrEqual (name_data, (const xmlChar *) "True"))
-                    {
-                      sound_data->omit_panning = TRUE;
-                    }
-                  xmlFree (name_data);
-                  name_data = NULL;
-                }
+/* Read the text of the current element as an integer.  If there is no
+ * text, leave the value unchanged and return FALSE.  */
+static gboolean
+element_integer (struct xml_stream *stream, gint64 * value)
+{
+  const gchar *text;
 
-              /* Ignore fields we don't recognize, so we can read future
-               * XML files. */
+  text = element_text (stream);
+  if (text == NULL)
+    return FALSE;
+  *value = g_ascii_strtoll (text, NULL, 10);
+  return TRUE;
+}
 
-              sound_loc = sound_loc->next;
-            }
-          /* Append this sound to the list of sounds.  */
-          sound_append_sound (sound_data, app);
-        }
-      sounds_loc = sounds_loc->next;
-    }
+/* Read the text of the current element as a time in seconds, and
+ * convert it to nanoseconds.  If there is no text, return FALSE.  */
+static gboolean
+element_time (struct xml_stream *stream, gdouble * value)
+{
+  const gchar *text;
 
-  return;
+  text = element_text (stream);
+  if (text == NULL)
+    return FALSE;
+  *value = g_ascii_strtod (text, NULL) * 1E9;
+  return TRUE;
 }
 
-/* Dig through a sequence xml file, or the sequence content of an equipment
- * or project xml file, looking for the individual sequence items.  
- * Construct the sound effect player's internal data structure for each 
- * sequence item.  */
-static void
-parse_sequence_info (xmlDocPtr sequence_file, gchar * sequence_file_name,
-                     xmlNodePtr sequence_loc, GApplication * app)
+/* Check that the version of a section starts with 1, since we can only
+ * interpret version 1.  The value after the decimal point doesn't 
+ * matter, since 1.1, for example, will be a compatible extension 
+ * of 1.0.  */
+static gboolean
+version_is_valid (struct xml_stream *stream, gchar * section_name)
 {
-  const xmlChar *name;
-  xmlChar *name_data;
-  gdouble double_data;
-  gint64 long_data;
-  xmlNodePtr sequence_item_loc;
-  struct sequence_item_info *sequence_item_data;
-  enum sequence_item_type item_type;
+  const gchar *text;
 
-  name_data = NULL;
-  /* We start at the children of a "sequence" section.  Each child should
-   * be a "version" or "sequence_item" section. */
-  while (sequence_loc != NULL)
+  text = element_text (stream);
+  if ((text == NULL) || (!g_str_has_prefix (text, (gchar *) "1.")))
     {
-      name = sequence_loc->name;
-      if (xmlStrEqual (name, (const xmlChar *) "version"))
-        {
-          name_data =
-            xmlNodeListGetString (sequence_file,
-                                  sequence_loc->xmlChildrenNode, 1);
-          if ((!g_str_has_prefix ((gchar *) name_data, (gchar *) "1.")))
-            {
-              g_printerr ("Version number of sequence is %s, "
-                          "should start with 1.\n", name_data);
-              return;
-            }
-        }
-      if (xmlStrEqual (name, (const xmlChar *) "sequence_item"))
-        {
-          /* This is a sequence item.  Copy its information.  */
-          sequence_item_loc = sequence_loc->xmlChildrenNode;
-          /* Allocate a structure to hold sequence item information. */
-          sequence_item_data = g_malloc (sizeof (struct sequence_item_info));
-          /* Set the fields to their default values.  If a field does not
-           * appear in the XML file, it will retain its default value.
-           * This lets us add new fields without invalidating old XML files.
-           */
-          /* Fields used in the Start Sound sequence item.  */
-          sequence_item_data->name = NULL;
-          sequence_item_data->type = unknown;
-          sequence_item_data->sound_name = NULL;
-          sequence_item_data->tag = NULL;
-          sequence_item_data->use_external_velocity = 0;
-          sequence_item_data->volume = 1.0;
-          sequence_item_data->pan = 0.0;
-          sequence_item_data->program_number = 0;
-          sequence_item_data->bank_number = 0;
-          sequence_item_data->cluster_number = 0;
-          sequence_item_data->cluster_number_specified = FALSE;
-          sequence_item_data->next_completion = NULL;
-          sequence_item_data->next_termination = NULL;
-          sequence_item_data->next_starts = NULL;
-          sequence_item_data->next_release_started = NULL;
-          sequence_item_data->importance = 1;
-          sequence_item_data->Q_number = NULL;
-          sequence_item_data->text_to_display = NULL;
-
-          /* Fields used in the Stop sequence item but not mentioned above.  */
-          sequence_item_data->next = NULL;
-
-          /* Fields used in the Wait sequence item but not mentioned above.  */
-          sequence_item_data->time_to_wait = 0;
-
-          /* Fields used in the Offer Sound sequence item but not mentioned
-           * above.  */
-          sequence_item_data->next_to_start = NULL;
-          sequence_item_data->MIDI_program_number = 0;
-          sequence_item_data->MIDI_note_number = 0;
-          sequence_item_data->MIDI_note_number_specified = FALSE;
-          sequence_item_data->OSC_name = NULL;
-          sequence_item_data->macro_number = 0;
-          sequence_item_data->function_key = NULL;
-
-          /* Fields used in the Operator Wait sequence item but not mentioned
-           * above.  */
-          sequence_item_data->next_play = NULL;
-          sequence_item_data->omit_from_display = FALSE;
-
-          /* The Cease Offering Sounds and Start Sequence
-           *  sequence items uses only fields already mentioned.  */
-
-          /* Collect information from the XML file.  */
-          while (sequence_item_loc != NULL)
-            {
-              name = sequence_item_loc->name;
-              if (xmlStrEqual (name, (const xmlChar *) "name"))
-                {
-                  /* This is the name of the sequence item.  It is mandatory.  
-                   */
-                  name_data =
-                    xmlNodeListGetString (sequence_file,
-                                          sequence_item_loc->xmlChildrenNode,
-                                          1);
-                  sequence_item_data->name = g_strdup ((gchar *) name_data);
-                  xmlFree (name_data);
-                  name_data = NULL;
-                }
+      g_printerr ("Version number of %s is %s, " "should start with 1.\n",
+                  section_name, text);
+      return FALSE;
+    }
+  return TRUE;
+}
 
-              if (xmlStrEqual (name, (const xmlChar *) "type"))
-                {
-                  /* The type field specifies what this sequence item does.  */
-                  name_data =
-                    xmlNodeListGetString (sequence_file,
-                                          sequence_item_loc->xmlChildrenNode,
-                                          1);
-
-                  /* Convert the textual name in the XML file into an enum.  */
-                  item_type = unknown;
-                  if (xmlStrEqual
-                      (name_data, (const xmlChar *) "start_sound"))
-                    {
-                      item_type = start_sound;
-                    }
-                  if (xmlStrEqual (name_data, (const xmlChar *) "stop"))
-                    {
-                      item_type = stop;
-                    }
-                  if (xmlStrEqual (name_data, (const xmlChar *) "wait"))
-                    {
-                      item_type = wait;
-                    }
-                  if (xmlStrEqual
-                      (name_data, (const xmlChar *) "offer_sound"))
-                    {
-                      item_type = offer_sound;
-                    }
-                  if (xmlStrEqual
-                      (name_data, (const xmlChar *) "cease_offering_sound"))
-                    {
-                      item_type = cease_offering_sound;
-                    }
-                  if (xmlStrEqual
-                      (name_data, (const xmlChar *) "operator_wait"))
-                    {
-                      item_type = operator_wait;
-                    }
-                  if (xmlStrEqual
-                      (name_data, (const xmlChar *) "start_sequence"))
-                    {
-                      item_type = start_sequence;
-                    }
+/* If a file name does not have an absolute path, prepend the path of 
+ * the file that refers to it.  This allows files to be copied along 
+ * with the files that refer to them.  */
+static gchar *
+resolve_file_name (const gchar * file_name, const gchar * referring_file_name)
+{
+  gchar *file_dirname;
+  gchar *absolute_file_name;
 
-                  sequence_item_data->type = item_type;
-                  xmlFree (name_data);
-                  name_data = NULL;
-                }
+  if (g_path_is_absolute (file_name))
+    return g_strdup (file_name);
 
-              if (xmlStrEqual (name, (const xmlChar *) "sound_name"))
-                {
-                  /* For the Start Sound sequence item, the name of the sound
-                   * to start.  */
-                  name_data =
-                    xmlNodeListGetString (sequence_file,
-                                          sequence_item_loc->xmlChildrenNode,
-                                          1);
-                  sequence_item_data->sound_name =
-                    g_strdup ((gchar *) name_data);
-                  xmlFree (name_data);
-                  name_data = NULL;
-                }
+  file_dirname = g_path_get_dirname (referring_file_name);
+  absolute_file_name = g_build_filename (file_dirname, file_name, NULL);
+  g_free (file_dirname);
+  return absolute_file_name;
+}
 
-              if (xmlStrEqual (name, (const xmlChar *) "tag"))
-                {
-                  /* The tag in Start Sound and Offer Sound is used by Stop
-                   * and Cease Offering Sound to name the sound or offering
-                   * to stop.  */
-                  name_data =
-                    xmlNodeListGetString (sequence_file,
-                                          sequence_item_loc->xmlChildrenNode,
-                                          1);
-                  sequence_item_data->tag = g_strdup ((gchar *) name_data);
-                  xmlFree (name_data);
-                  name_data = NULL;
-                }
+/* If the current element refers to another file, read that file, 
+ * which should contain the same kind of section.  */
+static void
+parse_referenced_file (struct xml_stream *stream,
+                       enum element_codes section_code)
+{
+  xmlChar *prop_name;
+  gchar *absolute_file_name;
 
-              if (xmlStrEqual
-                  (name, (const xmlChar *) "use_external_velocity"))
-                {
-                  /* For the Start Sound sequence item, if this is set to 1
-                   * we use the velocity of an external Note On message to
-                   * scale the volume of the sound.  */
-                  name_data =
-                    xmlNodeListGetString (sequence_file,
-                                          sequence_item_loc->xmlChildrenNode,
-                                          1);
-                  if (name_data != NULL)
-                    {
-                      long_data =
-                        g_ascii_strtoll ((gchar *) name_data, NULL, 10);
-                      xmlFree (name_data);
-                      sequence_item_data->use_external_velocity = long_data;
-                      name_data = NULL;
-                    }
-                }
+  prop_name =
+    xmlTextReaderGetAttribute (stream->reader, (const xmlChar *) "href");
+  if (prop_name == NULL)
+    return;
 
-              if (xmlStrEqual (name, (const xmlChar *) "volume"))
-                {
-                  /* For the Start Sound sequence item, scale the sound
-                   * designer's volume by this amount.  */
-                  name_data =
-                    xmlNodeListGetString (sequence_file,
-                                          sequence_item_loc->xmlChildrenNode,
-                                          1);
-                  if (name_data != NULL)
-                    {
-                      double_data =
-                        g_ascii_strtod ((gchar *) name_data, NULL);
-                      xmlFree (name_data);
-                      sequence_item_data->volume = double_data;
-                      name_data = NULL;
-                    }
-                }
+  absolute_file_name =
+    resolve_file_name ((gchar *) prop_name, stream->file_name);
+  xmlFree (prop_name);
+  parse_file (absolute_file_name, section_code, stream->app);
+  g_free (absolute_file_name);
 
-              if (xmlStrEqual (name, (const xmlChar *) "pan"))
-                {
-                  /* For the Start Sound sequence item, adjust the sound
-                   * designer's pan by this amount.  */
-                  name_data =
-                    xmlNodeListGetString (sequence_file,
-                                          sequence_item_loc->xmlChildrenNode,
-                                          1);
-                  if (name_data != NULL)
-                    {
-                      double_data =
-                        g_ascii_strtod ((gchar *) name_data, NULL);
-                      xmlFree (name_data);
-                      sequence_item_data->pan = double_data;
-                      name_data = NULL;
-                    }
-                }
+  return;
+}
 
-              if (xmlStrEqual (name, (const xmlChar *) "program_number"))
-                {
-                  /* For the Start Sound and Offer Sound sequence items, 
-                   * the program number of
-                   * the cluster in which we display the sound.  The program
-                   * number of the clusters being shown is controlled by
-                   * the sound effects operator.  Unless there are a large
-                   * number of clusters being used, let this value default
-                   * to zero.  */
-                  name_data =
-                    xmlNodeListGetString (sequence_file,
-                                          sequence_item_loc->xmlChildrenNode,
-                                          1);
-                  if (name_data != NULL)
-                    {
-                      long_data =
-                        g_ascii_strtoll ((gchar *) name_data, NULL, 10);
-                      xmlFree (name_data);
-                      sequence_item_data->program_number = long_data;
-                      name_data = NULL;
-                    }
-                }
+/* Read a send section of a sound: the bus the sound is sent to, and
+ * the level to send.  */
+static void
+parse_send (struct xml_stream *stream, struct sound_info *sound_data)
+{
+  gchar *bus_name;
+  gdouble level;
+  gint depth;
+
+  bus_name = NULL;
+  level = 1.0;
+  depth = xmlTextReaderDepth (stream->reader);
+  while (next_child (stream, depth))
+    {
+      switch (element_code (stream))
+        {
+        case element_bus_name:
+          bus_name = arena_intern (element_text (stream), stream->app);
+          break;
 
-              if (xmlStrEqual (name, (const xmlChar *) "bank_number"))
-                {
-                  /* For the Start Sound and Offer Sound sequence items, 
-                   * the bank number of the cluster in which we display 
-                   * the sound.  The bank
-                   * number of the clusters being shown is controlled by
-                   * the sound effects operator.  Unless there are a large
-                   * number of clusters being used, let this value default
-                   * to zero.  */
-                  name_data =
-                    xmlNodeListGetString (sequence_file,
-                                          sequence_item_loc->xmlChildrenNode,
-                                          1);
-                  if (name_data != NULL)
-                    {
-                      long_data =
-                        g_ascii_strtoll ((gchar *) name_data, NULL, 10);
-                      xmlFree (name_data);
-                      sequence_item_data->bank_number = long_data;
-                      name_data = NULL;
-                    }
-                }
+        case element_volume:
+          element_double (stream, &level);
+          break;
 
-              if (xmlStrEqual (name, (const xmlChar *) "cluster_number"))
-                {
-                  /* For the Start Sound and Offer Sound sequence items, 
-                   * the cluster number in which we display the sound.  
-                   * If none is specified,
-                   * one will be chosen at run time.  Use this to place
-                   * a sound in the same cluster as a previous, related,
-                   * sound.  For example, you might devote a particular
-                   * cluster to ringing a telephone even though it doesn't
-                   * ring throughtout the show.  */
-                  name_data =
-                    xmlNodeListGetString (sequence_file,
-                                          sequence_item_loc->xmlChildrenNode,
-                                          1);
-                  if (name_data != NULL)
-                    {
-                      long_data =
-                        g_ascii_strtoll ((gchar *) name_data, NULL, 10);
-                      xmlFree (name_data);
-                      sequence_item_data->cluster_number = long_data;
-                      sequence_item_data->cluster_number_specified = TRUE;
-                      name_data = NULL;
-                    }
-                }
+        default:
+          break;
+        }
+    }
 
-              if (xmlStrEqual (name, (const xmlChar *) "next_completion"))
-                {
-                  /* In the Start Sound sequence item, the next sequence item 
-                   * to execute, when and if this sound completes normally.
-                   * In the Wait sequence item, the sequence item to execute
-                   * when the wait has completed.  */
-                  name_data =
-                    xmlNodeListGetString (sequence_file,
-                                          sequence_item_loc->xmlChildrenNode,
-                                          1);
-                  sequence_item_data->next_completion =
-                    g_strdup ((gchar *) name_data);
-                  xmlFree (name_data);
-                  name_data = NULL;
-                }
+  if (bus_name == NULL)
+    return;
+  if (sound_data->send_count >= SOUND_MAX_SENDS)
+    {
+      g_printerr ("A sound is sent to more than %d buses; "
+                  "bus %s is ignored.\n", SOUND_MAX_SENDS, bus_name);
+      return;
+    }
+  sound_data->sends[sound_data->send_count].bus_name = bus_name;
+  sound_data->sends[sound_data->send_count].level = level;
+  sound_data->send_count = sound_data->send_count + 1;
 
-              if (xmlStrEqual (name, (const xmlChar *) "next_termination"))
-                {
-                  /* The next sequence item to execute, when and if this
-                   * sound terminates due to an external event, such as
-                   * a MIDI Note Off or the sound effects operator pressing
-                   * his Stop key.  */
-                  name_data =
-                    xmlNodeListGetString (sequence_file,
-                                          sequence_item_loc->xmlChildrenNode,
-                                          1);
-                  sequence_item_data->next_termination =
-                    g_strdup ((gchar *) name_data);
-                  xmlFree (name_data);
-                  name_data = NULL;
-                }
+  return;
+}
 
-              if (xmlStrEqual (name, (const xmlChar *) "next_starts"))
-                {
-                  /* The next sequence item to execute when this sound has
-                   * started.  This can be used to fork the sequencer.
-                   */
-                  name_data =
-                    xmlNodeListGetString (sequence_file,
-                                          sequence_item_loc->xmlChildrenNode,
-                                          1);
-                  sequence_item_data->next_starts =
-                    g_strdup ((gchar *) name_data);
-                  xmlFree (name_data);
-                  name_data = NULL;
-                }
+/* Read a speaker section of a sound: the bus and channel the sound is
+ * placed on, and its level there.  The bus defaults to the first.  */
+static void
+parse_speaker (struct xml_stream *stream, struct sound_info *sound_data)
+{
+  gchar *bus_name;
+  gint64 channel;
+  gdouble level;
+  gint depth;
+
+  bus_name = NULL;
+  channel = 0;
+  level = 1.0;
+  depth = xmlTextReaderDepth (stream->reader);
+  while (next_child (stream, depth))
+    {
+      switch (element_code (stream))
+        {
+        case element_bus_name:
+          bus_name = arena_intern (element_text (stream), stream->app);
+          break;
 
-              if (xmlStrEqual
-                  (name, (const xmlChar *) "next_release_started"))
-                {
-                  /* The next sequence item to execute when this sound has
-                   * reached the release stage of its amplitude envelope.  
-                   * This can be used to fork the sequencer.
-                   */
-                  name_data =
-                    xmlNodeListGetString (sequence_file,
-                                          sequence_item_loc->xmlChildrenNode,
-                                          1);
-                  sequence_item_data->next_release_started =
-                    g_strdup ((gchar *) name_data);
-                  xmlFree (name_data);
-                  name_data = NULL;
-                }
+        case element_channel:
+          element_integer (stream, &channel);
+          break;
 
-              if (xmlStrEqual (name, (const xmlChar *) "importance"))
-                {
-                  /* The importance of this sound to the sound effects
-                   * operator.  The most important sound being played
-                   * is displayed on the console.  */
-                  name_data =
-                    xmlNodeListGetString (sequence_file,
-                                          sequence_item_loc->xmlChildrenNode,
-                                          1);
-                  if (name_data != NULL)
-                    {
-                      long_data =
-                        g_ascii_strtoll ((gchar *) name_data, NULL, 10);
-                      xmlFree (name_data);
-                      sequence_item_data->importance = long_data;
-                      name_data = NULL;
-                    }
-                }
+        case element_volume:
+          element_double (stream, &level);
+          break;
 
-              if (xmlStrEqual (name, (const xmlChar *) "Q_number"))
-                {
-                  /* The Q number of this sound, for MIDI Show Control.  */
-                  name_data =
-                    xmlNodeListGetString (sequence_file,
-                                          sequence_item_loc->xmlChildrenNode,
-                                          1);
-                  sequence_item_data->Q_number =
-                    g_strdup ((gchar *) name_data);
-                  xmlFree (name_data);
-                  name_data = NULL;
-                }
+        default:
+          break;
+        }
+    }
 
-              if (xmlStrEqual (name, (const xmlChar *) "text_to_display"))
-                {
-                  /* The text to display to the sound effects operator when
-                   * this sound is playing.  */
-                  name_data =
-                    xmlNodeListGetString (sequence_file,
-                                          sequence_item_loc->xmlChildrenNode,
-                                          1);
-                  sequence_item_data->text_to_display =
-                    g_strdup ((gchar *) name_data);
-                  xmlFree (name_data);
-                  name_data = NULL;
-                }
+  if ((channel < 1) || (channel > ROUTING_MAX_CHANNELS))
+    {
+      g_printerr ("A sound is placed on a speaker without a valid "
+                  "channel.\n");
+      return;
+    }
+  if (sound_data->speaker_count >= SOUND_MAX_SPEAKERS)
+    {
+      g_printerr ("A sound is placed on more than %d speakers; "
+                  "channel %d is ignored.\n", SOUND_MAX_SPEAKERS,
+                  (gint) channel);
+      return;
+    }
+  sound_data->speakers[sound_data->speaker_count].bus_name = bus_name;
+  sound_data->speakers[sound_data->speaker_count].channel = channel;
+  sound_data->speakers[sound_data->speaker_count].level = level;
+  sound_data->speaker_count = sound_data->speaker_count + 1;
 
-              if (xmlStrEqual (name, (const xmlChar *) "next"))
-                {
-                  /* In other than the Start Sound sequence item, the next
-                   * seqeunce item to execute when this one is done.  The
-                   * Start Sound sequence item has three specialized next
-                   * sequence items, and so does not use this general one.
-                   */
-                  name_data =
-                    xmlNodeListGetString (sequence_file,
-                                          sequence_item_loc->xmlChildrenNode,
-                                          1);
-                  sequence_item_data->next = g_strdup ((gchar *) name_data);
-                  xmlFree (name_data);
-                  name_data = NULL;
-                }
+  return;
+}
 
-              if (xmlStrEqual (name, (const xmlChar *) "time_to_wait"))
-                {
-                  /* In the Wait sequence item, the length of time to wait,
-                   * in nanoseconds.  */
-                  name_data =
-                    xmlNodeListGetString (sequence_file,
-                                          sequence_item_loc->xmlChildrenNode,
-                                          1);
-                  if (name_data != NULL)
-                    {
-                      long_data =
-                        g_ascii_strtoll ((gchar *) name_data, NULL, 10);
-                      xmlFree (name_data);
-                      sequence_item_data->time_to_wait = long_data;
-                      name_data = NULL;
-                    }
-                }
+/* Read a sound section, and construct the sound effect player's internal
+ * data structure for it.  */
+static void
+parse_sound (struct xml_stream *stream)
+{
+  struct sound_info *sound_data;
+  const gchar *text;
+  gchar *full_name;
+  gdouble double_data;
+  gint64 long_data;
+  gint depth;
 
-              if (xmlStrEqual (name, (const xmlChar *) "next_to_start"))
-                {
-                  /* In the Offer Sound sequence item, the sequence item
-                   * that is to be executed when the sound effects operator
-                   * presses the Start button on the specified cluster.
-                   * The sequence item can also be started remotely.  
-                   * This sequence item, like Start Sound, can be used
-                   * to fork the sequencer.  */
-                  name_data =
-                    xmlNodeListGetString (sequence_file,
-                                          sequence_item_loc->xmlChildrenNode,
-                                          1);
-                  sequence_item_data->next_to_start =
-                    g_strdup ((gchar *) name_data);
-                  xmlFree (name_data);
-                  name_data = NULL;
-                }
+  /* Allocate a structure to hold sound information. */
+  sound_data = arena_new_record (sizeof (struct sound_info), stream->app);
+  /* Set the fields to their default values.  If a field does not
+   * appear in the XML file, it will retain its default value.
+   * This lets us add new fields without invalidating old XML files.
+   */
+  sound_data->name = NULL;
+  sound_data->disabled = FALSE;
+  sound_data->wav_file_name = NULL;
+  sound_data->wav_file_name_full = NULL;
+  sound_data->attack_duration_time = 0;
+  sound_data->attack_level = 1.0;
+  sound_data->decay_duration_time = 0;
+  sound_data->sustain_level = 1.0;
+  sound_data->release_start_time = 0;
+  sound_data->release_duration_time = 0;
+  sound_data->release_duration_infinite = FALSE;
+  sound_data->loop_from_time = 0;
+  sound_data->loop_to_time = 0;
+  sound_data->loop_limit = 0;
+  sound_data->max_duration_time = 0;
+  sound_data->start_time = 0;
+  sound_data->designer_volume_level = 1.0;
+  sound_data->designer_pan = 0.0;
+  sound_data->MIDI_program_number = 0;
+  sound_data->MIDI_program_number_specified = FALSE;
+  sound_data->MIDI_note_number = 0;
+  sound_data->MIDI_note_number_specified = FALSE;
+  sound_data->OSC_name = NULL;
+  sound_data->OSC_name_specified = FALSE;
+  sound_data->function_key = NULL;
+  sound_data->function_key_specified = FALSE;
+  sound_data->omit_panning = FALSE;
+  sound_data->send_count = 0;
+  sound_data->speaker_count = 0;
+
+  /* These fields will be filled at run time.  */
+  sound_data->sound_control = NULL;
+  sound_data->cluster_widget = NULL;
+  sound_data->cluster_number = 0;
+  sound_data->running = FALSE;
+  sound_data->release_sent = FALSE;
+  sound_data->release_has_started = FALSE;
+
+  /* Collect information from the XML file.  */
+  depth = xmlTextReaderDepth (stream->reader);
+  while (next_child (stream, depth))
+    {
+      switch (element_code (stream))
+        {
+        case element_name:
+          /* This is the name of the sound.  It is mandatory.  */
+          sound_data->name =
+            arena_intern (element_text (stream), stream->app);
+          break;
+
+        case element_wav_file_name:
+          /* The name of the WAV file from which we take the waveform.  */
+          text = element_text (stream);
+          if (text == NULL)
+            break;
+          sound_data->wav_file_name = arena_intern (text, stream->app);
+
+          /* A relative name is relative to the sounds, equipment or 
+           * project file, so wave files can be copied along with the 
+           * files that refer to them.  */
+          full_name =
+            resolve_file_name (sound_data->wav_file_name, stream->file_name);
+          sound_data->wav_file_name_full =
+            arena_intern (full_name, stream->app);
+          g_free (full_name);
+          if (!g_file_test (sound_data->wav_file_name_full,
+                            G_FILE_TEST_EXISTS))
+            {
+              g_printerr ("File %s does not exist.\n",
+                          sound_data->wav_file_name_full);
+              sound_data->disabled = TRUE;
+            }
+          break;
+
+        case element_attack_duration_time:
+          /* The time required to ramp up the sound when it starts.  */
+          if (element_time (stream, &double_data))
+            sound_data->attack_duration_time = double_data;
+          break;
+
+        case element_attack_level:
+          /* The level we ramp up to.  */
+          element_double (stream, &sound_data->attack_level);
+          break;
+
+        case element_decay_duration_time:
+          /* Following the attack, the time to decrease the volume
+           * to the sustain level.  */
+          if (element_time (stream, &double_data))
+            sound_data->decay_duration_time = double_data;
+          break;
+
+        case element_sustain_level:
+          /* The volume to reach at the end of the decay.  */
+          element_double (stream, &sound_data->sustain_level);
+          break;
+
+        case element_release_start_time:
+          /* When to start the release process.  If this value is
+           * zero, we start the release process only upon receipt
+           * of an external signal, such as MIDI Note Off.  */
+          if (element_time (stream, &double_data))
+            sound_data->release_start_time = double_data;
+          break;
+
+        case element_release_duration_time:
+          /* Once release has started, the time to ramp the volume
+           * down to zero.  Note this value may be infinity, which
+           * means that the volume does not decrease.  */
+          text = element_text (stream);
+          if (text == NULL)
+            break;
+          if (strcmp (text, "∞") == 0)
+            {
+              sound_data->release_duration_infinite = TRUE;
+              sound_data->release_duration_time = 0;
+            }
+          else
+            {
+              sound_data->release_duration_time =
+                g_ascii_strtod (text, NULL) * 1E9;
+              sound_data->release_duration_infinite = FALSE;
+            }
+          break;
+
+        case element_loop_from_time:
+          /* If we are looping, the end time of the loop.  
+           * 0, the default, means do not loop.  */
+          if (element_time (stream, &double_data))
+            sound_data->loop_from_time = double_data;
+          break;
+
+        case element_loop_to_time:
+          /* If we are looping, the start time of the loop.  
+           * Each time through the loop we play from start time
+           * to the end time of the loop.  */
+          if (element_time (stream, &double_data))
+            sound_data->loop_to_time = double_data;
+          break;
+
+        case element_loop_limit:
+          /* The number of times to pass through the loop.  Zero
+           * means loop until stopped by a Release message.  */
+          if (element_integer (stream, &long_data))
+            sound_data->loop_limit = long_data;
+          break;
+
+        case element_max_duration_time:
+          /* The maximum amount of time to absorb from the WAV file  */
+          if (element_time (stream, &double_data))
+            sound_data->max_duration_time = double_data;
+          break;
+
+        case element_start_time:
+          /* The time within the WAV file to start this sound effect.  */
+          if (element_time (stream, &double_data))
+            sound_data->start_time = double_data;
+          break;
+
+        case element_designer_volume_level:
+          /* For this sound effect, decrease the volume from the WAV
+           * file by this amount.  */
+          double_data = sound_data->designer_volume_level;
+          element_double (stream, &double_data);
+          sound_data->designer_volume_level = double_data;
+          break;
+
+        case element_designer_pan:
+          /* For monaural WAV files, the amount to send to the left and
+           * right channels, expressed as -1 for left channel only,
+           * 0 for both channels equally, and +1 for right channel
+           * only.  Other values between +1 and -1 also place the sound
+           * in the stereo field.  For stereo WAV files this operates
+           * as a balance control.  */
+          double_data = sound_data->designer_pan;
+          element_double (stream, &double_data);
+          sound_data->designer_pan = double_data;
+          break;
+
+        case element_MIDI_program_number:
+          /* If we aren't using the internal sequencer, the MIDI 
+           * program number within which a MIDI Note On will activate 
+           * this sound effect.  */
+          if (element_integer (stream, &long_data))
+            {
+              sound_data->MIDI_program_number = long_data;
+              sound_data->MIDI_program_number_specified = TRUE;
+            }
+          break;
 
-              if (xmlStrEqual (name, (const xmlChar *) "MIDI_program_number"))
-                {
-                  /* In the Offer Sound sequence item, the MIDI program number
-                   * of the MIDI Note On message that will trigger the
-                   * specified sequence item.  */
-                  name_data =
-                    xmlNodeListGetString (sequence_file,
-                                          sequence_item_loc->xmlChildrenNode,
-                                          1);
-                  if (name_data != NULL)
-                    {
-                      long_data =
-                        g_ascii_strtoll ((gchar *) name_data, NULL, 10);
-                      xmlFree (name_data);
-                      sequence_item_data->MIDI_program_number = long_data;
-                      name_data = NULL;
-                    }
-                }
+        case element_MIDI_note_number:
+          /* If we aren't using the internal sequencer, the MIDI Note
+           * number that will activate this sound effect.  */
+          if (element_integer (stream, &long_data))
+            {
+              sound_data->MIDI_note_number = long_data;
+              sound_data->MIDI_note_number_specified = TRUE;
+            }
+          break;
+
+        case element_OSC_name:
+          /* If we are not using the internal sequencer, this is the
+           * name by which this sound effect is activated using
+           * Open Sound Control.  */
+          text = element_text (stream);
+          if (text != NULL)
+            {
+              sound_data->OSC_name = arena_intern (text, stream->app);
+              sound_data->OSC_name_specified = TRUE;
+            }
+          break;
+
+        case element_function_key:
+          /* If we are not using the internal sequencer, this is the
+           * function key the operator presses to activate this
+           * sound effect.  */
+          text = element_text (stream);
+          if (text != NULL)
+            {
+              sound_data->function_key = arena_intern (text, stream->app);
+              sound_data->function_key_specified = TRUE;
+            }
+          break;
+
+        case element_omit_panning:
+          /* Do not allow the operator to pan this sound.
+           * Needed for sounds with more than two channels, or
+           * sounds with one channel that are directed at a
+           * specific speaker.  */
+          if (g_strcmp0 (element_text (stream), "True") == 0)
+            sound_data->omit_panning = TRUE;
+          break;
+
+        case element_send:
+          /* Send this sound to an output bus.  A sound may be sent
+           * to several.  */
+          parse_send (stream, sound_data);
+          break;
+
+        case element_speaker:
+          /* Place this sound on one channel of an output bus, for
+           * surround sound.  A sound may be placed on several.  */
+          parse_speaker (stream, sound_data);
+          break;
+
+        default:
+          /* Ignore fields we don't recognize, so we can read future
+           * XML files. */
+          break;
+        }
+    }
 
-              if (xmlStrEqual (name, (const xmlChar *) "MIDI_note_number"))
-                {
-                  /* In the Offer Sound sequence item, the MIDI note number
-                   * of the MIDI Note On message that will trigger the
-                   * specified sequence item.  */
-                  name_data =
-                    xmlNodeListGetString (sequence_file,
-                                          sequence_item_loc->xmlChildrenNode,
-                                          1);
-                  if (name_data != NULL)
-                    {
-                      long_data =
-                        g_ascii_strtoll ((gchar *) name_data, NULL, 10);
-                      xmlFree (name_data);
-                      sequence_item_data->MIDI_note_number = long_data;
-                      sequence_item_data->MIDI_note_number_specified = TRUE;
-                      name_data = NULL;
-                    }
-                }
+  /* If the file ended in the middle of the sound, discard it.
+   * Its record and strings stay in the arena until the show is
+   * released.  */
+  if (stream->failed)
+    return;
 
-              if (xmlStrEqual (name, (const xmlChar *) "OSC_name"))
-                {
-                  /* In the Offer Sound sequence item, the Open Show Control
-                   * (OSC) name used to trigger the specified sequence item
-                   * remotely.  */
-                  name_data =
-                    xmlNodeListGetString (sequence_file,
-                                          sequence_item_loc->xmlChildrenNode,
-                                          1);
-                  sequence_item_data->OSC_name =
-                    g_strdup ((gchar *) name_data);
-                  xmlFree (name_data);
-                  name_data = NULL;
-                }
+  /* Append this sound to the list of sounds.  */
+  sound_append_sound (sound_data, stream->app);
 
-              if (xmlStrEqual (name, (const xmlChar *) "macro_number"))
-                {
-                  /* In the Offer Sound sequence item, the macro number used
-                   * by the Fire command of MIDI Show Control to trigger
-                   * the specified sequence item remotely.  */
-                  name_data =
-                    xmlNodeListGetString (sequence_file,
-                                          sequence_item_loc->xmlChildrenNode,
-                                          1);
-                  if (name_data != NULL)
-                    {
-                      long_data =
-                        g_ascii_strtoll ((gchar *) name_data, NULL, 10);
-                      xmlFree (name_data);
-                      sequence_item_data->macro_number = long_data;
-                      name_data = NULL;
-                    }
-                }
+  return;
+}
 
-              if (xmlStrEqual (name, (const xmlChar *) "function_key"))
-                {
-                  /* In the Offer Sound and Operator Wait sequence items, 
-                   * the function key used to trigger the specified sequence 
-                   * item remotely.  */
-                  name_data =
-                    xmlNodeListGetString (sequence_file,
-                                          sequence_item_loc->xmlChildrenNode,
-                                          1);
-                  sequence_item_data->function_key =
-                    g_strdup ((gchar *) name_data);
-                  xmlFree (name_data);
-                  name_data = NULL;
-                }
+/* Read a bus section of the routing: the name of an output bus, its
+ * number of channels and the device it plays on.  */
+static void
+parse_bus (struct xml_stream *stream)
+{
+  gchar *bus_name;
+  gchar *device_name;
+  gint64 channel_count;
+  gint depth;
+
+  bus_name = NULL;
+  device_name = NULL;
+  channel_count = 2;
+  depth = xmlTextReaderDepth (stream->reader);
+  while (next_child (stream, depth))
+    {
+      switch (element_code (stream))
+        {
+        case element_name:
+          g_free (bus_name);
+          bus_name = g_strdup (element_text (stream));
+          break;
+
+        case element_channels:
+          element_integer (stream, &channel_count);
+          break;
+
+        case element_device:
+          g_free (device_name);
+          device_name = g_strdup (element_text (stream));
+          break;
+
+        default:
+          break;
+        }
+    }
 
-              if (xmlStrEqual (name, (const xmlChar *) "next_play"))
-                {
-                  /* In the Operator Wait sequence item, the sequence item
-                   * to execute when the operator presses the Play button.  */
-                  name_data =
-                    xmlNodeListGetString (sequence_file,
-                                          sequence_item_loc->xmlChildrenNode,
-                                          1);
-                  sequence_item_data->next_play =
-                    g_strdup ((gchar *) name_data);
-                  xmlFree (name_data);
-                  name_data = NULL;
-                }
+  if (!stream->failed)
+    routing_define_bus (bus_name,
+                        CLAMP (channel_count, 0, ROUTING_MAX_CHANNELS + 1),
+                        device_name, stream->app);
+  g_free (bus_name);
+  g_free (device_name);
 
-              if (xmlStrEqual (name, (const xmlChar *) "omit_from_display"))
-                {
-                  /* In the Operator Wait sequence item, do not display this
-                   * item to the operator.  */
-                  name_data =
-                    xmlNodeListGetString (sequence_file,
-                                          sequence_item_loc->xmlChildrenNode,
-                                          1);
-                  if (xmlStrEqual (name_data, (const xmlChar *) "True"))
-                    {
-                      sequence_item_data->omit_from_display = TRUE;
-                    }
-                  xmlFree (name_data);
-                  name_data = NULL;
-                }
+  return;
+}
 
-              /* Ignore fields we don't recognize, so we can read future
-               * XML files. */
+/* Read the routing section of a sounds file, which defines the output
+ * buses the sounds can be sent to.  If it names a device, all of the
+ * buses play on that one multichannel device; otherwise each bus plays
+ * on its own.  */
+static void
+parse_routing (struct xml_stream *stream)
+{
+  gint depth;
 
-              sequence_item_loc = sequence_item_loc->next;
-            }
+  depth = xmlTextReaderDepth (stream->reader);
+  while (next_child (stream, depth))
+    {
+      switch (element_code (stream))
+        {
+        case element_bus:
+          parse_bus (stream);
+          break;
+
+        case element_device:
+          routing_set_device (element_text (stream), stream->app);
+          break;
 
-          /* Append this sequence item to the sequence.  */
-          sequence_append_item (sequence_item_data, app);
+        default:
+          break;
         }
-      sequence_loc = sequence_loc->next;
     }
 
   return;
 }
 
-/* Dig through the sound_effects program section of an equipment file 
- * to find the sound and sequence information.  */
+/* Read the sounds section of a sounds, equipment or project file, 
+ * looking for the individual sounds.  */
 static void
-parse_program_info (xmlDocPtr equipment_file, gchar * equipment_file_name,
-                    xmlNodePtr program_loc, GApplication * app)
+parse_sounds_info (struct xml_stream *stream)
 {
-  xmlChar *key;
-  const xmlChar *name;
-  xmlChar *prop_name;
-  gchar *file_name;
-  gchar *file_dirname;
-  gchar *absolute_file_name;
-  gint64 port_number;
-  xmlNodePtr sounds_loc, sequence_loc;
-  xmlDocPtr sounds_file, sequence_file;
-  const xmlChar *root_name;
-  const xmlChar *sounds_name, *sequence_name;
-  gboolean sounds_section_parsed, sequence_section_parsed;
-
-  /* We start at the children of a "program" section which has the
-   * name "sound_effects". */
-  /* We are looking for sound and sequence sections.  */
-
-  file_name = NULL;
-  file_dirname = NULL;
-  absolute_file_name = NULL;
-  prop_name = NULL;
-
-  while (program_loc != NULL)
+  gint depth;
+
+  /* Each child should be a "version" or "sound" section. */
+  depth = xmlTextReaderDepth (stream->reader);
+  while (next_child (stream, depth))
     {
-      name = program_loc->name;
-      if (xmlStrEqual (name, (const xmlChar *) "port"))
+      switch (element_code (stream))
         {
-          /* This is the "port" section within "program".  */
-          key =
-            xmlNodeListGetString (equipment_file,
-                                  program_loc->xmlChildrenNode, 1);
-          port_number = g_ascii_strtoll ((gchar *) key, NULL, 10);
-          /* Tell the network module the new port number. */
-          network_set_port (port_number, app);
-          xmlFree (key);
+        case element_version:
+          if (!version_is_valid (stream, (gchar *) "sounds"))
+            return;
+          break;
+
+        case element_sound:
+          parse_sound (stream);
+          break;
+
+        case element_routing:
+          parse_routing (stream);
+          break;
+
+        default:
+          break;
         }
+    }
+
+  return;
+}
 
-      if (xmlStrEqual (name, (const xmlChar *) "sounds"))
+/* Read a sequence item section, and construct the sound effect player's 
+ * internal data structure for it.  */
+static void
+parse_sequence_item (struct xml_stream *stream)
+{
+  struct sequence_item_info *sequence_item_data;
+  const gchar *text;
+  gint64 long_data;
+  gint depth;
+  gint i;
+
+  /* Allocate a structure to hold sequence item information. */
+  sequence_item_data =
+    arena_new_record (sizeof (struct sequence_item_info), stream->app);
+  /* Set the fields to their default values.  If a field does not
+   * appear in the XML file, it will retain its default value.
+   * This lets us add new fields without invalidating old XML files.
+   */
+  /* Fields used in the Start Sound sequence item.  */
+  sequence_item_data->name = NULL;
+  sequence_item_data->type = unknown;
+  sequence_item_data->sound_name = NULL;
+  sequence_item_data->tag = NULL;
+  sequence_item_data->use_external_velocity = 0;
+  sequence_item_data->volume = 1.0;
+  sequence_item_data->pan = 0.0;
+  sequence_item_data->program_number = 0;
+  sequence_item_data->bank_number = 0;
+  sequence_item_data->cluster_number = 0;
+  sequence_item_data->cluster_number_specified = FALSE;
+  sequence_item_data->next_completion = NULL;
+  sequence_item_data->next_termination = NULL;
+  sequence_item_data->next_starts = NULL;
+  sequence_item_data->next_release_started = NULL;
+  sequence_item_data->importance = 1;
+  sequence_item_data->Q_number = NULL;
+  sequence_item_data->text_to_display = NULL;
+
+  /* Fields used in the Stop sequence item but not mentioned above.  */
+  sequence_item_data->next = NULL;
+
+  /* Fields used in the Wait sequence item but not mentioned above.  */
+  sequence_item_data->time_to_wait = 0;
+
+  /* Fields used in the Offer Sound sequence item but not mentioned
+   * above.  */
+  sequence_item_data->next_to_start = NULL;
+  sequence_item_data->MIDI_program_number = 0;
+  sequence_item_data->MIDI_note_number = 0;
+  sequence_item_data->MIDI_note_number_specified = FALSE;
+  sequence_item_data->OSC_name = NULL;
+  sequence_item_data->macro_number = 0;
+  sequence_item_data->function_key = NULL;
+
+  /* Fields used in the Operator Wait sequence item but not mentioned
+   * above.  */
+  sequence_item_data->next_play = NULL;
+  sequence_item_data->omit_from_display = FALSE;
+
+  /* The Cease Offering Sounds and Start Sequence
+   *  sequence items uses only fields already mentioned.  */
+
+  /* Collect information from the XML file.  */
+  depth = xmlTextReaderDepth (stream->reader);
+  while (next_child (stream, depth))
+    {
+      switch (element_code (stream))
         {
-          /* This is the "sounds" section within "program".  
-           * It will have a reference to a sounds XML file,
-           * content or both.  First process the referenced file. */
-          xmlFree (prop_name);
-          prop_name = xmlGetProp (program_loc, (const xmlChar *) "href");
-          if (prop_name != NULL)
+        case element_name:
+          /* This is the name of the sequence item.  It is mandatory.  */
+          sequence_item_data->name =
+            arena_intern (element_text (stream), stream->app);
+          break;
+
+        case element_type:
+          /* The type field specifies what this sequence item does.
+           * Convert the textual name in the XML file into an enum.  */
+          text = element_text (stream);
+          sequence_item_data->type = unknown;
+          for (i = 0; i < G_N_ELEMENTS (sequence_item_type_table); i++)
             {
-              /* We have a file reference.  */
-              g_free (file_name);
-              file_name = g_strdup ((gchar *) prop_name);
-              xmlFree (prop_name);
-              prop_name = NULL;
-              /* If the file name does not have an absolute path,
-               * prepend the path of the equipment or project file.
-               * This allows equipment and project files to be 
-               * copied along with the files they reference. */
-              if (g_path_is_absolute (file_name))
-                {
-                  g_free (absolute_file_name);
-                  absolute_file_name = g_strdup (file_name);
-                }
-              else
-                {
-                  g_free (file_dirname);
-                  file_dirname = g_path_get_dirname (equipment_file_name);
-                  absolute_file_name =
-                    g_build_filename (file_dirname, file_name, NULL);
-                  g_free (file_dirname);
-                  file_dirname = NULL;
-                }
-              g_free (file_name);
-              file_name = NULL;
-
-              /* Read the specified file as an XML file. */
-              xmlLineNumbersDefault (1);
-              xmlThrDefIndentTreeOutput (1);
-              xmlKeepBlanksDefault (0);
-              xmlThrDefTreeIndentString ("    ");
-              sounds_file = xmlParseFile (absolute_file_name);
-              if (sounds_file == NULL)
+              if (g_strcmp0 (text, sequence_item_type_table[i].name) == 0)
                 {
-                  g_printerr ("Load of sound file %s failed.\n",
-                              absolute_file_name);
-                  g_free (absolute_file_name);
-                  absolute_file_name = NULL;
-                  return;
+                  sequence_item_data->type =
+                    sequence_item_type_table[i].item_type;
+                  break;
                 }
-
-              /* Make sure the sounds file is valid, then extract
-               * data from it. */
-              sounds_loc = xmlDocGetRootElement (sounds_file);
-              if (sounds_loc == NULL)
-                {
-                  g_printerr ("Empty sound file: %s.\n", absolute_file_name);
-                  g_free (absolute_file_name);
-                  absolute_file_name = NULL;
-                  xmlFree (sounds_file);
-                  return;
-                }
-              root_name = sounds_loc->name;
-              if (!xmlStrEqual (root_name, (const xmlChar *) "show_control"))
-                {
-                  g_printerr ("Not a show_control file: %s; is %s.\n",
-                              absolute_file_name, root_name);
-                  xmlFree (sounds_file);
-                  g_free (absolute_file_name);
-                  absolute_file_name = NULL;
-                  return;
-                }
-              /* Within the top-level show_control structure
-               * should be a sounds structure.  If there isn't,
-               * this isn't a sound file and must be rejected.  */
-              sounds_loc = sounds_loc->xmlChildrenNode;
-              sounds_name = NULL;
-              sounds_section_parsed = FALSE;
-              while (sounds_loc != NULL)
-                {
-                  sounds_name = sounds_loc->name;
-                  if (xmlStrEqual (sounds_name, (const xmlChar *) "sounds"))
-                    {
-                      parse_sounds_info (sounds_file, absolute_file_name,
-                                         sounds_loc->xmlChildrenNode, app);
-                      sounds_section_parsed = TRUE;
-                    }
-                  sounds_loc = sounds_loc->next;
-                }
-              if (!sounds_section_parsed)
-                {
-                  g_printerr ("Not a sounds file: %s; is %s.\n",
-                              absolute_file_name, sounds_name);
-                }
-              xmlFree (sounds_file);
             }
-          /* Now process the content of the sounds section. */
-          parse_sounds_info (equipment_file, equipment_file_name,
-                             program_loc->xmlChildrenNode, app);
-          g_free (absolute_file_name);
-          absolute_file_name = NULL;
+          break;
+
+        case element_sound_name:
+          /* For the Start Sound sequence item, the name of the sound
+           * to start.  */
+          sequence_item_data->sound_name =
+            arena_intern (element_text (stream), stream->app);
+          break;
+
+        case element_tag:
+          /* The tag in Start Sound and Offer Sound is used by Stop
+           * and Cease Offering Sound to name the sound or offering
+           * to stop.  */
+          sequence_item_data->tag =
+            arena_intern (element_text (stream), stream->app);
+          break;
+
+        case element_use_external_velocity:
+          /* For the Start Sound sequence item, if this is set to 1
+           * we use the velocity of an external Note On message to
+           * scale the volume of the sound.  */
+          if (element_integer (stream, &long_data))
+            sequence_item_data->use_external_velocity = long_data;
+          break;
+
+        case element_volume:
+          /* For the Start Sound sequence item, scale the sound
+           * designer's volume by this amount.  */
+          element_double (stream, &sequence_item_data->volume);
+          break;
+
+        case element_pan:
+          /* For the Start Sound sequence item, adjust the sound
+           * designer's pan by this amount.  */
+          element_double (stream, &sequence_item_data->pan);
+          break;
+
+        case element_program_number:
+          /* For the Start Sound and Offer Sound sequence items, 
+           * the program number of the cluster in which we display 
+           * the sound.  The program number of the clusters being 
+           * shown is controlled by the sound effects operator.  
+           * Unless there are a large number of clusters being used, 
+           * let this value default to zero.  */
+          if (element_integer (stream, &long_data))
+            sequence_item_data->program_number = long_data;
+          break;
+
+        case element_bank_number:
+          /* For the Start Sound and Offer Sound sequence items, 
+           * the bank number of the cluster in which we display 
+           * the sound.  The bank number of the clusters being shown 
+           * is controlled by the sound effects operator.  Unless there 
+           * are a large number of clusters being used, let this value 
+           * default to zero.  */
+          if (element_integer (stream, &long_data))
+            sequence_item_data->bank_number = long_data;
+          break;
+
+        case element_cluster_number:
+          /* For the Start Sound and Offer Sound sequence items, 
+           * the cluster number in which we display the sound.  
+           * If none is specified, one will be chosen at run time.  
+           * Use this to place a sound in the same cluster as a previous, 
+           * related, sound.  For example, you might devote a particular
+           * cluster to ringing a telephone even though it doesn't
+           * ring throughtout the show.  */
+          if (element_integer (stream, &long_data))
+            {
+              sequence_item_data->cluster_number = long_data;
+              sequence_item_data->cluster_number_specified = TRUE;
+            }
+          break;
+
+        case element_next_completion:
+          /* In the Start Sound sequence item, the next sequence item 
+           * to execute, when and if this sound completes normally.
+           * In the Wait sequence item, the sequence item to execute
+           * when the wait has completed.  */
+          sequence_item_data->next_completion =
+            arena_intern (element_text (stream), stream->app);
+          break;
+
+        case element_next_termination:
+          /* The next sequence item to execute, when and if this
+           * sound terminates due to an external event, such as
+           * a MIDI Note Off or the sound effects operator pressing
+           * his Stop key.  */
+          sequence_item_data->next_termination =
+            arena_intern (element_text (stream), stream->app);
+          break;
+
+        case element_next_starts:
+          /* The next sequence item to execute when this sound has
+           * started.  This can be used to fork the sequencer.  */
+          sequence_item_data->next_starts =
+            arena_intern (element_text (stream), stream->app);
+          break;
+
+        case element_next_release_started:
+          /* The next sequence item to execute when this sound has
+           * reached the release stage of its amplitude envelope.  
+           * This can be used to fork the sequencer.  */
+          sequence_item_data->next_release_started =
+            arena_intern (element_text (stream), stream->app);
+          break;
+
+        case element_importance:
+          /* The importance of this sound to the sound effects
+           * operator.  The most important sound being played
+           * is displayed on the console.  */
+          if (element_integer (stream, &long_data))
+            sequence_item_data->importance = long_data;
+          break;
+
+        case element_Q_number:
+          /* The Q number of this sound, for MIDI Show Control.  */
+          sequence_item_data->Q_number =
+            arena_intern (element_text (stream), stream->app);
+          break;
+
+        case element_text_to_display:
+          /* The text to display to the sound effects operator when
+           * this sound is playing.  */
+          sequence_item_data->text_to_display =
+            arena_intern (element_text (stream), stream->app);
+          break;
+
+        case element_next:
+          /* In other than the Start Sound sequence item, the next
+           * seqeunce item to execute when this one is done.  The
+           * Start Sound sequence item has three specialized next
+           * sequence items, and so does not use this general one.  */
+          sequence_item_data->next =
+            arena_intern (element_text (stream), stream->app);
+          break;
+
+        case element_time_to_wait:
+          /* In the Wait sequence item, the length of time to wait,
+           * in nanoseconds.  */
+          if (element_integer (stream, &long_data))
+            sequence_item_data->time_to_wait = long_data;
+          break;
+
+        case element_next_to_start:
+          /* In the Offer Sound sequence item, the sequence item
+           * that is to be executed when the sound effects operator
+           * presses the Start button on the specified cluster.
+           * The sequence item can also be started remotely.  
+           * This sequence item, like Start Sound, can be used
+           * to fork the sequencer.  */
+          sequence_item_data->next_to_start =
+            arena_intern (element_text (stream), stream->app);
+          break;
+
+        case element_MIDI_program_number:
+          /* In the Offer Sound sequence item, the MIDI program number
+           * of the MIDI Note On message that will trigger the
+           * specified sequence item.  */
+          if (element_integer (stream, &long_data))
+            sequence_item_data->MIDI_program_number = long_data;
+          break;
+
+        case element_MIDI_note_number:
+          /* In the Offer Sound sequence item, the MIDI note number
+           * of the MIDI Note On message that will trigger the
+           * specified sequence item.  */
+          if (element_integer (stream, &long_data))
+            {
+              sequence_item_data->MIDI_note_number = long_data;
+              sequence_item_data->MIDI_note_number_specified = TRUE;
+            }
+          break;
+
+        case element_OSC_name:
+          /* In the Offer Sound sequence item, the Open Show Control
+           * (OSC) name used to trigger the specified sequence item
+           * remotely.  */
+          sequence_item_data->OSC_name =
+            arena_intern (element_text (stream), stream->app);
+          break;
+
+        case element_macro_number:
+          /* In the Offer Sound sequence item, the macro number used
+           * by the Fire command of MIDI Show Control to trigger
+           * the specified sequence item remotely.  */
+          if (element_integer (stream, &long_data))
+            sequence_item_data->macro_number = long_data;
+          break;
+
+        case element_function_key:
+          /* In the Offer Sound and Operator Wait sequence items, 
+           * the function key used to trigger the specified sequence 
+           * item remotely.  */
+          sequence_item_data->function_key =
+            arena_intern (element_text (stream), stream->app);
+          break;
+
+        case element_next_play:
+          /* In the Operator Wait sequence item, the sequence item
+           * to execute when the operator presses the Play button.  */
+          sequence_item_data->next_play =
+            arena_intern (element_text (stream), stream->app);
+          break;
+
+        case element_omit_from_display:
+          /* In the Operator Wait sequence item, do not display this
+           * item to the operator.  */
+          if (g_strcmp0 (element_text (stream), "True") == 0)
+            sequence_item_data->omit_from_display = TRUE;
+          break;
+
+        default:
+          /* Ignore fields we don't recognize, so we can read future
+           * XML files. */
+          break;
         }
+    }
+
+  /* If the file ended in the middle of the sequence item, 
+   * discard it.  Its record and strings stay in the arena until the show
+   * is released.  */
+  if (stream->failed)
+    return;
+
+  /* Append this sequence item to the sequence.  */
+  sequence_append_item (sequence_item_data, stream->app);
+
+  return;
+}
+
+/* Read the sound_sequence section of a sequence, equipment or project 
+ * file, looking for the individual sequence items.  */
+static void
+parse_sequence_info (struct xml_stream *stream)
+{
+  gint depth;
 
-      if (xmlStrEqual (name, (const xmlChar *) "sound_sequence"))
+  /* Each child should be a "version" or "sequence_item" section. */
+  depth = xmlTextReaderDepth (stream->reader);
+  while (next_child (stream, depth))
+    {
+      switch (element_code (stream))
         {
-          /* This is the "sound_sequence" section within "program".  
-           * It will have a reference to a sound sequence XML file,
-           * content or both.  First process the referenced file. */
-          xmlFree (prop_name);
-          prop_name = xmlGetProp (program_loc, (const xmlChar *) "href");
-          if (prop_name != NULL)
-            {
-              /* We have a file reference.  */
-              g_free (file_name);
-              file_name = g_strdup ((gchar *) prop_name);
-              xmlFree (prop_name);
-              prop_name = NULL;
-
-              /* If the file name does not have an absolute path,
-               * prepend the path of the equipment or project file.
-               * This allows equipment and project files to be 
-               * copied along with the files they reference. */
-              if (g_path_is_absolute (file_name))
-                {
-                  g_free (absolute_file_name);
-                  absolute_file_name = g_strdup (file_name);
-                }
-              else
-                {
-                  g_free (file_dirname);
-                  file_dirname = g_path_get_dirname (equipment_file_name);
-                  absolute_file_name =
-                    g_build_filename (file_dirname, file_name, NULL);
-                  g_free (file_dirname);
-                  file_dirname = NULL;
-                }
-              g_free (file_name);
-              file_name = NULL;
-
-              /* Read the specified file as an XML file. */
-              xmlLineNumbersDefault (1);
-              xmlThrDefIndentTreeOutput (1);
-              xmlKeepBlanksDefault (0);
-              xmlThrDefTreeIndentString ("    ");
-              sequence_file = xmlParseFile (absolute_file_name);
-              if (sequence_file == NULL)
-                {
-                  g_printerr ("Load of sound sequence file %s failed.\n",
-                              absolute_file_name);
-                  g_free (absolute_file_name);
-                  absolute_file_name = NULL;
-                  return;
-                }
+        case element_version:
+          if (!version_is_valid (stream, (gchar *) "sequence"))
+            return;
+          break;
 
-              /* Make sure the sound sequence file is valid, then extract
-               * data from it. */
-              sequence_loc = xmlDocGetRootElement (sequence_file);
-              if (sequence_loc == NULL)
-                {
-                  g_printerr ("Empty sound sequence file: %s.\n",
-                              absolute_file_name);
-                  g_free (absolute_file_name);
-                  absolute_file_name = NULL;
-                  xmlFree (sequence_file);
-                  return;
-                }
-              root_name = sequence_loc->name;
-              if (!xmlStrEqual (root_name, (const xmlChar *) "show_control"))
-                {
-                  g_printerr ("Not a show_control file: %s; is %s.\n",
-                              absolute_file_name, root_name);
-                  xmlFree (sequence_file);
-                  g_free (absolute_file_name);
-                  absolute_file_name = NULL;
-                  return;
-                }
-              /* Within the top-level show_control structure
-               * should be a sound sequence structure.  If there isn't,
-               * this isn't a sound sequence file and must be rejected.  */
-              sequence_loc = sequence_loc->xmlChildrenNode;
-              sequence_name = NULL;
-              sequence_section_parsed = FALSE;
-              while (sequence_loc != NULL)
-                {
-                  sequence_name = sequence_loc->name;
-                  if (xmlStrEqual
-                      (sequence_name, (const xmlChar *) "sound_sequence"))
-                    {
-                      parse_sequence_info (sequence_file, absolute_file_name,
-                                           sequence_loc->xmlChildrenNode,
-                                           app);
-                      sequence_section_parsed = TRUE;
-                    }
-                  sequence_loc = sequence_loc->next;
-                }
-              if (!sequence_section_parsed)
-                {
-                  g_printerr ("Not a sound sequence file: %s; is %s.\n",
-                              absolute_file_name, sequence_name);
-                }
-              xmlFree (sequence_file);
-            }
-          /* Now process the content of the sound sequence section. */
-          parse_sequence_info (equipment_file, equipment_file_name,
-                               program_loc->xmlChildrenNode, app);
-          g_free (absolute_file_name);
-          absolute_file_name = NULL;
-        }
+        case element_sequence_item:
+          parse_sequence_item (stream);
+          break;
 
-      program_loc = program_loc->next;
+        default:
+          break;
+        }
     }
+
+  return;
 }
 
-/* Dig through an equipment xml file, or the equipment section of a project
- * xml file, looking for the sound effect player's sounds and network port.  
- * When we find the network port, tell the network module about it. 
- * When we find sounds, parse the description.  */
+/* Read the sound_effects program section of an equipment file 
+ * to find the network port, the trace file, and the sound and sequence
+ * information.  */
 static void
-parse_equipment_info (xmlDocPtr equipment_file, gchar * equipment_file_name,
-                      xmlNodePtr equipment_loc, GApplication * app)
+parse_program_info (struct xml_stream *stream)
 {
-  xmlChar *key;
-  const xmlChar *name;
-  xmlNodePtr program_loc;
-  xmlChar *program_id;
-
-  /* We start at the children of an "equipment" section. */
-  /* We are looking for version and program sections. */
+  gint64 port_number;
+  const gchar *text;
+  gchar *full_name;
+  gint depth;
 
-  while (equipment_loc != NULL)
+  depth = xmlTextReaderDepth (stream->reader);
+  while (next_child (stream, depth))
     {
-      name = equipment_loc->name;
-      if (xmlStrEqual (name, (const xmlChar *) "version"))
+      switch (element_code (stream))
         {
-          /* This is the "version" section within "equipment". */
-          key =
-            xmlNodeListGetString (equipment_file,
-                                  equipment_loc->xmlChildrenNode, 1);
-          if ((!g_str_has_prefix ((gchar *) key, (gchar *) "1.")))
-            {
-              g_printerr ("Version number of equipment is %s, "
-                          "should start with 1.\n", key);
-              return;
-            }
-          xmlFree (key);
+        case element_port:
+          /* Tell the network module the new port number. */
+          if (element_integer (stream, &port_number))
+            network_set_port (port_number, stream->app);
+          break;
+
+        case element_trace_file:
+          /* Trace the pipeline into this file.  Like a wave file name,
+           * a relative name is relative to the file that gives it.  */
+          text = element_text (stream);
+          if (text == NULL)
+            break;
+          full_name = resolve_file_name (text, stream->file_name);
+          tracer_set_file_name (full_name, stream->app);
+          g_free (full_name);
+          break;
+
+        case element_sounds:
+          /* The sounds section will have a reference to a sounds XML 
+           * file, content or both.  First process the referenced file,
+           * then the content.  */
+          parse_referenced_file (stream, element_sounds);
+          parse_sounds_info (stream);
+          break;
+
+        case element_sound_sequence:
+          /* Likewise the sound sequence section.  */
+          parse_referenced_file (stream, element_sound_sequence);
+          parse_sequence_info (stream);
+          break;
+
+        default:
+          break;
         }
-      if (xmlStrEqual (name, (const xmlChar *) "program"))
+    }
+
+  return;
+}
+
+/* Read an equipment file, or the equipment section of a project
+ * file, looking for the sound effect player's program section.  */
+static void
+parse_equipment_info (struct xml_stream *stream)
+{
+  xmlChar *program_id;
+  gint depth;
+
+  depth = xmlTextReaderDepth (stream->reader);
+  while (next_child (stream, depth))
+    {
+      switch (element_code (stream))
         {
+        case element_version:
+          if (!version_is_valid (stream, (gchar *) "equipment"))
+            return;
+          break;
+
+        case element_program:
           /* This is a "program" section.  We only care about the sound
            * effects program. */
-          program_id = xmlGetProp (equipment_loc, (const xmlChar *) "id");
+          program_id =
+            xmlTextReaderGetAttribute (stream->reader,
+                                       (const xmlChar *) "id");
           if (xmlStrEqual (program_id, (const xmlChar *) "sound_effects"))
-            {
-              /* This is the section of the XML file that contains information
-               * about the sound effects program.  */
-              program_loc = equipment_loc->xmlChildrenNode;
-              parse_program_info (equipment_file, equipment_file_name,
-                                  program_loc, app);
-            }
+            parse_program_info (stream);
           xmlFree (program_id);
+          break;
+
+        default:
+          break;
         }
-      equipment_loc = equipment_loc->next;
     }
 
   return;
 }
 
-/* Dig through the project xml file looking for the equipment references.  
- * Parse each one, since the information we are looking for might be scattered 
- * among them.  */
+/* Read the project section of the project file, looking for the 
+ * equipment references.  Parse each one, since the information we are 
+ * looking for might be scattered among them.  */
 static void
-parse_project_info (xmlDocPtr project_file, gchar * project_file_name,
-                    xmlNodePtr current_loc, GApplication * app)
+parse_project_info (struct xml_stream *stream)
 {
-  xmlChar *key;
-  const xmlChar *name;
-  xmlChar *prop_name;
-  gchar *file_name;
-  gchar *file_dirname;
-  gchar *absolute_file_name;
-  xmlNodePtr equipment_loc;
-  xmlDocPtr equipment_file;
   gboolean found_equipment_section;
-  const xmlChar *root_name;
-  const xmlChar *equipment_name;
-  gboolean equipment_section_parsed;
+  gint depth;
 
-  /* We start at the children of the "project" section.  
-   * Important child sections for our purposes are "version" and "equipment".  
-   */
   found_equipment_section = FALSE;
-  file_name = NULL;
-  file_dirname = NULL;
-  absolute_file_name = NULL;
-  prop_name = NULL;
-
-  while (current_loc != NULL)
+  depth = xmlTextReaderDepth (stream->reader);
+  while (next_child (stream, depth))
     {
-      name = current_loc->name;
-      if (xmlStrEqual (name, (const xmlChar *) "version"))
-        {
-          /* This is the "version" section within "project".  We can only
-           * interpret version 1 of the project section, so reject all other
-           * versions.  The value after the decimal point doesn't matter,
-           * since 1.1, for example, will be a compatible extension of 1.0.  */
-          key =
-            xmlNodeListGetString (project_file, current_loc->xmlChildrenNode,
-                                  1);
-          if ((!g_str_has_prefix ((gchar *) key, (gchar *) "1.")))
-            {
-              g_printerr ("Version number of project is %s, "
-                          "should start with 1.\n", key);
-              return;
-            }
-          xmlFree (key);
-        }
-      if (xmlStrEqual (name, (const xmlChar *) "equipment"))
+      switch (element_code (stream))
         {
-          /* This is an "equipment" section within "project". 
-             It will have a reference to an equipment XML file,
-             content, or both.  First process the referenced file.  */
+        case element_version:
+          if (!version_is_valid (stream, (gchar *) "project"))
+            return;
+          break;
+
+        case element_equipment:
+          /* The equipment section will have a reference to an equipment 
+           * XML file, content, or both.  First process the referenced 
+           * file, then the content.  */
           found_equipment_section = TRUE;
-          xmlFree (prop_name);
-          prop_name = xmlGetProp (current_loc, (const xmlChar *) "href");
-          if (prop_name != NULL)
-            {
-              g_free (file_name);
-              file_name = g_strdup ((gchar *) prop_name);
-              xmlFree (prop_name);
-              prop_name = NULL;
-
-              /* If the file name specified does not have an absolute path,
-               * prepend the path to the project file.  This allows project 
-               * files to be copied along with the files they reference.  */
-              if (g_path_is_absolute (file_name))
-                {
-                  g_free (absolute_file_name);
-                  absolute_file_name = g_strdup (file_name);
-                }
-              else
-                {
-                  g_free (file_dirname);
-                  file_dirname = g_path_get_dirname (project_file_name);
-                  absolute_file_name =
-                    g_build_filename (file_dirname, file_name, NULL);
-                  g_free (file_dirname);
-                  file_dirname = NULL;
-                }
-              g_free (file_name);
-              file_name = NULL;
-
-              /* Read the specified file as an XML file. */
-              xmlLineNumbersDefault (1);
-              xmlThrDefIndentTreeOutput (1);
-              xmlKeepBlanksDefault (0);
-              xmlThrDefTreeIndentString ("    ");
-              equipment_file = xmlParseFile (absolute_file_name);
-              if (equipment_file == NULL)
-                {
-                  g_printerr ("Load of equipment file %s failed.\n",
-                              absolute_file_name);
-                  g_free (absolute_file_name);
-                  absolute_file_name = NULL;
-                  return;
-                }
-
-              /* Make sure the equipment file is valid, then extract data from 
-               * it.  */
-              equipment_loc = xmlDocGetRootElement (equipment_file);
-              if (equipment_loc == NULL)
-                {
-                  g_printerr ("Empty equipment file: %s.\n",
-                              absolute_file_name);
-                  xmlFree (equipment_file);
-                  g_free (absolute_file_name);
-                  absolute_file_name = NULL;
-                  return;
-                }
-              root_name = equipment_loc->name;
-              if (!xmlStrEqual (root_name, (const xmlChar *) "show_control"))
-                {
-                  g_printerr ("Not a show_control file: %s; is %s.\n",
-                              absolute_file_name, root_name);
-                  xmlFree (equipment_file);
-                  g_free (absolute_file_name);
-                  absolute_file_name = NULL;
-                  return;
-                }
-
-              /* Within the top-level show_control structure should be an 
-               * equipment structure.  If there isn't, this isn't an equipment 
-               * file and must be rejected. */
-              equipment_loc = equipment_loc->xmlChildrenNode;
-              equipment_name = NULL;
-              equipment_section_parsed = FALSE;
-              while (equipment_loc != NULL)
-                {
-                  equipment_name = equipment_loc->name;
-                  if (xmlStrEqual
-                      (equipment_name, (const xmlChar *) "equipment"))
-                    {
-                      parse_equipment_info (equipment_file,
-                                            absolute_file_name,
-                                            equipment_loc->xmlChildrenNode,
-                                            app);
-                      equipment_section_parsed = TRUE;
-                    }
-                  equipment_loc = equipment_loc->next;
-                }
-              if (!equipment_section_parsed)
-                {
-                  g_printerr ("Not an equipment file: %s; is %s.\n",
-                              absolute_file_name, equipment_name);
-                }
-              xmlFree (equipment_file);
-            }
+          parse_referenced_file (stream, element_equipment);
+          parse_equipment_info (stream);
+          break;
 
-          /* Now process the content of the equipment section. */
-          parse_equipment_info (project_file, project_file_name,
-                                current_loc->xmlChildrenNode, app);
-          g_free (absolute_file_name);
-          absolute_file_name = NULL;
+        default:
+          break;
         }
-      current_loc = current_loc->next;
     }
+
   if (!found_equipment_section)
     {
       g_printerr ("No equipment section in project file: %s.\n",
-                  absolute_file_name);
+                  stream->file_name);
     }
-  g_free (absolute_file_name);
-  absolute_file_name = NULL;
 
   return;
 }
 
-/* Open a project file and read its contents.  The file is assumed to be in 
- * XML format. */
-void
-parse_xml_read_project_file (gchar * project_file_name, GApplication * app)
+/* Read an XML file whose show_control section should contain the 
+ * specified section: project, equipment, sounds or sound_sequence.  
+ * Return FALSE if the file could not be read.  */
+static gboolean
+parse_file (gchar * file_name, enum element_codes section_code,
+            GApplication * app)
 {
-  xmlDocPtr project_file;
-  xmlNodePtr current_loc;
-  const xmlChar *name;
-  gboolean project_section_parsed;
-
-  /* Read the file as an XML file. */
-  xmlLineNumbersDefault (1);
-  xmlThrDefIndentTreeOutput (1);
-  xmlKeepBlanksDefault (0);
-  xmlThrDefTreeIndentString ("    ");
-  project_file = xmlParseFile (project_file_name);
-  if (project_file == NULL)
+  struct xml_stream stream;
+  const gchar *file_kind;
+  const gchar *section_name;
+  gboolean section_parsed;
+  gboolean file_read;
+
+  switch (section_code)
     {
-      g_printerr ("Load of project file %s failed.\n", project_file_name);
-      g_free (project_file_name);
-      project_file_name = NULL;
-      return;
+    case element_project:
+      file_kind = "project";
+      break;
+    case element_equipment:
+      file_kind = "equipment";
+      break;
+    case element_sounds:
+      file_kind = "sound";
+      break;
+    default:
+      file_kind = "sound sequence";
+      break;
     }
 
-  /* Remember the file name. */
-  sep_set_project_filename (project_file_name, app);
+  stream.file_name = file_name;
+  stream.failed = FALSE;
+  stream.app = app;
+  stream.reader =
+    xmlReaderForFile (file_name, NULL, XML_PARSE_NOBLANKS);
+  if (stream.reader == NULL)
+    {
+      g_printerr ("Load of %s file %s failed.\n", file_kind, file_name);
+      return FALSE;
+    }
+  stream.text = g_string_new (NULL);
 
-  /* Remember the data from the XML file, in case we want to refer to it
-   * later. */
-  sep_set_project_file (project_file, app);
+  /* A compiled image of the show is out of date if this file 
+   * changes.  */
+  show_image_note_source (file_name, app);
 
-  /* Make sure the project file is valid, then extract data from it. */
-  current_loc = xmlDocGetRootElement (project_file);
-  if (current_loc == NULL)
+  /* Make sure the file is valid, then extract data from it.  */
+  file_read = FALSE;
+  while (xmlTextReaderRead (stream.reader) == 1)
     {
-      g_printerr ("Empty project file.\n");
-      return;
+      if (xmlTextReaderNodeType (stream.reader) == XML_READER_TYPE_ELEMENT)
+        {
+          file_read = TRUE;
+          break;
+        }
     }
-  name = current_loc->name;
-  if (!xmlStrEqual (name, (const xmlChar *) "show_control"))
+  if (!file_read)
     {
-      g_printerr ("Not a show_control file: %s.\n", current_loc->name);
-      return;
+      g_printerr ("Empty %s file: %s.\n", file_kind, file_name);
     }
-
-  /* Within the top-level show_control section should be a project
-   * section.  If there isn't, this isn't a project file and must
-   * be rejected.  If there is, process it.  */
-  current_loc = current_loc->xmlChildrenNode;
-  name = NULL;
-  project_section_parsed = FALSE;
-  while (current_loc != NULL)
+  else if (element_code (&stream) != element_show_control)
     {
-      name = current_loc->name;
-      if (xmlStrEqual (name, (const xmlChar *) "project"))
+      g_printerr ("Not a show_control file: %s; is %s.\n", file_name,
+                  xmlTextReaderConstLocalName (stream.reader));
+    }
+  else
+    {
+      /* Within the top-level show_control section should be the
+       * section we are looking for.  If there isn't, the file
+       * must be rejected.  */
+      section_parsed = FALSE;
+      section_name = NULL;
+      while (next_child (&stream, 0))
         {
-          parse_project_info (project_file, project_file_name,
-                              current_loc->xmlChildrenNode, app);
-          project_section_parsed = TRUE;
+          section_name =
+            (const gchar *) xmlTextReaderConstLocalName (stream.reader);
+          if (element_code (&stream) != section_code)
+            continue;
+          switch (section_code)
+            {
+            case element_project:
+              parse_project_info (&stream);
+              break;
+            case element_equipment:
+              parse_equipment_info (&stream);
+              break;
+            case element_sounds:
+              parse_sounds_info (&stream);
+              break;
+            default:
+              parse_sequence_info (&stream);
+              break;
+            }
+          section_parsed = TRUE;
+        }
+      if (!section_parsed)
+        {
+          g_printerr ("Not a %s file: %s; is %s.\n", file_kind, file_name,
+                      section_name);
         }
-      current_loc = current_loc->next;
     }
-  if (!project_section_parsed)
+
+  /* A syntax error ends the reading early.  Report it, but keep
+   * what was read before it.  */
+  if (stream.failed)
     {
-      g_printerr ("Not a project file: %s.\n", name);
+      g_printerr ("Load of %s file %s failed.\n", file_kind, file_name);
+      file_read = FALSE;
     }
 
-  return;
+  xmlFreeTextReader (stream.reader);
+  g_string_free (stream.text, TRUE);
+
+  return file_read;
+}
+
+/* Open a project file and read its contents.  The file is assumed to be in 
+ * XML format.  Return FALSE if it could not be read.  */
+gboolean
+parse_xml_read_project_file (gchar * project_file_name, GApplication * app)
+{
+  /* The document of the previous project is no longer needed.
+   * If the project is written, its file is read again.  */
+  sep_set_project_file (NULL, app);
+  show_image_forget_sources (app);
+
+  /* If the show has been compiled, and none of its files has changed
+   * since, load it from the image instead of from the XML files.  */
+  if (!main_get_compile () && show_image_read (project_file_name, app))
+    {
+      sep_set_project_filename (project_file_name, app);
+      return TRUE;
+    }
+
+  if (!parse_file (project_file_name, element_project, app))
+    {
+      g_free (project_file_name);
+      project_file_name = NULL;
+      return FALSE;
+    }
+
+  /* Remember the file name. */
+  sep_set_project_filename (project_file_name, app);
+
+  return TRUE;
 }
 
 /* Write the project information to an XML file. */
@@ -1670,6 +1578,18 @@ parse_xml_write_project_file (gchar * project_file_name, GApplication * app)
 
   /* Write the project data as an XML file. */
   project_file = sep_get_project_file (app);
+  if ((project_file == NULL) && (sep_get_project_filename (app) != NULL))
+    {
+      /* The project file was read by the streaming parser, which does
+       * not keep the document, so read it again to update it.  */
+      xmlLineNumbersDefault (1);
+      xmlThrDefIndentTreeOutput (1);
+      xmlKeepBlanksDefault (0);
+      xmlThrDefTreeIndentString ("    ");
+      project_file = xmlParseFile (sep_get_project_filename (app));
+      if (project_file != NULL)
+        sep_set_project_file (project_file, app);
+    }
   if (project_file == NULL)
     {
       /* We don't have a project file--create one. */
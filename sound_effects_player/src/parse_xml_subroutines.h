@@ -20,7 +20,7 @@
 #include <gtk/gtk.h>
 /* Subroutines defined in parse_xml_subroutines.c */
 
-void
+gboolean
 parse_xml_read_project_file (gchar *project_file_name, GApplication *app);
 
 void
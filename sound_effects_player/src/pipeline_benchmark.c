@@ -0,0 +1,368 @@
+/*
+ * pipeline_benchmark.c
+ *
+ * Copyright © 2016 by John Sauter <John_Sauter@systemeyescomputerstore.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+
+/* Measure the throughput of the sound engine: the looper pushing a
+ * looped sound, the envelope shaping sound of each sample format
+ * and channel count it supports, the panner spreading a sound over
+ * many channels, and the adder mixing many voices.
+ * Each pipeline runs as fast as it can, not in real time, into a
+ * fake sink.  The looper, envelope and panner plugins are found through
+ * GST_PLUGIN_PATH; "make check" points it at the ones just built.
+ * Run it with "make pipeline_benchmark && ./pipeline_benchmark".
+ * Besides the text for a person, each result is printed on a line
+ * starting with "benchmark:" followed by its name, its value, and
+ * whether higher or lower is better, for benchmark_check.sh.  */
+
+/* The synthetic sounds are sampled at this rate.  */
+#define BENCHMARK_RATE 48000
+
+/* The length of the WAV file the looper plays, and its loop.  */
+#define LOOPER_FILE_SECONDS 10
+#define LOOPER_LOOP_FROM (9 * GST_SECOND)
+#define LOOPER_LOOP_TO (1 * GST_SECOND)
+#define LOOPER_LOOP_LIMIT 20
+
+/* The envelope and mixer are fed this much sound, in buffers.  */
+#define SAMPLES_PER_BUFFER 1024
+#define ENVELOPE_BUFFER_COUNT 20000
+#define MIX_BUFFER_COUNT 2000
+
+/* Write a WAV file holding a stereo 440 Hz tone as 16-bit samples.  */
+static gboolean
+write_wav_file (gchar * file_name, gint seconds)
+{
+  FILE *wav_file;
+  guint32 data_size, value_32;
+  guint16 value_16;
+  gint16 sample;
+  gint frame, frame_count;
+
+  wav_file = fopen (file_name, "wb");
+  if (wav_file == NULL)
+    return FALSE;
+  frame_count = seconds * BENCHMARK_RATE;
+  data_size = frame_count * 2 * sizeof (gint16);
+
+#define PUT_32(v) value_32 = GUINT32_TO_LE (v); \
+  fwrite (&value_32, sizeof (value_32), 1, wav_file)
+#define PUT_16(v) value_16 = GUINT16_TO_LE (v); \
+  fwrite (&value_16, sizeof (value_16), 1, wav_file)
+
+  fwrite ("RIFF", 4, 1, wav_file);
+  PUT_32 (36 + data_size);
+  fwrite ("WAVEfmt ", 8, 1, wav_file);
+  PUT_32 (16);
+  PUT_16 (1);                   /* PCM */
+  PUT_16 (2);                   /* channels */
+  PUT_32 (BENCHMARK_RATE);
+  PUT_32 (BENCHMARK_RATE * 2 * sizeof (gint16));
+  PUT_16 (2 * sizeof (gint16));
+  PUT_16 (16);
+  fwrite ("data", 4, 1, wav_file);
+  PUT_32 (data_size);
+  for (frame = 0; frame < frame_count; frame++)
+    {
+      sample =
+        GINT16_TO_LE ((gint16)
+                      (16000.0 *
+                       sin (2.0 * G_PI * 440.0 * frame / BENCHMARK_RATE)));
+      fwrite (&sample, sizeof (sample), 1, wav_file);
+      fwrite (&sample, sizeof (sample), 1, wav_file);
+    }
+
+#undef PUT_32
+#undef PUT_16
+
+  fclose (wav_file);
+  return TRUE;
+}
+
+/* Run a pipeline until it ends, returning the time it took in seconds,
+ * or a negative number if it failed.  If element_name is not NULL,
+ * that element is returned in *element, with a reference, so its
+ * properties can be examined afterwards.  */
+static gdouble
+run_pipeline (gchar * description, gchar * element_name,
+              GstElement ** element)
+{
+  GstElement *pipeline;
+  GstBus *bus;
+  GstMessage *message;
+  GError *error = NULL;
+  gint64 start_time, end_time;
+  gboolean failed;
+
+  pipeline = gst_parse_launch (description, &error);
+  if (pipeline == NULL)
+    {
+      g_printerr ("Cannot build pipeline \"%s\": %s.\n", description,
+                  error->message);
+      g_error_free (error);
+      return -1.0;
+    }
+  if (error != NULL)
+    g_error_free (error);
+
+  bus = gst_element_get_bus (pipeline);
+  start_time = g_get_monotonic_time ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  message =
+    gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+                                GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  end_time = g_get_monotonic_time ();
+
+  failed = (GST_MESSAGE_TYPE (message) == GST_MESSAGE_ERROR);
+  if (failed)
+    {
+      gst_message_parse_error (message, &error, NULL);
+      g_printerr ("Pipeline \"%s\" failed: %s.\n", description,
+                  error->message);
+      g_error_free (error);
+    }
+  gst_message_unref (message);
+  gst_object_unref (bus);
+
+  if (element_name != NULL)
+    *element = gst_bin_get_by_name (GST_BIN (pipeline), element_name);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  if (failed)
+    return -1.0;
+  return (gdouble) (end_time - start_time) / G_USEC_PER_SEC;
+}
+
+/* Measure how fast the looper can push a looped sound.  */
+static gboolean
+benchmark_looper (gchar * directory_name)
+{
+  gchar *file_name, *description;
+  GstElement *looper_element = NULL;
+  gint64 elapsed_time;
+  gdouble seconds, frames;
+
+  file_name = g_build_filename (directory_name, "looper.wav", NULL);
+  if (!write_wav_file (file_name, LOOPER_FILE_SECONDS))
+    {
+      g_printerr ("Cannot write %s.\n", file_name);
+      g_free (file_name);
+      return FALSE;
+    }
+  description =
+    g_strdup_printf ("filesrc location=\"%s\" ! wavparse ! "
+                     "looper name=looper autostart=TRUE "
+                     "file-location=\"%s\" loop-from=%" G_GUINT64_FORMAT
+                     " loop-to=%" G_GUINT64_FORMAT " loop-limit=%d ! "
+                     "fakesink sync=FALSE", file_name, file_name,
+                     (guint64) LOOPER_LOOP_FROM, (guint64) LOOPER_LOOP_TO,
+                     LOOPER_LOOP_LIMIT);
+  seconds = run_pipeline (description, (gchar *) "looper", &looper_element);
+  g_free (description);
+  g_remove (file_name);
+  g_free (file_name);
+  if ((seconds < 0.0) || (looper_element == NULL))
+    return FALSE;
+
+  /* The looper counts the sound it has sent.  */
+  g_object_get (looper_element, "elapsed", &elapsed_time, NULL);
+  gst_object_unref (looper_element);
+  frames = (gdouble) elapsed_time * BENCHMARK_RATE / GST_SECOND;
+  g_print ("The looper pushed %.0f frames in %.3f seconds: "
+           "%.0f frames per second.\n", frames, seconds, frames / seconds);
+  g_print ("benchmark: looper_push_frames_per_second %.0f higher\n",
+           frames / seconds);
+  return TRUE;
+}
+
+/* Measure how fast the envelope can shape sound of a format and
+ * channel count.  */
+static gboolean
+benchmark_envelope (const gchar * format, gint channel_count)
+{
+  gchar *description;
+  gdouble seconds, frames;
+
+  description =
+    g_strdup_printf ("audiotestsrc wave=sine num-buffers=%d "
+                     "samplesperbuffer=%d ! audio/x-raw,format=%s,"
+                     "rate=%d,channels=%d,layout=interleaved ! "
+                     "envelope autostart=TRUE "
+                     "attack-duration-time=500000000 "
+                     "decay-duration-time=200000000 sustain-level=0.8 ! "
+                     "fakesink sync=FALSE", ENVELOPE_BUFFER_COUNT,
+                     SAMPLES_PER_BUFFER, format, BENCHMARK_RATE,
+                     channel_count);
+  seconds = run_pipeline (description, NULL, NULL);
+  g_free (description);
+  if (seconds < 0.0)
+    return FALSE;
+
+  frames = (gdouble) ENVELOPE_BUFFER_COUNT * SAMPLES_PER_BUFFER;
+  g_print ("The envelope shaped %.0f %s frames of %d channels in "
+           "%.3f seconds: %.0f frames per second.\n", frames, format,
+           channel_count, seconds, frames / seconds);
+  g_print ("benchmark: envelope_%s_%dch_frames_per_second %.0f higher\n",
+           format, channel_count, frames / seconds);
+  return TRUE;
+}
+
+/* Measure how fast the panner can spread a stereo sound over a number
+ * of channels.  Every channel gets a different gain from each input
+ * channel, as a sound placed among several speakers would.  */
+static gboolean
+benchmark_panner (gint channel_count)
+{
+  GString *description;
+  gdouble seconds, frames;
+  gint channel;
+
+  description = g_string_new (NULL);
+  g_string_printf (description,
+                   "audiotestsrc wave=sine num-buffers=%d "
+                   "samplesperbuffer=%d ! audio/x-raw,"
+                   "format=F32LE,rate=%d,channels=2,"
+                   "layout=interleaved ! panner panorama=0.25 "
+                   "mix-matrix=\"<", ENVELOPE_BUFFER_COUNT,
+                   SAMPLES_PER_BUFFER, BENCHMARK_RATE);
+  for (channel = 0; channel < channel_count; channel++)
+    {
+      g_string_append_printf (description,
+                              "%s<(float)%.3f, (float)%.3f>",
+                              (channel == 0) ? "" : ", ",
+                              1.0 / (channel + 1), 0.5 / (channel + 1));
+    }
+  g_string_append_printf (description,
+                          ">\" ! audio/x-raw,channels=%d,"
+                          "channel-mask=(bitmask)0x0 ! "
+                          "fakesink sync=FALSE", channel_count);
+  seconds = run_pipeline (description->str, NULL, NULL);
+  g_string_free (description, TRUE);
+  if (seconds < 0.0)
+    return FALSE;
+
+  frames = (gdouble) ENVELOPE_BUFFER_COUNT * SAMPLES_PER_BUFFER;
+  g_print ("The panner spread %.0f frames over %d channels in "
+           "%.3f seconds: %.0f frames per second.\n", frames,
+           channel_count, seconds, frames / seconds);
+  g_print ("benchmark: panner_%dch_frames_per_second %.0f higher\n",
+           channel_count, frames / seconds);
+  return TRUE;
+}
+
+/* Measure the cost of mixing voices, each shaped by an envelope, as
+ * the player mixes its sounds.  The result is how many times faster
+ * than real time the mix ran.  */
+static gboolean
+benchmark_mix (gint voice_count)
+{
+  GString *description;
+  gdouble seconds, sound_seconds;
+  gint voice;
+
+  description = g_string_new ("adder name=mix ! fakesink sync=FALSE");
+  for (voice = 0; voice < voice_count; voice++)
+    {
+      g_string_append_printf (description,
+                              " audiotestsrc wave=sine freq=%d "
+                              "num-buffers=%d samplesperbuffer=%d ! "
+                              "audio/x-raw,format=F64LE,rate=%d,channels=2,"
+                              "layout=interleaved ! "
+                              "envelope autostart=TRUE ! mix.",
+                              220 + (voice * 10), MIX_BUFFER_COUNT,
+                              SAMPLES_PER_BUFFER, BENCHMARK_RATE);
+    }
+  seconds = run_pipeline (description->str, NULL, NULL);
+  g_string_free (description, TRUE);
+  if (seconds < 0.0)
+    return FALSE;
+
+  sound_seconds =
+    (gdouble) MIX_BUFFER_COUNT * SAMPLES_PER_BUFFER / BENCHMARK_RATE;
+  g_print ("Mixing %d voices of %.1f seconds took %.3f seconds: "
+           "%.1f times real time.\n", voice_count, sound_seconds, seconds,
+           sound_seconds / seconds);
+  g_print ("benchmark: mix_%d_voices_times_real_time %.1f higher\n",
+           voice_count, sound_seconds / seconds);
+  return TRUE;
+}
+
+int
+main (int argc, char *argv[])
+{
+  gchar *directory_name;
+  const gchar *formats[2] = { "F32LE", "F64LE" };
+  const gint channel_counts[3] = { 1, 2, 8 };
+  const gint voice_counts[3] = { 1, 8, 32 };
+  const gint panner_channel_counts[4] = { 2, 6, 16, 24 };
+  const gchar *plugin_names[3] = { "looper", "envelope", "panner" };
+  GstElementFactory *factory;
+  GError *error = NULL;
+  gboolean succeeded;
+  gint i, j;
+
+  gst_init (&argc, &argv);
+
+  /* Without our plugins there is nothing to measure.  Exit with the
+   * status that tells "make check" the test was skipped.  */
+  for (i = 0; i < 3; i++)
+    {
+      factory = gst_element_factory_find (plugin_names[i]);
+      if (factory == NULL)
+        {
+          g_printerr ("The %s plugin was not found; set GST_PLUGIN_PATH.\n",
+                      plugin_names[i]);
+          return 77;
+        }
+      gst_object_unref (factory);
+    }
+
+  directory_name = g_dir_make_tmp ("pipeline_benchmark_XXXXXX", &error);
+  if (directory_name == NULL)
+    {
+      g_printerr ("Cannot make a directory for the looper's file: %s.\n",
+                  error->message);
+      g_error_free (error);
+      succeeded = FALSE;
+    }
+  else
+    {
+      succeeded = benchmark_looper (directory_name);
+      g_rmdir (directory_name);
+      g_free (directory_name);
+    }
+
+  for (i = 0; i < 2; i++)
+    for (j = 0; j < 3; j++)
+      succeeded = benchmark_envelope (formats[i], channel_counts[j])
+        && succeeded;
+
+  for (i = 0; i < 4; i++)
+    succeeded = benchmark_panner (panner_channel_counts[i]) && succeeded;
+
+  for (i = 0; i < 3; i++)
+    succeeded = benchmark_mix (voice_counts[i]) && succeeded;
+
+  return succeeded ? 0 : 1;
+}
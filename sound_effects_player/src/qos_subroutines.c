@@ -0,0 +1,619 @@
+/*
+ * qos_subroutines.c
+ *
+ * Copyright © 2016 by John Sauter <John_Sauter@systemeyescomputerstore.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <string.h>
+#include <time.h>
+#include <gtk/gtk.h>
+#include <gst/gst.h>
+#include <gst/base/gstbasesink.h>
+#include "main.h"
+#include "qos_subroutines.h"
+#include "sound_effects_player.h"
+#include "telemetry_subroutines.h"
+#include "trace_ring_subroutines.h"
+
+/* When the machine is overloaded the sound drops out.  These counters
+ * show where, and how close we come, so hardware can be sized from
+ * data rather than from what the audience heard.
+ *
+ * For the master bus we watch the buffers reaching the sound output
+ * device.  A buffer arrives late if the device was due to start playing
+ * it before it arrived: its running time plus the pipeline latency is
+ * already past.  Each run of late buffers is an underrun, which the
+ * audience hears as a dropout.  The margin is how long before that
+ * deadline a buffer arrived; the least margin shows how close we came.
+ *
+ * For each sound effect we watch the buffers leaving its looper and
+ * leaving its bin for the adder.  The looper keeps ahead of the output
+ * by up to the pipeline latency, and falls behind when it cannot get
+ * the processor.  A buffer is late when the sound has fallen further
+ * behind its most-ahead point than the pipeline latency: the adder
+ * waits for every input, so one late sound delays them all.
+ *
+ * Quality-of-service messages, which elements post when they drop
+ * buffers or cannot keep up, are counted for the sound or the master
+ * bus that posted them.
+ *
+ * The processing load is the processor time used per second of sound,
+ * as a percentage of one processor.  For a sound effect it is the time
+ * used by the looper's streaming thread, which runs every element of
+ * the sound's bin, and whichever sound's thread completes a set of
+ * inputs to the adder also runs the mixing.  For the master bus it is
+ * the time used by the whole process.  Each is measured over windows of
+ * one second; we keep the latest, the greatest of the last
+ * QOS_LOAD_WINDOWS, and the greatest ever.
+ *
+ * The streaming threads update the counters without locks.  Each
+ * counter has one writer, and is read with atomic operations.  */
+
+/* The length of a processing load window, and how many are kept for
+ * the rolling maximum.  */
+#define QOS_LOAD_WINDOW GST_SECOND
+#define QOS_LOAD_WINDOWS 10
+
+/* A processing load.  The percentages are in hundredths.  */
+struct qos_load
+{
+  gint64 last_cpu_time;         /* nanoseconds */
+  gboolean have_last_cpu_time;
+  gint64 window_cpu_time;
+  gint64 window_time;
+  gint recent[QOS_LOAD_WINDOWS];
+  gint next_recent;
+
+  /* Published.  */
+  gint current;
+  gint rolling_maximum;
+  gint peak;
+};
+
+/* A place where a sound's buffers are checked for lateness.  */
+struct qos_point
+{
+  GstElement *element;
+  gint64 baseline;              /* most ahead, nanoseconds */
+  gboolean have_baseline;
+
+  /* Published.  */
+  gint late_count;
+  gint minimum_margin;          /* microseconds, or G_MAXINT */
+};
+
+/* The counters for one sound effect.  */
+struct qos_voice
+{
+  struct qos_info *qos_data;
+  gchar *name;
+  struct qos_point looper;
+  struct qos_point adder;
+  struct qos_load load;
+  gint qos_message_count;
+};
+
+/* The counters for the master bus.  */
+struct qos_master
+{
+  GstElement *sink_element;
+  GstSegment segment;
+  gboolean have_segment;
+  gboolean late;                /* The last buffer was late */
+  gint64 last_wall_time;        /* nanoseconds */
+  struct qos_load load;
+
+  /* Published.  */
+  gint underrun_count;
+  gint late_count;
+  gint minimum_margin;          /* microseconds, or G_MAXINT */
+  gint qos_message_count;
+};
+
+/* The persistent data used by the counters.  */
+struct qos_info
+{
+  struct qos_master master;
+  GHashTable *voices;           /* sound name to struct qos_voice */
+
+  /* The pipeline latency in microseconds, from the output device,
+   * published for the sound effects' threads.  */
+  gint latency_budget;
+};
+
+/* Initialize the counters.  */
+void *
+qos_init (GApplication * app)
+{
+  struct qos_info *qos_data;
+
+  /* An offline render runs as fast as it can, so nothing is late.  */
+  if (main_get_render_file_name () != NULL)
+    return NULL;
+
+  qos_data = g_malloc0 (sizeof (struct qos_info));
+  qos_data->master.minimum_margin = G_MAXINT;
+  qos_data->voices = g_hash_table_new (g_str_hash, g_str_equal);
+
+  return (qos_data);
+}
+
+/* Read a processor time clock, in nanoseconds.  */
+static gint64
+cpu_time (clockid_t clock_id)
+{
+  struct timespec now;
+
+  if (clock_gettime (clock_id, &now) != 0)
+    return 0;
+  return ((gint64) now.tv_sec * GST_SECOND) + now.tv_nsec;
+}
+
+/* Account for processor time used over an interval, and publish the
+ * load when a window is complete.  */
+static void
+update_load (struct qos_load *load, gint64 cpu_time_now, gint64 elapsed)
+{
+  gint percent, maximum;
+  gint i;
+
+  if (!load->have_last_cpu_time)
+    {
+      load->last_cpu_time = cpu_time_now;
+      load->have_last_cpu_time = TRUE;
+      return;
+    }
+  load->window_cpu_time =
+    load->window_cpu_time + (cpu_time_now - load->last_cpu_time);
+  load->last_cpu_time = cpu_time_now;
+  load->window_time = load->window_time + elapsed;
+  if (load->window_time < QOS_LOAD_WINDOW)
+    return;
+
+  percent = (load->window_cpu_time * 10000) / load->window_time;
+  load->recent[load->next_recent] = percent;
+  load->next_recent = (load->next_recent + 1) % QOS_LOAD_WINDOWS;
+  maximum = 0;
+  for (i = 0; i < QOS_LOAD_WINDOWS; i++)
+    maximum = MAX (maximum, load->recent[i]);
+
+  g_atomic_int_set (&load->current, percent);
+  g_atomic_int_set (&load->rolling_maximum, maximum);
+  if (percent > g_atomic_int_get (&load->peak))
+    g_atomic_int_set (&load->peak, percent);
+  load->window_cpu_time = 0;
+  load->window_time = 0;
+
+  return;
+}
+
+/* Find the running time of an element's pipeline, or
+ * GST_CLOCK_TIME_NONE if it is not playing.  */
+static GstClockTime
+running_time_now (GstElement * element)
+{
+  GstClock *clock;
+  GstClockTime now;
+
+  if (GST_STATE (element) != GST_STATE_PLAYING)
+    return GST_CLOCK_TIME_NONE;
+  clock = gst_element_get_clock (element);
+  if (clock == NULL)
+    return GST_CLOCK_TIME_NONE;
+  now = gst_clock_get_time (clock) - gst_element_get_base_time (element);
+  gst_object_unref (clock);
+
+  return now;
+}
+
+/* Record a margin, in nanoseconds, and whether it was missed.  */
+static void
+record_margin (gint * minimum_margin, gint * late_count, gint64 margin)
+{
+  gint margin_us;
+
+  margin_us = CLAMP (margin / 1000, -G_MAXINT, G_MAXINT - 1);
+  if (margin_us < g_atomic_int_get (minimum_margin))
+    g_atomic_int_set (minimum_margin, margin_us);
+  if (margin < 0)
+    g_atomic_int_inc (late_count);
+
+  return;
+}
+
+/* Check a sound's buffer for lateness.  */
+static void
+check_point (struct qos_point *point, GstBuffer * buffer,
+             struct qos_info *qos_data)
+{
+  GstClockTime now;
+  gint64 behind;
+  gint latency_budget;
+
+  if (!GST_BUFFER_PTS_IS_VALID (buffer))
+    return;
+  now = running_time_now (point->element);
+  if (now == GST_CLOCK_TIME_NONE)
+    return;
+
+  /* How far behind the sound's own timeline we are; the smaller,
+   * the further ahead.  */
+  behind = (gint64) now - (gint64) GST_BUFFER_PTS (buffer);
+  if (!point->have_baseline || (behind < point->baseline))
+    {
+      point->baseline = behind;
+      point->have_baseline = TRUE;
+    }
+
+  latency_budget = g_atomic_int_get (&qos_data->latency_budget);
+  if (latency_budget <= 0)
+    return;
+  record_margin (&point->minimum_margin, &point->late_count,
+                 ((gint64) latency_budget * 1000) -
+                 (behind - point->baseline));
+
+  return;
+}
+
+/* A buffer is leaving a sound's looper.  */
+static GstPadProbeReturn
+looper_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  struct qos_voice *voice = user_data;
+  GstBuffer *buffer;
+
+  buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+  check_point (&voice->looper, buffer, voice->qos_data);
+  if (GST_BUFFER_DURATION_IS_VALID (buffer))
+    {
+      update_load (&voice->load, cpu_time (CLOCK_THREAD_CPUTIME_ID),
+                   GST_BUFFER_DURATION (buffer));
+    }
+
+  return GST_PAD_PROBE_OK;
+}
+
+/* A buffer is leaving a sound's bin for the adder.  */
+static GstPadProbeReturn
+adder_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  struct qos_voice *voice = user_data;
+
+  check_point (&voice->adder, GST_PAD_PROBE_INFO_BUFFER (info),
+               voice->qos_data);
+
+  return GST_PAD_PROBE_OK;
+}
+
+/* A buffer or event is reaching the sound output device.  */
+static GstPadProbeReturn
+master_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  struct qos_info *qos_data = user_data;
+  struct qos_master *master = &qos_data->master;
+  GstEvent *event;
+  GstBuffer *buffer;
+  GstClockTime now, running_time, latency;
+  gint64 wall_time;
+
+  /* Keep the segment, to find the buffers' running times.  */
+  if ((GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER) == 0)
+    {
+      event = GST_PAD_PROBE_INFO_EVENT (info);
+      if (GST_EVENT_TYPE (event) == GST_EVENT_SEGMENT)
+        {
+          gst_event_copy_segment (event, &master->segment);
+          master->have_segment = TRUE;
+        }
+      return GST_PAD_PROBE_OK;
+    }
+
+  wall_time = g_get_monotonic_time () * 1000;
+  update_load (&master->load, cpu_time (CLOCK_PROCESS_CPUTIME_ID),
+               wall_time - master->last_wall_time);
+  master->last_wall_time = wall_time;
+
+  buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+  if (!master->have_segment || !GST_BUFFER_PTS_IS_VALID (buffer))
+    return GST_PAD_PROBE_OK;
+  now = running_time_now (master->sink_element);
+  if (now == GST_CLOCK_TIME_NONE)
+    return GST_PAD_PROBE_OK;
+  running_time =
+    gst_segment_to_running_time (&master->segment, GST_FORMAT_TIME,
+                                 GST_BUFFER_PTS (buffer));
+  if (running_time == GST_CLOCK_TIME_NONE)
+    return GST_PAD_PROBE_OK;
+
+  /* The device plays the buffer at its running time plus the
+   * latency.  */
+  latency = gst_base_sink_get_latency (GST_BASE_SINK (master->sink_element));
+  g_atomic_int_set (&qos_data->latency_budget, latency / 1000);
+  record_margin (&master->minimum_margin, &master->late_count,
+                 (gint64) (running_time + latency) - (gint64) now);
+  if ((gint64) (running_time + latency) < (gint64) now)
+    {
+      if (!master->late)
+        g_atomic_int_inc (&master->underrun_count);
+      master->late = TRUE;
+    }
+  else
+    master->late = FALSE;
+
+  return GST_PAD_PROBE_OK;
+}
+
+/* Watch the buffers reaching the sound output device.  */
+void
+qos_watch_master (GstElement * sink_element, GApplication * app)
+{
+  struct qos_info *qos_data;
+  GstPad *sink_pad;
+
+  qos_data = sep_get_qos_data (app);
+  if ((qos_data == NULL) || (sink_element == NULL))
+    return;
+
+  qos_data->master.sink_element = sink_element;
+  gst_segment_init (&qos_data->master.segment, GST_FORMAT_TIME);
+  qos_data->master.have_segment = FALSE;
+  qos_data->master.last_wall_time = g_get_monotonic_time () * 1000;
+
+  /* Have the device tell us when it drops a late buffer.  */
+  g_object_set (sink_element, "qos", TRUE, NULL);
+
+  sink_pad = gst_element_get_static_pad (sink_element, "sink");
+  gst_pad_add_probe (sink_pad,
+                     GST_PAD_PROBE_TYPE_BUFFER |
+                     GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM, master_probe,
+                     qos_data, NULL);
+  gst_object_unref (sink_pad);
+
+  return;
+}
+
+/* Start checking a place in a sound's bin.  */
+static void
+watch_point (struct qos_point *point, GstElement * element,
+             GstPadProbeCallback callback, struct qos_voice *voice)
+{
+  GstPad *source_pad;
+
+  point->element = element;
+  point->have_baseline = FALSE;
+  source_pad = gst_element_get_static_pad (element, "src");
+  gst_pad_add_probe (source_pad, GST_PAD_PROBE_TYPE_BUFFER, callback, voice,
+                     NULL);
+  gst_object_unref (source_pad);
+
+  return;
+}
+
+/* Watch the buffers leaving a sound effect's looper, and leaving its
+ * bin for the adder.  If the sound's bin is being created again, after
+ * a reload, its counters continue.  */
+void
+qos_watch_voice (const gchar * sound_name, GstElement * looper_element,
+                 GstElement * last_element, GApplication * app)
+{
+  struct qos_info *qos_data;
+  struct qos_voice *voice;
+
+  qos_data = sep_get_qos_data (app);
+  if (qos_data == NULL)
+    return;
+
+  voice = g_hash_table_lookup (qos_data->voices, sound_name);
+  if (voice == NULL)
+    {
+      voice = g_malloc0 (sizeof (struct qos_voice));
+      voice->qos_data = qos_data;
+      voice->name = g_strdup (sound_name);
+      voice->looper.minimum_margin = G_MAXINT;
+      voice->adder.minimum_margin = G_MAXINT;
+      g_hash_table_insert (qos_data->voices, voice->name, voice);
+    }
+  voice->load.have_last_cpu_time = FALSE;
+  voice->load.window_cpu_time = 0;
+  voice->load.window_time = 0;
+
+  watch_point (&voice->looper, looper_element, looper_probe, voice);
+  watch_point (&voice->adder, last_element, adder_probe, voice);
+
+  return;
+}
+
+/* Count a quality-of-service message from an element.  The elements
+ * of a sound effect are named sound/<sound name>/<element>; anything
+ * else is counted for the master bus.  */
+void
+qos_message (GstMessage * message, GApplication * app)
+{
+  struct qos_info *qos_data;
+  struct qos_voice *voice;
+  const gchar *element_name;
+  const gchar *last_slash;
+  gchar *sound_name;
+  gint64 jitter;
+  gdouble proportion;
+  gint quality;
+
+  qos_data = sep_get_qos_data (app);
+  if (qos_data == NULL)
+    return;
+
+  element_name = GST_OBJECT_NAME (GST_MESSAGE_SRC (message));
+  if (TRACE_RING_ENABLED (trace_messages))
+    {
+      gst_message_parse_qos_values (message, &jitter, &proportion, &quality);
+      trace_ring_record (trace_messages, "QoS from %s, jitter %"
+                         G_GINT64_FORMAT " ns, proportion %f.",
+                         element_name, jitter, proportion);
+    }
+
+  voice = NULL;
+  last_slash = strrchr (element_name, '/');
+  if (g_str_has_prefix (element_name, "sound/")
+      && (last_slash > element_name + strlen ("sound/")))
+    {
+      sound_name =
+        g_strndup (element_name + strlen ("sound/"),
+                   last_slash - (element_name + strlen ("sound/")));
+      voice = g_hash_table_lookup (qos_data->voices, sound_name);
+      g_free (sound_name);
+    }
+
+  if (voice != NULL)
+    voice->qos_message_count = voice->qos_message_count + 1;
+  else
+    g_atomic_int_inc (&qos_data->master.qos_message_count);
+
+  return;
+}
+
+/* Format a margin for printing.  */
+static gchar *
+margin_text (gint *minimum_margin)
+{
+  gint margin;
+
+  margin = g_atomic_int_get (minimum_margin);
+  if (margin == G_MAXINT)
+    return g_strdup ("-");
+  return g_strdup_printf ("%.1f", margin / 1000.0);
+}
+
+/* Sort the sound effects by name.  */
+static gint
+compare_voices (gconstpointer a, gconstpointer b)
+{
+  const struct qos_voice *voice_a = a;
+  const struct qos_voice *voice_b = b;
+
+  return strcmp (voice_a->name, voice_b->name);
+}
+
+/* Send the counters to the remote controllers.  The master bus is a
+ * line of the form
+ *   qos master <underruns> <late buffers> <QoS messages> <least margin>
+ *     <load> <rolling maximum load> <peak load>
+ * and each sound effect a line of the form
+ *   qos sound <late from looper> <late to adder> <QoS messages>
+ *     <least margin> <load> <rolling maximum load> <peak load> <name>
+ * with the margins in milliseconds, or "-" if not yet measured, and the
+ * loads in percent of one processor.  */
+void
+qos_send_statistics (GApplication * app)
+{
+  struct qos_info *qos_data;
+  struct qos_master *master;
+  struct qos_voice *voice;
+  GList *voice_list, *element;
+  gchar *line;
+  gchar *margin;
+
+  qos_data = sep_get_qos_data (app);
+  if (qos_data == NULL)
+    return;
+
+  master = &qos_data->master;
+  margin = margin_text (&master->minimum_margin);
+  line =
+    g_strdup_printf ("qos master %d %d %d %s %.2f %.2f %.2f",
+                     g_atomic_int_get (&master->underrun_count),
+                     g_atomic_int_get (&master->late_count),
+                     g_atomic_int_get (&master->qos_message_count), margin,
+                     g_atomic_int_get (&master->load.current) / 100.0,
+                     g_atomic_int_get (&master->load.rolling_maximum) /
+                     100.0, g_atomic_int_get (&master->load.peak) / 100.0);
+  telemetry_statistics (line, app);
+  g_free (line);
+  g_free (margin);
+
+  voice_list = g_list_sort (g_hash_table_get_values (qos_data->voices),
+                            compare_voices);
+  for (element = voice_list; element != NULL; element = element->next)
+    {
+      voice = element->data;
+      margin = margin_text (&voice->adder.minimum_margin);
+      line =
+        g_strdup_printf ("qos sound %d %d %d %s %.2f %.2f %.2f %s",
+                         g_atomic_int_get (&voice->looper.late_count),
+                         g_atomic_int_get (&voice->adder.late_count),
+                         voice->qos_message_count, margin,
+                         g_atomic_int_get (&voice->load.current) / 100.0,
+                         g_atomic_int_get (&voice->load.rolling_maximum) /
+                         100.0, g_atomic_int_get (&voice->load.peak) / 100.0,
+                         voice->name);
+      telemetry_statistics (line, app);
+      g_free (line);
+      g_free (margin);
+    }
+  g_list_free (voice_list);
+
+  return;
+}
+
+/* Print the counters.  */
+void
+qos_print_statistics (GApplication * app)
+{
+  struct qos_info *qos_data;
+  struct qos_master *master;
+  struct qos_voice *voice;
+  GList *voice_list, *element;
+  gchar *margin;
+
+  qos_data = sep_get_qos_data (app);
+  if (qos_data == NULL)
+    return;
+
+  master = &qos_data->master;
+  margin = margin_text (&master->minimum_margin);
+  g_print ("Master bus: %d underruns, %d late buffers, %d QoS messages, "
+           "least margin %s ms; load %.1f%% of a processor, "
+           "%.1f%% at most over the last %d seconds, %.1f%% at peak.\n",
+           g_atomic_int_get (&master->underrun_count),
+           g_atomic_int_get (&master->late_count),
+           g_atomic_int_get (&master->qos_message_count), margin,
+           g_atomic_int_get (&master->load.current) / 100.0,
+           g_atomic_int_get (&master->load.rolling_maximum) / 100.0,
+           QOS_LOAD_WINDOWS * (gint) (QOS_LOAD_WINDOW / GST_SECOND),
+           g_atomic_int_get (&master->load.peak) / 100.0);
+  g_free (margin);
+
+  voice_list = g_list_sort (g_hash_table_get_values (qos_data->voices),
+                            compare_voices);
+  for (element = voice_list; element != NULL; element = element->next)
+    {
+      voice = element->data;
+      margin = margin_text (&voice->adder.minimum_margin);
+      g_print ("Sound %s: %d late from the looper, %d late to the adder, "
+               "%d QoS messages, least margin %s ms; load %.1f%%, "
+               "%.1f%% at most recently, %.1f%% at peak.\n", voice->name,
+               g_atomic_int_get (&voice->looper.late_count),
+               g_atomic_int_get (&voice->adder.late_count),
+               voice->qos_message_count, margin,
+               g_atomic_int_get (&voice->load.current) / 100.0,
+               g_atomic_int_get (&voice->load.rolling_maximum) / 100.0,
+               g_atomic_int_get (&voice->load.peak) / 100.0);
+      g_free (margin);
+    }
+  g_list_free (voice_list);
+
+  return;
+}
@@ -0,0 +1,46 @@
+/*
+ * qos_subroutines.h
+ *
+ * Copyright © 2016 by John Sauter <John_Sauter@systemeyescomputerstore.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtk/gtk.h>
+#include <gst/gst.h>
+
+/* Subroutines defined in qos_subroutines.c */
+
+/* Initialize the underrun and lateness counters.  Returns NULL when
+ * rendering offline, since then nothing runs in real time.  */
+void *qos_init (GApplication * app);
+
+/* Watch the buffers reaching the sound output device.  */
+void qos_watch_master (GstElement * sink_element, GApplication * app);
+
+/* Watch the buffers leaving a sound effect's looper, and leaving its
+ * bin for the adder.  */
+void qos_watch_voice (const gchar * sound_name, GstElement * looper_element,
+                      GstElement * last_element, GApplication * app);
+
+/* Count a quality-of-service message from an element.  */
+void qos_message (GstMessage * message, GApplication * app);
+
+/* Send the counters to the remote controllers.  */
+void qos_send_statistics (GApplication * app);
+
+/* Print the counters.  */
+void qos_print_statistics (GApplication * app);
+
+/* End of file qos_subroutines.h */
@@ -0,0 +1,330 @@
+/*
+ * realtime_subroutines.c
+ *
+ * Copyright © 2016 by John Sauter <John_Sauter@systemeyescomputerstore.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <gtk/gtk.h>
+#include <gst/gst.h>
+#include "display_subroutines.h"
+#include "main.h"
+#include "realtime_subroutines.h"
+#include "sound_effects_player.h"
+#include "trace_ring_subroutines.h"
+
+/* Running in real time means keeping the streaming threads from being
+ * preempted by the rest of the system, and keeping them from waiting
+ * for the disk.  When --realtime-priority is given:
+ *
+ * All of our memory is locked, so the samples the loopers hold and the
+ * stacks of the streaming threads cannot be paged out.  Where the
+ * kernel allows it, pages are locked as they are first touched rather
+ * than all at once, since each thread has a large stack of which it
+ * uses little.  The loopers write every byte of their samples when
+ * they load them, so the samples are faulted in before the first play.
+ * Each streaming thread faults in the top of its stack when it starts.
+ *
+ * Each streaming thread is given the requested real-time scheduling
+ * policy and priority as it starts.  Gstreamer posts a stream-status
+ * enter message from the thread itself; the bus's synchronous handler
+ * sees it on that thread and calls realtime_enter_thread.
+ *
+ * The settings are read back to make sure they took effect.  If they
+ * did not, usually because the user lacks the privilege, the failure
+ * is reported on the terminal and in the status bar rather than
+ * leaving the show running at normal priority unnoticed.  */
+
+/* How much of each streaming thread's stack to fault in.  */
+#define REALTIME_STACK_PREFAULT (256 * 1024)
+
+/* The persistent data used for real-time operation.  */
+struct realtime_info
+{
+  GApplication *app;
+  int policy;                   /* SCHED_FIFO or SCHED_RR */
+  int priority;
+  gboolean memory_locked;
+  glong page_size;
+
+  /* Updated by the streaming threads.  */
+  gint thread_count;            /* Threads at real-time priority */
+  gint failure_count;           /* Threads we could not raise */
+  gint failure_reported;        /* Set once the first failure is shown */
+  gchar failure_text[256];
+};
+
+/* Touch each page of the top of the stack, so that the pages are
+ * present, and locked, before the thread has real work to do.  */
+static void
+prefault_stack (glong page_size)
+{
+  volatile guchar stack_space[REALTIME_STACK_PREFAULT];
+  gsize i;
+
+  for (i = 0; i < sizeof (stack_space); i = i + page_size)
+    stack_space[i] = 0;
+
+  return;
+}
+
+/* Find how much memory the kernel says is locked, in kilobytes.
+ * Returns -1 if we cannot tell.  */
+static glong
+locked_kilobytes ()
+{
+  FILE *status_file;
+  gchar line[128];
+  glong kilobytes;
+
+  kilobytes = -1;
+  status_file = fopen ("/proc/self/status", "r");
+  if (status_file == NULL)
+    return kilobytes;
+  while (fgets (line, sizeof (line), status_file) != NULL)
+    {
+      if (sscanf (line, "VmLck: %ld kB", &kilobytes) == 1)
+        break;
+    }
+  fclose (status_file);
+
+  return kilobytes;
+}
+
+/* Describe a resource limit for an error message.  */
+static gchar *
+describe_limit (int resource)
+{
+  struct rlimit limit;
+
+  if (getrlimit (resource, &limit) != 0)
+    return g_strdup ("unknown");
+  if (limit.rlim_cur == RLIM_INFINITY)
+    return g_strdup ("unlimited");
+  return g_strdup_printf ("%llu", (unsigned long long) limit.rlim_cur);
+}
+
+/* Show a failure in the status bar.  This runs on the main thread.  */
+static gboolean
+show_failure (gpointer user_data)
+{
+  GApplication *app = user_data;
+  struct realtime_info *realtime_data;
+
+  realtime_data = sep_get_realtime_data (app);
+  display_show_message (realtime_data->failure_text, app);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Report a failure, on the terminal and in the status bar.  Only the
+ * first failure is shown in the status bar; the rest are counted.  */
+static void
+report_failure (struct realtime_info *realtime_data, const gchar * text)
+{
+  g_print ("%s\n", text);
+  if (g_atomic_int_compare_and_exchange (&realtime_data->failure_reported,
+                                         FALSE, TRUE))
+    {
+      g_strlcpy (realtime_data->failure_text, text,
+                 sizeof (realtime_data->failure_text));
+      g_idle_add (show_failure, realtime_data->app);
+    }
+  return;
+}
+
+/* Lock our memory and prepare to run the streaming threads at real-time
+ * priority.  */
+void *
+realtime_init (GApplication * app)
+{
+  struct realtime_info *realtime_data;
+  const gchar *policy_name;
+  gchar *limit_text;
+  gchar *message_text;
+  int lock_flags;
+  int minimum_priority, maximum_priority;
+  int error_number;
+
+  /* Real time is only for playing a show.  */
+  if ((main_get_realtime_priority () <= 0) || main_get_compile ()
+      || (sep_get_render_data (app) != NULL))
+    return NULL;
+
+  /* Allocate the persistent data.  */
+  realtime_data = g_malloc0 (sizeof (struct realtime_info));
+  realtime_data->app = app;
+  realtime_data->priority = main_get_realtime_priority ();
+  realtime_data->page_size = sysconf (_SC_PAGESIZE);
+  if (realtime_data->page_size <= 0)
+    realtime_data->page_size = 4096;
+
+  policy_name = main_get_realtime_policy ();
+  if ((policy_name == NULL) || (g_ascii_strcasecmp (policy_name, "fifo") == 0))
+    realtime_data->policy = SCHED_FIFO;
+  else if (g_ascii_strcasecmp (policy_name, "rr") == 0)
+    realtime_data->policy = SCHED_RR;
+  else
+    {
+      g_print ("Unknown real-time policy %s; using fifo.\n", policy_name);
+      realtime_data->policy = SCHED_FIFO;
+    }
+
+  minimum_priority = sched_get_priority_min (realtime_data->policy);
+  maximum_priority = sched_get_priority_max (realtime_data->policy);
+  if ((realtime_data->priority < minimum_priority)
+      || (realtime_data->priority > maximum_priority))
+    {
+      g_print ("Real-time priority %d is out of range; using %d.\n",
+               realtime_data->priority, maximum_priority);
+      realtime_data->priority = maximum_priority;
+    }
+
+  /* Lock everything we have and everything we will get.  */
+  lock_flags = MCL_CURRENT | MCL_FUTURE;
+#ifdef MCL_ONFAULT
+  lock_flags = lock_flags | MCL_ONFAULT;
+#endif
+  errno = 0;
+  if (mlockall (lock_flags) == 0)
+    realtime_data->memory_locked = TRUE;
+#ifdef MCL_ONFAULT
+  else if (errno == EINVAL)
+    {
+      /* This kernel predates locking on fault, so lock and fault in
+       * everything now.  */
+      errno = 0;
+      if (mlockall (MCL_CURRENT | MCL_FUTURE) == 0)
+        realtime_data->memory_locked = TRUE;
+    }
+#endif
+  if (!realtime_data->memory_locked)
+    {
+      error_number = errno;
+      limit_text = describe_limit (RLIMIT_MEMLOCK);
+      message_text =
+        g_strdup_printf ("Cannot lock memory: %s; the limit on locked "
+                         "memory is %s bytes.", g_strerror (error_number),
+                         limit_text);
+      report_failure (realtime_data, message_text);
+      g_free (message_text);
+      g_free (limit_text);
+    }
+  else
+    {
+      prefault_stack (realtime_data->page_size);
+      if (TRACE_RING_ENABLED (trace_realtime))
+        {
+          trace_ring_record (trace_realtime, "memory locked, %ld kB.",
+                             locked_kilobytes ());
+        }
+    }
+
+  return (realtime_data);
+}
+
+/* A streaming thread is starting.  Raise it to real-time priority and
+ * make sure that took effect.  */
+void
+realtime_enter_thread (GstElement * owner_element, GApplication * app)
+{
+  struct realtime_info *realtime_data;
+  struct sched_param parameters;
+  int policy;
+  int error_number;
+  gchar *limit_text;
+  gchar *message_text;
+
+  realtime_data = sep_get_realtime_data (app);
+  if (realtime_data == NULL)
+    return;
+
+  prefault_stack (realtime_data->page_size);
+
+  memset (&parameters, 0, sizeof (parameters));
+  parameters.sched_priority = realtime_data->priority;
+  error_number =
+    pthread_setschedparam (pthread_self (), realtime_data->policy,
+                           &parameters);
+  if (error_number == 0)
+    {
+      /* Read the settings back.  */
+      error_number =
+        pthread_getschedparam (pthread_self (), &policy, &parameters);
+      if ((error_number == 0)
+          && ((policy != realtime_data->policy)
+              || (parameters.sched_priority != realtime_data->priority)))
+        error_number = EPERM;
+    }
+
+  if (error_number == 0)
+    {
+      g_atomic_int_inc (&realtime_data->thread_count);
+      if (TRACE_RING_ENABLED (trace_realtime))
+        {
+          trace_ring_record (trace_realtime, "streaming thread of %s at "
+                             "real-time priority %d.",
+                             GST_OBJECT_NAME (owner_element),
+                             realtime_data->priority);
+        }
+      return;
+    }
+
+  g_atomic_int_inc (&realtime_data->failure_count);
+  limit_text = describe_limit (RLIMIT_RTPRIO);
+  message_text =
+    g_strdup_printf ("Cannot run the streaming thread of %s at real-time "
+                     "priority %d: %s; the limit on real-time priority "
+                     "is %s.", GST_OBJECT_NAME (owner_element),
+                     realtime_data->priority, g_strerror (error_number),
+                     limit_text);
+  report_failure (realtime_data, message_text);
+  g_free (message_text);
+  g_free (limit_text);
+
+  return;
+}
+
+/* Print how many streaming threads run at real-time priority, and
+ * how much memory is locked.  */
+void
+realtime_print_statistics (GApplication * app)
+{
+  struct realtime_info *realtime_data;
+
+  realtime_data = sep_get_realtime_data (app);
+  if (realtime_data == NULL)
+    return;
+
+  g_print ("Real time: %d streaming threads at %s priority %d, %d failed; "
+           "memory %s, %ld kB locked.\n",
+           g_atomic_int_get (&realtime_data->thread_count),
+           (realtime_data->policy == SCHED_RR) ? "round-robin" : "FIFO",
+           realtime_data->priority,
+           g_atomic_int_get (&realtime_data->failure_count),
+           realtime_data->memory_locked ? "locked" : "not locked",
+           locked_kilobytes ());
+
+  return;
+}
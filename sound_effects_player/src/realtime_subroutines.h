@@ -0,0 +1,39 @@
+/*
+ * realtime_subroutines.h
+ *
+ * Copyright © 2016 by John Sauter <John_Sauter@systemeyescomputerstore.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtk/gtk.h>
+#include <gst/gst.h>
+
+/* Subroutines defined in realtime_subroutines.c */
+
+/* Lock our memory and prepare to run the streaming threads at real-time
+ * priority, if that was requested on the command line.  Returns NULL
+ * if it was not.  */
+void *realtime_init (GApplication * app);
+
+/* A streaming thread is starting.  This runs on that thread, from the
+ * bus's synchronous handler, when the thread's element posts its
+ * stream-status enter message.  */
+void realtime_enter_thread (GstElement * owner_element, GApplication * app);
+
+/* Print how many streaming threads run at real-time priority, and
+ * how much memory is locked.  */
+void realtime_print_statistics (GApplication * app);
+
+/* End of file realtime_subroutines.h */
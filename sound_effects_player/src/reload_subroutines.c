@@ -0,0 +1,587 @@
+/*
+ * reload_subroutines.c
+ *
+ * Copyright © 2016 by John Sauter <John_Sauter@systemeyescomputerstore.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <gtk/gtk.h>
+#include <gst/gst.h>
+#include "reload_subroutines.h"
+#include "arena_subroutines.h"
+#include "display_subroutines.h"
+#include "gstreamer_subroutines.h"
+#include "osc_subroutines.h"
+#include "parse_xml_subroutines.h"
+#include "routing_subroutines.h"
+#include "sequence_structure.h"
+#include "sequence_subroutines.h"
+#include "sound_effects_player.h"
+#include "sound_structure.h"
+#include "sound_subroutines.h"
+#include "trace_ring_subroutines.h"
+
+/* Reloading reads the project file again, while the show is running,
+ * and compares the new sounds and sequence items with the running 
+ * ones by name.  Only what has changed is touched:
+ *
+ * A sound whose volume, pan, envelope or loop parameters changed has
+ * them set on its existing bin, even while it is playing.  A sound 
+ * whose WAV file or panning changed gets a new bin, unless it is 
+ * playing, in which case the change is deferred: reload again after 
+ * it has finished.  New sounds get new bins, which are added to the 
+ * running pipeline, and removed sounds have their bins removed unless 
+ * they are playing or attached to a cluster.
+ *
+ * Sequence items are changed in place, so the sequencer keeps its
+ * position.  A removed item, or one whose type changed, is kept while
+ * the sequencer is still acting on it.
+ *
+ * The sound and sequence item structures that survive a reload are
+ * the ones the rest of the program already points to; new definitions
+ * are copied into them.  The new show is read into a scratch arena,
+ * from which only the added sounds and items are kept.  Its strings
+ * are interned along with those of the running show, so names and
+ * other strings are compared by address.  */
+
+/* What a reload did.  */
+struct reload_counts
+{
+  guint sounds_added;
+  guint sounds_changed;
+  guint sounds_rebuilt;
+  guint sounds_removed;
+  guint sounds_unchanged;
+  guint items_added;
+  guint items_changed;
+  guint items_removed;
+  guint items_unchanged;
+  guint deferred;
+};
+
+/* How a sound's definition has changed.  */
+enum sound_change
+{ sound_unchanged, sound_parameters_changed, sound_bin_changed };
+
+/* Compare where two sounds are sent and the speakers they are placed
+ * on.  The panner in a sound's bin takes these as its gains.  */
+static gboolean
+routing_equal (struct sound_info *old_sound, struct sound_info *new_sound)
+{
+  gint i;
+
+  if ((old_sound->send_count != new_sound->send_count)
+      || (old_sound->speaker_count != new_sound->speaker_count))
+    return FALSE;
+  for (i = 0; i < old_sound->send_count; i++)
+    {
+      if ((old_sound->sends[i].bus_name != new_sound->sends[i].bus_name)
+          || (old_sound->sends[i].level != new_sound->sends[i].level))
+        return FALSE;
+    }
+  for (i = 0; i < old_sound->speaker_count; i++)
+    {
+      if ((old_sound->speakers[i].bus_name !=
+           new_sound->speakers[i].bus_name)
+          || (old_sound->speakers[i].channel !=
+              new_sound->speakers[i].channel)
+          || (old_sound->speakers[i].level != new_sound->speakers[i].level))
+        return FALSE;
+    }
+  return TRUE;
+}
+
+/* Compare a running sound with its new definition.  Their strings
+ * are interned, so equal strings have equal addresses.  */
+static enum sound_change
+compare_sounds (struct sound_info *old_sound, struct sound_info *new_sound)
+{
+  if ((old_sound->wav_file_name_full != new_sound->wav_file_name_full)
+      || (old_sound->omit_panning != new_sound->omit_panning)
+      || (old_sound->disabled != new_sound->disabled))
+    return sound_bin_changed;
+
+  if ((old_sound->wav_file_name != new_sound->wav_file_name)
+      || (old_sound->attack_duration_time != new_sound->attack_duration_time)
+      || (old_sound->attack_level != new_sound->attack_level)
+      || (old_sound->decay_duration_time != new_sound->decay_duration_time)
+      || (old_sound->sustain_level != new_sound->sustain_level)
+      || (old_sound->release_start_time != new_sound->release_start_time)
+      || (old_sound->release_duration_time !=
+          new_sound->release_duration_time)
+      || (old_sound->release_duration_infinite !=
+          new_sound->release_duration_infinite)
+      || (old_sound->loop_from_time != new_sound->loop_from_time)
+      || (old_sound->loop_to_time != new_sound->loop_to_time)
+      || (old_sound->loop_limit != new_sound->loop_limit)
+      || (old_sound->max_duration_time != new_sound->max_duration_time)
+      || (old_sound->start_time != new_sound->start_time)
+      || (old_sound->designer_volume_level !=
+          new_sound->designer_volume_level)
+      || (old_sound->designer_pan != new_sound->designer_pan)
+      || !routing_equal (old_sound, new_sound)
+      || (old_sound->MIDI_program_number != new_sound->MIDI_program_number)
+      || (old_sound->MIDI_program_number_specified !=
+          new_sound->MIDI_program_number_specified)
+      || (old_sound->MIDI_note_number != new_sound->MIDI_note_number)
+      || (old_sound->MIDI_note_number_specified !=
+          new_sound->MIDI_note_number_specified)
+      || (old_sound->OSC_name != new_sound->OSC_name)
+      || (old_sound->OSC_name_specified != new_sound->OSC_name_specified)
+      || (old_sound->function_key != new_sound->function_key)
+      || (old_sound->function_key_specified !=
+          new_sound->function_key_specified))
+    return sound_parameters_changed;
+
+  return sound_unchanged;
+}
+
+/* Copy the definition of a sound into the running sound, leaving
+ * its run-time fields alone.  */
+static void
+take_sound_definition (struct sound_info *old_sound,
+                       struct sound_info *new_sound)
+{
+  old_sound->disabled = new_sound->disabled;
+  old_sound->wav_file_name = new_sound->wav_file_name;
+  old_sound->wav_file_name_full = new_sound->wav_file_name_full;
+  old_sound->attack_duration_time = new_sound->attack_duration_time;
+  old_sound->attack_level = new_sound->attack_level;
+  old_sound->decay_duration_time = new_sound->decay_duration_time;
+  old_sound->sustain_level = new_sound->sustain_level;
+  old_sound->release_start_time = new_sound->release_start_time;
+  old_sound->release_duration_time = new_sound->release_duration_time;
+  old_sound->release_duration_infinite =
+    new_sound->release_duration_infinite;
+  old_sound->loop_from_time = new_sound->loop_from_time;
+  old_sound->loop_to_time = new_sound->loop_to_time;
+  old_sound->loop_limit = new_sound->loop_limit;
+  old_sound->max_duration_time = new_sound->max_duration_time;
+  old_sound->start_time = new_sound->start_time;
+  old_sound->designer_volume_level = new_sound->designer_volume_level;
+  old_sound->designer_pan = new_sound->designer_pan;
+  old_sound->MIDI_program_number = new_sound->MIDI_program_number;
+  old_sound->MIDI_program_number_specified =
+    new_sound->MIDI_program_number_specified;
+  old_sound->MIDI_note_number = new_sound->MIDI_note_number;
+  old_sound->MIDI_note_number_specified =
+    new_sound->MIDI_note_number_specified;
+  old_sound->OSC_name = new_sound->OSC_name;
+  old_sound->OSC_name_specified = new_sound->OSC_name_specified;
+  old_sound->function_key = new_sound->function_key;
+  old_sound->function_key_specified = new_sound->function_key_specified;
+  old_sound->omit_panning = new_sound->omit_panning;
+  old_sound->send_count = new_sound->send_count;
+  memcpy (old_sound->sends, new_sound->sends, sizeof (old_sound->sends));
+  old_sound->speaker_count = new_sound->speaker_count;
+  memcpy (old_sound->speakers, new_sound->speakers,
+          sizeof (old_sound->speakers));
+  return;
+}
+
+/* Give a sound a bin in the running pipeline.  */
+static void
+add_sound_bin (struct sound_info *sound_data, GstPipeline * pipeline_element,
+               GApplication * app)
+{
+  if (sound_data->disabled)
+    return;
+
+  sound_data->sound_control =
+    gstreamer_add_bin (sound_data, pipeline_element, app);
+  if (sound_data->sound_control == NULL)
+    {
+      /* We are unable to create the gstreamer bin.  This might
+       * be because an element is unavailable.  */
+      sound_data->disabled = TRUE;
+    }
+  return;
+}
+
+/* Take the bin of a sound out of the running pipeline.  */
+static void
+remove_sound_bin (struct sound_info *sound_data,
+                  GstPipeline * pipeline_element, GApplication * app)
+{
+  if (sound_data->sound_control == NULL)
+    return;
+
+  gstreamer_remove_bin (sound_data->sound_control, pipeline_element, app);
+  sound_data->sound_control = NULL;
+  return;
+}
+
+/* Merge the newly read sounds into the running sounds.  */
+static GList *
+reload_sounds (GList * old_list, GList * new_list,
+               GstPipeline * pipeline_element, struct reload_counts *counts,
+               GApplication * app)
+{
+  GHashTable *old_by_name;
+  GHashTable *kept;
+  GList *result_list, *l;
+  struct sound_info *old_sound, *new_sound;
+
+  /* Index the running sounds by name.  If two have the same name, the 
+   * first is the one the rest of the program finds.  The names are
+   * interned, so they are indexed by address.  */
+  old_by_name = g_hash_table_new (g_direct_hash, g_direct_equal);
+  kept = g_hash_table_new (g_direct_hash, g_direct_equal);
+  for (l = old_list; l != NULL; l = l->next)
+    {
+      old_sound = l->data;
+      if ((old_sound->name != NULL)
+          && !g_hash_table_contains (old_by_name, old_sound->name))
+        g_hash_table_insert (old_by_name, old_sound->name, old_sound);
+    }
+
+  result_list = NULL;
+  for (l = new_list; l != NULL; l = l->next)
+    {
+      new_sound = l->data;
+      old_sound = NULL;
+      if (new_sound->name != NULL)
+        {
+          old_sound = g_hash_table_lookup (old_by_name, new_sound->name);
+          if (old_sound != NULL)
+            g_hash_table_remove (old_by_name, new_sound->name);
+        }
+
+      if (old_sound == NULL)
+        {
+          /* This is a new sound.  Move it out of the scratch arena
+           * before anything refers to it.  */
+          new_sound =
+            arena_keep_record (new_sound, sizeof (struct sound_info), app);
+          add_sound_bin (new_sound, pipeline_element, app);
+          result_list = g_list_prepend (result_list, new_sound);
+          counts->sounds_added = counts->sounds_added + 1;
+          if (TRACE_RING_ENABLED (trace_reload))
+            trace_ring_record (trace_reload, "Added sound %s.",
+                               new_sound->name);
+          continue;
+        }
+
+      g_hash_table_add (kept, old_sound);
+      result_list = g_list_prepend (result_list, old_sound);
+      switch (compare_sounds (old_sound, new_sound))
+        {
+        case sound_unchanged:
+          counts->sounds_unchanged = counts->sounds_unchanged + 1;
+          break;
+
+        case sound_parameters_changed:
+          take_sound_definition (old_sound, new_sound);
+          if (old_sound->sound_control != NULL)
+            gstreamer_update_bin (old_sound->sound_control, old_sound, app);
+          counts->sounds_changed = counts->sounds_changed + 1;
+          if (TRACE_RING_ENABLED (trace_reload))
+            trace_ring_record (trace_reload, "Changed sound %s.",
+                               old_sound->name);
+          break;
+
+        case sound_bin_changed:
+          if (old_sound->running)
+            {
+              g_print ("Sound %s is playing; reload again after it "
+                       "finishes to change it.\n", old_sound->name);
+              counts->deferred = counts->deferred + 1;
+              break;
+            }
+          remove_sound_bin (old_sound, pipeline_element, app);
+          take_sound_definition (old_sound, new_sound);
+          add_sound_bin (old_sound, pipeline_element, app);
+          counts->sounds_rebuilt = counts->sounds_rebuilt + 1;
+          if (TRACE_RING_ENABLED (trace_reload))
+            trace_ring_record (trace_reload, "Rebuilt sound %s.",
+                               old_sound->name);
+          break;
+        }
+    }
+
+  /* The running sounds which are not in the new show are removed,
+   * unless they are in use.  */
+  for (l = old_list; l != NULL; l = l->next)
+    {
+      old_sound = l->data;
+      if (g_hash_table_contains (kept, old_sound))
+        continue;
+      if (old_sound->running || (old_sound->cluster_widget != NULL))
+        {
+          g_print ("Sound %s is in use; reload again after it "
+                   "finishes to remove it.\n", old_sound->name);
+          result_list = g_list_prepend (result_list, old_sound);
+          counts->deferred = counts->deferred + 1;
+          continue;
+        }
+      remove_sound_bin (old_sound, pipeline_element, app);
+      if (TRACE_RING_ENABLED (trace_reload))
+        trace_ring_record (trace_reload, "Removed sound %s.",
+                           old_sound->name);
+      counts->sounds_removed = counts->sounds_removed + 1;
+    }
+
+  g_hash_table_destroy (old_by_name);
+  g_hash_table_destroy (kept);
+  g_list_free (old_list);
+  g_list_free (new_list);
+
+  return g_list_reverse (result_list);
+}
+
+/* Determine whether two definitions of a sequence item are the same.  */
+static gboolean
+items_equal (struct sequence_item_info *old_item,
+             struct sequence_item_info *new_item)
+{
+  return ((old_item->type == new_item->type)
+          && (old_item->sound_name == new_item->sound_name)
+          && (old_item->tag == new_item->tag)
+          && (old_item->use_external_velocity ==
+              new_item->use_external_velocity)
+          && (old_item->volume == new_item->volume)
+          && (old_item->pan == new_item->pan)
+          && (old_item->program_number == new_item->program_number)
+          && (old_item->bank_number == new_item->bank_number)
+          && (old_item->cluster_number == new_item->cluster_number)
+          && (old_item->cluster_number_specified ==
+              new_item->cluster_number_specified)
+          && (old_item->next_completion == new_item->next_completion)
+          && (old_item->next_termination == new_item->next_termination)
+          && (old_item->next_starts == new_item->next_starts)
+          && (old_item->next_release_started ==
+              new_item->next_release_started)
+          && (old_item->importance == new_item->importance)
+          && (old_item->Q_number == new_item->Q_number)
+          && (old_item->text_to_display == new_item->text_to_display)
+          && (old_item->next == new_item->next)
+          && (old_item->time_to_wait == new_item->time_to_wait)
+          && (old_item->next_to_start == new_item->next_to_start)
+          && (old_item->next_play == new_item->next_play)
+          && (old_item->MIDI_program_number == new_item->MIDI_program_number)
+          && (old_item->MIDI_note_number == new_item->MIDI_note_number)
+          && (old_item->MIDI_note_number_specified ==
+              new_item->MIDI_note_number_specified)
+          && (old_item->OSC_name == new_item->OSC_name)
+          && (old_item->macro_number == new_item->macro_number)
+          && (old_item->function_key == new_item->function_key)
+          && (old_item->omit_from_display == new_item->omit_from_display));
+}
+
+/* Copy the definition of a sequence item into the running item.
+ * They have the same name, so they differ only in their definitions.  */
+static void
+take_item_definition (struct sequence_item_info *old_item,
+                      struct sequence_item_info *new_item)
+{
+  *old_item = *new_item;
+  return;
+}
+
+/* Merge the newly read sequence items into the running sequence.  */
+static GList *
+reload_items (GList * old_list, GList * new_list,
+              struct reload_counts *counts, GApplication * app)
+{
+  GHashTable *old_by_name;
+  GHashTable *kept;
+  GList *result_list, *l;
+  struct sequence_item_info *old_item, *new_item;
+
+  /* The sequencer finds the first item with a given name.  */
+  old_by_name = g_hash_table_new (g_direct_hash, g_direct_equal);
+  kept = g_hash_table_new (g_direct_hash, g_direct_equal);
+  for (l = old_list; l != NULL; l = l->next)
+    {
+      old_item = l->data;
+      if ((old_item->name != NULL)
+          && !g_hash_table_contains (old_by_name, old_item->name))
+        g_hash_table_insert (old_by_name, old_item->name, old_item);
+    }
+
+  result_list = NULL;
+  for (l = new_list; l != NULL; l = l->next)
+    {
+      new_item = l->data;
+      old_item = NULL;
+      if (new_item->name != NULL)
+        {
+          old_item = g_hash_table_lookup (old_by_name, new_item->name);
+          if (old_item != NULL)
+            g_hash_table_remove (old_by_name, new_item->name);
+        }
+
+      if (old_item == NULL)
+        {
+          new_item =
+            arena_keep_record (new_item, sizeof (struct sequence_item_info),
+                               app);
+          result_list = g_list_prepend (result_list, new_item);
+          counts->items_added = counts->items_added + 1;
+          continue;
+        }
+
+      if (items_equal (old_item, new_item))
+        {
+          g_hash_table_add (kept, old_item);
+          result_list = g_list_prepend (result_list, old_item);
+          counts->items_unchanged = counts->items_unchanged + 1;
+          continue;
+        }
+
+      /* The sequencer's record of what an item is doing depends on its
+       * type, so an item in use keeps its type until it is done.  */
+      if ((old_item->type != new_item->type)
+          && sequence_item_in_use (old_item, app))
+        {
+          g_print ("Sequence item %s is in use; reload again after it "
+                   "finishes to change its type.\n", old_item->name);
+          g_hash_table_add (kept, old_item);
+          result_list = g_list_prepend (result_list, old_item);
+          counts->deferred = counts->deferred + 1;
+          continue;
+        }
+
+      g_hash_table_add (kept, old_item);
+      result_list = g_list_prepend (result_list, old_item);
+      take_item_definition (old_item, new_item);
+      counts->items_changed = counts->items_changed + 1;
+    }
+
+  for (l = old_list; l != NULL; l = l->next)
+    {
+      old_item = l->data;
+      if (g_hash_table_contains (kept, old_item))
+        continue;
+      if (sequence_item_in_use (old_item, app))
+        {
+          g_print ("Sequence item %s is in use; reload again after it "
+                   "finishes to remove it.\n", old_item->name);
+          result_list = g_list_prepend (result_list, old_item);
+          counts->deferred = counts->deferred + 1;
+          continue;
+        }
+      counts->items_removed = counts->items_removed + 1;
+    }
+
+  g_hash_table_destroy (old_by_name);
+  g_hash_table_destroy (kept);
+  g_list_free (old_list);
+  g_list_free (new_list);
+
+  return g_list_reverse (result_list);
+}
+
+/* Read the project file again and change the running show to match.  */
+void
+reload_project (GApplication * app)
+{
+  GstPipeline *pipeline_element;
+  GList *old_sounds, *old_items;
+  struct reload_counts counts;
+  gchar *file_name;
+  gchar *message_text;
+  gint64 start_time;
+  gdouble elapsed_ms;
+
+  if (sep_get_project_filename (app) == NULL)
+    {
+      display_show_message ("No project to reload.", app);
+      return;
+    }
+
+  start_time = g_get_monotonic_time ();
+  file_name = g_strdup (sep_get_project_filename (app));
+  pipeline_element = sep_get_pipeline_from_app (app);
+  old_sounds = sep_get_sound_list (app);
+  old_items = sequence_get_item_list (app);
+
+  if (pipeline_element == NULL)
+    {
+      /* There is no pipeline, so nothing is playing and the sequencer 
+       * has not started.  Load the project as if it had just been 
+       * opened.  */
+      g_list_free (old_sounds);
+      g_list_free (old_items);
+      sep_set_sound_list (NULL, app);
+      sequence_set_item_list (NULL, app);
+      arena_release_show (app);
+      routing_forget (app);
+      sep_create_pipeline (file_name, app);
+      g_print ("Reloaded %s in %.1f ms.\n", file_name,
+               (gdouble) (g_get_monotonic_time () - start_time) / 1000.0);
+      g_free (file_name);
+      return;
+    }
+
+  /* Read the project into empty lists, keeping the running show 
+   * aside.  */
+  sep_set_sound_list (NULL, app);
+  sequence_set_item_list (NULL, app);
+  arena_begin_scratch (app);
+  if (!parse_xml_read_project_file (g_strdup (file_name), app))
+    {
+      /* Keep running the show we have.  */
+      g_list_free (sep_get_sound_list (app));
+      g_list_free (sequence_get_item_list (app));
+      arena_end_scratch (app);
+      sep_set_sound_list (old_sounds, app);
+      sequence_set_item_list (old_items, app);
+      display_show_message ("Reload failed.", app);
+      g_free (file_name);
+      return;
+    }
+
+  memset (&counts, 0, sizeof (counts));
+  sep_set_sound_list (reload_sounds
+                      (old_sounds, sep_get_sound_list (app),
+                       pipeline_element, &counts, app), app);
+  sequence_set_item_list (reload_items
+                          (old_items, sequence_get_item_list (app), &counts,
+                           app), app);
+  arena_end_scratch (app);
+
+  /* The names Open Sound Control can use may have changed.  */
+  osc_address_space_changed (app);
+
+  elapsed_ms = (gdouble) (g_get_monotonic_time () - start_time) / 1000.0;
+  g_print ("Reloaded %s in %.1f ms.\n"
+           "Sounds: %u added, %u changed, %u rebuilt, %u removed, "
+           "%u unchanged.\n"
+           "Sequence items: %u added, %u changed, %u removed, "
+           "%u unchanged.\n", file_name, elapsed_ms, counts.sounds_added,
+           counts.sounds_changed, counts.sounds_rebuilt,
+           counts.sounds_removed, counts.sounds_unchanged,
+           counts.items_added, counts.items_changed, counts.items_removed,
+           counts.items_unchanged);
+  if (counts.deferred > 0)
+    g_print ("%u changes deferred until the sounds or items using them "
+             "finish.\n", counts.deferred);
+
+  message_text =
+    g_strdup_printf ("Reloaded in %.0f ms: %u sounds and %u sequence items "
+                     "changed%s.", elapsed_ms,
+                     counts.sounds_added + counts.sounds_changed +
+                     counts.sounds_rebuilt + counts.sounds_removed,
+                     counts.items_added + counts.items_changed +
+                     counts.items_removed,
+                     counts.deferred > 0 ? ", some deferred" : "");
+  display_show_message (message_text, app);
+  g_free (message_text);
+  g_free (file_name);
+
+  return;
+}
@@ -0,0 +1,367 @@
+/*
+ * render_subroutines.c
+ *
+ * Copyright © 2016 by John Sauter <John_Sauter@systemeyescomputerstore.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <gtk/gtk.h>
+#include <gst/gst.h>
+#include "main.h"
+#include "parse_net_subroutines.h"
+#include "render_subroutines.h"
+#include "sound_effects_player.h"
+#include "timer_subroutines.h"
+#include "trace_ring_subroutines.h"
+
+/* An offline render plays the show into a WAV file as fast as the CPU
+ * allows.  Nothing paces the pipeline, so the sequencer's notion of time
+ * is taken from the sound itself: the timer runs from a virtual clock
+ * which is advanced to the time of each buffer leaving the final bin.
+ *
+ * The render script says what the operator and the cue controllers do,
+ * and when.  Each line holds a time in seconds from the start of the
+ * show followed by one of the text commands accepted from the network,
+ * for example:
+ *
+ *   # Start the first cluster, then the cue, and finish.
+ *   0     start 0
+ *   2.5   /cue 1
+ *   10    stop 0
+ *   30    end
+ *
+ * The "end" command marks where the render stops.  Without it the
+ * render stops at the time of the last command.  */
+
+/* The longest the stream may run ahead of the sequencer.  This is the
+ * same as the tick of the real-time timer, and bounds how late the
+ * sequencer can react to a sound completing.  */
+#define RENDER_QUANTUM (GST_SECOND / 10)
+
+/* A command from the render script.  */
+struct render_event
+{
+  GstClockTime time;            /* When to perform the command */
+  gchar *text;                  /* The command, as a network command */
+};
+
+/* The persistent data used by the offline render.  */
+struct render_info
+{
+  GApplication *app;
+  GList *event_list;            /* The script's commands, in time order */
+  GstClockTime end_time;        /* When the render stops */
+
+  /* The streaming thread and the main loop meet here.  The streaming
+   * thread holds each buffer which starts at or after the deadline until
+   * the main loop has brought the sequencer up to the buffer's time.  */
+  GMutex lock;
+  GCond advanced;
+  GstClockTime stream_time;     /* Start of the buffer being held */
+  GstClockTime deadline;        /* Buffers before this may pass */
+  gboolean advance_pending;     /* The main loop has been asked to advance */
+  gboolean finished;            /* The end time has been reached */
+  gboolean eos_sent;            /* End of stream has been sent downstream */
+
+  /* Statistics, for the message printed at the end.  */
+  gint64 start_time;            /* Monotonic microseconds */
+  gint64 finish_time;
+  guint64 advance_count;
+};
+
+/* Compare two script commands by time, for sorting.  */
+static gint
+compare_events (gconstpointer a, gconstpointer b)
+{
+  const struct render_event *event_a = a;
+  const struct render_event *event_b = b;
+
+  if (event_a->time < event_b->time)
+    return -1;
+  if (event_a->time > event_b->time)
+    return 1;
+  return 0;
+}
+
+/* Read the render script.  Commands with the same time are performed
+ * in the order they appear in the script.  */
+static void
+read_script (struct render_info *render_data, gchar * script_file_name)
+{
+  gchar *contents = NULL;
+  gchar **lines;
+  gchar *line, *end_ptr;
+  GError *error = NULL;
+  gdouble seconds;
+  struct render_event *event_data;
+  gboolean end_seen;
+  gint i;
+
+  render_data->event_list = NULL;
+  render_data->end_time = 0;
+  end_seen = FALSE;
+
+  if (!g_file_get_contents (script_file_name, &contents, NULL, &error))
+    {
+      g_printerr ("Cannot read render script %s: %s.\n", script_file_name,
+                  error->message);
+      g_error_free (error);
+      return;
+    }
+
+  lines = g_strsplit (contents, "\n", -1);
+  g_free (contents);
+
+  for (i = 0; lines[i] != NULL; i++)
+    {
+      line = g_strstrip (lines[i]);
+      if ((line[0] == '\0') || (line[0] == '#'))
+        continue;
+
+      seconds = g_ascii_strtod (line, &end_ptr);
+      if ((end_ptr == line) || (seconds < 0.0))
+        {
+          g_printerr ("Render script %s line %d: no time: %s.\n",
+                      script_file_name, i + 1, line);
+          continue;
+        }
+      line = g_strchug (end_ptr);
+
+      if (g_ascii_strcasecmp (line, "end") == 0)
+        {
+          render_data->end_time = seconds * GST_SECOND;
+          end_seen = TRUE;
+          continue;
+        }
+
+      event_data = g_malloc (sizeof (struct render_event));
+      event_data->time = seconds * GST_SECOND;
+      event_data->text = g_strdup (line);
+      render_data->event_list =
+        g_list_prepend (render_data->event_list, event_data);
+      if ((!end_seen) && (event_data->time > render_data->end_time))
+        render_data->end_time = event_data->time;
+    }
+  g_strfreev (lines);
+
+  /* g_list_sort is stable, so commands with the same time stay in
+   * script order.  */
+  render_data->event_list =
+    g_list_sort (g_list_reverse (render_data->event_list), compare_events);
+
+  return;
+}
+
+/* Perform a command from the render script, just as though it had
+ * arrived from the network.  */
+static void
+perform_event (struct render_event *event_data, GApplication * app)
+{
+  if (TRACE_RING_ENABLED (trace_render))
+    {
+      trace_ring_record (trace_render, "render %" GST_TIME_FORMAT ": %s",
+                         GST_TIME_ARGS (event_data->time), event_data->text);
+    }
+
+  /* The parser modifies the text, which we don't need again.  */
+  parse_net_text (event_data->text, g_get_real_time () * 1000, app);
+  parse_net_execute_commands (app);
+
+  return;
+}
+
+/* Bring the sequencer up to the time of the buffer being held, then let
+ * the stream continue.  This is called from the main loop at idle
+ * priority, so the messages the pipeline posted before the buffer was
+ * held, such as a sound completing, have already been handled.  */
+static gboolean
+render_advance (gpointer user_data)
+{
+  struct render_info *render_data = user_data;
+  GApplication *app = render_data->app;
+  struct render_event *event_data;
+  GstClockTime now, deadline;
+  gdouble next_expiration;
+
+  g_mutex_lock (&render_data->lock);
+  now = render_data->stream_time;
+  g_mutex_unlock (&render_data->lock);
+
+  if (render_data->advance_count == 0)
+    render_data->start_time = g_get_monotonic_time ();
+  render_data->advance_count = render_data->advance_count + 1;
+
+  /* Run the timer up to now, which completes the sequencer's waits,
+   * then perform the script's commands which are due.  */
+  timer_advance_virtual_clock ((gdouble) now / GST_SECOND, app);
+  while (render_data->event_list != NULL)
+    {
+      event_data = render_data->event_list->data;
+      if (event_data->time > now)
+        break;
+      perform_event (event_data, app);
+      g_free (event_data->text);
+      g_free (event_data);
+      render_data->event_list =
+        g_list_delete_link (render_data->event_list,
+                            render_data->event_list);
+    }
+
+  /* The stream may run until the next thing we must do.  */
+  deadline = now + RENDER_QUANTUM;
+  if (render_data->event_list != NULL)
+    {
+      event_data = render_data->event_list->data;
+      deadline = MIN (deadline, event_data->time);
+    }
+  next_expiration = timer_get_next_expiration (app);
+  if (next_expiration * GST_SECOND < deadline)
+    deadline = next_expiration * GST_SECOND;
+  deadline = MIN (deadline, render_data->end_time);
+  if (deadline <= now)
+    deadline = now + 1;
+
+  g_mutex_lock (&render_data->lock);
+  if (now >= render_data->end_time)
+    {
+      render_data->finished = TRUE;
+      render_data->finish_time = g_get_monotonic_time ();
+    }
+  render_data->deadline = deadline;
+  render_data->advance_pending = FALSE;
+  g_cond_broadcast (&render_data->advanced);
+  g_mutex_unlock (&render_data->lock);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Pace the stream by the render script.  This is called from the
+ * streaming thread for each buffer leaving the final bin.  */
+static GstPadProbeReturn
+render_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  struct render_info *render_data = user_data;
+  GstBuffer *buffer;
+  gboolean finished, send_eos;
+
+  buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+  if (!GST_BUFFER_PTS_IS_VALID (buffer))
+    return GST_PAD_PROBE_OK;
+
+  g_mutex_lock (&render_data->lock);
+  while ((!render_data->finished)
+         && (GST_BUFFER_PTS (buffer) >= render_data->deadline))
+    {
+      render_data->stream_time = GST_BUFFER_PTS (buffer);
+      if (!render_data->advance_pending)
+        {
+          render_data->advance_pending = TRUE;
+          g_idle_add (render_advance, render_data);
+        }
+      g_cond_wait (&render_data->advanced, &render_data->lock);
+    }
+  finished = render_data->finished;
+  send_eos = finished && !render_data->eos_sent;
+  if (send_eos)
+    render_data->eos_sent = TRUE;
+  g_mutex_unlock (&render_data->lock);
+
+  /* At the end time, finish the file.  When end of stream reaches the
+   * bus the application quits.  Anything after it is discarded.  */
+  if (send_eos)
+    gst_pad_push_event (pad, gst_event_new_eos ());
+  if (finished)
+    return GST_PAD_PROBE_DROP;
+
+  return GST_PAD_PROBE_OK;
+}
+
+/* Initialize offline rendering.  */
+void *
+render_init (GApplication * app)
+{
+  struct render_info *render_data;
+
+  if (main_get_render_file_name () == NULL)
+    return NULL;
+
+  render_data = g_malloc0 (sizeof (struct render_info));
+  render_data->app = app;
+  g_mutex_init (&render_data->lock);
+  g_cond_init (&render_data->advanced);
+  read_script (render_data, main_get_render_script_file_name ());
+
+  /* The sequencer's time is the time in the stream.  */
+  timer_use_virtual_clock (app);
+
+  return render_data;
+}
+
+/* Hold each buffer leaving the final bin until the sequencer has caught
+ * up with it.  */
+void
+render_start (GstPipeline * pipeline_element, GApplication * app)
+{
+  struct render_info *render_data;
+  GstElement *volume_element;
+  GstPad *src_pad;
+
+  render_data = sep_get_render_data (app);
+  if ((render_data == NULL) || (pipeline_element == NULL))
+    return;
+
+  volume_element =
+    gst_bin_get_by_name (GST_BIN (pipeline_element), "final/volume");
+  if (volume_element == NULL)
+    {
+      g_printerr ("Cannot find the final volume element to render.\n");
+      return;
+    }
+  src_pad = gst_element_get_static_pad (volume_element, "src");
+  gst_pad_add_probe (src_pad, GST_PAD_PROBE_TYPE_BUFFER, render_probe,
+                     render_data, NULL);
+  gst_object_unref (src_pad);
+  gst_object_unref (volume_element);
+
+  return;
+}
+
+/* Print how long the render took, and how much faster than real time
+ * that was.  */
+void
+render_print_statistics (GApplication * app)
+{
+  struct render_info *render_data;
+  gdouble sound_seconds, render_seconds;
+
+  render_data = sep_get_render_data (app);
+  if ((render_data == NULL) || (!render_data->finished))
+    return;
+
+  sound_seconds = (gdouble) render_data->end_time / GST_SECOND;
+  render_seconds =
+    (gdouble) (render_data->finish_time - render_data->start_time) /
+    G_USEC_PER_SEC;
+  g_print ("Rendered %.1f seconds of sound in %.3f seconds", sound_seconds,
+           render_seconds);
+  if (render_seconds > 0.0)
+    g_print (", %.1f times real time", sound_seconds / render_seconds);
+  g_print (".\n");
+
+  return;
+}
@@ -0,0 +1,36 @@
+/*
+ * render_subroutines.h
+ *
+ * Copyright © 2016 by John Sauter <John_Sauter@systemeyescomputerstore.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <gtk/gtk.h>
+#include <gst/gst.h>
+
+/* Subroutines defined in render_subroutines.c */
+
+/* Initialize offline rendering, if it was requested on the command
+ * line.  Returns NULL if we are playing the show in real time.  */
+void *render_init (GApplication * app);
+
+/* The pipeline has been built; start pacing it by the render script.  */
+void render_start (GstPipeline * pipeline_element, GApplication * app);
+
+/* Print how long the render took.  */
+void render_print_statistics (GApplication * app);
+
+/* End of file render_subroutines.h */
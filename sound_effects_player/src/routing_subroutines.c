@@ -0,0 +1,369 @@
+/*
+ * routing_subroutines.c
+ *
+ * Copyright © 2016 by John Sauter <John_Sauter@systemeyescomputerstore.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <string.h>
+#include <gtk/gtk.h>
+#include "routing_subroutines.h"
+#include "sound_effects_player.h"
+#include "sound_structure.h"
+
+/* The sounds file can define output buses in its routing section, and
+ * each sound can be sent to any of them at its own level.  The mixer
+ * produces every bus in one pass: each sound's bin spreads the sound
+ * over all the buses' channels, through a matrix of gains, and the
+ * adder sums the sounds once for all of them.  The mixed output then
+ * goes to one multichannel device, or is split into its buses, each
+ * going to its own device.  The monitor file records every bus.
+ *
+ * A sound can also be placed on individual speakers, that is, on
+ * channels of the buses, each at its own level, for surround sound.
+ * A sound that is sent nowhere and placed on no speaker goes to the
+ * first bus.  A show with no routing section is played in stereo on
+ * the default device, as before.  */
+
+/* The persistent data used by the routing subroutines.  */
+struct routing_info
+{
+  GPtrArray *buses;             /* struct routing_bus */
+  gint channel_count;
+  gchar *device_name;
+  gboolean change_reported;
+};
+
+/* Free a bus.  */
+static void
+free_bus (gpointer data)
+{
+  struct routing_bus *bus_data = data;
+
+  g_free (bus_data->name);
+  g_free (bus_data->device_name);
+  g_free (bus_data);
+  return;
+}
+
+/* Initialize the output routing.  */
+void *
+routing_init (GApplication * app)
+{
+  struct routing_info *routing_data;
+
+  routing_data = g_malloc0 (sizeof (struct routing_info));
+  routing_data->buses = g_ptr_array_new_with_free_func (free_bus);
+  return routing_data;
+}
+
+/* Once the pipeline is built on the routing, a reload cannot
+ * change it.  */
+static gboolean
+routing_is_fixed (GApplication * app)
+{
+  return (sep_get_pipeline_from_app (app) != NULL);
+}
+
+/* Tell the operator, once, that a reload has changed the routing.  */
+static void
+report_change (struct routing_info *routing_data)
+{
+  if (routing_data->change_reported)
+    return;
+  g_printerr ("The routing has changed; restart the player "
+              "to use the new routing.\n");
+  routing_data->change_reported = TRUE;
+  return;
+}
+
+/* Send the whole output to one multichannel device.  */
+void
+routing_set_device (const gchar * device_name, GApplication * app)
+{
+  struct routing_info *routing_data;
+
+  routing_data = sep_get_routing_data (app);
+  if (routing_is_fixed (app))
+    {
+      if (g_strcmp0 (device_name, routing_data->device_name) != 0)
+        report_change (routing_data);
+      return;
+    }
+
+  g_free (routing_data->device_name);
+  routing_data->device_name = g_strdup (device_name);
+  return;
+}
+
+/* Find a bus by name.  Return its number, or -1.  */
+static gint
+find_bus (struct routing_info *routing_data, const gchar * bus_name)
+{
+  struct routing_bus *bus_data;
+  guint i;
+
+  for (i = 0; i < routing_data->buses->len; i++)
+    {
+      bus_data = g_ptr_array_index (routing_data->buses, i);
+      if (g_strcmp0 (bus_data->name, bus_name) == 0)
+        return i;
+    }
+  return -1;
+}
+
+/* Define an output bus.  */
+void
+routing_define_bus (const gchar * bus_name, gint channel_count,
+                    const gchar * device_name, GApplication * app)
+{
+  struct routing_info *routing_data;
+  struct routing_bus *bus_data;
+  gint bus_number, old_channel_count;
+
+  routing_data = sep_get_routing_data (app);
+  if (bus_name == NULL)
+    {
+      g_printerr ("A bus has no name.\n");
+      return;
+    }
+
+  bus_number = find_bus (routing_data, bus_name);
+  if (routing_is_fixed (app))
+    {
+      if (bus_number < 0)
+        {
+          report_change (routing_data);
+          return;
+        }
+      bus_data = g_ptr_array_index (routing_data->buses, bus_number);
+      if ((bus_data->channel_count != channel_count)
+          || (g_strcmp0 (bus_data->device_name, device_name) != 0))
+        report_change (routing_data);
+      return;
+    }
+
+  /* A bus defined again, by a later file, takes the new definition,
+   * so its old channels do not count against the limit.  */
+  old_channel_count = 0;
+  if (bus_number >= 0)
+    {
+      bus_data = g_ptr_array_index (routing_data->buses, bus_number);
+      old_channel_count = bus_data->channel_count;
+    }
+
+  if ((channel_count < 1)
+      || (routing_data->channel_count - old_channel_count + channel_count >
+          ROUTING_MAX_CHANNELS))
+    {
+      g_printerr ("Bus %s cannot have %d channels; the buses can have "
+                  "%d channels together.\n", bus_name, channel_count,
+                  ROUTING_MAX_CHANNELS);
+      return;
+    }
+
+  bus_data = g_malloc0 (sizeof (struct routing_bus));
+  bus_data->name = g_strdup (bus_name);
+  bus_data->channel_count = channel_count;
+  bus_data->device_name = g_strdup (device_name);
+
+  /* The new definition takes the old one's place, so the buses keep
+   * their order.  */
+  if (bus_number >= 0)
+    {
+      g_printerr ("Bus %s is defined more than once.\n", bus_name);
+      free_bus (g_ptr_array_index (routing_data->buses, bus_number));
+      g_ptr_array_index (routing_data->buses, bus_number) = bus_data;
+    }
+  else
+    g_ptr_array_add (routing_data->buses, bus_data);
+
+  /* Lay the buses' channels side by side.  */
+  routing_data->channel_count = 0;
+  for (bus_number = 0; bus_number < routing_data->buses->len; bus_number++)
+    {
+      bus_data = g_ptr_array_index (routing_data->buses, bus_number);
+      bus_data->first_channel = routing_data->channel_count;
+      routing_data->channel_count =
+        routing_data->channel_count + bus_data->channel_count;
+    }
+
+  return;
+}
+
+/* Forget the routing of the previous show.  */
+void
+routing_forget (GApplication * app)
+{
+  struct routing_info *routing_data;
+
+  routing_data = sep_get_routing_data (app);
+  g_ptr_array_set_size (routing_data->buses, 0);
+  routing_data->channel_count = 0;
+  g_free (routing_data->device_name);
+  routing_data->device_name = NULL;
+  routing_data->change_reported = FALSE;
+  return;
+}
+
+/* Find the number of buses.  */
+gint
+routing_get_bus_count (GApplication * app)
+{
+  struct routing_info *routing_data;
+
+  routing_data = sep_get_routing_data (app);
+  return routing_data->buses->len;
+}
+
+/* Find a bus by its number.  */
+const struct routing_bus *
+routing_get_bus (gint bus_number, GApplication * app)
+{
+  struct routing_info *routing_data;
+
+  routing_data = sep_get_routing_data (app);
+  if ((bus_number < 0) || (bus_number >= routing_data->buses->len))
+    return NULL;
+  return g_ptr_array_index (routing_data->buses, bus_number);
+}
+
+/* Find the number of channels of all the buses together.  */
+gint
+routing_get_channel_count (GApplication * app)
+{
+  struct routing_info *routing_data;
+
+  routing_data = sep_get_routing_data (app);
+  return routing_data->channel_count;
+}
+
+/* Find the multichannel device.  */
+const gchar *
+routing_get_device (GApplication * app)
+{
+  struct routing_info *routing_data;
+
+  routing_data = sep_get_routing_data (app);
+  return routing_data->device_name;
+}
+
+/* Add a sound's left and right channels to a bus.  A stereo sound goes
+ * to the first two channels of a bus; a one-channel bus gets both
+ * halves of it.  */
+static void
+add_send (const struct routing_bus *bus_data, gfloat level, gfloat * gains)
+{
+  gfloat *row;
+
+  row = gains + (bus_data->first_channel * 2);
+  if (bus_data->channel_count == 1)
+    {
+      row[0] = row[0] + (level * 0.5);
+      row[1] = row[1] + (level * 0.5);
+    }
+  else
+    {
+      row[0] = row[0] + level;
+      row[3] = row[3] + level;
+    }
+  return;
+}
+
+/* Place a sound on one channel of a bus.  The channel gets both halves
+ * of the sound.  */
+static void
+add_speaker (const struct routing_bus *bus_data, gint channel, gfloat level,
+             gfloat * gains)
+{
+  gfloat *row;
+
+  row = gains + ((bus_data->first_channel + channel - 1) * 2);
+  row[0] = row[0] + (level * 0.5);
+  row[1] = row[1] + (level * 0.5);
+  return;
+}
+
+/* Compute the gains from a sound's left and right channels to each
+ * output channel.  */
+void
+routing_get_gains (struct sound_info *sound_data, gfloat * gains,
+                   GApplication * app)
+{
+  struct routing_info *routing_data;
+  const struct routing_bus *bus_data;
+  gint send_number, speaker_number, bus_number;
+
+  routing_data = sep_get_routing_data (app);
+  memset (gains, 0, routing_data->channel_count * 2 * sizeof (gfloat));
+  if (routing_data->buses->len == 0)
+    return;
+
+  /* A sound that is sent nowhere goes to the first bus.  */
+  if ((sound_data->send_count == 0) && (sound_data->speaker_count == 0))
+    {
+      add_send (g_ptr_array_index (routing_data->buses, 0), 1.0, gains);
+      return;
+    }
+
+  for (send_number = 0; send_number < sound_data->send_count;
+       send_number++)
+    {
+      bus_number =
+        find_bus (routing_data, sound_data->sends[send_number].bus_name);
+      if (bus_number < 0)
+        {
+          g_printerr ("Sound %s is sent to bus %s, which is not defined.\n",
+                      sound_data->name,
+                      sound_data->sends[send_number].bus_name);
+          continue;
+        }
+      add_send (g_ptr_array_index (routing_data->buses, bus_number),
+                sound_data->sends[send_number].level, gains);
+    }
+
+  for (speaker_number = 0; speaker_number < sound_data->speaker_count;
+       speaker_number++)
+    {
+      bus_number = 0;
+      if (sound_data->speakers[speaker_number].bus_name != NULL)
+        bus_number =
+          find_bus (routing_data,
+                    sound_data->speakers[speaker_number].bus_name);
+      if (bus_number < 0)
+        {
+          g_printerr ("Sound %s is placed on bus %s, which is not "
+                      "defined.\n", sound_data->name,
+                      sound_data->speakers[speaker_number].bus_name);
+          continue;
+        }
+      bus_data = g_ptr_array_index (routing_data->buses, bus_number);
+      if ((sound_data->speakers[speaker_number].channel < 1)
+          || (sound_data->speakers[speaker_number].channel >
+              bus_data->channel_count))
+        {
+          g_printerr ("Sound %s is placed on channel %d of bus %s, which "
+                      "has %d.\n", sound_data->name,
+                      sound_data->speakers[speaker_number].channel,
+                      bus_data->name, bus_data->channel_count);
+          continue;
+        }
+      add_speaker (bus_data, sound_data->speakers[speaker_number].channel,
+                   sound_data->speakers[speaker_number].level, gains);
+    }
+
+  return;
+}
@@ -0,0 +1,74 @@
+/*
+ * routing_subroutines.h
+ *
+ * Copyright © 2016 by John Sauter <John_Sauter@systemeyescomputerstore.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <gtk/gtk.h>
+#include "sound_structure.h"
+
+/* The most channels the buses can have together.  */
+#define ROUTING_MAX_CHANNELS 64
+
+/* An output bus, such as the mains, the delays or the monitors.  The
+ * buses' channels are laid side by side in the output of the mixer,
+ * each bus starting at its first channel.  */
+struct routing_bus
+{
+  gchar *name;
+  gint channel_count;
+  gchar *device_name;           /* NULL means the default device */
+  gint first_channel;
+};
+
+/* Subroutines defined in routing_subroutines.c */
+
+/* Initialize the output routing.  */
+void *routing_init (GApplication * app);
+
+/* Send the whole output, every bus, to one multichannel device.  */
+void routing_set_device (const gchar * device_name, GApplication * app);
+
+/* Define an output bus.  Once the pipeline is built, the routing
+ * cannot change; a different definition is reported and ignored.  */
+void routing_define_bus (const gchar * bus_name, gint channel_count,
+                         const gchar * device_name, GApplication * app);
+
+/* Forget the routing of the previous show.  */
+void routing_forget (GApplication * app);
+
+/* Find the number of buses.  Zero means the show defines no routing,
+ * and everything goes to the default device in stereo.  */
+gint routing_get_bus_count (GApplication * app);
+
+/* Find a bus by its number.  */
+const struct routing_bus *routing_get_bus (gint bus_number,
+                                           GApplication * app);
+
+/* Find the number of channels of all the buses together.  */
+gint routing_get_channel_count (GApplication * app);
+
+/* Find the multichannel device, or NULL if each bus has its own.  */
+const gchar *routing_get_device (GApplication * app);
+
+/* Compute the gains from a sound's left and right channels to each
+ * output channel, as a matrix of routing_get_channel_count rows of two
+ * columns.  */
+void routing_get_gains (struct sound_info *sound_data, gfloat * gains,
+                        GApplication * app);
+
+/* End of file routing_subroutines.h */
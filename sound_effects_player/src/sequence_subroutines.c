@@ -27,11 +27,8 @@
 #include "sound_subroutines.h"
 #include "button_subroutines.h"
 #include "timer_subroutines.h"
+#include "trace_ring_subroutines.h"
 
-/* When debugging it can be useful to trace what is happening in the
- * internal sequencer.  */
-#define TRACE_SEQUENCER FALSE
-#define TRACE_SEQUENCER_DISPLAY_MESSAGE FALSE
 #define DO_OPERATOR_DISPLAY TRUE
 
 /* the persistent data used by the internal sequencer */
@@ -52,10 +49,8 @@ struct sequence_info
                                  * waiting for their turn at the operator.  */
   GList *waiting;               /* The Wait sequence items that are still 
                                  * pending.  */
-  gboolean message_displaying;  /* TRUE if the sequencer is displaying a
-                                 * message to the operator.  */
-  guint message_id;             /* The ID of the message being displayed by the
-                                 * sequencer.  */
+  gboolean message_displaying;  /* TRUE if the sequencer is displaying the
+                                 * status of a sound to the operator.  */
 };
 
 /* an entry on the running, offering or operator waiting lists */
@@ -113,7 +108,6 @@ static void execute_operator_wait (struct sequence_item_info *the_item,
 
 static void update_operator_display (struct sequence_info *sequence_data,
                                      GApplication * app);
-static void clock_tick (void *sequence_data, GApplication * app);
 static void cancel_operator_display (struct remember_info *remember_data,
                                      struct sequence_info *sequence_data,
                                      GApplication * app);
@@ -134,7 +128,6 @@ sequence_init (GApplication * app)
   sequence_data->operator_waiting = NULL;
   sequence_data->waiting = NULL;
   sequence_data->message_displaying = FALSE;
-  sequence_data->message_id = 0;
   return (sequence_data);
 }
 
@@ -149,6 +142,64 @@ sequence_append_item (struct sequence_item_info *item, GApplication * app)
   return;
 }
 
+/* Find the list of sequence items.  */
+GList *
+sequence_get_item_list (GApplication * app)
+{
+  struct sequence_info *sequence_data;
+
+  sequence_data = sep_get_sequence_data (app);
+  return (sequence_data->item_list);
+}
+
+/* Replace the list of sequence items.  The caller is responsible
+ * for the items on the old list, but must not free any that are
+ * in use.  */
+void
+sequence_set_item_list (GList * item_list, GApplication * app)
+{
+  struct sequence_info *sequence_data;
+
+  sequence_data = sep_get_sequence_data (app);
+  sequence_data->item_list = item_list;
+  return;
+}
+
+/* Search a list of remembered sequence items for an item.  */
+static gboolean
+item_remembered (struct sequence_item_info *item, GList * remember_list)
+{
+  GList *l;
+  struct remember_info *remember_data;
+
+  for (l = remember_list; l != NULL; l = l->next)
+    {
+      remember_data = l->data;
+      if (remember_data->sequence_item == item)
+        return TRUE;
+    }
+  return FALSE;
+}
+
+/* Determine whether the sequencer is still acting on a sequence item:
+ * a sound it started, a sound it offers, a wait or an operator wait.
+ * Such an item must not be freed.  */
+gboolean
+sequence_item_in_use (struct sequence_item_info *item, GApplication * app)
+{
+  struct sequence_info *sequence_data;
+
+  sequence_data = sep_get_sequence_data (app);
+  if ((sequence_data->current_operator_wait != NULL)
+      && (sequence_data->current_operator_wait->sequence_item == item))
+    return TRUE;
+
+  return (item_remembered (item, sequence_data->running)
+          || item_remembered (item, sequence_data->offering)
+          || item_remembered (item, sequence_data->operator_waiting)
+          || item_remembered (item, sequence_data->waiting));
+}
+
 /* Start running the sequencer.  */
 void
 sequence_start (GApplication * app)
@@ -227,9 +278,9 @@ find_item_by_name (gchar * item_name, struct sequence_info *sequence_data)
   struct sequence_item_info *item, *found_item;
   GList *item_list;
 
-  if (TRACE_SEQUENCER)
+  if (TRACE_RING_ENABLED (trace_sequencer))
     {
-      g_print ("Searching for item %s.\n", item_name);
+      trace_ring_record (trace_sequencer, "Searching for item %s.", item_name);
     }
 
   found_item = NULL;
@@ -238,7 +289,9 @@ find_item_by_name (gchar * item_name, struct sequence_info *sequence_data)
     {
       item = item_list->data;
 
-      if (g_strcmp0 (item_name, item->name) == 0)
+      /* The names of sequence items, and the names they refer to,
+       * are interned, so they can be compared by address.  */
+      if (item->name == item_name)
         {
           found_item = item;
           break;
@@ -305,22 +358,26 @@ execute_start_sound (struct sequence_item_info *the_item,
   gboolean item_found;
   GList *item_list;
 
-  if (TRACE_SEQUENCER)
+  if (TRACE_RING_ENABLED (trace_sequencer))
     {
-      g_print ("Start Sound, cluster = %d, sound name = %s, next = %s, "
-               " complete = %s, terminate = %s.\n", the_item->cluster_number,
-               the_item->sound_name, the_item->next_starts,
-               the_item->next_completion, the_item->next_termination);
-
-      g_print ("item_list = %p, " "next_item_name = %p, " "running = %p, "
-               "offering = %p, " "current_operator_wait = %p, "
-               "operator_waiting = %p, " "waiting = %p, "
-               "message_displaying = %d, " "message_id = %d.\n",
-               sequence_data->item_list, sequence_data->next_item_name,
-               sequence_data->running, sequence_data->offering,
-               sequence_data->current_operator_wait,
-               sequence_data->operator_waiting, sequence_data->waiting,
-               sequence_data->message_displaying, sequence_data->message_id);
+      trace_ring_record (trace_sequencer,
+                         "Start Sound, cluster = %d, sound name = %s, "
+                         "next = %s, complete = %s, terminate = %s.",
+                         the_item->cluster_number, the_item->sound_name,
+                         the_item->next_starts, the_item->next_completion,
+                         the_item->next_termination);
+
+      trace_ring_record (trace_sequencer, "item_list = %p, "
+                         "next_item_name = %p, " "running = %p, "
+                         "offering = %p, " "current_operator_wait = %p, "
+                         "operator_waiting = %p, " "waiting = %p, "
+                         "message_displaying = %d.", sequence_data->item_list,
+                         sequence_data->next_item_name, sequence_data->running,
+                         sequence_data->offering,
+                         sequence_data->current_operator_wait,
+                         sequence_data->operator_waiting,
+                         sequence_data->waiting,
+                         sequence_data->message_displaying);
     }
 
   cluster_number = the_item->cluster_number;
@@ -350,6 +407,7 @@ execute_start_sound (struct sequence_item_info *the_item,
       /* There is a sound on this cluster, but it is releasing.
        * Remove it from the cluster in favor of this new sound.  */
       button_reset_cluster (old_sound_effect, app);
+      display_set_cluster_sound (cluster_number, NULL, app);
       remember_data->off_cluster = TRUE;
     }
 
@@ -404,10 +462,10 @@ execute_stop_sound (struct sequence_item_info *the_item,
   gboolean item_found, still_searching;
   GList *item_list;
 
-  if (TRACE_SEQUENCER)
+  if (TRACE_RING_ENABLED (trace_sequencer))
     {
-      g_print ("stop sound, tag = %s, next = %s.\n", the_item->tag,
-               the_item->next);
+      trace_ring_record (trace_sequencer, "stop sound, tag = %s, next = %s.",
+                         the_item->tag, the_item->next);
     }
 
   /* Stop all running sounds with the specified tag.  */
@@ -423,7 +481,7 @@ execute_stop_sound (struct sequence_item_info *the_item,
         {
           remember_data = item_list->data;
           sequence_item = remember_data->sequence_item;
-          if ((g_strcmp0 (the_item->tag, sequence_item->tag) == 0)
+          if ((the_item->tag == sequence_item->tag)
               && remember_data->active && !remember_data->release_sent)
             {
               item_found = TRUE;
@@ -455,13 +513,14 @@ execute_wait (struct sequence_item_info *the_item,
 {
   struct remember_info *remember_data;
 
-  if (TRACE_SEQUENCER)
+  if (TRACE_RING_ENABLED (trace_sequencer))
     {
-      g_print ("Wait, name = %s, time = %" G_GUINT64_FORMAT ","
-               " when complete = %s, operator text = %s, next = %s.\n",
-               the_item->name, the_item->time_to_wait,
-               the_item->next_completion, the_item->text_to_display,
-               the_item->next);
+      trace_ring_record (trace_sequencer,
+                         "Wait, name = %s, time = %" G_GUINT64_FORMAT ","
+                         " when complete = %s, operator text = %s, next = %s.",
+                         the_item->name, the_item->time_to_wait,
+                         the_item->next_completion, the_item->text_to_display,
+                         the_item->next);
     }
 
   /* Record information about the wait, since we will need it when
@@ -536,16 +595,19 @@ wait_completed (void *user_data, GApplication * app)
       return;
     }
 
-  if (TRACE_SEQUENCER)
+  if (TRACE_RING_ENABLED (trace_sequencer))
     {
-      g_print ("Wait completed, name = %s, time = %" G_GUINT64_FORMAT ","
-               " when complete = %s, operator text = %s, next = %s.\n",
-               current_sequence_item->name,
-               current_sequence_item->time_to_wait,
-               current_sequence_item->next_completion,
-               current_sequence_item->text_to_display,
-               current_sequence_item->next);
-      g_print ("sequence_data->waiting  == %p.\n", sequence_data->waiting);
+      trace_ring_record (trace_sequencer,
+                         "Wait completed, name = %s, time = %"
+                         G_GUINT64_FORMAT ","
+                         " when complete = %s, operator text = %s, next = %s.",
+                         current_sequence_item->name,
+                         current_sequence_item->time_to_wait,
+                         current_sequence_item->next_completion,
+                         current_sequence_item->text_to_display,
+                         current_sequence_item->next);
+      trace_ring_record (trace_sequencer, "sequence_data->waiting  == %p.",
+                         sequence_data->waiting);
     }
   /* TODO: display the wait list item that will end soonest,
    * or the current operator wait if there is one.  */
@@ -564,13 +626,15 @@ execute_offer_sound (struct sequence_item_info *the_item,
 {
   struct remember_info *remember_data;
 
-  if (TRACE_SEQUENCER)
+  if (TRACE_RING_ENABLED (trace_sequencer))
     {
-      g_print ("Offer sound, name = %s, cluster = %d, Q number = %s, "
-               "next = %s,\n   next_to_start = %s, offering = %p.\n",
-               the_item->name, the_item->cluster_number, the_item->Q_number,
-               the_item->next, the_item->next_to_start,
-               sequence_data->offering);
+      trace_ring_record (trace_sequencer,
+                         "Offer sound, name = %s, cluster = %d, "
+                         "Q number = %s, next = %s,\n   next_to_start = %s, "
+                         "offering = %p.",
+                         the_item->name, the_item->cluster_number,
+                         the_item->Q_number, the_item->next,
+                         the_item->next_to_start, sequence_data->offering);
     }
 
   /* Set the name of the cluster to the specified text.  */
@@ -591,10 +655,10 @@ execute_offer_sound (struct sequence_item_info *the_item,
   sequence_data->offering =
     g_list_append (sequence_data->offering, remember_data);
 
-  if (TRACE_SEQUENCER)
+  if (TRACE_RING_ENABLED (trace_sequencer))
     {
-      g_print ("End of Offer sound, offering = %p.\n",
-               sequence_data->offering);
+      trace_ring_record (trace_sequencer, "End of Offer sound, offering = %p.",
+                         sequence_data->offering);
     }
 
 
@@ -615,10 +679,12 @@ execute_cease_offering_sound (struct sequence_item_info *the_item,
   struct sequence_item_info *sequence_item;
   GList *list_element, *next_list_element;
 
-  if (TRACE_SEQUENCER)
+  if (TRACE_RING_ENABLED (trace_sequencer))
     {
-      g_print ("Cease offering sound, name = %s, tag = %s, " "next = %s.\n",
-               the_item->name, the_item->tag, the_item->next);
+      trace_ring_record (trace_sequencer,
+                         "Cease offering sound, name = %s, tag = %s, "
+                         "next = %s.", the_item->name, the_item->tag,
+                         the_item->next);
     }
 
   /* Process every Offer Sound sequence item with the same tag.  */
@@ -628,7 +694,7 @@ execute_cease_offering_sound (struct sequence_item_info *the_item,
       next_list_element = list_element->next;
       remember_data = list_element->data;
       sequence_item = remember_data->sequence_item;
-      if ((g_strcmp0 (the_item->tag, sequence_item->tag) == 0)
+      if ((the_item->tag == sequence_item->tag)
           && (remember_data->active))
         {
           /* We have a match.  */
@@ -662,12 +728,13 @@ execute_operator_wait (struct sequence_item_info *the_item,
 {
   struct remember_info *remember_data;
 
-  if (TRACE_SEQUENCER)
+  if (TRACE_RING_ENABLED (trace_sequencer))
     {
-      g_print ("Operator Wait, name = %s, next play = %s, "
-               "operator text = %s, next = %s.\n", the_item->name,
-               the_item->next_play, the_item->text_to_display,
-               the_item->next);
+      trace_ring_record (trace_sequencer,
+                         "Operator Wait, name = %s, next play = %s, "
+                         "operator text = %s, next = %s.", the_item->name,
+                         the_item->next_play, the_item->text_to_display,
+                         the_item->next);
     }
 
   /* Record information about the operator wait, since we will need it when
@@ -703,7 +770,8 @@ execute_operator_wait (struct sequence_item_info *the_item,
 }
 
 /* Update the operator display.  Show the most important item, preferring
- * the current item in case of a tie.  */
+ * the current item in case of a tie.  This is done when the running
+ * sounds change; the display keeps the times current as they play.  */
 static void
 update_operator_display (struct sequence_info *sequence_data,
                          GApplication * app)
@@ -712,12 +780,9 @@ update_operator_display (struct sequence_info *sequence_data,
   struct sequence_item_info *sequence_item;
   struct remember_info *most_important;
   struct remember_info *current_display;
-  struct sound_info *sound_effect;
   gboolean found_item;
   guint most_importance;
   GList *item_list;
-  gchar *elapsed_time, *remaining_time;
-  gchar *display_text;
 
   /* For debugging, optionally don't update the operator display.  */
   if (!DO_OPERATOR_DISPLAY)
@@ -773,28 +838,12 @@ update_operator_display (struct sequence_info *sequence_data,
        * "current_display" is the item we are currently displaying, if any.  
        * These may be the same item.  */
       sequence_item = most_important->sequence_item;
-      sound_effect = most_important->sound_effect;
-      /* Prepend the elapsed time to the operator message, and append
-       * the remaining time.  */
-      elapsed_time = sound_get_elapsed_time (sound_effect, app);
-      remaining_time = sound_get_remaining_time (sound_effect, app);
-      display_text =
-        g_strdup_printf ("%s %s (%s)", elapsed_time,
-                         sequence_item->text_to_display, remaining_time);
-      /* If there is a message already being displayed by the sequencer,
-       * remove it.  */
-      if (sequence_data->message_displaying)
-        {
-          display_remove_message (sequence_data->message_id, app);
-        }
 
-      /* Display the most important message.  */
-      sequence_data->message_id = display_show_message (display_text, app);
+      /* Display the status of the most important sound, replacing
+       * any already being displayed by the sequencer.  */
+      display_set_operator_status (most_important->sound_effect,
+                                   sequence_item->text_to_display, app);
       sequence_data->message_displaying = TRUE;
-      g_free (display_text);
-      display_text = NULL;
-      g_free (elapsed_time);
-      elapsed_time = NULL;
 
       /* Mark the most important item as the one currently being displayed.  */
       if (current_display != NULL)
@@ -803,24 +852,14 @@ update_operator_display (struct sequence_info *sequence_data,
         }
       most_important->being_displayed = TRUE;
 
-      if (TRACE_SEQUENCER && TRACE_SEQUENCER_DISPLAY_MESSAGE)
+      if (TRACE_RING_ENABLED (trace_display))
         {
-          g_print ("Display message %d.\n", sequence_data->message_id);
+          trace_ring_record (trace_display, "Display status of %s.",
+                             most_important->sound_effect->name);
         }
-      /* Keep updating the display every 0.1 second until there is nothing
-       * to show.  */
-      timer_create_entry (clock_tick, 0.1, sequence_data, app);
     }
 }
 
-/* Come here when the 0.1-second clock ticks to update the operator display.  */
-static void
-clock_tick (void *user_data, GApplication * app)
-{
-  struct sequence_info *sequence_data = user_data;
-  update_operator_display (sequence_data, app);
-}
-
 /* Cease showing some text to the operator.  */
 static void
 cancel_operator_display (struct remember_info *remember_data,
@@ -830,13 +869,13 @@ cancel_operator_display (struct remember_info *remember_data,
 
   if (sequence_data->message_displaying && remember_data->being_displayed)
     {
-      if (TRACE_SEQUENCER)
+      if (TRACE_RING_ENABLED (trace_sequencer))
         {
-          g_print ("Cancel message %d.\n", sequence_data->message_id);
+          trace_ring_record (trace_sequencer, "Cancel status of %s.",
+                             remember_data->sound_effect->name);
         }
-      display_remove_message (sequence_data->message_id, app);
+      display_clear_operator_status (app);
       remember_data->being_displayed = FALSE;
-      sequence_data->message_id = 0;
       sequence_data->message_displaying = FALSE;
     }
 }
@@ -855,9 +894,10 @@ sequence_MIDI_show_control_go (gchar * Q_number, GApplication * app)
 
   sequence_data = sep_get_sequence_data (app);
 
-  if (TRACE_SEQUENCER)
+  if (TRACE_RING_ENABLED (trace_sequencer))
     {
-      g_print ("MIDI show control go, Q_number = %s.\n", Q_number);
+      trace_ring_record (trace_sequencer,
+                         "MIDI show control go, Q_number = %s.", Q_number);
     }
 
   /* Find the cluster whose Offer Sound sequence item has the specified
@@ -933,9 +973,11 @@ sequence_cluster_start (guint cluster_number, GApplication * app)
   gboolean found_item;
   GList *item_list;
 
-  if (TRACE_SEQUENCER)
+  if (TRACE_RING_ENABLED (trace_sequencer))
     {
-      g_print ("sequence_cluster_start: cluster = %d.\n", cluster_number);
+      trace_ring_record (trace_sequencer,
+                         "sequence_cluster_start: cluster = %d.",
+                         cluster_number);
     }
 
   sequence_data = sep_get_sequence_data (app);
@@ -1075,10 +1117,11 @@ sequence_sound_completion (struct sound_info *sound_effect,
 
   sequence_data = sep_get_sequence_data (app);
 
-  if (TRACE_SEQUENCER)
+  if (TRACE_RING_ENABLED (trace_sequencer))
     {
-      g_print ("completion of sound %s on cluster %d.\n", sound_effect->name,
-               sound_effect->cluster_number);
+      trace_ring_record (trace_sequencer,
+                         "completion of sound %s on cluster %d.",
+                         sound_effect->name, sound_effect->cluster_number);
     }
 
   /* See if there is a Start Sound sequence item outstanding which names
@@ -1117,6 +1160,7 @@ sequence_sound_completion (struct sound_info *sound_effect,
   if (!remember_data->off_cluster)
     {
       button_reset_cluster (sound_effect, app);
+      display_set_cluster_sound (remember_data->cluster_number, NULL, app);
       remember_data->off_cluster = TRUE;
 
 /* See if there is an Offer Sound sequence item outstanding which names
@@ -1139,9 +1183,9 @@ sequence_sound_completion (struct sound_info *sound_effect,
  * the text field.  */
       if (item_found)
         {
-          if (TRACE_SEQUENCER)
+          if (TRACE_RING_ENABLED (trace_sequencer))
             {
-              g_print ("Offer sound found.\n");
+              trace_ring_record (trace_sequencer, "Offer sound found.");
             }
           sound_cluster_set_name (offer_sound_sequence_item->text_to_display,
                                   remember_data->cluster_number, app);
@@ -1192,10 +1236,11 @@ sequence_sound_release_started (struct sound_info *sound_effect,
 
   sequence_data = sep_get_sequence_data (app);
 
-  if (TRACE_SEQUENCER)
+  if (TRACE_RING_ENABLED (trace_sequencer))
     {
-      g_print ("release started for sound %s on cluster %d.\n",
-               sound_effect->name, sound_effect->cluster_number);
+      trace_ring_record (trace_sequencer,
+                         "release started for sound %s on cluster %d.",
+                         sound_effect->name, sound_effect->cluster_number);
     }
   sound_effect->release_has_started = TRUE;
 
@@ -31,6 +31,16 @@ void *sequence_init (GApplication * app);
 void sequence_append_item (struct sequence_item_info *sequence_item_data,
                            GApplication * app);
 
+/* Find the list of sequence items.  */
+GList *sequence_get_item_list (GApplication * app);
+
+/* Replace the list of sequence items.  */
+void sequence_set_item_list (GList * item_list, GApplication * app);
+
+/* Determine whether the sequencer is still acting on a sequence item.  */
+gboolean sequence_item_in_use (struct sequence_item_info *item,
+                               GApplication * app);
+
 /* Start the internal sequencer.  */
 void sequence_start (GApplication * app);
 
@@ -0,0 +1,837 @@
+/*
+ * show_image_subroutines.c
+ *
+ * Copyright © 2016 by John Sauter <John_Sauter@systemeyescomputerstore.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <gtk/gtk.h>
+#include <glib/gstdio.h>
+#include "network_subroutines.h"
+#include "routing_subroutines.h"
+#include "sequence_structure.h"
+#include "sequence_subroutines.h"
+#include "show_image_subroutines.h"
+#include "arena_subroutines.h"
+#include "sound_effects_player.h"
+#include "sound_structure.h"
+#include "sound_subroutines.h"
+#include "tracer_subroutines.h"
+#include "trace_ring_subroutines.h"
+
+/* A compiled show image holds everything the player reads from the 
+ * project file and the files it refers to, after relative file names 
+ * have been resolved, in a form that can be mapped into memory and 
+ * used without parsing.  It is written by "sound_effects_player 
+ * --compile project.xml" next to the project file, with ".image" 
+ * appended to its name.  When the project file is loaded, the image 
+ * is used instead if the size and modification time, to the
+ * nanosecond, of every file it was compiled from are unchanged.
+ * Otherwise the XML files are read.
+ *
+ * The image is a header followed by tables of fixed-size records:
+ * the fingerprints of the source files, the sounds, the sequence 
+ * items and the output buses, then a table of strings.  Each string
+ * is stored once, and is referred to by its offset in the string
+ * table, offset 0 meaning no string.  The links between sequence
+ * items are kept as the names of the items, since that is how the
+ * sequencer finds them; each is checked when the image is written.
+ * All values are in the byte order of the machine that compiled the
+ * show; an image from a machine of the other byte order, or from a
+ * different version of the player, is ignored.  */
+
+#define SHOW_IMAGE_MAGIC "SEPSHOW"
+#define SHOW_IMAGE_VERSION 6
+#define SHOW_IMAGE_BYTE_ORDER 0x01020304
+#define SHOW_IMAGE_SUFFIX ".image"
+
+/* Flags in the sound and sequence item records.  */
+#define SHOW_IMAGE_RELEASE_DURATION_INFINITE 0x0001
+#define SHOW_IMAGE_MIDI_PROGRAM_NUMBER_SPECIFIED 0x0002
+#define SHOW_IMAGE_MIDI_NOTE_NUMBER_SPECIFIED 0x0004
+#define SHOW_IMAGE_OSC_NAME_SPECIFIED 0x0008
+#define SHOW_IMAGE_FUNCTION_KEY_SPECIFIED 0x0010
+#define SHOW_IMAGE_OMIT_PANNING 0x0020
+#define SHOW_IMAGE_CLUSTER_NUMBER_SPECIFIED 0x0040
+#define SHOW_IMAGE_OMIT_FROM_DISPLAY 0x0080
+
+struct show_image_header
+{
+  gchar magic[8];
+  guint32 version;
+  guint32 byte_order;
+
+  /* The sizes of the records, so a change in layout is noticed.  */
+  guint32 header_size;
+  guint32 fingerprint_size;
+  guint32 sound_size;
+  guint32 sequence_item_size;
+  guint32 bus_size;
+
+  guint32 fingerprint_offset, fingerprint_count;
+  guint32 sound_offset, sound_count;
+  guint32 sequence_item_offset, sequence_item_count;
+  guint32 bus_offset, bus_count;
+  guint32 string_offset, string_size;
+
+  gint32 port_number;
+  guint32 trace_file_name;
+  guint32 routing_device_name;
+};
+
+/* The identity of a file the show was compiled from.  */
+struct show_image_fingerprint
+{
+  gint64 size;
+  gint64 modification_time;     /* nanoseconds */
+  guint32 file_name;
+  guint32 padding;
+};
+
+struct show_image_sound
+{
+  guint64 attack_duration_time;
+  gdouble attack_level;
+  gdouble decay_duration_time;
+  gdouble sustain_level;
+  guint64 release_start_time;
+  guint64 release_duration_time;
+  gint64 loop_from_time;
+  gint64 loop_to_time;
+  guint64 max_duration_time;
+  guint64 start_time;
+  gdouble designer_volume_level;
+  gdouble designer_pan;
+  gint32 loop_limit;
+  gint32 MIDI_program_number;
+  gint32 MIDI_note_number;
+  guint32 flags;
+  guint32 name;
+  guint32 wav_file_name;
+  guint32 wav_file_name_full;
+  guint32 OSC_name;
+  guint32 function_key;
+  guint32 send_count;
+  guint32 send_bus_name[SOUND_MAX_SENDS];
+  gfloat send_level[SOUND_MAX_SENDS];
+  guint32 speaker_count;
+  guint32 speaker_bus_name[SOUND_MAX_SPEAKERS];
+  gint32 speaker_channel[SOUND_MAX_SPEAKERS];
+  gfloat speaker_level[SOUND_MAX_SPEAKERS];
+  guint32 padding;
+};
+
+struct show_image_sequence_item
+{
+  gdouble volume;
+  gdouble pan;
+  guint64 time_to_wait;
+  guint32 type;
+  guint32 use_external_velocity;
+  guint32 program_number;
+  guint32 bank_number;
+  guint32 cluster_number;
+  guint32 importance;
+  guint32 macro_number;
+  gint32 MIDI_program_number;
+  gint32 MIDI_note_number;
+  guint32 flags;
+  guint32 name;
+  guint32 sound_name;
+  guint32 tag;
+  guint32 Q_number;
+  guint32 text_to_display;
+  guint32 OSC_name;
+  guint32 function_key;
+  guint32 next_completion;
+  guint32 next_termination;
+  guint32 next_starts;
+  guint32 next_release_started;
+  guint32 next;
+  guint32 next_to_start;
+  guint32 next_play;
+};
+
+struct show_image_bus
+{
+  guint32 name;
+  guint32 device_name;
+  gint32 channel_count;
+  guint32 padding;
+};
+
+/* The persistent data used by the show image subroutines.  */
+struct show_image_info
+{
+  /* The files read to load the current show.  */
+  GPtrArray *source_files;
+};
+
+/* The state of an image being written.  */
+struct image_writer
+{
+  GString *strings;
+  GHashTable *string_offsets;
+  GHashTable *item_names;
+  guint unresolved_link_count;
+};
+
+/* The modification time of a file, in nanoseconds, so an edit made
+ * in the same second as the image was written is noticed.  */
+static gint64
+modification_time (GStatBuf * file_status)
+{
+  return ((gint64) file_status->st_mtim.tv_sec * 1000000000) +
+    file_status->st_mtim.tv_nsec;
+}
+
+/* Initialize the show image subroutines.  */
+void *
+show_image_init (GApplication * app)
+{
+  struct show_image_info *show_image_data;
+
+  show_image_data = g_malloc0 (sizeof (struct show_image_info));
+  show_image_data->source_files = g_ptr_array_new_with_free_func (g_free);
+  return show_image_data;
+}
+
+/* Note a file that was read to load the show.  */
+void
+show_image_note_source (const gchar * file_name, GApplication * app)
+{
+  struct show_image_info *show_image_data;
+
+  show_image_data = sep_get_show_image_data (app);
+  g_ptr_array_add (show_image_data->source_files, g_strdup (file_name));
+  return;
+}
+
+/* Forget the files of the previous show.  */
+void
+show_image_forget_sources (GApplication * app)
+{
+  struct show_image_info *show_image_data;
+
+  show_image_data = sep_get_show_image_data (app);
+  g_ptr_array_set_size (show_image_data->source_files, 0);
+  return;
+}
+
+/* Construct the name of the image of a project file.  */
+static gchar *
+image_file_name (const gchar * project_file_name)
+{
+  return g_strconcat (project_file_name, SHOW_IMAGE_SUFFIX, NULL);
+}
+
+/* Add a string to the string table, unless it is already there, 
+ * and return its offset.  */
+static guint32
+intern_string (struct image_writer *writer, const gchar * text)
+{
+  gpointer offset;
+
+  if (text == NULL)
+    return 0;
+
+  if (g_hash_table_lookup_extended (writer->string_offsets, text, NULL,
+                                    &offset))
+    return GPOINTER_TO_UINT (offset);
+
+  offset = GUINT_TO_POINTER (writer->strings->len);
+  g_string_append_len (writer->strings, text, strlen (text) + 1);
+  g_hash_table_insert (writer->string_offsets, (gpointer) text, offset);
+  return GPOINTER_TO_UINT (offset);
+}
+
+/* Check that a link from a sequence item names an item in the
+ * sequence, and return the offset of the name.  */
+static guint32
+check_link (struct image_writer *writer,
+            struct sequence_item_info *item, const gchar * field_name,
+            const gchar * target_name)
+{
+  if ((target_name != NULL)
+      && !g_hash_table_contains (writer->item_names, target_name))
+    {
+      g_printerr ("Sequence item %s: %s %s is not in the sequence.\n",
+                  item->name, field_name, target_name);
+      writer->unresolved_link_count = writer->unresolved_link_count + 1;
+    }
+  return intern_string (writer, target_name);
+}
+
+/* Write the image of the show that has just been loaded.  */
+gboolean
+show_image_write (const gchar * project_file_name, GApplication * app)
+{
+  struct show_image_info *show_image_data;
+  struct image_writer writer;
+  struct show_image_header header;
+  struct show_image_fingerprint *fingerprints;
+  struct show_image_sound *sound_records;
+  struct show_image_sequence_item *item_records;
+  struct show_image_bus *bus_records;
+  struct sound_info *sound_data;
+  struct sequence_item_info *item;
+  const struct routing_bus *bus_data;
+  GList *sound_list, *item_list, *l;
+  GString *image;
+  GStatBuf file_status;
+  gchar *file_name;
+  GError *error = NULL;
+  guint i, j;
+  gboolean written;
+
+  show_image_data = sep_get_show_image_data (app);
+  sound_list = sep_get_sound_list (app);
+  item_list = sequence_get_item_list (app);
+
+  writer.strings = g_string_new (NULL);
+  writer.string_offsets = g_hash_table_new (g_str_hash, g_str_equal);
+  writer.item_names = g_hash_table_new (g_str_hash, g_str_equal);
+  writer.unresolved_link_count = 0;
+
+  /* Offset 0 in the string table means no string.  */
+  g_string_append_c (writer.strings, '\0');
+
+  memset (&header, 0, sizeof (header));
+  memcpy (header.magic, SHOW_IMAGE_MAGIC, sizeof (header.magic));
+  header.version = SHOW_IMAGE_VERSION;
+  header.byte_order = SHOW_IMAGE_BYTE_ORDER;
+  header.header_size = sizeof (struct show_image_header);
+  header.fingerprint_size = sizeof (struct show_image_fingerprint);
+  header.sound_size = sizeof (struct show_image_sound);
+  header.sequence_item_size = sizeof (struct show_image_sequence_item);
+  header.bus_size = sizeof (struct show_image_bus);
+  header.fingerprint_count = show_image_data->source_files->len;
+  header.sound_count = g_list_length (sound_list);
+  header.sequence_item_count = g_list_length (item_list);
+  header.bus_count = routing_get_bus_count (app);
+  header.port_number = network_get_port (app);
+  header.trace_file_name =
+    intern_string (&writer, tracer_get_file_name (app));
+  header.routing_device_name =
+    intern_string (&writer, routing_get_device (app));
+
+  /* The fingerprints of the files the show was read from.  */
+  fingerprints =
+    g_new0 (struct show_image_fingerprint, header.fingerprint_count);
+  for (i = 0; i < header.fingerprint_count; i++)
+    {
+      file_name = g_ptr_array_index (show_image_data->source_files, i);
+      if (g_stat (file_name, &file_status) != 0)
+        {
+          g_printerr ("Cannot find the size of %s.\n", file_name);
+          continue;
+        }
+      fingerprints[i].file_name = intern_string (&writer, file_name);
+      fingerprints[i].size = file_status.st_size;
+      fingerprints[i].modification_time = modification_time (&file_status);
+    }
+
+  /* The sounds.  */
+  sound_records = g_new0 (struct show_image_sound, header.sound_count);
+  for (l = sound_list, i = 0; l != NULL; l = l->next, i++)
+    {
+      sound_data = l->data;
+      sound_records[i].name = intern_string (&writer, sound_data->name);
+      sound_records[i].wav_file_name =
+        intern_string (&writer, sound_data->wav_file_name);
+      sound_records[i].wav_file_name_full =
+        intern_string (&writer, sound_data->wav_file_name_full);
+      sound_records[i].OSC_name =
+        intern_string (&writer, sound_data->OSC_name);
+      sound_records[i].function_key =
+        intern_string (&writer, sound_data->function_key);
+      sound_records[i].attack_duration_time =
+        sound_data->attack_duration_time;
+      sound_records[i].attack_level = sound_data->attack_level;
+      sound_records[i].decay_duration_time = sound_data->decay_duration_time;
+      sound_records[i].sustain_level = sound_data->sustain_level;
+      sound_records[i].release_start_time = sound_data->release_start_time;
+      sound_records[i].release_duration_time =
+        sound_data->release_duration_time;
+      sound_records[i].loop_from_time = sound_data->loop_from_time;
+      sound_records[i].loop_to_time = sound_data->loop_to_time;
+      sound_records[i].loop_limit = sound_data->loop_limit;
+      sound_records[i].max_duration_time = sound_data->max_duration_time;
+      sound_records[i].start_time = sound_data->start_time;
+      sound_records[i].designer_volume_level =
+        sound_data->designer_volume_level;
+      sound_records[i].designer_pan = sound_data->designer_pan;
+      sound_records[i].MIDI_program_number = sound_data->MIDI_program_number;
+      sound_records[i].MIDI_note_number = sound_data->MIDI_note_number;
+      if (sound_data->release_duration_infinite)
+        sound_records[i].flags |= SHOW_IMAGE_RELEASE_DURATION_INFINITE;
+      if (sound_data->MIDI_program_number_specified)
+        sound_records[i].flags |= SHOW_IMAGE_MIDI_PROGRAM_NUMBER_SPECIFIED;
+      if (sound_data->MIDI_note_number_specified)
+        sound_records[i].flags |= SHOW_IMAGE_MIDI_NOTE_NUMBER_SPECIFIED;
+      if (sound_data->OSC_name_specified)
+        sound_records[i].flags |= SHOW_IMAGE_OSC_NAME_SPECIFIED;
+      if (sound_data->function_key_specified)
+        sound_records[i].flags |= SHOW_IMAGE_FUNCTION_KEY_SPECIFIED;
+      if (sound_data->omit_panning)
+        sound_records[i].flags |= SHOW_IMAGE_OMIT_PANNING;
+      sound_records[i].send_count = sound_data->send_count;
+      for (j = 0; j < sound_data->send_count; j++)
+        {
+          sound_records[i].send_bus_name[j] =
+            intern_string (&writer, sound_data->sends[j].bus_name);
+          sound_records[i].send_level[j] = sound_data->sends[j].level;
+        }
+      sound_records[i].speaker_count = sound_data->speaker_count;
+      for (j = 0; j < sound_data->speaker_count; j++)
+        {
+          sound_records[i].speaker_bus_name[j] =
+            intern_string (&writer, sound_data->speakers[j].bus_name);
+          sound_records[i].speaker_channel[j] =
+            sound_data->speakers[j].channel;
+          sound_records[i].speaker_level[j] = sound_data->speakers[j].level;
+        }
+    }
+
+  /* The sequence items.  Collect their names first, so the links
+   * between them can be checked.  */
+  for (l = item_list; l != NULL; l = l->next)
+    {
+      item = l->data;
+      if (item->name != NULL)
+        g_hash_table_add (writer.item_names, item->name);
+    }
+
+  item_records =
+    g_new0 (struct show_image_sequence_item, header.sequence_item_count);
+  for (l = item_list, i = 0; l != NULL; l = l->next, i++)
+    {
+      item = l->data;
+      item_records[i].name = intern_string (&writer, item->name);
+      item_records[i].type = item->type;
+      item_records[i].sound_name = intern_string (&writer, item->sound_name);
+      item_records[i].tag = intern_string (&writer, item->tag);
+      item_records[i].use_external_velocity = item->use_external_velocity;
+      item_records[i].volume = item->volume;
+      item_records[i].pan = item->pan;
+      item_records[i].program_number = item->program_number;
+      item_records[i].bank_number = item->bank_number;
+      item_records[i].cluster_number = item->cluster_number;
+      item_records[i].importance = item->importance;
+      item_records[i].Q_number = intern_string (&writer, item->Q_number);
+      item_records[i].text_to_display =
+        intern_string (&writer, item->text_to_display);
+      item_records[i].time_to_wait = item->time_to_wait;
+      item_records[i].MIDI_program_number = item->MIDI_program_number;
+      item_records[i].MIDI_note_number = item->MIDI_note_number;
+      item_records[i].OSC_name = intern_string (&writer, item->OSC_name);
+      item_records[i].macro_number = item->macro_number;
+      item_records[i].function_key =
+        intern_string (&writer, item->function_key);
+      if (item->cluster_number_specified)
+        item_records[i].flags |= SHOW_IMAGE_CLUSTER_NUMBER_SPECIFIED;
+      if (item->MIDI_note_number_specified)
+        item_records[i].flags |= SHOW_IMAGE_MIDI_NOTE_NUMBER_SPECIFIED;
+      if (item->omit_from_display)
+        item_records[i].flags |= SHOW_IMAGE_OMIT_FROM_DISPLAY;
+
+      item_records[i].next_completion =
+        check_link (&writer, item, "next_completion", item->next_completion);
+      item_records[i].next_termination =
+        check_link (&writer, item, "next_termination",
+                    item->next_termination);
+      item_records[i].next_starts =
+        check_link (&writer, item, "next_starts", item->next_starts);
+      item_records[i].next_release_started =
+        check_link (&writer, item, "next_release_started",
+                    item->next_release_started);
+      item_records[i].next = check_link (&writer, item, "next", item->next);
+      item_records[i].next_to_start =
+        check_link (&writer, item, "next_to_start", item->next_to_start);
+      item_records[i].next_play =
+        check_link (&writer, item, "next_play", item->next_play);
+    }
+
+  /* The output buses.  */
+  bus_records = g_new0 (struct show_image_bus, header.bus_count);
+  for (i = 0; i < header.bus_count; i++)
+    {
+      bus_data = routing_get_bus (i, app);
+      bus_records[i].name = intern_string (&writer, bus_data->name);
+      bus_records[i].device_name =
+        intern_string (&writer, bus_data->device_name);
+      bus_records[i].channel_count = bus_data->channel_count;
+    }
+
+  /* Lay out the image.  Every table starts on an 8-byte boundary.  */
+  header.fingerprint_offset = sizeof (header);
+  header.sound_offset =
+    header.fingerprint_offset +
+    (header.fingerprint_count * sizeof (struct show_image_fingerprint));
+  header.sequence_item_offset =
+    header.sound_offset +
+    (header.sound_count * sizeof (struct show_image_sound));
+  header.bus_offset =
+    header.sequence_item_offset +
+    (header.sequence_item_count * sizeof (struct show_image_sequence_item));
+  header.string_offset =
+    header.bus_offset + (header.bus_count * sizeof (struct show_image_bus));
+  header.string_size = writer.strings->len;
+
+  image = g_string_sized_new (header.string_offset + header.string_size);
+  g_string_append_len (image, (gchar *) & header, sizeof (header));
+  g_string_append_len (image, (gchar *) fingerprints,
+                       header.fingerprint_count *
+                       sizeof (struct show_image_fingerprint));
+  g_string_append_len (image, (gchar *) sound_records,
+                       header.sound_count * sizeof (struct show_image_sound));
+  g_string_append_len (image, (gchar *) item_records,
+                       header.sequence_item_count *
+                       sizeof (struct show_image_sequence_item));
+  g_string_append_len (image, (gchar *) bus_records,
+                       header.bus_count * sizeof (struct show_image_bus));
+  g_string_append_len (image, writer.strings->str, writer.strings->len);
+
+  /* Write the image under a temporary name and rename it, so a player
+   * starting meanwhile never sees half an image.  */
+  file_name = image_file_name (project_file_name);
+  written = g_file_set_contents (file_name, image->str, image->len, &error);
+  if (written)
+    {
+      g_print ("Compiled %s: %u sounds, %u sequence items, %u files, "
+               "%u strings, %" G_GSIZE_FORMAT " bytes.\n", file_name,
+               header.sound_count, header.sequence_item_count,
+               header.fingerprint_count,
+               g_hash_table_size (writer.string_offsets), image->len);
+      if (writer.unresolved_link_count > 0)
+        g_print ("%u links name sequence items which are not in the "
+                 "sequence.\n", writer.unresolved_link_count);
+    }
+  else
+    {
+      g_printerr ("Cannot write %s: %s\n", file_name, error->message);
+      g_error_free (error);
+    }
+
+  g_free (file_name);
+  g_string_free (image, TRUE);
+  g_free (fingerprints);
+  g_free (sound_records);
+  g_free (item_records);
+  g_free (bus_records);
+  g_hash_table_destroy (writer.string_offsets);
+  g_hash_table_destroy (writer.item_names);
+  g_string_free (writer.strings, TRUE);
+
+  return written;
+}
+
+/* Check that a table lies within the image.  */
+static gboolean
+table_is_valid (gsize image_length, guint32 offset, guint32 count,
+                gsize record_size)
+{
+  if ((offset % 8) != 0)
+    return FALSE;
+  if (offset > image_length)
+    return FALSE;
+  if ((image_length - offset) / record_size < count)
+    return FALSE;
+  return TRUE;
+}
+
+/* Find a string in the image.  An offset outside the string table
+ * is treated as no string.  */
+static const gchar *
+image_string (const gchar * strings, guint32 string_size, guint32 offset)
+{
+  if ((offset == 0) || (offset >= string_size))
+    return NULL;
+  return strings + offset;
+}
+
+/* Load the show from the image of a project file.  */
+gboolean
+show_image_read (const gchar * project_file_name, GApplication * app)
+{
+  GMappedFile *mapped_file;
+  const gchar *contents;
+  gsize length;
+  const struct show_image_header *header;
+  const struct show_image_fingerprint *fingerprints;
+  const struct show_image_sound *sound_records;
+  const struct show_image_sequence_item *item_records;
+  const struct show_image_bus *bus_records;
+  const gchar *strings;
+  const gchar *source_name;
+  struct sound_info *sound_data;
+  struct sequence_item_info *item;
+  GStatBuf file_status;
+  gchar *file_name;
+  gint64 start_time;
+  guint32 i, j;
+
+#define STRING(offset) \
+  arena_intern (image_string (strings, header->string_size, (offset)), app)
+
+  start_time = g_get_monotonic_time ();
+  file_name = image_file_name (project_file_name);
+  mapped_file = g_mapped_file_new (file_name, FALSE, NULL);
+  if (mapped_file == NULL)
+    {
+      /* There is no image.  */
+      g_free (file_name);
+      return FALSE;
+    }
+  contents = g_mapped_file_get_contents (mapped_file);
+  length = g_mapped_file_get_length (mapped_file);
+  header = (const struct show_image_header *) contents;
+
+  /* Make sure this is an image we can use.  */
+  if ((length < sizeof (struct show_image_header))
+      || (memcmp (header->magic, SHOW_IMAGE_MAGIC, sizeof (header->magic))
+          != 0) || (header->version != SHOW_IMAGE_VERSION)
+      || (header->byte_order != SHOW_IMAGE_BYTE_ORDER)
+      || (header->header_size != sizeof (struct show_image_header))
+      || (header->fingerprint_size != sizeof (struct show_image_fingerprint))
+      || (header->sound_size != sizeof (struct show_image_sound))
+      || (header->sequence_item_size !=
+          sizeof (struct show_image_sequence_item))
+      || (header->bus_size != sizeof (struct show_image_bus))
+      || !table_is_valid (length, header->fingerprint_offset,
+                          header->fingerprint_count,
+                          sizeof (struct show_image_fingerprint))
+      || !table_is_valid (length, header->sound_offset, header->sound_count,
+                          sizeof (struct show_image_sound))
+      || !table_is_valid (length, header->sequence_item_offset,
+                          header->sequence_item_count,
+                          sizeof (struct show_image_sequence_item))
+      || !table_is_valid (length, header->bus_offset, header->bus_count,
+                          sizeof (struct show_image_bus))
+      || (header->string_offset > length)
+      || (header->string_size == 0)
+      || (length - header->string_offset < header->string_size)
+      || (contents[header->string_offset + header->string_size - 1] != '\0'))
+    {
+      g_printerr ("%s is not a usable show image; reading the XML files.\n",
+                  file_name);
+      g_mapped_file_unref (mapped_file);
+      g_free (file_name);
+      return FALSE;
+    }
+
+  fingerprints = (const struct show_image_fingerprint *)
+    (contents + header->fingerprint_offset);
+  sound_records = (const struct show_image_sound *)
+    (contents + header->sound_offset);
+  item_records = (const struct show_image_sequence_item *)
+    (contents + header->sequence_item_offset);
+  bus_records = (const struct show_image_bus *)
+    (contents + header->bus_offset);
+  strings = contents + header->string_offset;
+
+  /* Make sure none of the files the show was compiled from 
+   * has changed.  */
+  for (i = 0; i < header->fingerprint_count; i++)
+    {
+      source_name =
+        image_string (strings, header->string_size,
+                      fingerprints[i].file_name);
+      if ((source_name == NULL) || (g_stat (source_name, &file_status) != 0)
+          || (file_status.st_size != fingerprints[i].size)
+          || (modification_time (&file_status) !=
+              fingerprints[i].modification_time))
+        {
+          g_print ("%s is out of date; reading the XML files.\n",
+                   file_name);
+          g_mapped_file_unref (mapped_file);
+          g_free (file_name);
+          return FALSE;
+        }
+    }
+
+  /* The type of each sequence item selects what the sequencer does
+   * with it, so make sure it is one the sequencer knows.  */
+  for (i = 0; i < header->sequence_item_count; i++)
+    {
+      if (item_records[i].type > start_sequence)
+        {
+          g_printerr ("%s has a sequence item of unknown type %u; "
+                      "reading the XML files.\n", file_name,
+                      item_records[i].type);
+          g_mapped_file_unref (mapped_file);
+          g_free (file_name);
+          return FALSE;
+        }
+    }
+
+  /* The image is good.  Construct the sounds and sequence items
+   * from it, as if they had been read from the XML files.  */
+  show_image_forget_sources (app);
+  for (i = 0; i < header->fingerprint_count; i++)
+    {
+      show_image_note_source (image_string
+                              (strings, header->string_size,
+                               fingerprints[i].file_name), app);
+    }
+
+  network_set_port (header->port_number, app);
+  tracer_set_file_name (image_string
+                        (strings, header->string_size,
+                         header->trace_file_name), app);
+
+  routing_set_device (image_string
+                      (strings, header->string_size,
+                       header->routing_device_name), app);
+  for (i = 0; i < header->bus_count; i++)
+    {
+      routing_define_bus (image_string
+                          (strings, header->string_size,
+                           bus_records[i].name),
+                          bus_records[i].channel_count,
+                          image_string (strings, header->string_size,
+                                        bus_records[i].device_name), app);
+    }
+
+  for (i = 0; i < header->sound_count; i++)
+    {
+      sound_data = arena_new_record (sizeof (struct sound_info), app);
+      sound_data->name = STRING (sound_records[i].name);
+      sound_data->wav_file_name = STRING (sound_records[i].wav_file_name);
+      sound_data->wav_file_name_full =
+        STRING (sound_records[i].wav_file_name_full);
+      sound_data->OSC_name = STRING (sound_records[i].OSC_name);
+      sound_data->function_key = STRING (sound_records[i].function_key);
+      sound_data->attack_duration_time =
+        sound_records[i].attack_duration_time;
+      sound_data->attack_level = sound_records[i].attack_level;
+      sound_data->decay_duration_time = sound_records[i].decay_duration_time;
+      sound_data->sustain_level = sound_records[i].sustain_level;
+      sound_data->release_start_time = sound_records[i].release_start_time;
+      sound_data->release_duration_time =
+        sound_records[i].release_duration_time;
+      sound_data->release_duration_infinite =
+        (sound_records[i].flags & SHOW_IMAGE_RELEASE_DURATION_INFINITE) != 0;
+      sound_data->loop_from_time = sound_records[i].loop_from_time;
+      sound_data->loop_to_time = sound_records[i].loop_to_time;
+      sound_data->loop_limit = sound_records[i].loop_limit;
+      sound_data->max_duration_time = sound_records[i].max_duration_time;
+      sound_data->start_time = sound_records[i].start_time;
+      sound_data->designer_volume_level =
+        sound_records[i].designer_volume_level;
+      sound_data->designer_pan = sound_records[i].designer_pan;
+      sound_data->MIDI_program_number = sound_records[i].MIDI_program_number;
+      sound_data->MIDI_program_number_specified =
+        (sound_records[i].flags & SHOW_IMAGE_MIDI_PROGRAM_NUMBER_SPECIFIED)
+        != 0;
+      sound_data->MIDI_note_number = sound_records[i].MIDI_note_number;
+      sound_data->MIDI_note_number_specified =
+        (sound_records[i].flags & SHOW_IMAGE_MIDI_NOTE_NUMBER_SPECIFIED) != 0;
+      sound_data->OSC_name_specified =
+        (sound_records[i].flags & SHOW_IMAGE_OSC_NAME_SPECIFIED) != 0;
+      sound_data->function_key_specified =
+        (sound_records[i].flags & SHOW_IMAGE_FUNCTION_KEY_SPECIFIED) != 0;
+      sound_data->omit_panning =
+        (sound_records[i].flags & SHOW_IMAGE_OMIT_PANNING) != 0;
+      sound_data->send_count =
+        MIN (sound_records[i].send_count, SOUND_MAX_SENDS);
+      for (j = 0; j < sound_data->send_count; j++)
+        {
+          sound_data->sends[j].bus_name =
+            STRING (sound_records[i].send_bus_name[j]);
+          sound_data->sends[j].level = sound_records[i].send_level[j];
+        }
+      sound_data->speaker_count =
+        MIN (sound_records[i].speaker_count, SOUND_MAX_SPEAKERS);
+      for (j = 0; j < sound_data->speaker_count; j++)
+        {
+          sound_data->speakers[j].bus_name =
+            STRING (sound_records[i].speaker_bus_name[j]);
+          sound_data->speakers[j].channel =
+            sound_records[i].speaker_channel[j];
+          sound_data->speakers[j].level = sound_records[i].speaker_level[j];
+        }
+
+      /* The WAV files are not part of the image, so check that
+       * they are still there.  */
+      if ((sound_data->wav_file_name_full != NULL)
+          && !g_file_test (sound_data->wav_file_name_full,
+                           G_FILE_TEST_EXISTS))
+        {
+          g_printerr ("File %s does not exist.\n",
+                      sound_data->wav_file_name_full);
+          sound_data->disabled = TRUE;
+        }
+
+      sound_append_sound (sound_data, app);
+    }
+
+  for (i = 0; i < header->sequence_item_count; i++)
+    {
+      item = arena_new_record (sizeof (struct sequence_item_info), app);
+      item->name = STRING (item_records[i].name);
+      item->type = item_records[i].type;
+      item->sound_name = STRING (item_records[i].sound_name);
+      item->tag = STRING (item_records[i].tag);
+      item->use_external_velocity = item_records[i].use_external_velocity;
+      item->volume = item_records[i].volume;
+      item->pan = item_records[i].pan;
+      item->program_number = item_records[i].program_number;
+      item->bank_number = item_records[i].bank_number;
+      item->cluster_number = item_records[i].cluster_number;
+      item->cluster_number_specified =
+        (item_records[i].flags & SHOW_IMAGE_CLUSTER_NUMBER_SPECIFIED) != 0;
+      item->next_completion = STRING (item_records[i].next_completion);
+      item->next_termination =
+        STRING (item_records[i].next_termination);
+      item->next_starts = STRING (item_records[i].next_starts);
+      item->next_release_started =
+        STRING (item_records[i].next_release_started);
+      item->importance = item_records[i].importance;
+      item->Q_number = STRING (item_records[i].Q_number);
+      item->text_to_display = STRING (item_records[i].text_to_display);
+      item->next = STRING (item_records[i].next);
+      item->time_to_wait = item_records[i].time_to_wait;
+      item->next_to_start = STRING (item_records[i].next_to_start);
+      item->MIDI_program_number = item_records[i].MIDI_program_number;
+      item->MIDI_note_number = item_records[i].MIDI_note_number;
+      item->MIDI_note_number_specified =
+        (item_records[i].flags & SHOW_IMAGE_MIDI_NOTE_NUMBER_SPECIFIED) != 0;
+      item->OSC_name = STRING (item_records[i].OSC_name);
+      item->macro_number = item_records[i].macro_number;
+      item->function_key = STRING (item_records[i].function_key);
+      item->next_play = STRING (item_records[i].next_play);
+      item->omit_from_display =
+        (item_records[i].flags & SHOW_IMAGE_OMIT_FROM_DISPLAY) != 0;
+
+      sequence_append_item (item, app);
+    }
+
+#undef STRING
+
+  if (TRACE_RING_ENABLED (trace_show_image))
+    {
+      trace_ring_record (trace_show_image, "Loaded %u sounds and %u "
+                         "sequence items from %s in %" G_GINT64_FORMAT
+                         " microseconds.", header->sound_count,
+                         header->sequence_item_count, file_name,
+                         g_get_monotonic_time () - start_time);
+    }
+
+  g_mapped_file_unref (mapped_file);
+  g_free (file_name);
+  return TRUE;
+}
@@ -0,0 +1,44 @@
+/*
+ * show_image_subroutines.h
+ *
+ * Copyright © 2016 by John Sauter <John_Sauter@systemeyescomputerstore.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtk/gtk.h>
+
+/* Subroutines defined in show_image_subroutines.c */
+
+/* Initialize the compiled show image subroutines.  */
+void *show_image_init (GApplication * app);
+
+/* Note a file that was read to load the show, so the image can
+ * tell when it is out of date.  */
+void show_image_note_source (const gchar * file_name, GApplication * app);
+
+/* Forget the files of the previous show.  */
+void show_image_forget_sources (GApplication * app);
+
+/* Load the show from the image of a project file, if the image 
+ * exists and is up to date.  Return FALSE if it could not be used.  */
+gboolean show_image_read (const gchar * project_file_name,
+                          GApplication * app);
+
+/* Write the image of the show that has just been loaded from
+ * a project file.  Return FALSE if it could not be written.  */
+gboolean show_image_write (const gchar * project_file_name,
+                           GApplication * app);
+
+/* End of file show_image_subroutines.h */
@@ -24,14 +24,11 @@
 #include "signal_subroutines.h"
 #include "sound_effects_player.h"
 #include "gstreamer_subroutines.h"
-
-/* When debugging it can be useful to trace what is happening in the
- * signal handler.  */
-#define TRACE_SIGNALS FALSE
+#include "reload_subroutines.h"
+#include "trace_ring_subroutines.h"
 
 /* the persistent data used by the signal handler */
-/* none used at the moment, but we will probably need something
- * to implement sighup.  */
+/* none used at the moment.  */
 
 struct signal_info
 {
@@ -42,6 +39,7 @@ struct signal_info
  */
 static gboolean signal_term (gpointer user_data);
 static gboolean signal_hup (gpointer user_data);
+static gboolean signal_usr1 (gpointer user_data);
 
 /* Initialize the signal handler.  */
 void *
@@ -55,6 +53,7 @@ signal_init (GApplication * app)
   /* Specify the routines to handle signals.  */
   g_unix_signal_add (SIGTERM, signal_term, app);
   g_unix_signal_add (SIGHUP, signal_hup, app);
+  g_unix_signal_add (SIGUSR1, signal_usr1, app);
 
   return (signal_data);
 }
@@ -65,9 +64,9 @@ signal_term (gpointer user_data)
 {
   GApplication *app = user_data;
 
-  if (TRACE_SIGNALS)
+  if (TRACE_RING_ENABLED (trace_signals))
     {
-      g_print ("signal term.\n");
+      trace_ring_record (trace_signals, "signal term.");
     }
 
   /* Initiate the shutdown of the gstreamer pipeline.  When it is complete
@@ -81,13 +80,35 @@ signal_term (gpointer user_data)
 static gboolean
 signal_hup (gpointer user_data)
 {
-  if (TRACE_SIGNALS)
+  GApplication *app = user_data;
+
+  if (TRACE_RING_ENABLED (trace_signals))
+    {
+      trace_ring_record (trace_signals, "signal hup.");
+    }
+
+  /* Re-read the current project, and change only the parts of the
+   * gstreamer pipeline and the sequence that differ, so the sounds
+   * that are playing are not interrupted.  */
+  reload_project (app);
+
+  return TRUE;
+}
+
+/* Subroutine called when a usr1 signal is received.  */
+static gboolean
+signal_usr1 (gpointer user_data)
+{
+  GApplication *app = user_data;
+
+  if (TRACE_RING_ENABLED (trace_signals))
     {
-      g_print ("signal hup.\n");
+      trace_ring_record (trace_signals, "signal usr1.");
     }
 
-  /* TODO: shutdown the gstreamer pipeline, re-read the current project,
-   * and rebuild the gstreamer pipeline based on it.  */
+  /* Dump the trace ring buffers, so we can see what led up to a
+   * problem without stopping the show.  */
+  trace_ring_dump (app);
 
   return TRUE;
 }
@@ -107,6 +128,7 @@ signal_finalize (GApplication * app)
   new_action.sa_flags = 0;
   sigaction (SIGTERM, &new_action, NULL);
   sigaction (SIGHUP, &new_action, NULL);
+  sigaction (SIGUSR1, &new_action, NULL);
 
   g_free (signal_data);
   signal_data = NULL;
@@ -21,15 +21,28 @@
 #include "sound_effects_player.h"
 #include "sound_structure.h"
 #include "gstreamer_subroutines.h"
+#include "latency_subroutines.h"
 #include "menu_subroutines.h"
+#include "monitor_subroutines.h"
 #include "network_subroutines.h"
+#include "osc_subroutines.h"
 #include "parse_xml_subroutines.h"
 #include "parse_net_subroutines.h"
+#include "qos_subroutines.h"
+#include "realtime_subroutines.h"
+#include "render_subroutines.h"
+#include "routing_subroutines.h"
 #include "sound_subroutines.h"
 #include "sequence_subroutines.h"
+#include "show_image_subroutines.h"
+#include "arena_subroutines.h"
 #include "signal_subroutines.h"
+#include "telemetry_subroutines.h"
 #include "timer_subroutines.h"
+#include "tracer_subroutines.h"
+#include "trace_ring_subroutines.h"
 #include "display_subroutines.h"
+#include "main.h"
 
 G_DEFINE_TYPE (Sound_Effects_Player, sound_effects_player,
                GTK_TYPE_APPLICATION);
@@ -77,8 +90,8 @@ struct _Sound_Effects_PlayerPrivate
   /* The persistent information for the timer.  */
   void *timer_data;
 
-  /* The list of clusters that might contain sound effects. */
-  GList *clusters;
+  /* The widgets that are updated as the show runs. */
+  void *display_data;
 
   /* The persistent network information. */
   void *network_data;
@@ -86,6 +99,42 @@ struct _Sound_Effects_PlayerPrivate
   /* The persistent information for the network commands parser. */
   void *parse_net_data;
 
+  /* The persistent information for the Open Sound Control decoder. */
+  void *osc_data;
+
+  /* The persistent information for the telemetry stream. */
+  void *telemetry_data;
+
+  /* The persistent information for the compiled show image. */
+  void *show_image_data;
+
+  /* The storage for the sounds and sequence items of the show. */
+  void *arena_data;
+
+  /* The persistent information for rendering the show offline. */
+  void *render_data;
+
+  /* The persistent information for measuring command-to-sound latency. */
+  void *latency_data;
+
+  /* The persistent information for tracing the pipeline. */
+  void *tracer_data;
+
+  /* The persistent information for the trace ring buffers. */
+  void *trace_ring_data;
+
+  /* The persistent information for running in real time. */
+  void *realtime_data;
+
+  /* The persistent information for the underrun counters. */
+  void *qos_data;
+
+  /* The persistent information for the monitor file writer. */
+  void *monitor_data;
+
+  /* The persistent information for the output routing. */
+  void *routing_data;
+
   /* The XML file that holds parameters for the program. */
   xmlDocPtr project_file;
 
@@ -110,9 +159,6 @@ sound_effects_player_new_window (GApplication * app, GFile * file)
   guint context_id;
   GtkBuilder *builder;
   GError *error = NULL;
-  gint cluster_number;
-  gchar *cluster_name;
-  GtkWidget *cluster_widget;
   gchar *filename;
   gchar *local_filename;
   guint message_code;
@@ -120,6 +166,10 @@ sound_effects_player_new_window (GApplication * app, GFile * file)
   Sound_Effects_PlayerPrivate *priv =
     SOUND_EFFECTS_PLAYER_APPLICATION (app)->priv;
 
+  /* Initialize the trace ring buffers first, so everything after
+   * can be traced.  */
+  priv->trace_ring_data = trace_ring_init (app);
+
   /* Initialize the signal handler.  */
   priv->signal_data = signal_init (app);
 
@@ -183,19 +233,9 @@ sound_effects_player_new_window (GApplication * app, GFile * file)
   /* We are done with the name of the user interface file. */
   g_free (filename);
 
-  /* Remember where the clusters are. Each cluster has a name identifying it. */
-  priv->clusters = NULL;
-  for (cluster_number = 0; cluster_number < 16; ++cluster_number)
-    {
-      cluster_name = g_strdup_printf ("cluster_%2.2d", cluster_number);
-      cluster_widget =
-        GTK_WIDGET (gtk_builder_get_object (builder, cluster_name));
-      if (cluster_widget != NULL)
-        {
-          priv->clusters = g_list_prepend (priv->clusters, cluster_widget);
-        }
-      g_free (cluster_name);
-    }
+  /* Remember where the clusters, their labels and the VU meter are,
+   * so they can be updated without searching for them. */
+  priv->display_data = display_init (builder, app);
 
   /* ANJUTA: Widgets initialization for sound_effects_player.ui 
    * - DO NOT REMOVE */
@@ -227,12 +267,71 @@ sound_effects_player_new_window (GApplication * app, GFile * file)
   /* Initialize the internal sequencer.  */
   priv->sequence_data = sequence_init (app);
 
+  /* Set aside storage for the sounds and sequence items. */
+  priv->arena_data = arena_init (app);
+
+  /* Keep track of the files the show is read from. */
+  priv->show_image_data = show_image_init (app);
+
+  /* Hold the output buses the show defines. */
+  priv->routing_data = routing_init (app);
+
+  /* Measure how long commands take to be heard. */
+  priv->latency_data = latency_init (app);
+
+  /* Be ready to trace the pipeline, if the project asks for it. */
+  priv->tracer_data = tracer_init (app);
+
   /* Initialize the network message parser. */
   priv->parse_net_data = parse_net_init (app);
 
-  /* Listen for network messages. */
+  /* Initialize the Open Sound Control decoder. */
+  priv->osc_data = osc_init (app);
+
+  /* Hold the network port until we start to listen.  */
   priv->network_data = network_init (app);
 
+  /* If we were asked only to compile the project file, read it,
+   * write its image and quit without showing the display.  Do this
+   * before we open any sockets or lock any memory.  */
+  if (main_get_compile ())
+    {
+      if (priv->project_filename == NULL)
+        {
+          g_printerr ("No project file to compile.\n");
+        }
+      else
+        {
+          local_filename = g_strdup (priv->project_filename);
+          if (parse_xml_read_project_file (local_filename, app))
+            show_image_write (priv->project_filename, app);
+        }
+      g_application_quit (app);
+      return;
+    }
+
+  /* Tell remote controllers what we are doing. */
+  priv->telemetry_data = telemetry_init (app);
+
+  /* Listen for network messages. */
+  network_start (app);
+
+  /* If we were asked to render the show offline, run the sequencer
+   * from the time in the stream rather than the system clock.  */
+  priv->render_data = render_init (app);
+
+  /* If we were asked to run in real time, lock our memory now, before
+   * the samples are loaded.  */
+  priv->realtime_data = realtime_init (app);
+
+  /* Count underruns and late buffers, from before the pipeline is
+   * built.  */
+  priv->qos_data = qos_init (app);
+
+  /* If we were asked to record what we play, open the monitor file and
+   * start its writer, before the pipeline is built.  */
+  priv->monitor_data = monitor_init (app);
+
   /* The display is initialized; time to show it. */
   gtk_widget_show_all (GTK_WIDGET (top_window));
   priv->windows_showing = TRUE;
@@ -245,9 +344,15 @@ sound_effects_player_new_window (GApplication * app, GFile * file)
       local_filename = g_strdup (priv->project_filename);
       parse_xml_read_project_file (local_filename, app);
       priv->gstreamer_pipeline = sound_init (app);
+      render_start (priv->gstreamer_pipeline, app);
       display_remove_message (message_code, app);
       message_code = display_show_message ("Starting...", app);
     }
+  else if (priv->render_data != NULL)
+    {
+      g_printerr ("No project file to render.\n");
+      g_application_quit (app);
+    }
   else
     {
       message_code = display_show_message ("No sounds.", app);
@@ -285,11 +390,56 @@ sound_effects_player_init (Sound_Effects_Player * object)
 static void
 sound_effects_player_finalize (GObject * object)
 {
-  GList *sound_effect_list;
-  GList *next_sound_effect;
-  struct sound_info *sound_effect;
   Sound_Effects_Player *self = (Sound_Effects_Player *) object;
 
+  /* Send the last of the telemetry.  */
+  if (self->priv->telemetry_data != NULL)
+    {
+      telemetry_shutdown ((GApplication *) self);
+      telemetry_print_statistics ((GApplication *) self);
+    }
+
+  /* Stop listening to the network, and report the network counters
+   * and the latency of network commands.  */
+  if (self->priv->network_data != NULL)
+    {
+      network_shutdown ((GApplication *) self);
+      network_print_statistics ((GApplication *) self);
+      parse_net_print_statistics ((GApplication *) self);
+    }
+
+  /* Write the pipeline trace, if we were tracing.  */
+  if (self->priv->tracer_data != NULL)
+    tracer_shutdown ((GApplication *) self);
+
+  /* Report how long commands took to be heard.  */
+  if (self->priv->latency_data != NULL)
+    latency_print_statistics ((GApplication *) self);
+
+  /* Report how long an offline render took.  */
+  if (self->priv->render_data != NULL)
+    render_print_statistics ((GApplication *) self);
+
+  /* Report whether the streaming threads ran in real time.  */
+  if (self->priv->realtime_data != NULL)
+    realtime_print_statistics ((GApplication *) self);
+
+  /* Report whether any sound was late.  */
+  if (self->priv->qos_data != NULL)
+    qos_print_statistics ((GApplication *) self);
+
+  /* Complete the monitor file, and report whether any sound was left
+   * out of it.  */
+  if (self->priv->monitor_data != NULL)
+    {
+      monitor_shutdown ((GApplication *) self);
+      monitor_print_statistics ((GApplication *) self);
+    }
+
+  /* Dump what was traced.  */
+  if (self->priv->trace_ring_data != NULL)
+    trace_ring_shutdown ((GApplication *) self);
+
   /* Deallocate the gstreamer pipeline.  */
   if (self->priv->gstreamer_pipeline != NULL)
     {
@@ -297,23 +447,12 @@ sound_effects_player_finalize (GObject * object)
       self->priv->gstreamer_pipeline = NULL;
     }
 
-  /* Deallocate the list of sound effects. */
-  sound_effect_list = self->priv->sound_list;
-
-  while (sound_effect_list != NULL)
-    {
-      sound_effect = sound_effect_list->data;
-      next_sound_effect = sound_effect_list->next;
-      g_free (sound_effect->name);
-      g_free (sound_effect->wav_file_name);
-      g_free (sound_effect->wav_file_name_full);
-      g_free (sound_effect->OSC_name);
-      g_free (sound_effect->function_key);
-      g_free (sound_effect);
-      self->priv->sound_list =
-        g_list_delete_link (self->priv->sound_list, sound_effect_list);
-      sound_effect_list = next_sound_effect;
-    }
+  /* Deallocate the list of sound effects.  The sounds themselves,
+   * and the sequence items, are freed along with their arena. */
+  g_list_free (self->priv->sound_list);
+  self->priv->sound_list = NULL;
+  if (self->priv->arena_data != NULL)
+    arena_release_show ((GApplication *) self);
 
   G_OBJECT_CLASS (sound_effects_player_parent_class)->finalize (object);
 }
@@ -506,30 +645,7 @@ sep_get_sound_effect (GtkWidget * object)
 GtkWidget *
 sep_get_cluster_from_number (guint cluster_number, GApplication * app)
 {
-  Sound_Effects_PlayerPrivate *priv =
-    SOUND_EFFECTS_PLAYER_APPLICATION (app)->priv;
-  GtkWidget *cluster_widget;
-  GList *cluster_list;
-  const gchar *widget_name;
-  gchar *cluster_name;
-
-  /* Go through the list of clusters looking for one with the name
-   * "cluster_" followed by the cluster number.  */
-  for (cluster_list = priv->clusters; cluster_list != NULL;
-       cluster_list = cluster_list->next)
-    {
-      cluster_widget = cluster_list->data;
-      widget_name = gtk_widget_get_name (cluster_widget);
-      cluster_name = g_strdup_printf ("cluster_%2.2d", cluster_number);
-      if (g_ascii_strcasecmp (widget_name, cluster_name) == 0)
-        {
-          g_free (cluster_name);
-          return (cluster_widget);
-        }
-      g_free (cluster_name);
-    }
-
-  return NULL;
+  return (display_get_cluster (cluster_number, app));
 }
 
 /* Given a cluster, find its cluster number.  */
@@ -593,6 +709,71 @@ sep_get_parse_net_data (GApplication * app)
   return (parse_net_data);
 }
 
+/* Find the Open Sound Control decoder information.  
+ * The parameter passed is the application.  */
+void *
+sep_get_osc_data (GApplication * app)
+{
+  Sound_Effects_PlayerPrivate *priv =
+    SOUND_EFFECTS_PLAYER_APPLICATION (app)->priv;
+  void *osc_data;
+
+  osc_data = priv->osc_data;
+  return (osc_data);
+}
+
+/* Find the telemetry stream information.  
+ * The parameter passed is the application.  */
+void *
+sep_get_telemetry_data (GApplication * app)
+{
+  Sound_Effects_PlayerPrivate *priv =
+    SOUND_EFFECTS_PLAYER_APPLICATION (app)->priv;
+  void *telemetry_data;
+
+  telemetry_data = priv->telemetry_data;
+  return (telemetry_data);
+}
+
+/* Find the compiled show image information.  
+ * The parameter passed is the application.  */
+void *
+sep_get_show_image_data (GApplication * app)
+{
+  Sound_Effects_PlayerPrivate *priv =
+    SOUND_EFFECTS_PLAYER_APPLICATION (app)->priv;
+  void *show_image_data;
+
+  show_image_data = priv->show_image_data;
+  return (show_image_data);
+}
+
+/* Find the widgets that are updated as the show runs.  
+ * The parameter passed is the application.  */
+void *
+sep_get_display_data (GApplication * app)
+{
+  Sound_Effects_PlayerPrivate *priv =
+    SOUND_EFFECTS_PLAYER_APPLICATION (app)->priv;
+  void *display_data;
+
+  display_data = priv->display_data;
+  return (display_data);
+}
+
+/* Find the storage for the show's sounds and sequence items.  
+ * The parameter passed is the application.  */
+void *
+sep_get_arena_data (GApplication * app)
+{
+  Sound_Effects_PlayerPrivate *priv =
+    SOUND_EFFECTS_PLAYER_APPLICATION (app)->priv;
+  void *arena_data;
+
+  arena_data = priv->arena_data;
+  return (arena_data);
+}
+
 /* Find the top-level window, to use as the transient parent for
  * dialogs. */
 GtkWindow *
@@ -772,3 +953,99 @@ sep_get_timer_data (GApplication * app)
   timer_data = priv->timer_data;
   return (timer_data);
 }
+
+/* Find the persistent data for rendering offline.  */
+void *
+sep_get_render_data (GApplication * app)
+{
+  void *render_data;
+  Sound_Effects_PlayerPrivate *priv =
+    SOUND_EFFECTS_PLAYER_APPLICATION (app)->priv;
+
+  render_data = priv->render_data;
+  return (render_data);
+}
+
+/* Find the persistent data for measuring latency.  */
+void *
+sep_get_latency_data (GApplication * app)
+{
+  void *latency_data;
+  Sound_Effects_PlayerPrivate *priv =
+    SOUND_EFFECTS_PLAYER_APPLICATION (app)->priv;
+
+  latency_data = priv->latency_data;
+  return (latency_data);
+}
+
+/* Find the persistent data for tracing the pipeline.  */
+void *
+sep_get_tracer_data (GApplication * app)
+{
+  void *tracer_data;
+  Sound_Effects_PlayerPrivate *priv =
+    SOUND_EFFECTS_PLAYER_APPLICATION (app)->priv;
+
+  tracer_data = priv->tracer_data;
+  return (tracer_data);
+}
+
+/* Find the persistent data for the trace ring buffers.  */
+void *
+sep_get_trace_ring_data (GApplication * app)
+{
+  void *trace_ring_data;
+  Sound_Effects_PlayerPrivate *priv =
+    SOUND_EFFECTS_PLAYER_APPLICATION (app)->priv;
+
+  trace_ring_data = priv->trace_ring_data;
+  return (trace_ring_data);
+}
+
+/* Find the persistent data for running in real time.  */
+void *
+sep_get_realtime_data (GApplication * app)
+{
+  void *realtime_data;
+  Sound_Effects_PlayerPrivate *priv =
+    SOUND_EFFECTS_PLAYER_APPLICATION (app)->priv;
+
+  realtime_data = priv->realtime_data;
+  return (realtime_data);
+}
+
+/* Find the persistent data for the underrun counters.  */
+void *
+sep_get_qos_data (GApplication * app)
+{
+  void *qos_data;
+  Sound_Effects_PlayerPrivate *priv =
+    SOUND_EFFECTS_PLAYER_APPLICATION (app)->priv;
+
+  qos_data = priv->qos_data;
+  return (qos_data);
+}
+
+/* Find the persistent data for the monitor file writer.  */
+void *
+sep_get_monitor_data (GApplication * app)
+{
+  void *monitor_data;
+  Sound_Effects_PlayerPrivate *priv =
+    SOUND_EFFECTS_PLAYER_APPLICATION (app)->priv;
+
+  monitor_data = priv->monitor_data;
+  return (monitor_data);
+}
+
+/* Find the persistent data for the output routing.  */
+void *
+sep_get_routing_data (GApplication * app)
+{
+  void *routing_data;
+  Sound_Effects_PlayerPrivate *priv =
+    SOUND_EFFECTS_PLAYER_APPLICATION (app)->priv;
+
+  routing_data = priv->routing_data;
+  return (routing_data);
+}
@@ -89,6 +89,21 @@ void *sep_get_network_data (GApplication * app);
 /* Find the network messages parser information. */
 void *sep_get_parse_net_data (GApplication * app);
 
+/* Find the Open Sound Control decoder information. */
+void *sep_get_osc_data (GApplication * app);
+
+/* Find the telemetry stream information. */
+void *sep_get_telemetry_data (GApplication * app);
+
+/* Find the compiled show image information. */
+void *sep_get_show_image_data (GApplication * app);
+
+/* Find the widgets that are updated as the show runs. */
+void *sep_get_display_data (GApplication * app);
+
+/* Find the storage for the show's sounds and sequence items. */
+void *sep_get_arena_data (GApplication * app);
+
 /* Find the top-level window. */
 GtkWindow *sep_get_top_window (GApplication * app);
 
@@ -131,5 +146,29 @@ void *sep_get_signal_data (GApplication *app);
 /* Find the timer information.  */
 void *sep_get_timer_data (GApplication *app);
 
+/* Find the offline render information.  */
+void *sep_get_render_data (GApplication *app);
+
+/* Find the latency measurement information.  */
+void *sep_get_latency_data (GApplication *app);
+
+/* Find the pipeline tracer information.  */
+void *sep_get_tracer_data (GApplication *app);
+
+/* Find the trace ring buffer information.  */
+void *sep_get_trace_ring_data (GApplication *app);
+
+/* Find the real-time operation information.  */
+void *sep_get_realtime_data (GApplication *app);
+
+/* Find the underrun counter information.  */
+void *sep_get_qos_data (GApplication *app);
+
+/* Find the monitor file writer information.  */
+void *sep_get_monitor_data (GApplication *app);
+
+/* Find the output routing information.  */
+void *sep_get_routing_data (GApplication *app);
+
 G_END_DECLS
 #endif /* _SOUND_EFFECTS_PLAYER_H_ */
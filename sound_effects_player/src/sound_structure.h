@@ -29,6 +29,28 @@
 #include <gtk/gtk.h>
 #include <gst/gst.h>
 
+/* The most buses a sound can be sent to.  */
+#define SOUND_MAX_SENDS 8
+
+/* Where a sound is sent: an output bus, and the level to send.  */
+struct sound_send
+{
+  gchar *bus_name;
+  gfloat level;                 /* 1.0 means 100% of volume */
+};
+
+/* The most speakers a sound can be placed on.  */
+#define SOUND_MAX_SPEAKERS 16
+
+/* A speaker a sound is placed on: a channel of an output bus, and the
+ * level of the sound there.  */
+struct sound_speaker
+{
+  gchar *bus_name;              /* NULL means the first bus */
+  gint channel;                 /* counting from 1 */
+  gfloat level;                 /* 1.0 means 100% of volume */
+};
+
 struct sound_info
 {
   gchar *name;                  /* name of the sound */
@@ -67,6 +89,15 @@ struct sound_info
   gboolean release_sent;        /* A Release command was given.  */
   gboolean release_has_started; /* The sound has started its release stage.  */
   gboolean omit_panning;        /* Do not let the operator pan this sound.  */
+  gint send_count;              /* The number of buses the sound is sent
+                                 * to.  Zero sends it to the first bus.  */
+  struct sound_send sends[SOUND_MAX_SENDS];
+  gint speaker_count;           /* The number of speakers the sound is
+                                 * placed on, besides its sends.  */
+  struct sound_speaker speakers[SOUND_MAX_SPEAKERS];
+  guint meter_snapshot[2];      /* The level of the sound, published by
+                                 * the envelope: the peak since last read
+                                 * and the RMS of the latest buffer.  */
 };
 
 #endif /* ifndef SOUND_STRUCTURE_H */
@@ -20,12 +20,16 @@
 #include <stdlib.h>
 #include <gst/gst.h>
 #include "sound_subroutines.h"
+#include "arena_subroutines.h"
 #include "sound_structure.h"
 #include "sound_effects_player.h"
 #include "gstreamer_subroutines.h"
 #include "button_subroutines.h"
 #include "display_subroutines.h"
 #include "sequence_subroutines.h"
+#include "latency_subroutines.h"
+#include "osc_subroutines.h"
+#include "telemetry_subroutines.h"
 
 /* Subroutines for processing sounds.  */
 
@@ -104,6 +108,10 @@ sound_init (GApplication * app)
       pipeline_element = NULL;
     }
 
+  /* The sounds that can be started by Open Sound Control messages
+   * have changed.  */
+  osc_address_space_changed (app);
+
   return pipeline_element;
 }
 
@@ -112,36 +120,8 @@ void
 sound_cluster_set_name (gchar * sound_name, guint cluster_number,
                         GApplication * app)
 {
-  GList *children_list;
-  const char *child_name;
-  GtkLabel *title_label;
-  GtkWidget *cluster;
-
-  /* find the cluster */
-  cluster = sep_get_cluster_from_number (cluster_number, app);
-
-  if (cluster == NULL)
-    return;
-
-  /* Set the name in the cluster.  */
-  title_label = NULL;
-  children_list = gtk_container_get_children (GTK_CONTAINER (cluster));
-  while (children_list != NULL)
-    {
-      child_name = gtk_widget_get_name (children_list->data);
-      if (g_strcmp0 (child_name, "title") == 0)
-        {
-          title_label = children_list->data;
-          break;
-        }
-      children_list = children_list->next;
-    }
-  g_list_free (children_list);
-
-  if (title_label != NULL)
-    {
-      gtk_label_set_label (title_label, sound_name);
-    }
+  display_set_cluster_title (cluster_number, sound_name, app);
+  return;
 }
 
 /* Append a sound to the list of sounds. */
@@ -171,7 +151,9 @@ sound_bind_to_cluster (gchar * sound_name, guint cluster_number,
   while (sound_effect_list != NULL)
     {
       sound_effect = sound_effect_list->data;
-      if ((g_strcmp0 (sound_name, sound_effect->name)) == 0)
+      /* The sound name comes from a sequence item, and is interned
+       * like the names of the sounds.  */
+      if (sound_effect->name == sound_name)
         {
           sound_effect_found = TRUE;
           break;
@@ -186,6 +168,9 @@ sound_bind_to_cluster (gchar * sound_name, guint cluster_number,
   sound_effect->cluster_number = cluster_number;
   sound_effect->cluster_widget = cluster_widget;
 
+  /* The cluster's meter shows this sound.  */
+  display_set_cluster_sound (cluster_number, sound_effect, app);
+
   return sound_effect;
 
 }
@@ -225,14 +210,21 @@ sound_start_playing (struct sound_info *sound_data, GApplication * app)
   /* Send a start message to the bin.  It will be routed to the source, and
    * flow from there downstream through the looper and envelope.  
    * The looper element will start sending its local buffer
-   * and the envelope element will start to shape the volume.  */
+   * and the envelope element will start to shape the volume.  
+   * The message carries the time of the command that started the
+   * sound, so they can report how long it took to be heard.  */
   sound_data->running = TRUE;
   sound_data->release_sent = FALSE;
   sound_data->release_has_started = FALSE;
-  structure = gst_structure_new_empty ((gchar *) "start");
+  structure =
+    gst_structure_new ((gchar *) "start", "trigger-time", G_TYPE_INT64,
+                       latency_sound_starting (app), NULL);
   event = gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM, structure);
   gst_element_send_event (GST_ELEMENT (bin_element), event);
 
+  /* Tell the remote controllers.  */
+  telemetry_sound_started (sound_data->name, app);
+
   return;
 }
 
@@ -260,30 +252,43 @@ sound_stop_playing (struct sound_info *sound_data, GApplication * app)
   return;
 }
 
-/* Get the elapsed time of a playing sound.  */
-gchar *
+/* Get the elapsed time of a playing sound, in nanoseconds.  The looper
+ * publishes this as it plays, so reading it does not wait for or delay
+ * the streaming thread.  */
+gint64
 sound_get_elapsed_time (struct sound_info * sound_data, GApplication * app)
 {
   GstElement *looper_element;
-  gchar *string_value;
+  gint64 elapsed_time;
 
   looper_element = gstreamer_get_looper (sound_data->sound_control);
-  g_object_get (looper_element, (gchar *) "elapsed-time", &string_value,
-                NULL);
-  return string_value;
+  g_object_get (looper_element, (gchar *) "elapsed", &elapsed_time, NULL);
+  return elapsed_time;
 }
 
-/* Get the remaining run time of a playing sound.  */
-gchar *
+/* Get the remaining run time of a playing sound, in nanoseconds,
+ * or -1 if the sound will not stop by itself.  */
+gint64
 sound_get_remaining_time (struct sound_info * sound_data, GApplication * app)
 {
   GstElement *looper_element;
-  gchar *string_value;
+  gint64 remaining_time;
 
   looper_element = gstreamer_get_looper (sound_data->sound_control);
-  g_object_get (looper_element, (gchar *) "remaining-time", &string_value,
-		NULL);
-  return string_value;
+  g_object_get (looper_element, (gchar *) "remaining", &remaining_time,
+                NULL);
+  return remaining_time;
+}
+
+/* Format a time from the above subroutines, in seconds, for display.  */
+void
+sound_format_time (gint64 time_value, gchar * buffer, gsize buffer_size)
+{
+  if (time_value < 0)
+    g_strlcpy (buffer, "∞", buffer_size);
+  else
+    g_snprintf (buffer, buffer_size, "%.1f", (gdouble) time_value / 1e9);
+  return;
 }
 
 /* Receive a completed message, which indicates that a sound has finished.  */
@@ -292,15 +297,21 @@ sound_completed (const gchar * sound_name, GApplication * app)
 {
   GList *sound_effect_list;
   struct sound_info *sound_effect = NULL;
+  gchar *interned_name;
   gboolean sound_effect_found;
 
-  /* Search through the sound effects for the one with this name.  */
+  /* Search through the sound effects for the one with this name.
+   * The name comes from the message, so find its interned copy
+   * first; if there is none, no sound has this name.  */
+  interned_name = arena_lookup (sound_name, app);
+  if (interned_name == NULL)
+    return;
   sound_effect_list = sep_get_sound_list (app);
   sound_effect_found = FALSE;
   while (sound_effect_list != NULL)
     {
       sound_effect = sound_effect_list->data;
-      if (g_strcmp0 (sound_effect->name, sound_name) == 0)
+      if (sound_effect->name == interned_name)
         {
           sound_effect_found = TRUE;
           break;
@@ -314,6 +325,7 @@ sound_completed (const gchar * sound_name, GApplication * app)
 
   /* Flag that the sound is no longer playing.  */
   sound_effect->running = FALSE;
+  telemetry_sound_completed (sound_effect->name, app);
 
   /* Let the internal sequencer distinguish a sound that has completed
    * normally from one that has been stopped.  */
@@ -328,15 +340,21 @@ sound_release_started (const gchar * sound_name, GApplication * app)
 {
   GList *sound_effect_list;
   struct sound_info *sound_effect = NULL;
+  gchar *interned_name;
   gboolean sound_effect_found;
 
-  /* Search through the sound effects for the one with this name.  */
+  /* Search through the sound effects for the one with this name.
+   * The name comes from the message, so find its interned copy
+   * first; if there is none, no sound has this name.  */
+  interned_name = arena_lookup (sound_name, app);
+  if (interned_name == NULL)
+    return;
   sound_effect_list = sep_get_sound_list (app);
   sound_effect_found = FALSE;
   while (sound_effect_list != NULL)
     {
       sound_effect = sound_effect_list->data;
-      if (g_strcmp0 (sound_effect->name, sound_name) == 0)
+      if (sound_effect->name == interned_name)
         {
           sound_effect_found = TRUE;
           break;
@@ -350,6 +368,7 @@ sound_release_started (const gchar * sound_name, GApplication * app)
 
   /* Remember that the sound is in its release stage.  */
   sound_effect->release_has_started = TRUE;
+  telemetry_sound_released (sound_effect->name, app);
 
   /* Let the internal sequencer handle it.  */
   sequence_sound_release_started (sound_effect, app);
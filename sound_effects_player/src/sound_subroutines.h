@@ -48,14 +48,19 @@ void sound_start_playing (struct sound_info *sound_data, GApplication * app);
 /* Stop playing a sound.  */
 void sound_stop_playing (struct sound_info *sound_data, GApplication * app);
 
-/* Get the elapsed time of a playing sound.  */
-gchar *sound_get_elapsed_time (struct sound_info *sound_data,
+/* Get the elapsed time of a playing sound, in nanoseconds.  */
+gint64 sound_get_elapsed_time (struct sound_info *sound_data,
                                GApplication * app);
 
-/* Get the remaining time of a playing sound.  */
-gchar *sound_get_remaining_time (struct sound_info *sound_data,
+/* Get the remaining time of a playing sound, in nanoseconds,
+ * or -1 if it will not stop.  */
+gint64 sound_get_remaining_time (struct sound_info *sound_data,
                                  GApplication * app);
 
+/* Format a time, in seconds, for display.  */
+void sound_format_time (gint64 time_value, gchar * buffer,
+                        gsize buffer_size);
+
 /* Note that a sound has completed.  */
 void sound_completed (const gchar * sound_name, GApplication * app);
 
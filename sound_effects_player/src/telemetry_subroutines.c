@@ -0,0 +1,603 @@
+/*
+ * telemetry_subroutines.c
+ *
+ * Copyright © 2016 by John Sauter <John_Sauter@systemeyescomputerstore.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <gtk/gtk.h>
+#include <gio/gio.h>
+#include <gio/gunixsocketaddress.h>
+#include "main.h"
+#include "routing_subroutines.h"
+#include "sound_effects_player.h"
+#include "sound_structure.h"
+#include "sound_subroutines.h"
+#include "telemetry_subroutines.h"
+#include "trace_ring_subroutines.h"
+
+/* The telemetry stream is a sequence of datagrams, each holding lines
+ * of text in the same style as the network commands:
+ *
+ *   seq <n>                       first line of every datagram
+ *   started <sound name>
+ *   released <sound name>
+ *   completed <sound name>
+ *   stats <text>                  statistics asked for by a stats command
+ *   operator <text>               the operator wait text; empty if cleared
+ *   time <elapsed> <remaining> <sound name>
+ *   meter <channel> <rms dB> <peak dB>
+ *
+ * The started, released, completed and stats events are sent in the order
+ * they happened.  The others describe the current state, so only the
+ * latest value is sent, and only if it has changed.  Everything is
+ * coalesced into at most one datagram per period, no matter how busy
+ * the player is.  Each datagram is sent once to each destination, and
+ * a destination may be a multicast group, so any number of controllers
+ * can follow the player at no extra cost to it.  The sequence number 
+ * lets a controller notice a lost datagram.  */
+
+/* The largest datagram we send, small enough to avoid fragmentation.  */
+#define TELEMETRY_DATAGRAM_SIZE 1400
+
+/* The number of output channels whose levels we report: every channel
+ * the output buses can have.  */
+#define TELEMETRY_MAX_CHANNELS ROUTING_MAX_CHANNELS
+
+/* If nothing has changed for this long, send a datagram anyway, so the
+ * controllers know the player is still running.  */
+#define TELEMETRY_HEARTBEAT_INTERVAL G_USEC_PER_SEC
+
+/* The default number of datagrams per second.  */
+#define TELEMETRY_DEFAULT_RATE 10
+
+/* A place to send the telemetry.  */
+struct telemetry_destination
+{
+  GSocketAddress *address;
+  GSocket *socket;
+};
+
+/* The persistent data used by the telemetry subroutines.  */
+struct telemetry_info
+{
+  GApplication *app;
+  GList *destinations;
+  GSocket *socket_IPv4, *socket_IPv6, *socket_unix;
+  guint timeout_source_id;
+
+  /* The started, released and completed events since the last
+   * datagram, one per line.  */
+  GString *pending_events;
+
+  /* The latest operator text.  */
+  gchar *operator_text;
+  gboolean operator_text_changed;
+
+  /* The latest meter levels, and the levels last sent, in tenths
+   * of a dB.  */
+  gint channel_count;
+  gint rms_level[TELEMETRY_MAX_CHANNELS];
+  gint peak_level[TELEMETRY_MAX_CHANNELS];
+  gint sent_rms_level[TELEMETRY_MAX_CHANNELS];
+  gint sent_peak_level[TELEMETRY_MAX_CHANNELS];
+
+  /* The datagram being built.  */
+  GString *datagram;
+  gsize header_length;
+  guint64 sequence_number;
+  gint64 last_send_time;
+
+  /* Counters, printed at shutdown.  */
+  guint64 event_count;
+  guint64 datagram_count;
+  guint64 send_error_count;
+};
+
+/* Find or create the socket used to send to an address.  */
+static GSocket *
+get_socket (struct telemetry_info *telemetry_data, GSocketFamily family)
+{
+  GSocket **socket_pointer;
+  GError *error = NULL;
+
+  switch (family)
+    {
+    case G_SOCKET_FAMILY_IPV4:
+      socket_pointer = &telemetry_data->socket_IPv4;
+      break;
+    case G_SOCKET_FAMILY_IPV6:
+      socket_pointer = &telemetry_data->socket_IPv6;
+      break;
+    case G_SOCKET_FAMILY_UNIX:
+      socket_pointer = &telemetry_data->socket_unix;
+      break;
+    default:
+      return NULL;
+    }
+
+  if (*socket_pointer == NULL)
+    {
+      *socket_pointer =
+        g_socket_new (family, G_SOCKET_TYPE_DATAGRAM,
+                      G_SOCKET_PROTOCOL_DEFAULT, &error);
+      if (*socket_pointer == NULL)
+        {
+          g_printerr ("Unable to create telemetry socket: %s\n",
+                      error->message);
+          g_error_free (error);
+          return NULL;
+        }
+
+      /* Never wait for the network: if a datagram cannot be sent
+       * right away, it is dropped.  */
+      g_socket_set_blocking (*socket_pointer, FALSE);
+    }
+
+  return *socket_pointer;
+}
+
+/* Convert a destination, written as address:port, [IPv6 address]:port,
+ * host name:port or unix:path, into a socket address.  */
+static GSocketAddress *
+parse_destination (const gchar * text)
+{
+  gchar *host;
+  gchar *colon;
+  gchar *end_pointer;
+  gint64 port_number;
+  GSocketAddress *address;
+  GResolver *resolver;
+  GList *address_list;
+  GError *error = NULL;
+
+  if (g_str_has_prefix (text, "unix:"))
+    return g_unix_socket_address_new (text + strlen ("unix:"));
+
+  host = g_strdup (text);
+  colon = strrchr (host, ':');
+  if (colon == NULL)
+    {
+      g_printerr ("Telemetry destination %s has no port number.\n", text);
+      g_free (host);
+      return NULL;
+    }
+  *colon = '\0';
+  port_number = g_ascii_strtoll (colon + 1, &end_pointer, 10);
+  if ((*end_pointer != '\0') || (port_number <= 0) || (port_number > 65535))
+    {
+      g_printerr ("Telemetry destination %s has an invalid port number.\n",
+                  text);
+      g_free (host);
+      return NULL;
+    }
+
+  /* Remove the brackets around an IPv6 address.  */
+  if ((host[0] == '[') && (colon > host + 1) && (*(colon - 1) == ']'))
+    {
+      *(colon - 1) = '\0';
+      memmove (host, host + 1, strlen (host + 1) + 1);
+    }
+
+  address = g_inet_socket_address_new_from_string (host, port_number);
+  if (address == NULL)
+    {
+      /* It is not a numeric address, so look up the name.  This happens
+       * only at startup, so it may wait.  */
+      resolver = g_resolver_get_default ();
+      address_list =
+        g_resolver_lookup_by_name (resolver, host, NULL, &error);
+      if (address_list == NULL)
+        {
+          g_printerr ("Cannot find telemetry destination %s: %s\n", host,
+                      error->message);
+          g_error_free (error);
+        }
+      else
+        {
+          address =
+            g_inet_socket_address_new (address_list->data, port_number);
+          g_resolver_free_addresses (address_list);
+        }
+      g_object_unref (resolver);
+    }
+
+  g_free (host);
+  return address;
+}
+
+/* Send the datagram we have built to every destination, and start
+ * the next one.  */
+static void
+send_datagram (struct telemetry_info *telemetry_data)
+{
+  GList *destination_list;
+  struct telemetry_destination *destination;
+  GError *error = NULL;
+  gssize bytes_sent;
+
+  for (destination_list = telemetry_data->destinations;
+       destination_list != NULL; destination_list = destination_list->next)
+    {
+      destination = destination_list->data;
+      bytes_sent =
+        g_socket_send_to (destination->socket, destination->address,
+                          telemetry_data->datagram->str,
+                          telemetry_data->datagram->len, NULL, &error);
+      if (bytes_sent < 0)
+        {
+          /* Report only the first failure, since a controller that has
+           * gone away would otherwise fill the log.  */
+          if (telemetry_data->send_error_count == 0)
+            g_printerr ("Unable to send telemetry: %s\n", error->message);
+          telemetry_data->send_error_count =
+            telemetry_data->send_error_count + 1;
+          g_clear_error (&error);
+        }
+    }
+
+  if (TRACE_RING_ENABLED (trace_telemetry))
+    {
+      trace_ring_record (trace_telemetry, "Telemetry: %s",
+                         telemetry_data->datagram->str);
+    }
+
+  telemetry_data->datagram_count = telemetry_data->datagram_count + 1;
+  telemetry_data->last_send_time = g_get_monotonic_time ();
+
+  /* Start the next datagram.  */
+  telemetry_data->sequence_number = telemetry_data->sequence_number + 1;
+  g_string_printf (telemetry_data->datagram, "seq %" G_GUINT64_FORMAT "\n",
+                   telemetry_data->sequence_number);
+  telemetry_data->header_length = telemetry_data->datagram->len;
+
+  return;
+}
+
+/* Add a line to the datagram being built, sending it first if the
+ * line will not fit.  */
+static void
+append_line (struct telemetry_info *telemetry_data, const gchar * line,
+             gsize line_length)
+{
+  if ((telemetry_data->datagram->len + line_length + 1 >
+       TELEMETRY_DATAGRAM_SIZE)
+      && (telemetry_data->datagram->len > telemetry_data->header_length))
+    send_datagram (telemetry_data);
+
+  g_string_append_len (telemetry_data->datagram, line, line_length);
+  g_string_append_c (telemetry_data->datagram, '\n');
+  return;
+}
+
+/* Convert a level in dB to tenths of a dB, treating silence 
+ * as -100 dB.  */
+static gint
+level_in_tenths (gdouble level_dB)
+{
+  if (!(level_dB > -100.0))
+    return -1000;
+  if (level_dB > 100.0)
+    return 1000;
+  return (gint) (level_dB * 10.0 + (level_dB < 0 ? -0.5 : 0.5));
+}
+
+/* Build and send a datagram describing what has happened since the
+ * last one.  If nothing has, send only if a heartbeat is due.  */
+static void
+send_telemetry (struct telemetry_info *telemetry_data)
+{
+  gchar *line_start, *line_end;
+  gchar *line;
+  gchar elapsed_time[G_ASCII_DTOSTR_BUF_SIZE];
+  gchar remaining_time[G_ASCII_DTOSTR_BUF_SIZE];
+  GList *sound_list;
+  struct sound_info *sound_effect;
+  gint channel;
+
+  /* The events, in the order they happened.  */
+  line_start = telemetry_data->pending_events->str;
+  while (*line_start != '\0')
+    {
+      line_end = strchr (line_start, '\n');
+      append_line (telemetry_data, line_start, line_end - line_start);
+      line_start = line_end + 1;
+    }
+  g_string_truncate (telemetry_data->pending_events, 0);
+
+  /* The operator text, if it has changed.  */
+  if (telemetry_data->operator_text_changed)
+    {
+      line = g_strconcat ("operator ", telemetry_data->operator_text, NULL);
+      g_strdelimit (line, "\r\n", ' ');
+      append_line (telemetry_data, line, strlen (line));
+      g_free (line);
+      telemetry_data->operator_text_changed = FALSE;
+    }
+
+  /* The elapsed and remaining time of each sound that is playing.  */
+  for (sound_list = sep_get_sound_list (telemetry_data->app);
+       sound_list != NULL; sound_list = sound_list->next)
+    {
+      sound_effect = sound_list->data;
+      if ((!sound_effect->running) || (sound_effect->sound_control == NULL))
+        continue;
+      sound_format_time (sound_get_elapsed_time
+                         (sound_effect, telemetry_data->app), elapsed_time,
+                         G_ASCII_DTOSTR_BUF_SIZE);
+      sound_format_time (sound_get_remaining_time
+                         (sound_effect, telemetry_data->app), remaining_time,
+                         G_ASCII_DTOSTR_BUF_SIZE);
+      line = g_strdup_printf ("time %s %s %s", elapsed_time, remaining_time,
+                              sound_effect->name);
+      append_line (telemetry_data, line, strlen (line));
+      g_free (line);
+    }
+
+  /* The meter levels that have changed.  */
+  for (channel = 0; channel < telemetry_data->channel_count; channel++)
+    {
+      if ((telemetry_data->rms_level[channel] ==
+           telemetry_data->sent_rms_level[channel])
+          && (telemetry_data->peak_level[channel] ==
+              telemetry_data->sent_peak_level[channel]))
+        continue;
+      line = g_strdup_printf ("meter %d %.1f %.1f", channel,
+                              telemetry_data->rms_level[channel] / 10.0,
+                              telemetry_data->peak_level[channel] / 10.0);
+      append_line (telemetry_data, line, strlen (line));
+      g_free (line);
+      telemetry_data->sent_rms_level[channel] =
+        telemetry_data->rms_level[channel];
+      telemetry_data->sent_peak_level[channel] =
+        telemetry_data->peak_level[channel];
+    }
+
+  if ((telemetry_data->datagram->len > telemetry_data->header_length)
+      || (g_get_monotonic_time () - telemetry_data->last_send_time >=
+          TELEMETRY_HEARTBEAT_INTERVAL))
+    send_datagram (telemetry_data);
+
+  return;
+}
+
+/* The telemetry period has expired.  */
+static gboolean
+telemetry_timeout (gpointer user_data)
+{
+  struct telemetry_info *telemetry_data = user_data;
+
+  send_telemetry (telemetry_data);
+  return G_SOURCE_CONTINUE;
+}
+
+/* Remember a started, released or completed event until the next
+ * datagram is sent.  */
+static void
+record_event (const gchar * event_name, const gchar * sound_name,
+              GApplication * app)
+{
+  struct telemetry_info *telemetry_data;
+
+  telemetry_data = sep_get_telemetry_data (app);
+  if ((telemetry_data == NULL) || (telemetry_data->destinations == NULL))
+    return;
+
+  g_string_append_printf (telemetry_data->pending_events, "%s %s\n",
+                          event_name, sound_name);
+  telemetry_data->event_count = telemetry_data->event_count + 1;
+  return;
+}
+
+/* Initialize the telemetry stream.  The destinations and the rate come
+ * from the command line.  If there are no destinations, the telemetry
+ * subroutines do nothing.  */
+void *
+telemetry_init (GApplication * app)
+{
+  struct telemetry_info *telemetry_data;
+  struct telemetry_destination *destination;
+  GSocketAddress *address;
+  gchar **destination_names;
+  gint rate;
+  gint i;
+
+  telemetry_data = g_malloc0 (sizeof (struct telemetry_info));
+  telemetry_data->app = app;
+  telemetry_data->operator_text = g_strdup ("");
+  telemetry_data->pending_events = g_string_new (NULL);
+  telemetry_data->datagram = g_string_sized_new (TELEMETRY_DATAGRAM_SIZE);
+  g_string_printf (telemetry_data->datagram, "seq 0\n");
+  telemetry_data->header_length = telemetry_data->datagram->len;
+  for (i = 0; i < TELEMETRY_MAX_CHANNELS; i++)
+    {
+      telemetry_data->rms_level[i] = -1000;
+      telemetry_data->peak_level[i] = -1000;
+      telemetry_data->sent_rms_level[i] = -1000;
+      telemetry_data->sent_peak_level[i] = -1000;
+    }
+
+  destination_names = main_get_telemetry_addresses ();
+  for (i = 0; (destination_names != NULL) && (destination_names[i] != NULL);
+       i++)
+    {
+      address = parse_destination (destination_names[i]);
+      if (address == NULL)
+        continue;
+      destination = g_malloc0 (sizeof (struct telemetry_destination));
+      destination->address = address;
+      destination->socket =
+        get_socket (telemetry_data, g_socket_address_get_family (address));
+      if (destination->socket == NULL)
+        {
+          g_object_unref (address);
+          g_free (destination);
+          continue;
+        }
+      telemetry_data->destinations =
+        g_list_append (telemetry_data->destinations, destination);
+    }
+
+  if (telemetry_data->destinations == NULL)
+    return telemetry_data;
+
+  rate = main_get_telemetry_rate ();
+  if (rate <= 0)
+    rate = TELEMETRY_DEFAULT_RATE;
+  if (rate > 1000)
+    rate = 1000;
+
+  /* Tell the controllers we have started, then report at the
+   * requested rate.  */
+  send_datagram (telemetry_data);
+  telemetry_data->timeout_source_id =
+    g_timeout_add (1000 / rate, telemetry_timeout, telemetry_data);
+
+  return telemetry_data;
+}
+
+/* A sound has started.  */
+void
+telemetry_sound_started (const gchar * sound_name, GApplication * app)
+{
+  record_event ("started", sound_name, app);
+  return;
+}
+
+/* A sound has entered its release stage.  */
+void
+telemetry_sound_released (const gchar * sound_name, GApplication * app)
+{
+  record_event ("released", sound_name, app);
+  return;
+}
+
+/* A sound has completed.  */
+void
+telemetry_sound_completed (const gchar * sound_name, GApplication * app)
+{
+  record_event ("completed", sound_name, app);
+  return;
+}
+
+/* Statistics have been asked for.  */
+void
+telemetry_statistics (const gchar * text, GApplication * app)
+{
+  record_event ("stats", text, app);
+  return;
+}
+
+/* The operator text has changed.  */
+void
+telemetry_operator_text (const gchar * text, GApplication * app)
+{
+  struct telemetry_info *telemetry_data;
+
+  telemetry_data = sep_get_telemetry_data (app);
+  if ((telemetry_data == NULL) || (telemetry_data->destinations == NULL))
+    return;
+
+  if (g_strcmp0 (text, telemetry_data->operator_text) == 0)
+    return;
+
+  g_free (telemetry_data->operator_text);
+  telemetry_data->operator_text = g_strdup (text);
+  telemetry_data->operator_text_changed = TRUE;
+  return;
+}
+
+/* The level of an output channel has been measured.  Only the latest
+ * level is kept.  */
+void
+telemetry_meter_level (gint channel, gdouble rms_dB, gdouble peak_dB,
+                       GApplication * app)
+{
+  struct telemetry_info *telemetry_data;
+
+  telemetry_data = sep_get_telemetry_data (app);
+  if ((telemetry_data == NULL) || (telemetry_data->destinations == NULL))
+    return;
+
+  if ((channel < 0) || (channel >= TELEMETRY_MAX_CHANNELS))
+    return;
+
+  if (channel >= telemetry_data->channel_count)
+    telemetry_data->channel_count = channel + 1;
+  telemetry_data->rms_level[channel] = level_in_tenths (rms_dB);
+  telemetry_data->peak_level[channel] = level_in_tenths (peak_dB);
+  return;
+}
+
+/* Send anything that is pending and stop sending.  */
+void
+telemetry_shutdown (GApplication * app)
+{
+  struct telemetry_info *telemetry_data;
+  struct telemetry_destination *destination;
+  GList *destination_list;
+
+  telemetry_data = sep_get_telemetry_data (app);
+  if ((telemetry_data == NULL) || (telemetry_data->destinations == NULL))
+    return;
+
+  if (telemetry_data->timeout_source_id != 0)
+    {
+      g_source_remove (telemetry_data->timeout_source_id);
+      telemetry_data->timeout_source_id = 0;
+    }
+
+  send_telemetry (telemetry_data);
+
+  for (destination_list = telemetry_data->destinations;
+       destination_list != NULL; destination_list = destination_list->next)
+    {
+      destination = destination_list->data;
+      g_object_unref (destination->address);
+      g_free (destination);
+    }
+  g_list_free (telemetry_data->destinations);
+  telemetry_data->destinations = NULL;
+
+  if (telemetry_data->socket_IPv4 != NULL)
+    g_object_unref (telemetry_data->socket_IPv4);
+  if (telemetry_data->socket_IPv6 != NULL)
+    g_object_unref (telemetry_data->socket_IPv6);
+  if (telemetry_data->socket_unix != NULL)
+    g_object_unref (telemetry_data->socket_unix);
+  telemetry_data->socket_IPv4 = NULL;
+  telemetry_data->socket_IPv6 = NULL;
+  telemetry_data->socket_unix = NULL;
+
+  return;
+}
+
+/* Print the telemetry counters.  */
+void
+telemetry_print_statistics (GApplication * app)
+{
+  struct telemetry_info *telemetry_data;
+
+  telemetry_data = sep_get_telemetry_data (app);
+  if ((telemetry_data == NULL) || (telemetry_data->datagram_count == 0))
+    return;
+
+  g_print ("Telemetry: %" G_GUINT64_FORMAT " events in %" G_GUINT64_FORMAT
+           " datagrams, %" G_GUINT64_FORMAT " send errors.\n",
+           telemetry_data->event_count, telemetry_data->datagram_count,
+           telemetry_data->send_error_count);
+  return;
+}
@@ -0,0 +1,54 @@
+/*
+ * telemetry_subroutines.h
+ *
+ * Copyright © 2016 by John Sauter <John_Sauter@systemeyescomputerstore.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtk/gtk.h>
+
+/* Subroutines defined in telemetry_subroutines.c */
+
+/* Initialize the telemetry stream, which tells remote controllers
+ * what the player is doing.  */
+void *telemetry_init (GApplication * app);
+
+/* A sound has started.  */
+void telemetry_sound_started (const gchar * sound_name, GApplication * app);
+
+/* A sound has entered the release stage of its amplitude envelope.  */
+void telemetry_sound_released (const gchar * sound_name, GApplication * app);
+
+/* A sound has completed.  */
+void telemetry_sound_completed (const gchar * sound_name,
+                                GApplication * app);
+
+/* Send a line of statistics, in answer to a stats command.  */
+void telemetry_statistics (const gchar * text, GApplication * app);
+
+/* The text shown to the operator has changed.  */
+void telemetry_operator_text (const gchar * text, GApplication * app);
+
+/* The level of an output channel has been measured.  */
+void telemetry_meter_level (gint channel, gdouble rms_dB, gdouble peak_dB,
+                            GApplication * app);
+
+/* Send what is pending and stop sending.  */
+void telemetry_shutdown (GApplication * app);
+
+/* Print the telemetry counters.  */
+void telemetry_print_statistics (GApplication * app);
+
+/* End of file telemetry_subroutines.h */
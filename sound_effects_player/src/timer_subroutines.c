@@ -24,10 +24,7 @@
 #include <gst/gst.h>
 #include "timer_subroutines.h"
 #include "sound_effects_player.h"
-
-/* When debugging it can be useful to trace what is happening in the
- * timer.  */
-#define TRACE_TIMER FALSE
+#include "trace_ring_subroutines.h"
 
 /* the persistent data used by the timer */
 struct timer_info
@@ -35,6 +32,9 @@ struct timer_info
   gdouble last_trace_time;
   GList *timer_entry_list;      /* The list of timer items  */
   guint tick_source;
+  gboolean virtual_clock;       /* Time is set by timer_advance_virtual_clock
+                                 * rather than read from the system */
+  gdouble virtual_time;         /* The time when using the virtual clock */
 };
 
 /* an entry on the timer list */
@@ -49,6 +49,19 @@ struct timer_entry_info
 /* Forward declarations, so I can call these subroutines before I define them.  
  */
 static gboolean timer_tick (gpointer user_data);
+static void dispatch_expired_entries (struct timer_info *timer_data,
+                                      GApplication * app);
+
+/* Fetch the current time in seconds.  Normally this is the time since
+ * the last reboot, but when rendering offline it is the virtual time.  */
+static gdouble
+current_time (struct timer_info *timer_data)
+{
+  if (timer_data->virtual_clock)
+    return timer_data->virtual_time;
+
+  return g_get_monotonic_time () / 1e6;
+}
 
 /* Initialize the timer.  */
 void *
@@ -59,14 +72,15 @@ timer_init (GApplication * app)
   /* Allocate the persistent data.  */
   timer_data = g_malloc (sizeof (struct timer_info));
 
-  if (TRACE_TIMER)
-    {
-      timer_data->last_trace_time = g_get_monotonic_time () / 1e6;
-    }
+  timer_data->last_trace_time = g_get_monotonic_time () / 1e6;
 
   /* The list of timer entries is empty.  */
   timer_data->timer_entry_list = NULL;
 
+  /* Use the system clock until told otherwise.  */
+  timer_data->virtual_clock = FALSE;
+  timer_data->virtual_time = 0.0;
+
   /* Specify where to go on each tick.  */
   timer_data->tick_source = g_timeout_add (100, timer_tick, app);
 
@@ -95,8 +109,9 @@ timer_finalize (GApplication * app)
       timer_entry_list = timer_entry_next;
     }
 
-  /* Cancel the ticking source.  */
-  g_source_remove (timer_data->tick_source);
+  /* Cancel the ticking source, if it is still running.  */
+  if (timer_data->tick_source != 0)
+    g_source_remove (timer_data->tick_source);
 
   g_free (timer_data);
   timer_data = NULL;
@@ -110,20 +125,21 @@ timer_create_entry (void (*subroutine) (void *, GApplication *),
 {
   struct timer_info *timer_data;
   struct timer_entry_info *timer_entry_data;
-  gdouble current_time;
+  gdouble now;
 
   timer_data = sep_get_timer_data (app);
-  if (TRACE_TIMER)
+  if (TRACE_RING_ENABLED (trace_timer))
     {
-      g_print ("create timer entry at %p for %4.1f seconds from now.\n",
-	       subroutine, interval);
+      trace_ring_record (trace_timer, "create timer entry at %p for %4.1f "
+                         "seconds from now.",
+                         subroutine, interval);
     }
-  current_time = g_get_monotonic_time () / 1e6;
+  now = current_time (timer_data);
 
   /* Construct the timer entry.  */
   timer_entry_data = g_malloc (sizeof (struct timer_entry_info));
   timer_entry_data->subroutine = subroutine;
-  timer_entry_data->expiration_time = current_time + interval;
+  timer_entry_data->expiration_time = now + interval;
   timer_entry_data->user_data = user_data;
 
   /* Place it on the timer entry list.  We will see it on the next tick.  */
@@ -137,22 +153,33 @@ static gboolean
 timer_tick (gpointer user_data)
 {
   GApplication *app = user_data;
-  gdouble current_time;
-  GList *timer_entry_list;
-  struct timer_entry_info *timer_entry_data;
   struct timer_info *timer_data;
 
   /* Get our persistent data.  */
   timer_data = sep_get_timer_data (app);
 
-  /* Calculate the current time in seconds since the last reboot.  */
-  current_time = g_get_monotonic_time () / 1e6;
+  dispatch_expired_entries (timer_data, app);
 
-  /* Don't print the trace message oftener than once a second.  */
-  if (TRACE_TIMER && ((current_time - timer_data->last_trace_time) >= 1.0))
+  return G_SOURCE_CONTINUE;
+}
+
+/* Call the subroutines of the timer entries which have expired.  */
+static void
+dispatch_expired_entries (struct timer_info *timer_data, GApplication * app)
+{
+  gdouble now;
+  GList *timer_entry_list;
+  struct timer_entry_info *timer_entry_data;
+
+  /* Find the current time in seconds.  */
+  now = current_time (timer_data);
+
+  /* Don't record the time oftener than once a second.  */
+  if (TRACE_RING_ENABLED (trace_timer)
+      && ((now - timer_data->last_trace_time) >= 1.0))
     {
-      g_print ("current time is %f seconds.\n", current_time);
-      timer_data->last_trace_time = current_time;
+      trace_ring_record (trace_timer, "current time is %f seconds.", now);
+      timer_data->last_trace_time = now;
     }
 
   /* Check the timer entry list for expired timer entries.  For each one found,
@@ -163,14 +190,14 @@ timer_tick (gpointer user_data)
     {
       GList *timer_entry_next = timer_entry_list->next;
       timer_entry_data = timer_entry_list->data;
-      if (current_time >= timer_entry_data->expiration_time)
+      if (now >= timer_entry_data->expiration_time)
         {
           /* The timer has expired.  Call the specified subroutine with
            * its user data and the app as parameters.  */
-          if (TRACE_TIMER)
+          if (TRACE_RING_ENABLED (trace_timer))
             {
-              g_print ("timer routine called at %p.\n",
-                       timer_entry_data->subroutine);
+              trace_ring_record (trace_timer, "timer routine called at %p.",
+                                 timer_entry_data->subroutine);
             }
           (*timer_entry_data->subroutine) (timer_entry_data->user_data, app);
 
@@ -185,5 +212,68 @@ timer_tick (gpointer user_data)
       timer_entry_list = timer_entry_next;
     }
 
-  return G_SOURCE_CONTINUE;
+  return;
+}
+
+/* Stop following the system clock.  From now on time starts at zero
+ * and moves only when timer_advance_virtual_clock is called.  This is
+ * used for rendering a show offline, faster than real time.  */
+void
+timer_use_virtual_clock (GApplication * app)
+{
+  struct timer_info *timer_data;
+
+  timer_data = sep_get_timer_data (app);
+  timer_data->virtual_clock = TRUE;
+  timer_data->virtual_time = 0.0;
+  timer_data->last_trace_time = 0.0;
+
+  /* Expired entries are dispatched when the clock advances, so we no
+   * longer need to tick.  */
+  if (timer_data->tick_source != 0)
+    {
+      g_source_remove (timer_data->tick_source);
+      timer_data->tick_source = 0;
+    }
+
+  return;
+}
+
+/* Move the virtual clock forward to the specified time, in seconds,
+ * and dispatch the timer entries which have expired.  */
+void
+timer_advance_virtual_clock (gdouble new_time, GApplication * app)
+{
+  struct timer_info *timer_data;
+
+  timer_data = sep_get_timer_data (app);
+  if (new_time > timer_data->virtual_time)
+    timer_data->virtual_time = new_time;
+
+  dispatch_expired_entries (timer_data, app);
+
+  return;
+}
+
+/* Find when the next timer entry will expire, in seconds.  If there
+ * are no timer entries, return G_MAXDOUBLE.  */
+gdouble
+timer_get_next_expiration (GApplication * app)
+{
+  struct timer_info *timer_data;
+  GList *timer_entry_list;
+  struct timer_entry_info *timer_entry_data;
+  gdouble next_expiration;
+
+  timer_data = sep_get_timer_data (app);
+  next_expiration = G_MAXDOUBLE;
+  for (timer_entry_list = timer_data->timer_entry_list;
+       timer_entry_list != NULL; timer_entry_list = timer_entry_list->next)
+    {
+      timer_entry_data = timer_entry_list->data;
+      if (timer_entry_data->expiration_time < next_expiration)
+        next_expiration = timer_entry_data->expiration_time;
+    }
+
+  return next_expiration;
 }
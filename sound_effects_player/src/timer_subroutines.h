@@ -33,4 +33,13 @@ void timer_create_entry (void (*subroutine) (void *, GApplication *),
                          gdouble interval, gpointer user_data,
                          GApplication * app);
 
+/* Run the timer from a virtual clock instead of the system clock.  */
+void timer_use_virtual_clock (GApplication * app);
+
+/* Move the virtual clock forward and dispatch expired entries.  */
+void timer_advance_virtual_clock (gdouble new_time, GApplication * app);
+
+/* Find when the next entry will expire.  */
+gdouble timer_get_next_expiration (GApplication * app);
+
 /* End of file timer_subroutines.h */
@@ -0,0 +1,293 @@
+/*
+ * trace_ring_decode.c
+ *
+ * Copyright © 2016 by John Sauter <John_Sauter@systemeyescomputerstore.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include "trace_ring_subroutines.h"
+
+/* Print a dump of the trace ring buffers as text, one line per record:
+ * the time in seconds since boot, the thread, the category and the
+ * message.  The dump is written by sound_effects_player on SIGUSR1,
+ * on a "trace dump" network command and at exit.
+ * Run it with "./trace_ring_decode dump_file".  */
+
+/* Read a number in little-endian order.  */
+static gboolean
+read_guint32 (FILE * dump_file, guint32 * value)
+{
+  if (fread (value, sizeof (*value), 1, dump_file) != 1)
+    return FALSE;
+  *value = GUINT32_FROM_LE (*value);
+  return TRUE;
+}
+
+static gboolean
+read_guint64 (FILE * dump_file, guint64 * value)
+{
+  if (fread (value, sizeof (*value), 1, dump_file) != 1)
+    return FALSE;
+  *value = GUINT64_FROM_LE (*value);
+  return TRUE;
+}
+
+/* Read a string preceded by its length.  */
+static gchar *
+read_string (FILE * dump_file)
+{
+  guint32 length;
+  gchar *text;
+
+  if (!read_guint32 (dump_file, &length))
+    return NULL;
+  text = g_malloc (length + 1);
+  if (fread (text, 1, length, dump_file) != length)
+    {
+      g_free (text);
+      return NULL;
+    }
+  text[length] = '\0';
+  return text;
+}
+
+/* Read a table of strings preceded by its size.  */
+static GPtrArray *
+read_string_table (FILE * dump_file)
+{
+  GPtrArray *table;
+  guint32 count, i;
+  gchar *text;
+
+  if (!read_guint32 (dump_file, &count))
+    return NULL;
+  table = g_ptr_array_new_with_free_func (g_free);
+  for (i = 0; i < count; i++)
+    {
+      text = read_string (dump_file);
+      if (text == NULL)
+        {
+          g_ptr_array_free (table, TRUE);
+          return NULL;
+        }
+      g_ptr_array_add (table, text);
+    }
+  return table;
+}
+
+/* Format a record's message, taking the arguments in the order the
+ * format asks for them, just as trace_ring_record captured them.  */
+static void
+format_message (GString * message, const gchar * format,
+                guint64 * arguments, guint argument_count,
+                const gchar * strings, guint string_length)
+{
+  const gchar *p, *spec_start;
+  GString *spec;
+  guint argument_number;
+  guint64 value;
+  gdouble double_value;
+
+  spec = g_string_new (NULL);
+  argument_number = 0;
+  p = format;
+  while (*p != '\0')
+    {
+      if (*p != '%')
+        {
+          g_string_append_c (message, *p);
+          p++;
+          continue;
+        }
+      if (p[1] == '%')
+        {
+          g_string_append_c (message, '%');
+          p = p + 2;
+          continue;
+        }
+
+      /* Keep the flags, width and precision, but supply our own length
+       * modifier, since every argument was kept as 64 bits.  */
+      spec_start = p;
+      p++;
+      while ((*p != '\0') && (strchr ("-+ #0123456789.", *p) != NULL))
+        p++;
+      g_string_assign (spec, "");
+      g_string_append_len (spec, spec_start, p - spec_start);
+      while ((*p != '\0') && (strchr ("hlqjz", *p) != NULL))
+        p++;
+
+      /* If the argument was not captured, print the rest of the format
+       * as it stands.  */
+      if ((argument_number >= argument_count)
+          || (*p == '\0') || (strchr ("diuxXocpeEfFgGs", *p) == NULL))
+        {
+          g_string_append (message, spec_start);
+          break;
+        }
+      value = arguments[argument_number];
+      argument_number = argument_number + 1;
+
+      switch (*p)
+        {
+        case 'd':
+        case 'i':
+          g_string_append (spec, "ll");
+          g_string_append_c (spec, *p);
+          g_string_append_printf (message, spec->str,
+                                  (long long) (gint64) value);
+          break;
+
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+          g_string_append (spec, "ll");
+          g_string_append_c (spec, *p);
+          g_string_append_printf (message, spec->str,
+                                  (unsigned long long) value);
+          break;
+
+        case 'c':
+          g_string_append_c (spec, *p);
+          g_string_append_printf (message, spec->str, (int) value);
+          break;
+
+        case 'p':
+          /* The address was in the player, so print it as a number.  */
+          g_string_append_printf (message, "0x%" G_GINT64_MODIFIER "x",
+                                  value);
+          break;
+
+        case 's':
+          g_string_append_c (spec, *p);
+          g_string_append_printf (message, spec->str,
+                                  (value < string_length) ?
+                                  &strings[value] : "");
+          break;
+
+        default:
+          memcpy (&double_value, &value, sizeof (double_value));
+          g_string_append_c (spec, *p);
+          g_string_append_printf (message, spec->str, double_value);
+          break;
+        }
+      p++;
+    }
+
+  g_string_free (spec, TRUE);
+  return;
+}
+
+int
+main (int argc, char *argv[])
+{
+  FILE *dump_file;
+  gchar magic[sizeof (TRACE_RING_MAGIC) - 1];
+  guint32 version, record_count, i, j;
+  guint32 thread_number, category_number, format_number;
+  guint64 time;
+  guint8 counts[2];
+  guint64 arguments[256];
+  gchar strings[256];
+  GPtrArray *categories;
+  GPtrArray *formats;
+  GString *message;
+  const gchar *category_name;
+
+  if (argc != 2)
+    {
+      g_print ("Usage: %s dump_file\n", argv[0]);
+      return 1;
+    }
+
+  errno = 0;
+  dump_file = fopen (argv[1], "rb");
+  if (dump_file == NULL)
+    {
+      g_print ("Cannot open %s: %s.\n", argv[1], strerror (errno));
+      return 1;
+    }
+
+  if ((fread (magic, 1, sizeof (magic), dump_file) != sizeof (magic))
+      || (memcmp (magic, TRACE_RING_MAGIC, sizeof (magic)) != 0)
+      || !read_guint32 (dump_file, &version))
+    {
+      g_print ("%s is not a trace dump.\n", argv[1]);
+      return 1;
+    }
+  if (version != TRACE_RING_VERSION)
+    {
+      g_print ("%s is version %u of the trace dump format; "
+               "this decoder reads version %d.\n", argv[1], version,
+               TRACE_RING_VERSION);
+      return 1;
+    }
+
+  categories = read_string_table (dump_file);
+  formats = (categories == NULL) ? NULL : read_string_table (dump_file);
+  if ((formats == NULL) || !read_guint32 (dump_file, &record_count))
+    {
+      g_print ("%s is truncated.\n", argv[1]);
+      return 1;
+    }
+
+  message = g_string_new (NULL);
+  for (i = 0; i < record_count; i++)
+    {
+      if (!read_guint64 (dump_file, &time)
+          || !read_guint32 (dump_file, &thread_number)
+          || !read_guint32 (dump_file, &category_number)
+          || !read_guint32 (dump_file, &format_number)
+          || (fread (counts, 1, 2, dump_file) != 2))
+        break;
+      for (j = 0; j < counts[0]; j++)
+        {
+          if (!read_guint64 (dump_file, &arguments[j]))
+            break;
+        }
+      if ((j < counts[0])
+          || (fread (strings, 1, counts[1], dump_file) != counts[1])
+          || (format_number >= formats->len))
+        break;
+
+      if (category_number < categories->len)
+        category_name = g_ptr_array_index (categories, category_number);
+      else
+        category_name = "unknown";
+
+      g_string_assign (message, "");
+      format_message (message, g_ptr_array_index (formats, format_number),
+                      arguments, counts[0], strings, counts[1]);
+      g_print ("%" G_GINT64_FORMAT ".%06d [%u] %s: %s\n",
+               (gint64) time / G_USEC_PER_SEC,
+               (gint) ((gint64) time % G_USEC_PER_SEC), thread_number,
+               category_name, message->str);
+    }
+  if (i < record_count)
+    g_print ("%s is truncated after %u of %u records.\n", argv[1], i,
+             record_count);
+
+  g_string_free (message, TRUE);
+  g_ptr_array_free (formats, TRUE);
+  g_ptr_array_free (categories, TRUE);
+  fclose (dump_file);
+
+  return 0;
+}
@@ -0,0 +1,605 @@
+/*
+ * trace_ring_subroutines.c
+ *
+ * Copyright © 2016 by John Sauter <John_Sauter@systemeyescomputerstore.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <gtk/gtk.h>
+#include "main.h"
+#include "sound_effects_player.h"
+#include "trace_ring_subroutines.h"
+
+/* The trace ring buffers record what the sequencer, the timer, the
+ * message handler and the Gstreamer subroutines are doing, without
+ * rebuilding the program and without writing to the terminal, so
+ * tracing can be left on during a performance.
+ *
+ * Each thread which records a trace event has its own ring buffer,
+ * which only it writes, so recording takes no lock.  The ring buffers
+ * are allocated when the program starts, and a thread takes a free one
+ * at its first record, so a streaming thread does not allocate memory
+ * while it is tracing.  When a thread ends, its ring buffer goes back
+ * to the pool, keeping its records until another thread reuses it.
+ * A record keeps the address of its format and the values of its
+ * arguments; the text is not formatted until the dump is decoded.
+ * When a ring buffer is full the oldest records are overwritten, so
+ * a dump holds the most recent events.
+ *
+ * The categories to record are given by the --trace option or a
+ * "trace" network command.  The ring buffers are dumped to a file when
+ * the program receives SIGUSR1, on a "trace dump" network command,
+ * and at shutdown.  The dump is in the compact binary format described
+ * in trace_ring_subroutines.h; trace_ring_decode prints it as text.  */
+
+/* The number of records in each thread's ring buffer.  This must be
+ * a power of two.  */
+#define TRACE_RING_SIZE 4096
+
+/* The number of ring buffers, and so the most threads that can trace
+ * at once.  Records from further threads are counted and dropped.  */
+#define TRACE_RING_POOL_SIZE 16
+
+/* The names of the categories, in order by bit number.  */
+static const gchar *const category_names[] =
+  { "sequencer", "display", "timer", "messages", "gstreamer", "network",
+  "osc", "telemetry", "show_image", "reload", "arena", "render", "latency",
+  "realtime", "signals"
+};
+
+/* One trace record.  */
+struct trace_ring_entry
+{
+  gint64 time;                  /* monotonic time, microseconds */
+  const gchar *format;
+  guint32 thread_number;
+  guint32 category_number;
+  guint8 argument_count;
+  guint8 string_length;
+  guint64 arguments[TRACE_RING_MAX_ARGUMENTS];
+  gchar strings[TRACE_RING_STRING_SIZE];
+};
+
+/* The ring buffer of one thread.  */
+struct trace_ring
+{
+  /* Set while a thread owns the ring buffer.  */
+  gint in_use;
+
+  /* The thread number of the owning thread.  Each record also keeps
+   * it, since a ring buffer may hold records from an earlier owner.  */
+  guint32 thread_number;
+
+  /* The number of records written, modulo 2**32.  Record N is in
+   * slot N modulo TRACE_RING_SIZE.  Only the owning thread changes
+   * this, after it has filled in the record.  */
+  gint next;
+
+  /* Set once the ring buffer has wrapped, so every slot is in use.  */
+  gint full;
+  struct trace_ring_entry entries[TRACE_RING_SIZE];
+};
+
+/* the persistent data used by the trace ring buffers */
+struct trace_ring_info
+{
+  gchar *file_name;             /* where to write the dump */
+};
+
+/* Return a thread's ring buffer to the pool when the thread ends.  */
+static void
+release_thread_ring (gpointer data)
+{
+  struct trace_ring *ring = data;
+
+  g_atomic_int_set (&ring->in_use, FALSE);
+  return;
+}
+
+/* The ring buffers are reached from threads which do not know the
+ * application, so they are kept here rather than in trace_ring_info.
+ * A ring buffer outlives its thread, so its last records can still
+ * be dumped.  */
+volatile guint trace_ring_categories = 0;
+static GPrivate thread_ring = G_PRIVATE_INIT (release_thread_ring);
+static struct trace_ring *ring_pool = NULL;
+static gint thread_count = 0;
+static gint dropped_record_count = 0;
+
+/* Initialize the trace ring buffers.  */
+void *
+trace_ring_init (GApplication * app)
+{
+  struct trace_ring_info *trace_ring_data;
+  gchar *base_name;
+
+  /* Allocate the persistent data.  */
+  trace_ring_data = g_malloc (sizeof (struct trace_ring_info));
+
+  /* Allocate the ring buffers, and touch them now, so a thread does
+   * not fault them in at its first record.  */
+  ring_pool = g_malloc (TRACE_RING_POOL_SIZE * sizeof (struct trace_ring));
+  memset (ring_pool, 0, TRACE_RING_POOL_SIZE * sizeof (struct trace_ring));
+
+  /* Unless told otherwise, dump into the temporary directory, with our
+   * process ID in the name so several players do not collide.  */
+  if (main_get_trace_dump_file_name () != NULL)
+    {
+      trace_ring_data->file_name =
+        g_strdup (main_get_trace_dump_file_name ());
+    }
+  else
+    {
+      base_name =
+        g_strdup_printf ("sound_effects_player_%d.trace", (int) getpid ());
+      trace_ring_data->file_name =
+        g_build_filename (g_get_tmp_dir (), base_name, NULL);
+      g_free (base_name);
+    }
+
+  if ((main_get_trace_categories () != NULL)
+      && !trace_ring_set_categories (main_get_trace_categories ()))
+    {
+      g_print ("Unknown trace category in %s; expected all, none or "
+               "a list of sequencer, display, timer, messages, gstreamer, "
+               "network, osc, telemetry, show_image, reload, arena, "
+               "render, latency, realtime and signals.\n",
+               main_get_trace_categories ());
+    }
+
+  return (trace_ring_data);
+}
+
+/* Set the categories to record from a list of names separated by
+ * commas, or "all" or "none".  */
+gboolean
+trace_ring_set_categories (const gchar * category_names_text)
+{
+  gchar **names;
+  guint categories;
+  gint i, j;
+  gboolean found;
+
+  names = g_strsplit (category_names_text, ",", 0);
+  categories = 0;
+  for (i = 0; names[i] != NULL; i++)
+    {
+      g_strstrip (names[i]);
+      if (g_ascii_strcasecmp (names[i], "all") == 0)
+        {
+          categories = (1 << G_N_ELEMENTS (category_names)) - 1;
+          continue;
+        }
+      if ((g_ascii_strcasecmp (names[i], "none") == 0)
+          || (names[i][0] == '\0'))
+        continue;
+
+      found = FALSE;
+      for (j = 0; j < G_N_ELEMENTS (category_names); j++)
+        {
+          if (g_ascii_strcasecmp (names[i], category_names[j]) == 0)
+            {
+              categories = categories | (1 << j);
+              found = TRUE;
+              break;
+            }
+        }
+      if (!found)
+        {
+          g_strfreev (names);
+          return FALSE;
+        }
+    }
+  g_strfreev (names);
+
+  trace_ring_categories = categories;
+  return TRUE;
+}
+
+/* Find the calling thread's ring buffer, taking a free one from the
+ * pool if this is the thread's first record.  Return NULL if every
+ * ring buffer is in use.  */
+static struct trace_ring *
+get_thread_ring ()
+{
+  struct trace_ring *ring;
+  gint i;
+
+  ring = g_private_get (&thread_ring);
+  if (ring != NULL)
+    return ring;
+
+  if (ring_pool == NULL)
+    return NULL;
+
+  for (i = 0; i < TRACE_RING_POOL_SIZE; i++)
+    {
+      ring = &ring_pool[i];
+      if (g_atomic_int_compare_and_exchange (&ring->in_use, FALSE, TRUE))
+        {
+          ring->thread_number = g_atomic_int_add (&thread_count, 1);
+          g_private_set (&thread_ring, ring);
+          return ring;
+        }
+    }
+
+  return NULL;
+}
+
+/* Record a trace event on the calling thread's ring buffer.  The
+ * arguments are captured by walking the format, so only the
+ * conversions g_print would see in our trace points are understood:
+ * integers, characters, pointers, doubles and strings.  At the first
+ * conversion we do not understand we stop capturing; the decoder
+ * prints the rest of the format as it stands.  */
+void
+trace_ring_record (guint category, const gchar * format, ...)
+{
+  struct trace_ring *ring;
+  struct trace_ring_entry *entry;
+  va_list args;
+  const gchar *p;
+  const gchar *string_value;
+  gint long_count;
+  gboolean size_t_argument;
+  gdouble double_value;
+  guint64 value;
+  gsize length, offset;
+  guint index;
+
+  ring = get_thread_ring ();
+  if (ring == NULL)
+    {
+      g_atomic_int_inc (&dropped_record_count);
+      return;
+    }
+  index = (guint) ring->next;
+  entry = &ring->entries[index & (TRACE_RING_SIZE - 1)];
+  entry->time = g_get_monotonic_time ();
+  entry->format = format;
+  entry->thread_number = ring->thread_number;
+  entry->category_number = g_bit_nth_lsf (category, -1);
+  entry->argument_count = 0;
+  entry->string_length = 0;
+
+  va_start (args, format);
+  p = format;
+  while ((entry->argument_count < TRACE_RING_MAX_ARGUMENTS)
+         && ((p = strchr (p, '%')) != NULL))
+    {
+      p++;
+      if (*p == '%')
+        {
+          p++;
+          continue;
+        }
+
+      /* Skip the flags, width and precision, then count the length
+       * modifiers.  */
+      while ((*p != '\0') && (strchr ("-+ #0123456789.", *p) != NULL))
+        p++;
+      long_count = 0;
+      size_t_argument = FALSE;
+      while ((*p != '\0') && (strchr ("hlqjz", *p) != NULL))
+        {
+          if ((*p == 'l') || (*p == 'q') || (*p == 'j'))
+            long_count = long_count + ((*p == 'l') ? 1 : 2);
+          if (*p == 'z')
+            size_t_argument = TRUE;
+          p++;
+        }
+
+      switch (*p)
+        {
+        case 'd':
+        case 'i':
+          if (size_t_argument)
+            value = (guint64) va_arg (args, gssize);
+          else if (long_count >= 2)
+            value = (guint64) va_arg (args, gint64);
+          else if (long_count == 1)
+            value = (guint64) (gint64) va_arg (args, glong);
+          else
+            value = (guint64) (gint64) va_arg (args, gint);
+          break;
+
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+        case 'c':
+          if (size_t_argument)
+            value = va_arg (args, gsize);
+          else if (long_count >= 2)
+            value = va_arg (args, guint64);
+          else if (long_count == 1)
+            value = va_arg (args, gulong);
+          else
+            value = va_arg (args, guint);
+          break;
+
+        case 'p':
+          value = (guint64) (guintptr) va_arg (args, gpointer);
+          break;
+
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+          double_value = va_arg (args, gdouble);
+          memcpy (&value, &double_value, sizeof (value));
+          break;
+
+        case 's':
+          /* Copy as much of the string as fits.  If none of it fits,
+           * the offset is past the end of the string area, and the
+           * decoder prints nothing.  */
+          string_value = va_arg (args, const gchar *);
+          if (string_value == NULL)
+            string_value = "(null)";
+          offset = entry->string_length;
+          value = offset;
+          if (offset < TRACE_RING_STRING_SIZE)
+            {
+              length = strlen (string_value);
+              if (length > TRACE_RING_STRING_SIZE - 1 - offset)
+                length = TRACE_RING_STRING_SIZE - 1 - offset;
+              memcpy (&entry->strings[offset], string_value, length);
+              entry->strings[offset + length] = '\0';
+              entry->string_length = offset + length + 1;
+            }
+          break;
+
+        default:
+          /* We do not understand this conversion, so we cannot find
+           * the arguments after it.  */
+          goto formatted;
+        }
+      entry->arguments[entry->argument_count] = value;
+      entry->argument_count = entry->argument_count + 1;
+      p++;
+    }
+formatted:
+  va_end (args);
+
+  /* Publish the record.  The dump reads the count before the
+   * records.  */
+  if ((index + 1) % TRACE_RING_SIZE == 0)
+    g_atomic_int_set (&ring->full, TRUE);
+  g_atomic_int_set (&ring->next, (gint) (index + 1));
+
+  return;
+}
+
+/* Sort the dumped records by time.  */
+static gint
+compare_dump_entries (gconstpointer a, gconstpointer b)
+{
+  const struct trace_ring_entry *entry_a = a;
+  const struct trace_ring_entry *entry_b = b;
+
+  if (entry_a->time < entry_b->time)
+    return -1;
+  if (entry_a->time > entry_b->time)
+    return 1;
+  if (entry_a->thread_number < entry_b->thread_number)
+    return -1;
+  if (entry_a->thread_number > entry_b->thread_number)
+    return 1;
+  return 0;
+}
+
+/* Copy the records from one ring buffer.  Its thread may be writing
+ * while we copy, so after copying we check which slots it could have
+ * overwritten and discard what we took from them.  */
+static void
+copy_ring (struct trace_ring *ring, GArray * dump_entries)
+{
+  guint next, next_after, available, index;
+  guint first_entry, distance;
+
+  next = (guint) g_atomic_int_get (&ring->next);
+  if (g_atomic_int_get (&ring->full))
+    available = TRACE_RING_SIZE;
+  else
+    available = MIN (next, TRACE_RING_SIZE);
+
+  first_entry = dump_entries->len;
+  for (index = next - available; index != next; index++)
+    {
+      g_array_append_val (dump_entries,
+                          ring->entries[index & (TRACE_RING_SIZE - 1)]);
+    }
+
+  /* While the thread writes record N it may have overwritten record
+   * N - TRACE_RING_SIZE, so keep only the records newer than that.  */
+  next_after = (guint) g_atomic_int_get (&ring->next);
+  distance = next_after - (next - available);
+  if (distance >= TRACE_RING_SIZE)
+    {
+      g_array_remove_range (dump_entries, first_entry,
+                            MIN (distance - TRACE_RING_SIZE + 1,
+                                 available));
+    }
+
+  return;
+}
+
+/* Write a number in little-endian order.  */
+static void
+write_guint32 (guint32 value, FILE * dump_file)
+{
+  value = GUINT32_TO_LE (value);
+  fwrite (&value, sizeof (value), 1, dump_file);
+  return;
+}
+
+static void
+write_guint64 (guint64 value, FILE * dump_file)
+{
+  value = GUINT64_TO_LE (value);
+  fwrite (&value, sizeof (value), 1, dump_file);
+  return;
+}
+
+/* Write a string preceded by its length.  */
+static void
+write_string (const gchar * text, FILE * dump_file)
+{
+  write_guint32 (strlen (text), dump_file);
+  fwrite (text, 1, strlen (text), dump_file);
+  return;
+}
+
+/* Write the contents of all the ring buffers to the dump file.  */
+void
+trace_ring_dump (GApplication * app)
+{
+  struct trace_ring_info *trace_ring_data;
+  struct trace_ring_entry *dump_entry;
+  GArray *dump_entries;
+  GHashTable *format_numbers;
+  GPtrArray *formats;
+  FILE *dump_file;
+  gpointer format_number;
+  guint8 counts[2];
+  gint i, j;
+  gboolean write_error;
+
+  trace_ring_data = sep_get_trace_ring_data (app);
+  if ((trace_ring_data == NULL) || (trace_ring_data->file_name == NULL))
+    return;
+
+  /* Take the records from every ring buffer.  */
+  dump_entries = g_array_new (FALSE, FALSE, sizeof (struct trace_ring_entry));
+  for (i = 0; i < TRACE_RING_POOL_SIZE; i++)
+    copy_ring (&ring_pool[i], dump_entries);
+  g_array_sort (dump_entries, compare_dump_entries);
+
+  /* Number the formats.  */
+  format_numbers = g_hash_table_new (NULL, NULL);
+  formats = g_ptr_array_new ();
+  for (i = 0; i < dump_entries->len; i++)
+    {
+      dump_entry = &g_array_index (dump_entries, struct trace_ring_entry, i);
+      if (!g_hash_table_contains (format_numbers,
+                                  (gpointer) dump_entry->format))
+        {
+          g_hash_table_insert (format_numbers,
+                               (gpointer) dump_entry->format,
+                               GUINT_TO_POINTER (formats->len));
+          g_ptr_array_add (formats, (gpointer) dump_entry->format);
+        }
+    }
+
+  errno = 0;
+  dump_file = fopen (trace_ring_data->file_name, "wb");
+  if (dump_file == NULL)
+    {
+      g_print ("Cannot create trace dump file %s: %s.\n",
+               trace_ring_data->file_name, strerror (errno));
+    }
+  else
+    {
+      fwrite (TRACE_RING_MAGIC, 1, strlen (TRACE_RING_MAGIC), dump_file);
+      write_guint32 (TRACE_RING_VERSION, dump_file);
+
+      write_guint32 (G_N_ELEMENTS (category_names), dump_file);
+      for (i = 0; i < G_N_ELEMENTS (category_names); i++)
+        write_string (category_names[i], dump_file);
+
+      write_guint32 (formats->len, dump_file);
+      for (i = 0; i < formats->len; i++)
+        write_string (g_ptr_array_index (formats, i), dump_file);
+
+      write_guint32 (dump_entries->len, dump_file);
+      for (i = 0; i < dump_entries->len; i++)
+        {
+          dump_entry =
+            &g_array_index (dump_entries, struct trace_ring_entry, i);
+          format_number =
+            g_hash_table_lookup (format_numbers,
+                                 (gpointer) dump_entry->format);
+          write_guint64 (dump_entry->time, dump_file);
+          write_guint32 (dump_entry->thread_number, dump_file);
+          write_guint32 (dump_entry->category_number, dump_file);
+          write_guint32 (GPOINTER_TO_UINT (format_number), dump_file);
+          counts[0] = dump_entry->argument_count;
+          counts[1] = dump_entry->string_length;
+          fwrite (counts, 1, 2, dump_file);
+          for (j = 0; j < dump_entry->argument_count; j++)
+            write_guint64 (dump_entry->arguments[j], dump_file);
+          fwrite (dump_entry->strings, 1,
+                  dump_entry->string_length, dump_file);
+        }
+
+      write_error = ferror (dump_file);
+      if ((fclose (dump_file) != 0) || write_error)
+        {
+          g_print ("Error writing trace dump file %s.\n",
+                   trace_ring_data->file_name);
+        }
+      else
+        {
+          g_print ("Wrote %u trace records to %s.\n", dump_entries->len,
+                   trace_ring_data->file_name);
+        }
+    }
+  if (g_atomic_int_get (&dropped_record_count) > 0)
+    {
+      g_print ("%d trace records were dropped because more than %d "
+               "threads were tracing.\n",
+               g_atomic_int_get (&dropped_record_count),
+               TRACE_RING_POOL_SIZE);
+    }
+
+  g_ptr_array_free (formats, TRUE);
+  g_hash_table_destroy (format_numbers);
+  g_array_free (dump_entries, TRUE);
+
+  return;
+}
+
+/* Write the last dump, if anything was recorded, before we exit.  */
+void
+trace_ring_shutdown (GApplication * app)
+{
+  struct trace_ring_info *trace_ring_data;
+  gboolean anything_recorded;
+  gint i;
+
+  anything_recorded = FALSE;
+  for (i = 0; i < TRACE_RING_POOL_SIZE; i++)
+    {
+      if (g_atomic_int_get (&ring_pool[i].next) != 0)
+        anything_recorded = TRUE;
+    }
+
+  if (anything_recorded)
+    trace_ring_dump (app);
+
+  trace_ring_data = sep_get_trace_ring_data (app);
+  g_free (trace_ring_data->file_name);
+  trace_ring_data->file_name = NULL;
+
+  return;
+}
@@ -0,0 +1,104 @@
+/*
+ * trace_ring_subroutines.h
+ *
+ * Copyright © 2016 by John Sauter <John_Sauter@systemeyescomputerstore.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtk/gtk.h>
+
+/* Subroutines defined in trace_ring_subroutines.c */
+
+/* The categories of trace records.  Each is a bit, so a set of them
+ * fits in one word.  */
+enum trace_categories
+{
+  trace_sequencer = 1 << 0,
+  trace_display = 1 << 1,
+  trace_timer = 1 << 2,
+  trace_messages = 1 << 3,
+  trace_gstreamer = 1 << 4,
+  trace_network = 1 << 5,
+  trace_osc = 1 << 6,
+  trace_telemetry = 1 << 7,
+  trace_show_image = 1 << 8,
+  trace_reload = 1 << 9,
+  trace_arena = 1 << 10,
+  trace_render = 1 << 11,
+  trace_latency = 1 << 12,
+  trace_realtime = 1 << 13,
+  trace_signals = 1 << 14
+};
+
+/* The categories currently being recorded.  This is read on every
+ * trace point, so it is a variable rather than a subroutine; set it
+ * only with trace_ring_set_categories.  */
+extern volatile guint trace_ring_categories;
+
+/* Test whether a category is being recorded.  Use it around each call
+ * to trace_ring_record, so that the arguments are not evaluated when
+ * the category is off.  */
+#define TRACE_RING_ENABLED(category) \
+  ((trace_ring_categories & (category)) != 0)
+
+/* The format of a dump file.  All numbers are little-endian.
+ *
+ *   magic            8 bytes, TRACE_RING_MAGIC
+ *   version          guint32, TRACE_RING_VERSION
+ *   category count   guint32, then for each category, by bit number:
+ *                      guint32 length, then the name
+ *   format count     guint32, then for each format:
+ *                      guint32 length, then the printf format
+ *   record count     guint32, then the records in time order, each:
+ *                      gint64 time, microseconds since boot
+ *                      guint32 thread number
+ *                      guint32 category bit number
+ *                      guint32 format number
+ *                      guint8 argument count
+ *                      guint8 length of the string area
+ *                      the arguments, 8 bytes each
+ *                      the string area
+ *
+ * Integer and pointer arguments are stored as 64-bit integers and
+ * floating-point arguments as 64-bit doubles.  A string argument is
+ * the offset of its text, terminated by a NUL, in the string area.  */
+#define TRACE_RING_MAGIC "SEPTRACE"
+#define TRACE_RING_VERSION 1
+
+/* The most arguments and string bytes kept with a trace record.
+ * Arguments beyond these are dropped and strings are truncated.  */
+#define TRACE_RING_MAX_ARGUMENTS 8
+#define TRACE_RING_STRING_SIZE 64
+
+/* Initialize the trace ring buffers.  */
+void *trace_ring_init (GApplication * app);
+
+/* Set the categories to record from a list of names separated by
+ * commas, or "all" or "none".  Return FALSE if a name is not known,
+ * in which case the categories are not changed.  */
+gboolean trace_ring_set_categories (const gchar * category_names);
+
+/* Record a trace event on the calling thread's ring buffer.  The format
+ * must be a string constant, since only its address is kept.  */
+void trace_ring_record (guint category, const gchar * format, ...)
+  G_GNUC_PRINTF (2, 3);
+
+/* Write the contents of all the ring buffers to the dump file.  */
+void trace_ring_dump (GApplication * app);
+
+/* Write the last dump, if anything was recorded, before we exit.  */
+void trace_ring_shutdown (GApplication * app);
+
+/* End of file trace_ring_subroutines.h */
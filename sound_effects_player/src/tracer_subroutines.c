@@ -0,0 +1,856 @@
+/*
+ * tracer_subroutines.c
+ *
+ * Copyright © 2016 by John Sauter <John_Sauter@systemeyescomputerstore.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/* The tracer hooks were introduced as unstable API.  */
+#define GST_USE_UNSTABLE_API
+
+#include <stdio.h>
+#include <string.h>
+#include <gtk/gtk.h>
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+#include "main.h"
+#include "sound_effects_player.h"
+#include "telemetry_subroutines.h"
+#include "tracer_subroutines.h"
+
+/* The pipeline tracer measures how much time each element of the
+ * pipeline spends on each buffer, how full the queues are and how many
+ * buffers each element allocates.  It is turned on by naming a trace
+ * file in the sound_effects program section of the equipment:
+ *
+ *   <trace_file>show_trace.json</trace_file>
+ *
+ * The tracer is attached to GStreamer's tracing hooks, which are called
+ * on the streaming threads around every push and pull of data.  The
+ * time an element spends on a buffer is the time from the buffer being
+ * pushed into it until the push returns, less the time spent in the
+ * pushes it makes itself, so each element is charged only for its own
+ * work.  A buffer an element pushes which is not the one it was given,
+ * or any buffer pushed by a source, counts as allocated by it.
+ *
+ * Since the hooks run on the streaming threads we are measuring, they
+ * take no lock and allocate no memory.  Each streaming thread takes a
+ * record from a pool allocated when tracing starts, and keeps its
+ * pushes and its events there; the events of all the threads are
+ * merged when the trace is written.  An element's record is made when
+ * the element is created and attached to it, and the statistics in it
+ * are updated atomically.  The queue levels are read from the main
+ * loop, not from the streaming threads.  Elements which existed before
+ * tracing started are not traced.
+ *
+ * A summary is printed at shutdown and sent over the telemetry stream
+ * in answer to a stats command.  At shutdown the trace is also written
+ * to the trace file in the Chrome trace event format, which can be
+ * loaded into chrome://tracing or Perfetto.  */
+
+/* The number of thread records, and so the most threads that can be
+ * traced at once.  Pushes on further threads are not traced.  */
+#define TRACER_THREAD_COUNT 16
+
+/* The most events kept for the trace file by each thread.  Each is 32
+ * bytes.  Events beyond this are counted but not kept; the summary is
+ * still complete.  */
+#define TRACER_MAX_EVENTS (1 << 16)
+
+/* The deepest nesting of pushes we follow on one thread.  */
+#define TRACER_MAX_DEPTH 64
+
+/* How often to read the levels of the queues, in milliseconds.  */
+#define TRACER_LEVEL_INTERVAL 10
+
+/* What we know about an element.  These are kept until the tracer is
+ * shut down, so an event can point to one even after its element has
+ * gone.  The counts and times are changed only by atomic operations.  */
+struct tracer_element
+{
+  gchar *name;
+  GWeakRef element;
+  gboolean is_queue;
+  guint64 buffer_count;
+  guint64 total_time;           /* nanoseconds */
+  guint64 maximum_time;         /* nanoseconds */
+  guint64 allocation_count;
+  guint64 queue_level;          /* nanoseconds of data */
+  guint64 maximum_queue_level;
+};
+
+/* An event for the trace file: an element working on a buffer, or the
+ * level of a queue.  */
+struct tracer_event
+{
+  struct tracer_element *element;
+  GstClockTime time;
+  guint64 value;                /* duration or queue level, nanoseconds */
+  guint32 thread_number;
+  gboolean is_level;
+};
+
+/* A push or pull in progress on a streaming thread.  */
+struct tracer_frame
+{
+  struct tracer_element *element;       /* NULL if not an element */
+  gpointer buffer;
+  GstClockTime start;
+  GstClockTime child_time;
+};
+
+/* The pushes and pulls in progress on one thread, and its events.
+ * Only the owning thread changes these.  */
+struct tracer_thread
+{
+  /* Set while a thread owns the record.  */
+  gint in_use;
+  guint32 thread_number;
+
+  /* The pushes in progress.  The depth counts on past the end of the
+   * frames, so the pushes too deep to follow still match up.  */
+  guint depth;
+  struct tracer_frame frames[TRACER_MAX_DEPTH];
+
+  /* The events array is allocated at its full size; event_count says
+   * how many of them are filled in.  */
+  GArray *events;
+  gint event_count;
+};
+
+/* The persistent data used by the tracer.  */
+struct tracer_info
+{
+  gchar *file_name;
+  GstObject *tracer;
+
+  /* Set when the trace has been written, after which the hooks do
+   * nothing.  */
+  gint stopped;
+  gint thread_count;
+  struct tracer_thread *threads;
+  guint level_source_id;
+
+  /* The records of all the elements, old and new.  The lock guards
+   * the array; it is taken only when an element is created, when the
+   * queue levels are read and when the trace is summarized.  */
+  GMutex lock;
+  GPtrArray *elements;
+
+  guint64 dropped_event_count;
+  guint64 dropped_thread_count;
+};
+
+#if GST_CHECK_VERSION (1, 8, 0)
+
+/* The tracer object GStreamer calls.  */
+typedef struct
+{
+  GstTracer parent;
+  struct tracer_info *tracer_data;
+} SepTracer;
+
+typedef struct
+{
+  GstTracerClass parent_class;
+} SepTracerClass;
+
+G_DEFINE_TYPE (SepTracer, sep_tracer, GST_TYPE_TRACER);
+
+static void
+sep_tracer_class_init (SepTracerClass * klass)
+{
+  return;
+}
+
+static void
+sep_tracer_init (SepTracer * self)
+{
+  self->tracer_data = NULL;
+  return;
+}
+
+/* Return a thread's record to the pool when the thread ends.  */
+static void
+release_thread (gpointer data)
+{
+  struct tracer_thread *thread_data = data;
+
+  g_atomic_int_set (&thread_data->in_use, FALSE);
+  return;
+}
+
+static GPrivate thread_key = G_PRIVATE_INIT (release_thread);
+
+/* The key under which an element's record is attached to it.  */
+static GQuark element_quark = 0;
+
+/* Find the record of the current thread, taking a free one from the
+ * pool if this is the thread's first push or pull.  Its earlier
+ * events are kept.  Return NULL if every record is in use.  */
+static struct tracer_thread *
+get_thread (struct tracer_info *tracer_data)
+{
+  struct tracer_thread *thread_data;
+  gint i;
+
+  thread_data = g_private_get (&thread_key);
+  if (thread_data != NULL)
+    return thread_data;
+
+  for (i = 0; i < TRACER_THREAD_COUNT; i++)
+    {
+      thread_data = &tracer_data->threads[i];
+      if (g_atomic_int_compare_and_exchange (&thread_data->in_use, FALSE,
+                                             TRUE))
+        {
+          thread_data->thread_number =
+            g_atomic_int_add (&tracer_data->thread_count, 1) + 1;
+          thread_data->depth = 0;
+          g_private_set (&thread_key, thread_data);
+          return thread_data;
+        }
+    }
+
+  return NULL;
+}
+
+/* Find the element that owns a pad.  Bins and the proxy pads inside
+ * ghost pads only pass data along, so they are not counted.  */
+static GstElement *
+pad_element (GstPad * pad)
+{
+  GstObject *parent;
+
+  if (pad == NULL)
+    return NULL;
+  parent = GST_OBJECT_PARENT (pad);
+  if ((parent == NULL) || !GST_IS_ELEMENT (parent) || GST_IS_BIN (parent))
+    return NULL;
+  return GST_ELEMENT (parent);
+}
+
+/* Find our record of an element, or NULL if we have none.  */
+static struct tracer_element *
+find_element (GstElement * element)
+{
+  if (element == NULL)
+    return NULL;
+
+  return g_object_get_qdata (G_OBJECT (element), element_quark);
+}
+
+/* Raise a maximum to a new value, if it is larger.  */
+static void
+update_maximum (guint64 * maximum, guint64 value)
+{
+  guint64 old_value;
+
+  old_value = __atomic_load_n (maximum, __ATOMIC_RELAXED);
+  while ((value > old_value)
+         && !__atomic_compare_exchange_n (maximum, &old_value, value, TRUE,
+                                          __ATOMIC_RELAXED,
+                                          __ATOMIC_RELAXED));
+  return;
+}
+
+/* Keep an event for the trace file in the thread's record.  */
+static void
+add_event (struct tracer_info *tracer_data, struct tracer_thread *thread_data,
+           struct tracer_element *element, GstClockTime time,
+           guint64 value, gboolean is_level)
+{
+  struct tracer_event *event;
+
+  if (thread_data->event_count >= TRACER_MAX_EVENTS)
+    {
+      __atomic_fetch_add (&tracer_data->dropped_event_count, 1,
+                          __ATOMIC_RELAXED);
+      return;
+    }
+
+  event =
+    &g_array_index (thread_data->events, struct tracer_event,
+                    thread_data->event_count);
+  event->element = element;
+  event->time = time;
+  event->value = value;
+  event->thread_number = thread_data->thread_number;
+  event->is_level = is_level;
+
+  /* Publish the event only once it is filled in.  */
+  g_atomic_int_set (&thread_data->event_count,
+                    thread_data->event_count + 1);
+  return;
+}
+
+/* Data is about to move through a pad.  The element working on it is
+ * the one whose pad is pushed into, or, for a pull, the one pulled
+ * from.  For a push, note whether the pushing element allocated the
+ * buffer.  */
+static void
+enter_frame (struct tracer_info *tracer_data, GstClockTime ts,
+             GstPad * pad, gpointer buffer)
+{
+  struct tracer_thread *thread_data;
+  struct tracer_frame *frame, *top;
+  struct tracer_element *sender;
+
+  if (g_atomic_int_get (&tracer_data->stopped))
+    return;
+
+  thread_data = get_thread (tracer_data);
+  if (thread_data == NULL)
+    {
+      __atomic_fetch_add (&tracer_data->dropped_thread_count, 1,
+                          __ATOMIC_RELAXED);
+      return;
+    }
+
+  thread_data->depth = thread_data->depth + 1;
+  if (thread_data->depth > TRACER_MAX_DEPTH)
+    return;
+
+  top = NULL;
+  if (thread_data->depth > 1)
+    top = &thread_data->frames[thread_data->depth - 2];
+
+  sender = NULL;
+  if ((buffer != NULL) && (GST_PAD_DIRECTION (pad) == GST_PAD_SRC))
+    sender = find_element (pad_element (pad));
+  if ((sender != NULL)
+      && ((top == NULL) || (top->element != sender)
+          || (top->buffer != buffer)))
+    __atomic_fetch_add (&sender->allocation_count, 1, __ATOMIC_RELAXED);
+
+  frame = &thread_data->frames[thread_data->depth - 1];
+  frame->element = find_element (pad_element (GST_PAD_PEER (pad)));
+  frame->buffer = buffer;
+  frame->start = ts;
+  frame->child_time = 0;
+  return;
+}
+
+/* The push or pull has returned.  Charge the element for its time, less
+ * the time spent in the pushes it made.  */
+static void
+leave_frame (struct tracer_info *tracer_data, GstClockTime ts)
+{
+  struct tracer_thread *thread_data;
+  struct tracer_frame *frame;
+  struct tracer_element *element_data;
+  GstClockTime elapsed, own_time;
+
+  if (g_atomic_int_get (&tracer_data->stopped))
+    return;
+
+  /* If tracing started during this push, we did not see it begin.  */
+  thread_data = get_thread (tracer_data);
+  if ((thread_data == NULL) || (thread_data->depth == 0))
+    return;
+
+  thread_data->depth = thread_data->depth - 1;
+  if (thread_data->depth >= TRACER_MAX_DEPTH)
+    return;
+
+  frame = &thread_data->frames[thread_data->depth];
+  elapsed = (ts > frame->start) ? ts - frame->start : 0;
+  own_time = (elapsed > frame->child_time) ? elapsed - frame->child_time : 0;
+  if (thread_data->depth > 0)
+    thread_data->frames[thread_data->depth - 1].child_time += elapsed;
+
+  element_data = frame->element;
+  if (element_data == NULL)
+    return;
+
+  __atomic_fetch_add (&element_data->buffer_count, 1, __ATOMIC_RELAXED);
+  __atomic_fetch_add (&element_data->total_time, own_time,
+                      __ATOMIC_RELAXED);
+  update_maximum (&element_data->maximum_time, own_time);
+  add_event (tracer_data, thread_data, element_data, frame->start, elapsed,
+             FALSE);
+
+  return;
+}
+
+/* An element has been created.  Make our record of it and attach the
+ * record to it, so a later element at the same address gets a record
+ * of its own.  Creating an element allocates memory anyway, so making
+ * the record here adds no new stall to a streaming thread.  */
+static void
+element_new (GObject * self, GstClockTime ts, GstElement * element)
+{
+  struct tracer_info *tracer_data = ((SepTracer *) self)->tracer_data;
+  struct tracer_element *element_data;
+
+  if (g_atomic_int_get (&tracer_data->stopped) || GST_IS_BIN (element))
+    return;
+
+  element_data = g_new0 (struct tracer_element, 1);
+  element_data->name = g_strdup (GST_OBJECT_NAME (element));
+  g_weak_ref_init (&element_data->element, element);
+  element_data->is_queue =
+    (g_strcmp0 (G_OBJECT_TYPE_NAME (element), "GstQueue") == 0);
+
+  g_mutex_lock (&tracer_data->lock);
+  g_ptr_array_add (tracer_data->elements, element_data);
+  g_mutex_unlock (&tracer_data->lock);
+
+  /* The record outlives the element, so the element does not free it.  */
+  g_object_set_qdata (G_OBJECT (element), element_quark, element_data);
+  return;
+}
+
+/* Read the levels of the queues that still exist.  This runs from the
+ * main loop, so a streaming thread does not wait on the queue's lock
+ * or on the property machinery.  */
+static gboolean
+read_queue_levels (gpointer user_data)
+{
+  struct tracer_info *tracer_data = user_data;
+  struct tracer_thread *thread_data;
+  struct tracer_element *element_data;
+  GstElement *element;
+  guint64 level;
+  GstClockTime now;
+  guint i;
+
+  if (g_atomic_int_get (&tracer_data->stopped))
+    {
+      tracer_data->level_source_id = 0;
+      return G_SOURCE_REMOVE;
+    }
+
+  thread_data = get_thread (tracer_data);
+  now = gst_util_get_timestamp ();
+  g_mutex_lock (&tracer_data->lock);
+  for (i = 0; i < tracer_data->elements->len; i++)
+    {
+      element_data = g_ptr_array_index (tracer_data->elements, i);
+      if (!element_data->is_queue)
+        continue;
+      element = g_weak_ref_get (&element_data->element);
+      if (element == NULL)
+        continue;
+      level = 0;
+      g_object_get (element, "current-level-time", &level, NULL);
+      gst_object_unref (element);
+
+      element_data->queue_level = level;
+      if (level > element_data->maximum_queue_level)
+        element_data->maximum_queue_level = level;
+      if (thread_data != NULL)
+        add_event (tracer_data, thread_data, element_data, now, level,
+                   TRUE);
+    }
+  g_mutex_unlock (&tracer_data->lock);
+
+  return G_SOURCE_CONTINUE;
+}
+
+/* The hooks.  */
+static void
+push_pre (GObject * self, GstClockTime ts, GstPad * pad, GstBuffer * buffer)
+{
+  enter_frame (((SepTracer *) self)->tracer_data, ts, pad, buffer);
+  return;
+}
+
+static void
+push_list_pre (GObject * self, GstClockTime ts, GstPad * pad,
+               GstBufferList * list)
+{
+  enter_frame (((SepTracer *) self)->tracer_data, ts, pad, list);
+  return;
+}
+
+static void
+push_post (GObject * self, GstClockTime ts, GstPad * pad,
+           GstFlowReturn result)
+{
+  leave_frame (((SepTracer *) self)->tracer_data, ts);
+  return;
+}
+
+static void
+pull_range_pre (GObject * self, GstClockTime ts, GstPad * pad,
+                guint64 offset, guint size)
+{
+  enter_frame (((SepTracer *) self)->tracer_data, ts, pad, NULL);
+  return;
+}
+
+static void
+pull_range_post (GObject * self, GstClockTime ts, GstPad * pad,
+                 GstBuffer * buffer, GstFlowReturn result)
+{
+  leave_frame (((SepTracer *) self)->tracer_data, ts);
+  return;
+}
+
+/* Attach the tracer to GStreamer.  */
+static void
+start_tracing (struct tracer_info *tracer_data)
+{
+  SepTracer *tracer;
+  struct tracer_thread *thread_data;
+  gint i;
+
+  element_quark = g_quark_from_static_string ("sep-tracer-element");
+
+  /* Allocate the thread records and their events, and touch the events
+   * now, so a streaming thread does not fault them in.  */
+  tracer_data->threads = g_new0 (struct tracer_thread, TRACER_THREAD_COUNT);
+  for (i = 0; i < TRACER_THREAD_COUNT; i++)
+    {
+      thread_data = &tracer_data->threads[i];
+      thread_data->events =
+        g_array_sized_new (FALSE, TRUE, sizeof (struct tracer_event),
+                           TRACER_MAX_EVENTS);
+      g_array_set_size (thread_data->events, TRACER_MAX_EVENTS);
+    }
+
+  tracer = g_object_new (sep_tracer_get_type (), NULL);
+  gst_object_ref_sink (tracer);
+  tracer->tracer_data = tracer_data;
+  tracer_data->tracer = GST_OBJECT (tracer);
+
+  gst_tracing_register_hook (GST_TRACER (tracer), "element-new",
+                             G_CALLBACK (element_new));
+  gst_tracing_register_hook (GST_TRACER (tracer), "pad-push-pre",
+                             G_CALLBACK (push_pre));
+  gst_tracing_register_hook (GST_TRACER (tracer), "pad-push-post",
+                             G_CALLBACK (push_post));
+  gst_tracing_register_hook (GST_TRACER (tracer), "pad-push-list-pre",
+                             G_CALLBACK (push_list_pre));
+  gst_tracing_register_hook (GST_TRACER (tracer), "pad-push-list-post",
+                             G_CALLBACK (push_post));
+  gst_tracing_register_hook (GST_TRACER (tracer), "pad-pull-range-pre",
+                             G_CALLBACK (pull_range_pre));
+  gst_tracing_register_hook (GST_TRACER (tracer), "pad-pull-range-post",
+                             G_CALLBACK (pull_range_post));
+
+  tracer_data->level_source_id =
+    g_timeout_add (TRACER_LEVEL_INTERVAL, read_queue_levels, tracer_data);
+
+  return;
+}
+
+#else /* GStreamer before 1.8 has no tracing hooks.  */
+
+static void
+start_tracing (struct tracer_info *tracer_data)
+{
+  g_printerr ("Tracing the pipeline requires GStreamer 1.8 or later.\n");
+  return;
+}
+
+#endif
+
+/* Initialize the tracer.  */
+void *
+tracer_init (GApplication * app)
+{
+  struct tracer_info *tracer_data;
+
+  tracer_data = g_malloc0 (sizeof (struct tracer_info));
+  g_mutex_init (&tracer_data->lock);
+  tracer_data->elements = g_ptr_array_new ();
+
+  return (tracer_data);
+}
+
+/* The project has named a trace file.  Reloading the project may name
+ * it again, or another; the trace goes into the last one named.  */
+void
+tracer_set_file_name (const gchar * file_name, GApplication * app)
+{
+  struct tracer_info *tracer_data;
+
+  tracer_data = sep_get_tracer_data (app);
+  if ((tracer_data == NULL) || (file_name == NULL))
+    return;
+
+  g_free (tracer_data->file_name);
+  tracer_data->file_name = g_strdup (file_name);
+
+  /* Compiling the project only records the name in the image.  */
+  if ((tracer_data->tracer == NULL) && !main_get_compile ())
+    start_tracing (tracer_data);
+
+  return;
+}
+
+/* Fetch the name of the trace file.  */
+const gchar *
+tracer_get_file_name (GApplication * app)
+{
+  struct tracer_info *tracer_data;
+
+  tracer_data = sep_get_tracer_data (app);
+  if (tracer_data == NULL)
+    return NULL;
+
+  return tracer_data->file_name;
+}
+
+/* Order elements by the time they have taken, most first.  */
+static gint
+compare_total_time (gconstpointer a, gconstpointer b)
+{
+  const struct tracer_element *element_a = *(struct tracer_element **) a;
+  const struct tracer_element *element_b = *(struct tracer_element **) b;
+
+  guint64 time_a, time_b;
+
+  time_a = __atomic_load_n (&element_a->total_time, __ATOMIC_RELAXED);
+  time_b = __atomic_load_n (&element_b->total_time, __ATOMIC_RELAXED);
+  if (time_a > time_b)
+    return -1;
+  if (time_a < time_b)
+    return 1;
+  return 0;
+}
+
+/* Make a line of the summary for each element that has seen data.
+ * This is called with the lock held.  */
+static GPtrArray *
+summarize (struct tracer_info *tracer_data)
+{
+  struct tracer_element *element_data;
+  GPtrArray *sorted, *lines;
+  gchar *line;
+  guint64 buffer_count;
+  gdouble mean_time;
+  guint i;
+
+  sorted = g_ptr_array_new ();
+  for (i = 0; i < tracer_data->elements->len; i++)
+    g_ptr_array_add (sorted, g_ptr_array_index (tracer_data->elements, i));
+  g_ptr_array_sort (sorted, compare_total_time);
+
+  lines = g_ptr_array_new_with_free_func (g_free);
+  for (i = 0; i < sorted->len; i++)
+    {
+      element_data = g_ptr_array_index (sorted, i);
+      buffer_count =
+        __atomic_load_n (&element_data->buffer_count, __ATOMIC_RELAXED);
+      if (buffer_count > 0)
+        {
+          mean_time =
+            (gdouble) __atomic_load_n (&element_data->total_time,
+                                       __ATOMIC_RELAXED) / buffer_count;
+          line =
+            g_strdup_printf ("element %" G_GUINT64_FORMAT " %.1f %.1f %"
+                             G_GUINT64_FORMAT " %s", buffer_count,
+                             mean_time / 1000.0,
+                             (gdouble) __atomic_load_n (&element_data->
+                                                        maximum_time,
+                                                        __ATOMIC_RELAXED)
+                             / 1000.0,
+                             __atomic_load_n (&element_data->
+                                              allocation_count,
+                                              __ATOMIC_RELAXED),
+                             element_data->name);
+          g_ptr_array_add (lines, line);
+        }
+      if (element_data->is_queue)
+        {
+          line =
+            g_strdup_printf ("queue %.1f %.1f %s",
+                             (gdouble) element_data->queue_level /
+                             GST_MSECOND,
+                             (gdouble) element_data->maximum_queue_level /
+                             GST_MSECOND, element_data->name);
+          g_ptr_array_add (lines, line);
+        }
+    }
+  g_ptr_array_free (sorted, TRUE);
+
+  return lines;
+}
+
+/* Send the summary to the remote controllers, as lines of the form
+ *   element <buffers> <mean> <maximum> <allocated> <element name>
+ *   queue <level> <maximum level> <element name>
+ * with processing times in microseconds and queue levels in
+ * milliseconds.  */
+void
+tracer_send_statistics (GApplication * app)
+{
+  struct tracer_info *tracer_data;
+  GPtrArray *lines;
+  guint i;
+
+  tracer_data = sep_get_tracer_data (app);
+  if ((tracer_data == NULL) || (tracer_data->tracer == NULL))
+    return;
+
+  g_mutex_lock (&tracer_data->lock);
+  lines = summarize (tracer_data);
+  g_mutex_unlock (&tracer_data->lock);
+
+  for (i = 0; i < lines->len; i++)
+    telemetry_statistics (g_ptr_array_index (lines, i), app);
+  g_ptr_array_free (lines, TRUE);
+
+  return;
+}
+
+/* Write a string as a JSON string.  */
+static void
+write_json_string (FILE * file, const gchar * text)
+{
+  const gchar *p;
+
+  fputc ('"', file);
+  for (p = text; *p != '\0'; p++)
+    {
+      if ((*p == '"') || (*p == '\\'))
+        fprintf (file, "\\%c", *p);
+      else if ((guchar) * p < 0x20)
+        fprintf (file, "\\u%04x", (guchar) * p);
+      else
+        fputc (*p, file);
+    }
+  fputc ('"', file);
+  return;
+}
+
+/* Order events by time.  */
+static gint
+compare_event_time (gconstpointer a, gconstpointer b)
+{
+  const struct tracer_event *event_a = a;
+  const struct tracer_event *event_b = b;
+
+  if (event_a->time < event_b->time)
+    return -1;
+  if (event_a->time > event_b->time)
+    return 1;
+  return 0;
+}
+
+/* Merge the events of all the threads, in order by time.  This is
+ * called after tracing has stopped.  */
+static GArray *
+merge_events (struct tracer_info *tracer_data)
+{
+  struct tracer_thread *thread_data;
+  GArray *events;
+  gint i;
+
+  events = g_array_new (FALSE, FALSE, sizeof (struct tracer_event));
+  for (i = 0; i < TRACER_THREAD_COUNT; i++)
+    {
+      thread_data = &tracer_data->threads[i];
+      g_array_append_vals (events, thread_data->events->data,
+                           g_atomic_int_get (&thread_data->event_count));
+    }
+  g_array_sort (events, compare_event_time);
+
+  return events;
+}
+
+/* Write the trace in the Chrome trace event format.  This is called
+ * after tracing has stopped.  */
+static void
+write_trace_file (struct tracer_info *tracer_data)
+{
+  FILE *file;
+  GArray *events;
+  struct tracer_event *event;
+  guint i;
+
+  file = g_fopen (tracer_data->file_name, "w");
+  if (file == NULL)
+    {
+      g_printerr ("Cannot write trace file %s.\n", tracer_data->file_name);
+      return;
+    }
+
+  events = merge_events (tracer_data);
+  fprintf (file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+  for (i = 0; i < events->len; i++)
+    {
+      event = &g_array_index (events, struct tracer_event, i);
+      fprintf (file, "{\"name\":");
+      write_json_string (file, event->element->name);
+      if (event->is_level)
+        fprintf (file, ",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,"
+                 "\"args\":{\"level_ms\":%.3f}}",
+                 (gdouble) event->time / 1000.0, event->thread_number,
+                 (gdouble) event->value / GST_MSECOND);
+      else
+        fprintf (file, ",\"cat\":\"buffer\",\"ph\":\"X\",\"ts\":%.3f,"
+                 "\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+                 (gdouble) event->time / 1000.0,
+                 (gdouble) event->value / 1000.0, event->thread_number);
+      fprintf (file, "%s\n", (i + 1 < events->len) ? "," : "");
+    }
+  fprintf (file, "]}\n");
+  fclose (file);
+  g_array_free (events, TRUE);
+
+  return;
+}
+
+/* Stop tracing, write the trace file and print the summary.  */
+void
+tracer_shutdown (GApplication * app)
+{
+  struct tracer_info *tracer_data;
+  GPtrArray *lines;
+  guint64 dropped_count;
+  guint i;
+
+  tracer_data = sep_get_tracer_data (app);
+  if ((tracer_data == NULL) || (tracer_data->tracer == NULL)
+      || g_atomic_int_get (&tracer_data->stopped))
+    return;
+
+  /* The tracer stays registered, since the hooks cannot be removed,
+   * but from now on it ignores them.  */
+  g_atomic_int_set (&tracer_data->stopped, TRUE);
+  if (tracer_data->level_source_id != 0)
+    {
+      g_source_remove (tracer_data->level_source_id);
+      tracer_data->level_source_id = 0;
+    }
+
+  write_trace_file (tracer_data);
+  g_mutex_lock (&tracer_data->lock);
+  lines = summarize (tracer_data);
+  g_mutex_unlock (&tracer_data->lock);
+
+  g_print ("Pipeline trace written to %s", tracer_data->file_name);
+  dropped_count =
+    __atomic_load_n (&tracer_data->dropped_event_count, __ATOMIC_RELAXED);
+  if (dropped_count > 0)
+    g_print (", less %" G_GUINT64_FORMAT " events for lack of room",
+             dropped_count);
+  dropped_count =
+    __atomic_load_n (&tracer_data->dropped_thread_count, __ATOMIC_RELAXED);
+  if (dropped_count > 0)
+    g_print (", less %" G_GUINT64_FORMAT " pushes on untraced threads",
+             dropped_count);
+  g_print (".\n");
+  for (i = 0; i < lines->len; i++)
+    g_print ("  %s\n", (gchar *) g_ptr_array_index (lines, i));
+  g_ptr_array_free (lines, TRUE);
+
+  return;
+}
@@ -0,0 +1,42 @@
+/*
+ * tracer_subroutines.h
+ *
+ * Copyright © 2016 by John Sauter <John_Sauter@systemeyescomputerstore.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <gtk/gtk.h>
+
+/* Subroutines defined in tracer_subroutines.c */
+
+/* Initialize the pipeline tracer.  It does nothing until the project
+ * names a trace file.  */
+void *tracer_init (GApplication * app);
+
+/* The project has named the file to write the trace into.  Start
+ * tracing, if we have not already.  */
+void tracer_set_file_name (const gchar * file_name, GApplication * app);
+
+/* Fetch the name of the trace file, or NULL if we are not tracing.  */
+const gchar *tracer_get_file_name (GApplication * app);
+
+/* Send a summary of the trace over the telemetry stream.  */
+void tracer_send_statistics (GApplication * app);
+
+/* Stop tracing, write the trace file and print the summary.  */
+void tracer_shutdown (GApplication * app);
+
+/* End of file tracer_subroutines.h */